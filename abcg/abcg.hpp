@@ -11,9 +11,34 @@
 #define ABCG_HPP_
 
 #include "abcg_application.hpp"
+#include "abcg_asyncprogram.hpp"
+#include "abcg_batch2d.hpp"
+#include "abcg_bounds.hpp"
+#include "abcg_bvh.hpp"
+#include "abcg_dynamicresolution.hpp"
+#include "abcg_framegraph.hpp"
+#include "abcg_geometrypool.hpp"
+#include "abcg_glstatecache.hpp"
 #include "abcg_image.hpp"
+#include "abcg_impostor.hpp"
+#include "abcg_lightclusters.hpp"
+#include "abcg_occlusionculler.hpp"
 #include "abcg_openglwindow.hpp"
+#include "abcg_program.hpp"
+#include "abcg_programcache.hpp"
+#include "abcg_programvariants.hpp"
+#include "abcg_renderqueue.hpp"
+#include "abcg_shaderpreprocessor.hpp"
+#include "abcg_shadinglod.hpp"
+#include "abcg_softwarerasterizer.hpp"
+#include "abcg_staticbatch.hpp"
+#include "abcg_streambuffer.hpp"
 #include "abcg_string.hpp"
+#include "abcg_textureatlas.hpp"
+#include "abcg_texturebudget.hpp"
+#include "abcg_threadpool.hpp"
 #include "abcg_trackball.hpp"
+#include "abcg_uniformbuffer.hpp"
+#include "abcg_virtualtexture.hpp"
 
 #endif
\ No newline at end of file
@@ -0,0 +1,217 @@
+/**
+ * @file abcg_asyncprogram.cpp
+ * @brief Definition of abcg::AsyncProgram class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_asyncprogram.hpp"
+
+#include <fmt/core.h>
+
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "abcg_exception.hpp"
+
+namespace {
+void printShaderInfoLog(GLuint shader, std::string_view prefix) {
+  GLint infoLogLength{};
+  glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLogLength);
+
+  if (infoLogLength > 0) {
+    std::vector<GLchar> infoLog(static_cast<size_t>(infoLogLength));
+    glGetShaderInfoLog(shader, infoLogLength, nullptr, infoLog.data());
+    fmt::print("{} information log:\n{}\n", prefix, infoLog.data());
+  }
+}
+
+void printProgramInfoLog(GLuint program) {
+  GLint infoLogLength{};
+  glGetProgramiv(program, GL_INFO_LOG_LENGTH, &infoLogLength);
+
+  if (infoLogLength > 0) {
+    std::vector<GLchar> infoLog(static_cast<size_t>(infoLogLength));
+    glGetProgramInfoLog(program, infoLogLength, nullptr, infoLog.data());
+    fmt::print("Program information log:\n{}\n", infoLog.data());
+  }
+}
+
+GLuint createShader(GLenum type, const std::string &source) {
+  const auto shader{glCreateShader(type)};
+  const auto *sourceConstChar{source.c_str()};
+  glShaderSource(shader, 1, &sourceConstChar, nullptr);
+  glCompileShader(shader);
+  return shader;
+}
+}  // namespace
+
+/**
+ * @brief Creates a handle to a program that is not yet submitted.
+ *
+ * @param vertexShaderSource Final source code of the vertex shader.
+ * @param fragmentShaderSource Final source code of the fragment shader.
+ * @param cache Program binary cache, or `nullptr`.
+ */
+abcg::AsyncProgram::AsyncProgram(std::string vertexShaderSource,
+                                 std::string fragmentShaderSource,
+                                 ProgramCache *cache)
+    : m_state{std::make_shared<State>(
+          State{.vertexShaderSource = std::move(vertexShaderSource),
+                .fragmentShaderSource = std::move(fragmentShaderSource),
+                .cache = cache})} {}
+
+/**
+ * @brief Issues the compile and link commands of the program, if not
+ * issued yet.
+ *
+ * Programs found in the binary cache are ready immediately.
+ */
+void abcg::AsyncProgram::submit() {
+  if (!m_state || m_state->status != Status::Deferred) return;
+  auto &state{*m_state};
+
+  if (state.cache != nullptr) {
+    if (const auto program{state.cache->load(state.vertexShaderSource,
+                                             state.fragmentShaderSource)};
+        program != 0) {
+      state.programID = program;
+      state.program = Program{program};
+      state.status = Status::Ready;
+      return;
+    }
+  }
+
+  state.vertexShader = createShader(GL_VERTEX_SHADER, state.vertexShaderSource);
+  state.fragmentShader =
+      createShader(GL_FRAGMENT_SHADER, state.fragmentShaderSource);
+
+  state.programID = glCreateProgram();
+  glAttachShader(state.programID, state.vertexShader);
+  glAttachShader(state.programID, state.fragmentShader);
+  if (state.cache != nullptr && state.cache->isEnabled()) {
+    glProgramParameteri(state.programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                        GL_TRUE);
+  }
+  glLinkProgram(state.programID);
+
+  state.status = Status::Compiling;
+}
+
+/**
+ * @brief Checks whether the program can be used, submitting it if needed.
+ *
+ * Does not block if the context supports KHR_parallel_shader_compile.
+ *
+ * @throw abcg::Exception if the program failed to compile or link.
+ * @return True if the program is linked.
+ */
+bool abcg::AsyncProgram::isReady() {
+  if (!m_state) return false;
+  submit();
+
+  if (m_state->status == Status::Compiling) {
+#if !defined(__EMSCRIPTEN__)
+    if (isParallelCompileSupported()) {
+      GLint completionStatus{};
+      glGetProgramiv(m_state->programID, GL_COMPLETION_STATUS_KHR,
+                     &completionStatus);
+      if (completionStatus == GL_FALSE) return false;
+    }
+#endif
+    finish();
+  }
+  return m_state->status == Status::Ready;
+}
+
+/**
+ * @brief Returns the linked program, waiting for it if needed.
+ *
+ * @throw abcg::Exception if the program failed to compile or link.
+ */
+abcg::Program abcg::AsyncProgram::get() {
+  if (!m_state) return {};
+  submit();
+  if (m_state->status == Status::Compiling) finish();
+  return m_state->program;
+}
+
+/**
+ * @brief Releases the program and its shaders, compiled or not.
+ *
+ * The status becomes Status::Destroyed for every copy of the handle.
+ */
+void abcg::AsyncProgram::destroy() {
+  if (!m_state) return;
+  auto &state{*m_state};
+  glDeleteShader(state.vertexShader);
+  glDeleteShader(state.fragmentShader);
+  glDeleteProgram(state.programID);
+  state.vertexShader = state.fragmentShader = state.programID = 0;
+  state.program = {};
+  state.status = Status::Destroyed;
+}
+
+abcg::AsyncProgram::Status abcg::AsyncProgram::getStatus() const noexcept {
+  return m_state ? m_state->status : Status::Deferred;
+}
+
+/**
+ * @brief Returns whether the completion status of programs can be polled
+ * without blocking.
+ */
+bool abcg::AsyncProgram::isParallelCompileSupported() {
+#if defined(__EMSCRIPTEN__)
+  return false;
+#else
+  return GLEW_KHR_parallel_shader_compile;
+#endif
+}
+
+// Checks the result of the compile and link commands, which blocks until
+// they are complete
+void abcg::AsyncProgram::finish() {
+  auto &state{*m_state};
+
+  const auto fail{[&state](std::string_view message) {
+    glDeleteShader(state.vertexShader);
+    glDeleteShader(state.fragmentShader);
+    glDeleteProgram(state.programID);
+    state.vertexShader = state.fragmentShader = state.programID = 0;
+    state.status = Status::Failed;
+    throw abcg::Exception{abcg::Exception::Runtime(std::string{message})};
+  }};
+
+  GLint compileStatus{};
+  glGetShaderiv(state.vertexShader, GL_COMPILE_STATUS, &compileStatus);
+  if (compileStatus == 0) {
+    printShaderInfoLog(state.vertexShader, "Vertex shader");
+    fail("Failed to compile vertex shader");
+  }
+
+  glGetShaderiv(state.fragmentShader, GL_COMPILE_STATUS, &compileStatus);
+  if (compileStatus == 0) {
+    printShaderInfoLog(state.fragmentShader, "Fragment shader");
+    fail("Failed to compile fragment shader");
+  }
+
+  GLint linkStatus{};
+  glGetProgramiv(state.programID, GL_LINK_STATUS, &linkStatus);
+  if (linkStatus == 0) {
+    printProgramInfoLog(state.programID);
+    fail("Failed to link program");
+  }
+
+  glDeleteShader(state.fragmentShader);
+  glDeleteShader(state.vertexShader);
+  state.vertexShader = state.fragmentShader = 0;
+
+  if (state.cache != nullptr) {
+    state.cache->store(state.programID, state.vertexShaderSource,
+                       state.fragmentShaderSource);
+  }
+
+  state.program = Program{state.programID};
+  state.status = Status::Ready;
+}
@@ -0,0 +1,79 @@
+/**
+ * @file abcg_asyncprogram.hpp
+ * @brief abcg::AsyncProgram header file.
+ *
+ * Declaration of abcg::AsyncProgram class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_ASYNCPROGRAM_HPP_
+#define ABCG_ASYNCPROGRAM_HPP_
+
+#include <memory>
+#include <string>
+
+#include "abcg_openglfunctions.hpp"
+#include "abcg_program.hpp"
+#include "abcg_programcache.hpp"
+
+namespace abcg {
+class AsyncProgram;
+}  // namespace abcg
+
+/**
+ * @brief abcg::AsyncProgram class.
+ *
+ * Handle to a shader program that is compiled and linked without blocking
+ * the caller.
+ *
+ * submit() issues the compile and link commands without querying their
+ * status. isReady() polls `GL_COMPLETION_STATUS_KHR` when the context
+ * supports KHR_parallel_shader_compile, so that the driver can compile in
+ * background threads while frames are rendered with another program. Without
+ * the extension, the status queries block, and isReady() finishes the
+ * program on its first call.
+ *
+ * Programs that are never submitted are compiled on first use, i.e., on the
+ * first call to isReady() or get().
+ *
+ * Copies of the handle share the same program. The program is not owned by
+ * the handle and must be released with destroy(). A destroyed program is
+ * never compiled again: isReady() returns false and get() returns an empty
+ * program.
+ */
+class abcg::AsyncProgram {
+ public:
+  enum class Status { Deferred, Compiling, Ready, Failed, Destroyed };
+
+  AsyncProgram() = default;
+  AsyncProgram(std::string vertexShaderSource, std::string fragmentShaderSource,
+               ProgramCache* cache = nullptr);
+
+  void submit();
+  [[nodiscard]] bool isReady();
+  [[nodiscard]] Program get();
+  void destroy();
+
+  [[nodiscard]] Status getStatus() const noexcept;
+  [[nodiscard]] static bool isParallelCompileSupported();
+
+ private:
+  struct State {
+    std::string vertexShaderSource;
+    std::string fragmentShaderSource;
+    ProgramCache* cache{};
+    Status status{Status::Deferred};
+    GLuint vertexShader{};
+    GLuint fragmentShader{};
+    GLuint programID{};
+    // Created once the program is linked
+    Program program{};
+  };
+
+  std::shared_ptr<State> m_state;
+
+  void finish();
+};
+
+#endif
@@ -0,0 +1,264 @@
+/**
+ * @file abcg_batch2d.cpp
+ * @brief Definition of abcg::Batch2D class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_batch2d.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numbers>
+
+#include "abcg_exception.hpp"
+
+/**
+ * @brief Creates the stream buffer and the VAO.
+ *
+ * @param program Program used to draw the primitives.
+ * @param maxVertices Capacity of the vertex array. Each triangle uses three
+ * vertices, each point uses one, and a polygon of n sides uses 3n.
+ * @param maxVerticesPerFrame Number of vertices that can be flushed in a
+ * frame without waiting for the GPU.
+ */
+void abcg::Batch2D::initializeGL(GLuint program, std::size_t maxVertices,
+                                 std::size_t maxVerticesPerFrame) {
+  terminateGL();
+
+  m_program = program;
+  m_maxVertices = std::max<std::size_t>(maxVertices, 3);
+  m_vertices.reserve(m_maxVertices);
+
+  // Each frame uses one segment of the ring, shared by its flushes
+  const auto segmentVertices{std::max(maxVerticesPerFrame, m_maxVertices)};
+  m_streamBuffer.initializeGL(
+      GL_ARRAY_BUFFER,
+      static_cast<GLsizeiptr>(segmentVertices * sizeof(Vertex)));
+
+  glGenVertexArrays(1, &m_VAO);
+  glBindVertexArray(m_VAO);
+  glBindBuffer(GL_ARRAY_BUFFER, m_streamBuffer.getBuffer());
+
+  const GLint positionAttribute{glGetAttribLocation(program, "inPosition")};
+  if (positionAttribute >= 0) {
+    const auto location{static_cast<GLuint>(positionAttribute)};
+    glEnableVertexAttribArray(location);
+    glVertexAttribPointer(location, 2, GL_FLOAT, GL_FALSE,
+                          sizeof(Vertex), nullptr);
+  }
+
+  const GLint colorAttribute{glGetAttribLocation(program, "inColor")};
+  if (colorAttribute >= 0) {
+    const auto location{static_cast<GLuint>(colorAttribute)};
+    glEnableVertexAttribArray(location);
+    glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE,
+                          sizeof(Vertex),
+                          // NOLINTNEXTLINE(performance-no-int-to-ptr)
+                          reinterpret_cast<void *>(offsetof(Vertex, color)));
+  }
+
+  const GLint pointSizeAttribute{glGetAttribLocation(program, "inPointSize")};
+  if (pointSizeAttribute >= 0) {
+    const auto location{static_cast<GLuint>(pointSizeAttribute)};
+    glEnableVertexAttribArray(location);
+    glVertexAttribPointer(
+        location, 1, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+        // NOLINTNEXTLINE(performance-no-int-to-ptr)
+        reinterpret_cast<void *>(offsetof(Vertex, pointSize)));
+  }
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindVertexArray(0);
+}
+
+/**
+ * @brief Releases the stream buffer and the VAO.
+ *
+ * Primitives not yet flushed are discarded.
+ */
+void abcg::Batch2D::terminateGL() {
+  m_streamBuffer.terminateGL();
+  glDeleteVertexArrays(1, &m_VAO);
+  m_VAO = 0;
+  m_vertices.clear();
+  m_runs.clear();
+}
+
+/**
+ * @brief Adds a triangle of a single color.
+ */
+void abcg::Batch2D::drawTriangle(const glm::vec2 &p0, const glm::vec2 &p1,
+                                 const glm::vec2 &p2, const glm::vec4 &color) {
+  drawTriangle(p0, p1, p2, color, color, color);
+}
+
+/**
+ * @brief Adds a triangle with colors interpolated from its vertices.
+ */
+void abcg::Batch2D::drawTriangle(const glm::vec2 &p0, const glm::vec2 &p1,
+                                 const glm::vec2 &p2, const glm::vec4 &color0,
+                                 const glm::vec4 &color1,
+                                 const glm::vec4 &color2) {
+  auto *vertices{reserve(GL_TRIANGLES, 3)};
+  vertices[0] = {.position = p0, .color = color0};
+  vertices[1] = {.position = p1, .color = color1};
+  vertices[2] = {.position = p2, .color = color2};
+}
+
+/**
+ * @brief Adds a regular polygon with a radial color gradient.
+ *
+ * @param center Position of the center.
+ * @param radius Distance from the center to the vertices.
+ * @param sides Number of sides (at least 3).
+ * @param centerColor Color at the center.
+ * @param borderColor Color at the vertices.
+ */
+void abcg::Batch2D::drawPolygon(const glm::vec2 &center, float radius,
+                                int sides, const glm::vec4 &centerColor,
+                                const glm::vec4 &borderColor) {
+  sides = std::max(sides, 3);
+  const auto &unitVertices{getPolygonTemplate(sides)};
+
+  // The polygon is drawn as a fan of triangles in a triangle list, so that
+  // it can share the draw call with other primitives. Polygons with more
+  // vertices than the array holds are split across flushes.
+  const auto numSides{static_cast<std::size_t>(sides)};
+  const auto maxSides{m_maxVertices / 3};
+  for (std::size_t firstSide{}; firstSide < numSides; firstSide += maxSides) {
+    const auto lastSide{std::min(firstSide + maxSides, numSides)};
+    auto *vertices{reserve(GL_TRIANGLES, 3 * (lastSide - firstSide))};
+    for (auto side{firstSide}; side < lastSide; ++side) {
+      *vertices++ = {.position = center, .color = centerColor};
+      *vertices++ = {.position = center + radius * unitVertices[side],
+                     .color = borderColor};
+      *vertices++ = {.position = center + radius * unitVertices[side + 1],
+                     .color = borderColor};
+    }
+  }
+}
+
+/**
+ * @brief Adds a point.
+ *
+ * @param position Position of the point.
+ * @param color Color of the point.
+ * @param size Diameter of the point, in pixels. Only used if the program
+ * reads the `inPointSize` attribute.
+ */
+void abcg::Batch2D::drawPoint(const glm::vec2 &position,
+                              const glm::vec4 &color, float size) {
+  auto *vertex{reserve(GL_POINTS, 1)};
+  *vertex = {.position = position, .color = color, .pointSize = size};
+}
+
+/**
+ * @brief Draws the primitives added since the last flush.
+ *
+ * Called by endFrame(), and whenever the vertex array is full. May also be
+ * called to draw the primitives before other draw calls of the frame. The
+ * blending state and `GL_PROGRAM_POINT_SIZE` are disabled afterwards.
+ */
+void abcg::Batch2D::flush() {
+  if (m_vertices.empty()) return;
+
+  const auto size{static_cast<GLsizeiptr>(m_vertices.size() * sizeof(Vertex))};
+  // The segment of this frame is full: move on to the next one
+  if (!m_streamBuffer.canAllocate(size, sizeof(Vertex))) {
+    m_streamBuffer.endFrame();
+  }
+  const auto allocation{m_streamBuffer.allocate(size, sizeof(Vertex))};
+  std::memcpy(allocation.data, m_vertices.data(),
+              static_cast<std::size_t>(size));
+  m_streamBuffer.commit(allocation);
+  const auto base{static_cast<std::size_t>(allocation.offset) / sizeof(Vertex)};
+
+  glUseProgram(m_program);
+  glBindVertexArray(m_VAO);
+
+  for (const auto &run : m_runs) {
+    switch (run.blendMode) {
+      case BlendMode::Opaque:
+        glDisable(GL_BLEND);
+        break;
+      case BlendMode::Alpha:
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        break;
+      case BlendMode::Additive:
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+        break;
+    }
+#if !defined(__EMSCRIPTEN__)
+    // Let the vertex shader set gl_PointSize
+    if (run.mode == GL_POINTS) glEnable(GL_PROGRAM_POINT_SIZE);
+#endif
+    glDrawArrays(run.mode, static_cast<GLint>(base + run.first),
+                 static_cast<GLsizei>(run.count));
+#if !defined(__EMSCRIPTEN__)
+    if (run.mode == GL_POINTS) glDisable(GL_PROGRAM_POINT_SIZE);
+#endif
+    ++m_stats.drawCalls;
+  }
+
+  glBindVertexArray(0);
+  glUseProgram(0);
+  glDisable(GL_BLEND);
+
+  m_stats.vertices += m_vertices.size();
+  m_vertices.clear();
+  m_runs.clear();
+}
+
+/**
+ * @brief Draws the remaining primitives and finishes the frame.
+ *
+ * Must be called once per frame, after the last primitive.
+ */
+void abcg::Batch2D::endFrame() {
+  flush();
+  m_streamBuffer.endFrame();
+}
+
+// Appends count vertices with the current state, flushing first if the
+// array is full, and returns a pointer to the first of them
+abcg::Batch2D::Vertex *abcg::Batch2D::reserve(GLenum mode, std::size_t count) {
+  if (count > m_maxVertices) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Batch of {} vertices cannot hold {} vertices",
+                    m_maxVertices, count))};
+  }
+  if (m_vertices.size() + count > m_maxVertices) flush();
+
+  const auto first{m_vertices.size()};
+  if (m_runs.empty() || m_runs.back().blendMode != m_blendMode ||
+      m_runs.back().mode != mode) {
+    m_runs.push_back({.blendMode = m_blendMode, .mode = mode, .first = first});
+  }
+  m_runs.back().count += count;
+
+  m_vertices.resize(m_vertices.size() + count);
+  return m_vertices.data() + first;
+}
+
+const std::vector<glm::vec2> &abcg::Batch2D::getPolygonTemplate(int sides) {
+  auto [iter, inserted]{m_polygonTemplates.try_emplace(sides)};
+  auto &unitVertices{iter->second};
+  if (inserted) {
+    // The first vertex is repeated at the end to close the polygon
+    unitVertices.resize(static_cast<std::size_t>(sides) + 1);
+    const auto step{2.0f * std::numbers::pi_v<float> /
+                    static_cast<float>(sides)};
+    for (std::size_t side{}; side < unitVertices.size() - 1; ++side) {
+      const auto angle{step * static_cast<float>(side)};
+      unitVertices[side] = {std::cos(angle), std::sin(angle)};
+    }
+    unitVertices.back() = unitVertices.front();
+  }
+  return unitVertices;
+}
@@ -0,0 +1,105 @@
+/**
+ * @file abcg_batch2d.hpp
+ * @brief abcg::Batch2D header file.
+ *
+ * Declaration of abcg::Batch2D class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_BATCH2D_HPP_
+#define ABCG_BATCH2D_HPP_
+
+#include <cstddef>
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+#include <unordered_map>
+#include <vector>
+
+#include "abcg_streambuffer.hpp"
+
+namespace abcg {
+class Batch2D;
+}  // namespace abcg
+
+/**
+ * @brief abcg::Batch2D class.
+ *
+ * Immediate-mode renderer of 2D triangles, regular polygons and points.
+ *
+ * The draw functions only append vertices to an array in CPU memory.
+ * flush() copies the array to a stream buffer in one allocation and draws
+ * it with one `glDrawArrays` call per run of primitives with the same type
+ * and blend mode. The array is also flushed when it reaches its capacity.
+ *
+ * The flushes of a frame share one segment of the stream buffer. The owner
+ * calls endFrame() once per frame, after the last primitive, to move to the
+ * next segment. Only frames with more vertices than the segment holds
+ * move on earlier, which may wait for the GPU.
+ *
+ * The program given to initializeGL() reads the attributes `inPosition`
+ * (vec2, in normalized device coordinates unless the program transforms
+ * it), `inColor` (vec4) and, optionally, `inPointSize` (float).
+ */
+class abcg::Batch2D {
+ public:
+  enum class BlendMode { Opaque, Alpha, Additive };
+
+  struct Vertex {
+    glm::vec2 position{};
+    glm::vec4 color{};
+    float pointSize{};
+  };
+
+  struct Stats {
+    std::size_t vertices{};
+    std::size_t drawCalls{};
+  };
+
+  void initializeGL(GLuint program, std::size_t maxVertices = 1 << 16,
+                    std::size_t maxVerticesPerFrame = 1 << 18);
+  void terminateGL();
+
+  void setBlendMode(BlendMode blendMode) noexcept { m_blendMode = blendMode; }
+  void drawTriangle(const glm::vec2& p0, const glm::vec2& p1,
+                    const glm::vec2& p2, const glm::vec4& color);
+  void drawTriangle(const glm::vec2& p0, const glm::vec2& p1,
+                    const glm::vec2& p2, const glm::vec4& color0,
+                    const glm::vec4& color1, const glm::vec4& color2);
+  void drawPolygon(const glm::vec2& center, float radius, int sides,
+                   const glm::vec4& centerColor, const glm::vec4& borderColor);
+  void drawPoint(const glm::vec2& position, const glm::vec4& color,
+                 float size = 1.0f);
+  void flush();
+  void endFrame();
+
+  [[nodiscard]] Stats getStats() const noexcept { return m_stats; }
+  void resetStats() noexcept { m_stats = {}; }
+
+ private:
+  // Consecutive vertices drawn with the same state
+  struct Run {
+    BlendMode blendMode{};
+    GLenum mode{};
+    std::size_t first{};
+    std::size_t count{};
+  };
+
+  GLuint m_program{};
+  GLuint m_VAO{};
+  StreamBuffer m_streamBuffer;
+
+  std::size_t m_maxVertices{};
+  std::vector<Vertex> m_vertices;
+  std::vector<Run> m_runs;
+  BlendMode m_blendMode{BlendMode::Opaque};
+  Stats m_stats{};
+
+  // Unit circle vertices of the polygons drawn so far, by number of sides
+  std::unordered_map<int, std::vector<glm::vec2>> m_polygonTemplates;
+
+  [[nodiscard]] Vertex* reserve(GLenum mode, std::size_t count);
+  [[nodiscard]] const std::vector<glm::vec2>& getPolygonTemplate(int sides);
+};
+
+#endif
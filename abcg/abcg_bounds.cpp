@@ -0,0 +1,191 @@
+/**
+ * @file abcg_bounds.cpp
+ * @brief Definition of bounding volume functions and abcg::Frustum members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_bounds.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/geometric.hpp>
+#include <limits>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define ABCG_BOUNDS_SSE
+#endif
+
+namespace {
+#if defined(ABCG_BOUNDS_SSE)
+// Loads x, y, z into the first three lanes of a register
+__m128 loadPosition(const float *position) {
+  return _mm_setr_ps(position[0], position[1], position[2], 0.0f);
+}
+#endif
+
+// Advances a pointer to the position of the next vertex
+const float *next(const float *position, std::size_t stride) {
+  return reinterpret_cast<const float *>(
+      reinterpret_cast<const unsigned char *>(position) + stride);
+}
+}  // namespace
+
+/**
+ * @brief Computes the bounding box and sphere of a set of points.
+ *
+ * Each point is processed as a single 4-wide register with SSE when
+ * available. The sphere is centered on the box and encloses every point.
+ *
+ * @param positions Pointer to the x coordinate of the first point, followed
+ * by y and z.
+ * @param count Number of points.
+ * @param stride Distance in bytes between consecutive points, e.g.,
+ * `sizeof(Vertex)`.
+ * @return Bounds of the points, or empty bounds at the origin if there are
+ * no points.
+ */
+abcg::Bounds abcg::computeBounds(const float *positions, std::size_t count,
+                                 std::size_t stride) {
+  if (count == 0 || positions == nullptr) return {};
+
+  Bounds bounds;
+  auto maxDistanceSquared{0.0f};
+
+#if defined(ABCG_BOUNDS_SSE)
+  auto min{_mm_set1_ps(std::numeric_limits<float>::max())};
+  auto max{_mm_set1_ps(std::numeric_limits<float>::lowest())};
+  auto *position{positions};
+  for (std::size_t index{}; index < count; ++index) {
+    const auto point{loadPosition(position)};
+    min = _mm_min_ps(min, point);
+    max = _mm_max_ps(max, point);
+    position = next(position, stride);
+  }
+
+  alignas(16) std::array<float, 4> minValues{};
+  alignas(16) std::array<float, 4> maxValues{};
+  _mm_store_ps(minValues.data(), min);
+  _mm_store_ps(maxValues.data(), max);
+  bounds.box = {.min = {minValues[0], minValues[1], minValues[2]},
+                .max = {maxValues[0], maxValues[1], maxValues[2]}};
+
+  const auto center{_mm_mul_ps(_mm_add_ps(min, max), _mm_set1_ps(0.5f))};
+  auto maxSquared{_mm_setzero_ps()};
+  position = positions;
+  for (std::size_t index{}; index < count; ++index) {
+    const auto offset{_mm_sub_ps(loadPosition(position), center)};
+    const auto squared{_mm_mul_ps(offset, offset)};
+    // Horizontal sum of x, y, z in the first lane (the fourth lane is zero)
+    const auto sum{_mm_add_ps(squared, _mm_movehl_ps(squared, squared))};
+    const auto length{
+        _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 1, 1, 1)))};
+    maxSquared = _mm_max_ss(maxSquared, length);
+    position = next(position, stride);
+  }
+  maxDistanceSquared = _mm_cvtss_f32(maxSquared);
+#else
+  glm::vec3 min{std::numeric_limits<float>::max()};
+  glm::vec3 max{std::numeric_limits<float>::lowest()};
+  auto *position{positions};
+  for (std::size_t index{}; index < count; ++index) {
+    const glm::vec3 point{position[0], position[1], position[2]};
+    min = glm::min(min, point);
+    max = glm::max(max, point);
+    position = next(position, stride);
+  }
+  bounds.box = {.min = min, .max = max};
+
+  const auto center{bounds.box.getCenter()};
+  position = positions;
+  for (std::size_t index{}; index < count; ++index) {
+    const auto offset{glm::vec3{position[0], position[1], position[2]} -
+                      center};
+    maxDistanceSquared = std::max(maxDistanceSquared, glm::dot(offset, offset));
+    position = next(position, stride);
+  }
+#endif
+
+  bounds.sphere = {.center = bounds.box.getCenter(),
+                   .radius = std::sqrt(maxDistanceSquared)};
+  return bounds;
+}
+
+/**
+ * @brief Extracts the planes of the frustum of a clip space transformation.
+ *
+ * @param clipMatrix Transformation to clip space, e.g., the projection
+ * matrix times the view matrix. If a model matrix is included, the planes
+ * are in the space of that model.
+ */
+abcg::Frustum::Frustum(const glm::mat4 &clipMatrix) {
+  // Rows of the matrix (glm matrices are column-major)
+  std::array<glm::vec4, 4> rows{};
+  for (auto row{0}; row < 4; ++row) {
+    rows.at(static_cast<std::size_t>(row)) = {
+        clipMatrix[0][row], clipMatrix[1][row], clipMatrix[2][row],
+        clipMatrix[3][row]};
+  }
+
+  // Left, right, bottom, top, near, far
+  m_planes = {rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1],
+              rows[3] - rows[1], rows[3] + rows[2], rows[3] - rows[2]};
+  for (auto &plane : m_planes) {
+    plane /= glm::length(glm::vec3{plane});
+  }
+}
+
+/**
+ * @brief Tests whether a box is at least partially inside the frustum.
+ *
+ * @param box Box to test.
+ * @param planeMask Mask of the planes to test. On return, the planes that
+ * contain the box entirely are cleared.
+ * @param lastRejectingPlane Plane tested first. On return, the plane that
+ * rejected the box, if any.
+ * @return False if the box is outside the frustum.
+ */
+bool abcg::Frustum::testAABB(const AABB &box, std::uint8_t &planeMask,
+                             std::uint8_t &lastRejectingPlane) const {
+  const auto center{box.getCenter()};
+  const auto extents{box.getExtents()};
+
+  const auto testPlane{[&](std::uint8_t index) {
+    const auto &plane{m_planes.at(index)};
+    const glm::vec3 normal{plane};
+    const auto distance{glm::dot(normal, center) + plane.w};
+    const auto radius{glm::dot(extents, glm::abs(normal))};
+    if (distance + radius < 0.0f) return false;
+    if (distance - radius >= 0.0f) {
+      planeMask &= static_cast<std::uint8_t>(~(1U << index));
+    }
+    return true;
+  }};
+
+  // Test the plane that rejected the box last time first, since it is
+  // likely to reject it again
+  const auto first{lastRejectingPlane};
+  if ((planeMask & (1U << first)) != 0 && !testPlane(first)) return false;
+
+  for (std::uint8_t index{}; index < m_planes.size(); ++index) {
+    if (index == first || (planeMask & (1U << index)) == 0) continue;
+    if (!testPlane(index)) {
+      lastRejectingPlane = index;
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Tests whether a sphere is at least partially inside the frustum.
+ */
+bool abcg::Frustum::intersects(const BoundingSphere &sphere) const {
+  for (const auto &plane : m_planes) {
+    if (glm::dot(glm::vec3{plane}, sphere.center) + plane.w < -sphere.radius) {
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,106 @@
+/**
+ * @file abcg_bounds.hpp
+ * @brief Bounding volumes and view frustum.
+ *
+ * Declaration of abcg::AABB, abcg::BoundingSphere and abcg::Frustum.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_BOUNDS_HPP_
+#define ABCG_BOUNDS_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <glm/common.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+namespace abcg {
+struct AABB;
+struct BoundingSphere;
+struct Bounds;
+class Frustum;
+
+[[nodiscard]] Bounds computeBounds(const float* positions, std::size_t count,
+                                   std::size_t stride);
+}  // namespace abcg
+
+/**
+ * @brief Axis-aligned bounding box.
+ */
+struct abcg::AABB {
+  glm::vec3 min{};
+  glm::vec3 max{};
+
+  [[nodiscard]] glm::vec3 getCenter() const noexcept {
+    return (min + max) * 0.5f;
+  }
+  [[nodiscard]] glm::vec3 getExtents() const noexcept {
+    return (max - min) * 0.5f;
+  }
+  // Half the surface area, used as the cost of a node of abcg::BVH
+  [[nodiscard]] float getPerimeter() const noexcept {
+    const auto size{max - min};
+    return size.x * size.y + size.y * size.z + size.z * size.x;
+  }
+  [[nodiscard]] bool contains(const AABB& other) const noexcept {
+    return min.x <= other.min.x && min.y <= other.min.y &&
+           min.z <= other.min.z && other.max.x <= max.x &&
+           other.max.y <= max.y && other.max.z <= max.z;
+  }
+  [[nodiscard]] AABB merge(const AABB& other) const noexcept {
+    return {.min = glm::min(min, other.min), .max = glm::max(max, other.max)};
+  }
+};
+
+/**
+ * @brief Bounding sphere.
+ */
+struct abcg::BoundingSphere {
+  glm::vec3 center{};
+  float radius{};
+
+  [[nodiscard]] AABB getAABB() const noexcept {
+    return {.min = center - radius, .max = center + radius};
+  }
+};
+
+/**
+ * @brief Bounding box and sphere of a mesh.
+ */
+struct abcg::Bounds {
+  AABB box;
+  BoundingSphere sphere;
+};
+
+/**
+ * @brief abcg::Frustum class.
+ *
+ * The six planes of a view frustum, extracted from a clip space
+ * transformation, pointing inwards.
+ *
+ * Box tests take a mask of the planes that still have to be tested. Planes
+ * that contain the box entirely are cleared from the mask, so that the
+ * children of a node of a hierarchy skip them. The plane that rejected a
+ * box is returned so that it is tested first in the next frame.
+ */
+class abcg::Frustum {
+ public:
+  // Mask of the six planes
+  static constexpr std::uint8_t allPlanes{0x3F};
+
+  Frustum() = default;
+  explicit Frustum(const glm::mat4& clipMatrix);
+
+  [[nodiscard]] bool testAABB(const AABB& box, std::uint8_t& planeMask,
+                              std::uint8_t& lastRejectingPlane) const;
+  [[nodiscard]] bool intersects(const BoundingSphere& sphere) const;
+
+ private:
+  std::array<glm::vec4, 6> m_planes{};
+};
+
+#endif
@@ -0,0 +1,314 @@
+/**
+ * @file abcg_bvh.cpp
+ * @brief Definition of abcg::BVH class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_bvh.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+
+/**
+ * @brief Adds an object to the tree.
+ *
+ * @param box Bounding box of the object.
+ * @param userData Value returned by cull() if the object is visible, e.g.,
+ * the index of the object.
+ * @return Handle to the object.
+ */
+abcg::BVH::Handle abcg::BVH::insert(const AABB &box, std::uint32_t userData) {
+  const auto leaf{allocateNode()};
+  auto &node{getNode(leaf)};
+  node.box = {.min = box.min - m_margin, .max = box.max + m_margin};
+  node.userData = userData;
+  node.height = 0;
+  insertLeaf(leaf);
+  ++m_numObjects;
+  return leaf;
+}
+
+/**
+ * @brief Removes an object from the tree.
+ *
+ * @param handle Handle returned by insert().
+ */
+void abcg::BVH::remove(Handle handle) {
+  removeLeaf(handle);
+  freeNode(handle);
+  --m_numObjects;
+}
+
+/**
+ * @brief Updates the bounding box of an object.
+ *
+ * The object is reinserted only if the box is no longer inside the
+ * enlarged box of the leaf.
+ *
+ * @param handle Handle returned by insert().
+ * @param box New bounding box of the object.
+ * @return True if the object was reinserted.
+ */
+bool abcg::BVH::update(Handle handle, const AABB &box) {
+  if (getNode(handle).box.contains(box)) return false;
+
+  removeLeaf(handle);
+  getNode(handle).box = {.min = box.min - m_margin, .max = box.max + m_margin};
+  insertLeaf(handle);
+  return true;
+}
+
+/**
+ * @brief Removes every object.
+ */
+void abcg::BVH::clear() {
+  m_nodes.clear();
+  m_root = m_freeList = nullHandle;
+  m_numObjects = 0;
+}
+
+/**
+ * @brief Finds the objects whose boxes intersect a view frustum.
+ *
+ * @param frustum View frustum in the space of the boxes.
+ * @param visible User data of the visible objects. Cleared before the
+ * traversal.
+ */
+void abcg::BVH::cull(const Frustum &frustum,
+                     std::vector<std::uint32_t> &visible) {
+  visible.clear();
+  m_stats = {};
+
+  if (m_root != nullHandle) {
+    m_stack.clear();
+    m_stack.emplace_back(m_root, Frustum::allPlanes);
+    while (!m_stack.empty()) {
+      auto [handle, planeMask]{m_stack.back()};
+      m_stack.pop_back();
+
+      auto &node{getNode(handle)};
+      ++m_stats.nodesTested;
+      if (!frustum.testAABB(node.box, planeMask, node.lastRejectingPlane)) {
+        continue;
+      }
+
+      // Nothing else to test if the node is entirely inside
+      if (planeMask == 0) {
+        addSubtree(handle, visible);
+      } else if (node.isLeaf()) {
+        visible.push_back(node.userData);
+      } else {
+        m_stack.emplace_back(node.child1, planeMask);
+        m_stack.emplace_back(node.child2, planeMask);
+      }
+    }
+  }
+
+  m_stats.visible = visible.size();
+  m_stats.culled = m_numObjects - visible.size();
+}
+
+/**
+ * @brief Returns the height of the tree (0 for a single object).
+ */
+int abcg::BVH::getHeight() const noexcept {
+  return m_root == nullHandle ? 0 : getNode(m_root).height;
+}
+
+abcg::BVH::Handle abcg::BVH::allocateNode() {
+  if (m_freeList == nullHandle) {
+    m_nodes.emplace_back();
+    return static_cast<Handle>(m_nodes.size() - 1);
+  }
+  const auto handle{m_freeList};
+  m_freeList = getNode(handle).parent;
+  getNode(handle) = {};
+  return handle;
+}
+
+void abcg::BVH::freeNode(Handle handle) {
+  auto &node{getNode(handle)};
+  node.parent = m_freeList;
+  node.height = -1;
+  m_freeList = handle;
+}
+
+void abcg::BVH::insertLeaf(Handle leaf) {
+  if (m_root == nullHandle) {
+    m_root = leaf;
+    getNode(leaf).parent = nullHandle;
+    return;
+  }
+
+  // Descend to the sibling that minimizes the increase in surface area
+  const auto leafBox{getNode(leaf).box};
+  auto sibling{m_root};
+  while (!getNode(sibling).isLeaf()) {
+    const auto &node{getNode(sibling)};
+    const auto area{node.box.getPerimeter()};
+    const auto combinedArea{node.box.merge(leafBox).getPerimeter()};
+
+    // Cost of making a new parent for this node and the leaf, and minimum
+    // cost of pushing the leaf further down
+    const auto cost{2.0f * combinedArea};
+    const auto inheritanceCost{2.0f * (combinedArea - area)};
+
+    const auto childCost{[&](Handle child) {
+      const auto &childBox{getNode(child).box};
+      const auto newArea{childBox.merge(leafBox).getPerimeter()};
+      if (getNode(child).isLeaf()) return newArea + inheritanceCost;
+      return newArea - childBox.getPerimeter() + inheritanceCost;
+    }};
+    const auto cost1{childCost(node.child1)};
+    const auto cost2{childCost(node.child2)};
+
+    if (cost < cost1 && cost < cost2) break;
+    sibling = cost1 < cost2 ? node.child1 : node.child2;
+  }
+
+  // Create a new parent for the sibling and the leaf
+  const auto oldParent{getNode(sibling).parent};
+  const auto newParent{allocateNode()};
+  {
+    auto &node{getNode(newParent)};
+    node.parent = oldParent;
+    node.box = leafBox.merge(getNode(sibling).box);
+    node.height = getNode(sibling).height + 1;
+    node.child1 = sibling;
+    node.child2 = leaf;
+  }
+  if (oldParent == nullHandle) {
+    m_root = newParent;
+  } else if (getNode(oldParent).child1 == sibling) {
+    getNode(oldParent).child1 = newParent;
+  } else {
+    getNode(oldParent).child2 = newParent;
+  }
+  getNode(sibling).parent = newParent;
+  getNode(leaf).parent = newParent;
+
+  fixUpwards(getNode(leaf).parent);
+}
+
+void abcg::BVH::removeLeaf(Handle leaf) {
+  if (leaf == m_root) {
+    m_root = nullHandle;
+    return;
+  }
+
+  // Replace the parent with the sibling
+  const auto parent{getNode(leaf).parent};
+  const auto grandParent{getNode(parent).parent};
+  const auto sibling{getNode(parent).child1 == leaf
+                         ? getNode(parent).child2
+                         : getNode(parent).child1};
+
+  if (grandParent == nullHandle) {
+    m_root = sibling;
+    getNode(sibling).parent = nullHandle;
+    freeNode(parent);
+    return;
+  }
+
+  if (getNode(grandParent).child1 == parent) {
+    getNode(grandParent).child1 = sibling;
+  } else {
+    getNode(grandParent).child2 = sibling;
+  }
+  getNode(sibling).parent = grandParent;
+  freeNode(parent);
+
+  fixUpwards(grandParent);
+}
+
+// Refits the boxes and heights from a node to the root, balancing the tree
+void abcg::BVH::fixUpwards(Handle handle) {
+  while (handle != nullHandle) {
+    handle = balance(handle);
+
+    auto &node{getNode(handle)};
+    const auto &child1{getNode(node.child1)};
+    const auto &child2{getNode(node.child2)};
+    node.height = 1 + std::max(child1.height, child2.height);
+    node.box = child1.box.merge(child2.box);
+
+    handle = node.parent;
+  }
+}
+
+// Rotates the tree if the subtrees of a node differ in height by more than
+// one. Returns the node that took the place of the given one.
+abcg::BVH::Handle abcg::BVH::balance(Handle handleA) {
+  auto &nodeA{getNode(handleA)};
+  if (nodeA.isLeaf() || nodeA.height < 2) return handleA;
+
+  const auto handleB{nodeA.child1};
+  const auto handleC{nodeA.child2};
+  const auto heightDifference{getNode(handleC).height -
+                              getNode(handleB).height};
+  if (std::abs(heightDifference) <= 1) return handleA;
+
+  // The taller child goes up and takes the place of A
+  const auto handleUp{heightDifference > 0 ? handleC : handleB};
+  const auto handleOther{heightDifference > 0 ? handleB : handleC};
+  auto &nodeUp{getNode(handleUp)};
+  const auto handleF{nodeUp.child1};
+  const auto handleG{nodeUp.child2};
+
+  // Swap A and the taller child
+  nodeUp.child1 = handleA;
+  nodeUp.parent = nodeA.parent;
+  nodeA.parent = handleUp;
+
+  if (nodeUp.parent == nullHandle) {
+    m_root = handleUp;
+  } else if (getNode(nodeUp.parent).child1 == handleA) {
+    getNode(nodeUp.parent).child1 = handleUp;
+  } else {
+    getNode(nodeUp.parent).child2 = handleUp;
+  }
+
+  // The taller grandchild stays under the node that went up, and the other
+  // one replaces it under A
+  auto &nodeF{getNode(handleF)};
+  auto &nodeG{getNode(handleG)};
+  const auto &nodeOther{getNode(handleOther)};
+  const auto [handleKeep, handleMove]{nodeF.height > nodeG.height
+                                          ? std::pair{handleF, handleG}
+                                          : std::pair{handleG, handleF}};
+  nodeUp.child2 = handleKeep;
+  if (heightDifference > 0) {
+    nodeA.child2 = handleMove;
+  } else {
+    nodeA.child1 = handleMove;
+  }
+  getNode(handleMove).parent = handleA;
+
+  const auto &nodeMove{getNode(handleMove)};
+  const auto &nodeKeep{getNode(handleKeep)};
+  nodeA.box = nodeOther.box.merge(nodeMove.box);
+  nodeA.height = 1 + std::max(nodeOther.height, nodeMove.height);
+  nodeUp.box = nodeA.box.merge(nodeKeep.box);
+  nodeUp.height = 1 + std::max(nodeA.height, nodeKeep.height);
+
+  return handleUp;
+}
+
+// Adds every object of a subtree that is entirely inside the frustum
+void abcg::BVH::addSubtree(Handle handle, std::vector<std::uint32_t> &visible) {
+  const auto first{m_stack.size()};
+  m_stack.emplace_back(handle, 0);
+  while (m_stack.size() > first) {
+    const auto current{m_stack.back().first};
+    m_stack.pop_back();
+    const auto &node{getNode(current)};
+    if (node.isLeaf()) {
+      visible.push_back(node.userData);
+    } else {
+      m_stack.emplace_back(node.child1, 0);
+      m_stack.emplace_back(node.child2, 0);
+    }
+  }
+}
@@ -0,0 +1,107 @@
+/**
+ * @file abcg_bvh.hpp
+ * @brief abcg::BVH header file.
+ *
+ * Declaration of abcg::BVH class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_BVH_HPP_
+#define ABCG_BVH_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "abcg_bounds.hpp"
+
+namespace abcg {
+class BVH;
+}  // namespace abcg
+
+/**
+ * @brief abcg::BVH class.
+ *
+ * Dynamic bounding volume hierarchy of object instances, used to find the
+ * objects inside a view frustum.
+ *
+ * Objects are the leaves of a binary tree of axis-aligned bounding boxes.
+ * Leaves are inserted next to the sibling that least increases the surface
+ * area of the tree, and the tree is kept balanced with rotations. The box
+ * of each leaf is enlarged by a margin, so that objects that move a little
+ * do not have to be reinserted.
+ *
+ * cull() traverses the tree testing only the frustum planes that do not
+ * already contain the parent node, and each node remembers the plane that
+ * rejected it last, which is tested first in the next frame.
+ */
+class abcg::BVH {
+ public:
+  // Identifies an object in the tree
+  using Handle = std::int32_t;
+  static constexpr Handle nullHandle{-1};
+
+  struct Stats {
+    std::size_t nodesTested{};
+    std::size_t visible{};
+    std::size_t culled{};
+  };
+
+  explicit BVH(float margin = 0.1f) : m_margin{margin} {}
+
+  [[nodiscard]] Handle insert(const AABB& box, std::uint32_t userData);
+  void remove(Handle handle);
+  bool update(Handle handle, const AABB& box);
+  void clear();
+
+  void cull(const Frustum& frustum, std::vector<std::uint32_t>& visible);
+
+  [[nodiscard]] std::size_t size() const noexcept { return m_numObjects; }
+  [[nodiscard]] int getHeight() const noexcept;
+  [[nodiscard]] Stats getStats() const noexcept { return m_stats; }
+
+ private:
+  struct Node {
+    // Enlarged box for leaves
+    AABB box;
+    Handle parent{nullHandle};
+    Handle child1{nullHandle};
+    Handle child2{nullHandle};
+    // Leaves have height 0. Free nodes have height -1.
+    int height{};
+    std::uint32_t userData{};
+    std::uint8_t lastRejectingPlane{};
+
+    [[nodiscard]] bool isLeaf() const noexcept { return child1 == nullHandle; }
+  };
+
+  std::vector<Node> m_nodes;
+  Handle m_root{nullHandle};
+  // Head of the list of free nodes, linked through Node::parent
+  Handle m_freeList{nullHandle};
+  std::size_t m_numObjects{};
+  float m_margin{};
+
+  // Stack of (node, plane mask) pairs used by cull()
+  std::vector<std::pair<Handle, std::uint8_t>> m_stack;
+  Stats m_stats{};
+
+  // Handles are signed so that nullHandle can be -1
+  [[nodiscard]] Node& getNode(Handle handle) {
+    return m_nodes.at(static_cast<std::size_t>(handle));
+  }
+  [[nodiscard]] const Node& getNode(Handle handle) const {
+    return m_nodes.at(static_cast<std::size_t>(handle));
+  }
+  Handle allocateNode();
+  void freeNode(Handle handle);
+  void insertLeaf(Handle leaf);
+  void removeLeaf(Handle leaf);
+  Handle balance(Handle handle);
+  void fixUpwards(Handle handle);
+  void addSubtree(Handle handle, std::vector<std::uint32_t>& visible);
+};
+
+#endif
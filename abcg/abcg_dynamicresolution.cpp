@@ -0,0 +1,426 @@
+/**
+ * @file abcg_dynamicresolution.cpp
+ * @brief Definition of abcg::DynamicResolution class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_dynamicresolution.hpp"
+
+#include <fmt/core.h>
+#include <imgui.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cppitertools/itertools.hpp>
+#include <glm/vec2.hpp>
+#include <iterator>
+
+#include "abcg_exception.hpp"
+
+namespace {
+// Smallest change of scale applied to the render target
+constexpr float scaleStep{0.05f};
+
+// Gains of the controller. The frame time is measured a few frames late,
+// so the gains are kept low to avoid oscillations
+constexpr float proportionalGain{0.2f};
+constexpr float integralGain{0.05f};
+constexpr float derivativeGain{0.05f};
+
+// Relative error of the frame time that is ignored, so that the scale
+// settles instead of alternating between two steps
+constexpr float tolerance{0.1f};
+
+// Weight of a new sample in the exponential moving average of the frame
+// time
+constexpr float frameTimeSmoothing{0.1f};
+
+// Returns the scale, between minScale and maxScale, in steps of scaleStep
+float quantizeScale(float scale,
+                    const abcg::DynamicResolutionSettings &settings) {
+  return std::clamp(std::round(scale / scaleStep) * scaleStep,
+                    settings.minScale, settings.maxScale);
+}
+}  // namespace
+
+const std::string_view abcg::DynamicResolution::vertexShaderSource{R"gl(
+out vec2 fragTexCoord;
+
+// Triangle covering the viewport
+void main() {
+  vec2 position = vec2(gl_VertexID == 1 ? 3.0 : -1.0,
+                       gl_VertexID == 2 ? 3.0 : -1.0);
+  fragTexCoord = position * 0.5 + 0.5;
+  gl_Position = vec4(position, 0.0, 1.0);
+}
+)gl"};
+
+const std::string_view abcg::DynamicResolution::fragmentShaderSource{R"gl(
+in vec2 fragTexCoord;
+
+out vec4 outColor;
+
+uniform sampler2D colorTex;
+uniform vec2 texelSize;
+uniform float sharpness;
+
+void main() {
+  vec3 color = texture(colorTex, fragTexCoord).rgb;
+
+  if (sharpness > 0.0) {
+    vec3 north = texture(colorTex, fragTexCoord + vec2(0.0, texelSize.y)).rgb;
+    vec3 south = texture(colorTex, fragTexCoord - vec2(0.0, texelSize.y)).rgb;
+    vec3 east = texture(colorTex, fragTexCoord + vec2(texelSize.x, 0.0)).rgb;
+    vec3 west = texture(colorTex, fragTexCoord - vec2(texelSize.x, 0.0)).rgb;
+
+    // Unsharp mask, limited to the range of the neighborhood
+    vec3 minColor = min(color, min(min(north, south), min(east, west)));
+    vec3 maxColor = max(color, max(max(north, south), max(east, west)));
+    vec3 sharpened =
+        color + sharpness * (4.0 * color - north - south - east - west);
+    color = clamp(sharpened, minColor, maxColor);
+  }
+
+  outColor = vec4(color, 1.0);
+}
+)gl"};
+
+/**
+ * @brief Creates the render target and the objects of the upscaling pass.
+ *
+ * @param program Program created from vertexShaderSource and
+ * fragmentShaderSource. It is deleted by terminateGL().
+ * @param samples Number of samples of the default framebuffer.
+ *
+ * @throw abcg::Exception if the render target cannot be created.
+ */
+void abcg::DynamicResolution::initializeGL(Program program, int samples) {
+  m_program = program;
+
+  GLint maxSamples{};
+  abcg::glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+  m_samples = std::min(samples, maxSamples);
+
+  // The vertices of the upscaling pass come from gl_VertexID, but core
+  // profiles require a VAO to draw
+  abcg::glGenVertexArrays(1, &m_VAO);
+
+  createTarget();
+}
+
+/**
+ * @brief Sets the size of the window the target is upscaled to.
+ *
+ * @throw abcg::Exception if the render target cannot be created.
+ */
+void abcg::DynamicResolution::resize(int windowWidth, int windowHeight) {
+  m_windowWidth = windowWidth;
+  m_windowHeight = windowHeight;
+  if (m_VAO != 0) createTarget();
+}
+
+/**
+ * @brief Updates the resolution scale from the frame time.
+ *
+ * Called once per frame, before begin().
+ *
+ * @param deltaTime Time since the previous frame, in seconds. Used if the
+ * GPU time is not available.
+ *
+ * @return Whether the size of the render target has changed.
+ * @throw abcg::Exception if the render target cannot be created.
+ */
+bool abcg::DynamicResolution::update(double deltaTime) {
+  collectQueries();
+
+  const auto frameTime{m_gpuTime >= 0.0f
+                           ? m_gpuTime
+                           : static_cast<float>(deltaTime * 1000.0)};
+  if (frameTime <= 0.0f) return false;
+  m_frameTime = m_frameTime <= 0.0f
+                    ? frameTime
+                    : m_frameTime +
+                          (frameTime - m_frameTime) * frameTimeSmoothing;
+
+  // Relative headroom: positive if frames are faster than the target
+  auto error{std::clamp(
+      (m_settings.targetFrameTime - m_frameTime) / m_settings.targetFrameTime,
+      -1.0f, 1.0f)};
+  if (std::abs(error) < tolerance) error = 0.0f;
+
+  // PID controller in velocity form: its output is the change of scale, so
+  // that clamping the scale does not wind up the integral term
+  m_scale += proportionalGain * (error - m_error) + integralGain * error +
+             derivativeGain * (error - 2.0f * m_error + m_previousError);
+  m_scale = std::clamp(m_scale, m_settings.minScale, m_settings.maxScale);
+  m_previousError = m_error;
+  m_error = error;
+
+  // Hysteresis, so that the target is not reallocated back and forth
+  if (std::abs(m_scale - m_appliedScale) < scaleStep * 0.75f) return false;
+  const auto scale{quantizeScale(m_scale, m_settings)};
+  if (scale == m_appliedScale) return false;
+
+  m_appliedScale = scale;
+  createTarget();
+  return true;
+}
+
+/**
+ * @brief Binds the render target, to be drawn by paintGL().
+ *
+ * The viewport is set to the size of the target.
+ */
+void abcg::DynamicResolution::begin() {
+#if !defined(__EMSCRIPTEN__)
+  // Timestamps instead of a GL_TIME_ELAPSED query, which would conflict
+  // with the queries of paintGL (they cannot be nested)
+  const auto start{getQuery()};
+  abcg::glQueryCounter(start, GL_TIMESTAMP);
+  m_pendingQueries.emplace_back(start, getQuery());
+#endif
+
+  abcg::glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+  abcg::glViewport(0, 0, m_width, m_height);
+}
+
+/**
+ * @brief Upscales the render target to the default framebuffer.
+ *
+ * The default framebuffer is bound afterwards, with the viewport set to the
+ * size of the window. The OpenGL state changed by the upscaling pass is
+ * restored.
+ */
+void abcg::DynamicResolution::end() {
+#if !defined(__EMSCRIPTEN__)
+  abcg::glQueryCounter(m_pendingQueries.back().second, GL_TIMESTAMP);
+#endif
+
+  if (m_framebuffer != m_resolveFramebuffer) {
+    abcg::glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+    abcg::glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_resolveFramebuffer);
+    abcg::glBlitFramebuffer(0, 0, m_width, m_height, 0, 0, m_width, m_height,
+                            GL_COLOR_BUFFER_BIT, GL_NEAREST);
+  }
+
+  abcg::glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  abcg::glViewport(0, 0, m_windowWidth, m_windowHeight);
+
+  // Save the state changed by the pass
+  const std::array<GLenum, 5> capabilities{GL_BLEND, GL_CULL_FACE,
+                                          GL_DEPTH_TEST, GL_SCISSOR_TEST,
+                                          GL_STENCIL_TEST};
+  std::array<GLboolean, capabilities.size()> enabled{};
+  for (const auto index : iter::range(capabilities.size())) {
+    enabled.at(index) = abcg::glIsEnabled(capabilities.at(index));
+    abcg::glDisable(capabilities.at(index));
+  }
+  GLint program{};
+  abcg::glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+  GLint vertexArray{};
+  abcg::glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &vertexArray);
+  GLint activeTexture{};
+  abcg::glGetIntegerv(GL_ACTIVE_TEXTURE, &activeTexture);
+  abcg::glActiveTexture(GL_TEXTURE0);
+  GLint texture{};
+  abcg::glGetIntegerv(GL_TEXTURE_BINDING_2D, &texture);
+
+  m_program.use();
+  m_program.setUniform("colorTex", 0);
+  m_program.setUniform("texelSize",
+                       glm::vec2{1.0f / static_cast<float>(m_width),
+                                 1.0f / static_cast<float>(m_height)});
+  m_program.setUniform("sharpness", m_settings.sharpness);
+  abcg::glBindTexture(GL_TEXTURE_2D, m_colorTexture);
+  abcg::glBindVertexArray(m_VAO);
+  abcg::glDrawArrays(GL_TRIANGLES, 0, 3);
+
+  // Restore the state
+  abcg::glBindVertexArray(static_cast<GLuint>(vertexArray));
+  abcg::glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(texture));
+  abcg::glActiveTexture(static_cast<GLenum>(activeTexture));
+  abcg::glUseProgram(static_cast<GLuint>(program));
+  for (const auto index : iter::range(capabilities.size())) {
+    if (enabled.at(index) == GL_TRUE) abcg::glEnable(capabilities.at(index));
+  }
+}
+
+/**
+ * @brief Releases the OpenGL objects, including the program given to
+ * initializeGL().
+ */
+void abcg::DynamicResolution::terminateGL() {
+  destroyTarget();
+  abcg::glDeleteVertexArrays(1, &m_VAO);
+  m_VAO = 0;
+  abcg::glDeleteProgram(m_program);
+  m_program = {};
+
+  for (const auto &[start, end] : m_pendingQueries) {
+    m_freeQueries.push_back(start);
+    m_freeQueries.push_back(end);
+  }
+  m_pendingQueries.clear();
+  if (!m_freeQueries.empty()) {
+    abcg::glDeleteQueries(static_cast<GLsizei>(m_freeQueries.size()),
+                          m_freeQueries.data());
+    m_freeQueries.clear();
+  }
+}
+
+void abcg::DynamicResolution::paintUI() {
+  ImGui::SetNextWindowSize(ImVec2(320, 170), ImGuiCond_FirstUseEver);
+  ImGui::Begin("Dynamic resolution");
+
+  ImGui::Text("%dx%d (%.0f%%) of %dx%d", m_width, m_height,
+              static_cast<double>(m_appliedScale) * 100.0, m_windowWidth,
+              m_windowHeight);
+  ImGui::Text("Frame time: %.2f ms (%s)", static_cast<double>(m_frameTime),
+              m_gpuTime >= 0.0f ? "GPU" : "CPU");
+
+  auto settings{m_settings};
+  auto targetFrameRate{1000.0f / settings.targetFrameTime};
+  if (ImGui::SliderFloat("Target FPS", &targetFrameRate, 10.0f, 240.0f,
+                         "%.0f")) {
+    settings.targetFrameTime = 1000.0f / targetFrameRate;
+  }
+  ImGui::SliderFloat("Min scale", &settings.minScale, 0.25f, 1.0f, "%.2f");
+  ImGui::SliderFloat("Sharpness", &settings.sharpness, 0.0f, 1.0f, "%.2f");
+  settings.maxScale = std::max(settings.maxScale, settings.minScale);
+  setSettings(settings);
+
+  ImGui::End();
+}
+
+/**
+ * @brief Sets the target frame time, the range of the scale and the
+ * sharpness of the upscaling pass.
+ *
+ * The scales are clamped to [0.1, 1], and the sharpness to [0, 1].
+ */
+void abcg::DynamicResolution::setSettings(
+    const DynamicResolutionSettings &settings) {
+  m_settings = settings;
+  m_settings.targetFrameTime = std::max(m_settings.targetFrameTime, 1.0f);
+  m_settings.maxScale = std::clamp(m_settings.maxScale, 0.1f, 1.0f);
+  m_settings.minScale =
+      std::clamp(m_settings.minScale, 0.1f, m_settings.maxScale);
+  m_settings.sharpness = std::clamp(m_settings.sharpness, 0.0f, 1.0f);
+  m_scale = std::clamp(m_scale, m_settings.minScale, m_settings.maxScale);
+}
+
+void abcg::DynamicResolution::createTarget() {
+  destroyTarget();
+
+  const auto scaled{[this](int size) {
+    return std::max(1, static_cast<int>(std::lround(static_cast<float>(size) *
+                                                    m_appliedScale)));
+  }};
+  m_width = scaled(m_windowWidth);
+  m_height = scaled(m_windowHeight);
+
+  // Single-sampled color texture, filtered by the upscaling pass
+  abcg::glGenTextures(1, &m_colorTexture);
+  abcg::glBindTexture(GL_TEXTURE_2D, m_colorTexture);
+  abcg::glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_width, m_height, 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  abcg::glBindTexture(GL_TEXTURE_2D, 0);
+
+  const auto createRenderbuffer{[&](GLenum internalFormat) {
+    GLuint renderbuffer{};
+    abcg::glGenRenderbuffers(1, &renderbuffer);
+    abcg::glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+    abcg::glRenderbufferStorageMultisample(GL_RENDERBUFFER, m_samples,
+                                           internalFormat, m_width, m_height);
+    abcg::glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    m_renderbuffers.push_back(renderbuffer);
+    return renderbuffer;
+  }};
+
+  abcg::glGenFramebuffers(1, &m_resolveFramebuffer);
+  abcg::glBindFramebuffer(GL_FRAMEBUFFER, m_resolveFramebuffer);
+  abcg::glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                               GL_TEXTURE_2D, m_colorTexture, 0);
+  if (m_samples == 0) {
+    m_framebuffer = m_resolveFramebuffer;
+  } else {
+    abcg::glGenFramebuffers(1, &m_framebuffer);
+    abcg::glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    abcg::glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                    GL_RENDERBUFFER,
+                                    createRenderbuffer(GL_RGBA8));
+  }
+  abcg::glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                                  GL_RENDERBUFFER,
+                                  createRenderbuffer(GL_DEPTH24_STENCIL8));
+
+  const auto status{abcg::glCheckFramebufferStatus(GL_FRAMEBUFFER)};
+  abcg::glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
+    destroyTarget();
+    throw abcg::Exception{abcg::Exception::Runtime(fmt::format(
+        "Incomplete dynamic resolution framebuffer ({:#x})", status))};
+  }
+}
+
+void abcg::DynamicResolution::destroyTarget() {
+  if (m_framebuffer != m_resolveFramebuffer) {
+    abcg::glDeleteFramebuffers(1, &m_framebuffer);
+  }
+  abcg::glDeleteFramebuffers(1, &m_resolveFramebuffer);
+  m_framebuffer = m_resolveFramebuffer = 0;
+
+  abcg::glDeleteTextures(1, &m_colorTexture);
+  m_colorTexture = 0;
+
+  if (!m_renderbuffers.empty()) {
+    abcg::glDeleteRenderbuffers(static_cast<GLsizei>(m_renderbuffers.size()),
+                                m_renderbuffers.data());
+    m_renderbuffers.clear();
+  }
+}
+
+GLuint abcg::DynamicResolution::getQuery() {
+  if (m_freeQueries.empty()) {
+    GLuint query{};
+    abcg::glGenQueries(1, &query);
+    return query;
+  }
+  const auto query{m_freeQueries.back()};
+  m_freeQueries.pop_back();
+  return query;
+}
+
+// Reads the timestamps of previous frames that are already available,
+// without waiting for the GPU
+void abcg::DynamicResolution::collectQueries() {
+#if !defined(__EMSCRIPTEN__)
+  std::size_t collected{};
+  for (const auto &[start, end] : m_pendingQueries) {
+    GLuint available{};
+    abcg::glGetQueryObjectuiv(end, GL_QUERY_RESULT_AVAILABLE, &available);
+    // Queries finish in the order they were issued
+    if (available == GL_FALSE) break;
+
+    GLuint64 startTime{};
+    GLuint64 endTime{};
+    abcg::glGetQueryObjectui64v(start, GL_QUERY_RESULT, &startTime);
+    abcg::glGetQueryObjectui64v(end, GL_QUERY_RESULT, &endTime);
+    m_gpuTime = static_cast<float>(endTime - startTime) * 1.0e-6f;
+
+    m_freeQueries.push_back(start);
+    m_freeQueries.push_back(end);
+    ++collected;
+  }
+  m_pendingQueries.erase(
+      m_pendingQueries.begin(),
+      std::next(m_pendingQueries.begin(),
+                static_cast<std::ptrdiff_t>(collected)));
+#endif
+}
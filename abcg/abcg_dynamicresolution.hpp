@@ -0,0 +1,127 @@
+/**
+ * @file abcg_dynamicresolution.hpp
+ * @brief abcg::DynamicResolution header file.
+ *
+ * Declaration of abcg::DynamicResolution class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_DYNAMICRESOLUTION_HPP_
+#define ABCG_DYNAMICRESOLUTION_HPP_
+
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "abcg_openglfunctions.hpp"
+#include "abcg_program.hpp"
+
+namespace abcg {
+class DynamicResolution;
+struct DynamicResolutionSettings;
+}  // namespace abcg
+
+/**
+ * @brief Settings of abcg::DynamicResolution.
+ */
+struct abcg::DynamicResolutionSettings {
+  // Frame time the controller aims for, in milliseconds
+  float targetFrameTime{1000.0f / 60.0f};
+  // Range of the resolution scale, relative to the window size
+  float minScale{0.5f};
+  float maxScale{1.0f};
+  // Amount of sharpening applied when upscaling, in [0, 1]. Zero gives
+  // plain bilinear filtering
+  float sharpness{0.25f};
+};
+
+/**
+ * @brief abcg::DynamicResolution class.
+ *
+ * Offscreen render target whose resolution follows the frame time, used by
+ * abcg::OpenGLWindow when OpenGLSettings::dynamicResolution is set.
+ *
+ * The window draws paintGL() into the target and upscales it to the default
+ * framebuffer before the UI is rendered. The scale of the target relative
+ * to the window is driven by a PID controller that compares the measured
+ * frame time with the target frame time. The frame time is the GPU time of
+ * the scene, measured with timer queries and read without waiting for the
+ * GPU; where timer queries are not available (WebGL), the time between
+ * frames is used instead.
+ *
+ * The scale is applied in steps, so that the target is not reallocated on
+ * every frame. The upscaling pass filters the target bilinearly and can
+ * sharpen the result to hide the loss of detail. Sharpening is limited to
+ * the range of the neighboring texels, so that it does not create halos.
+ *
+ * If the window is multisampled, the target is also multisampled and is
+ * resolved before upscaling.
+ */
+class abcg::DynamicResolution {
+ public:
+  static const std::string_view vertexShaderSource;
+  static const std::string_view fragmentShaderSource;
+
+  void initializeGL(Program program, int samples);
+  void resize(int windowWidth, int windowHeight);
+  [[nodiscard]] bool update(double deltaTime);
+  void begin();
+  void end();
+  void terminateGL();
+  void paintUI();
+
+  void setSettings(const DynamicResolutionSettings& settings);
+  [[nodiscard]] DynamicResolutionSettings getSettings() const noexcept {
+    return m_settings;
+  }
+  [[nodiscard]] float getScale() const noexcept { return m_appliedScale; }
+  // Whether the controller cannot lower the resolution any further
+  [[nodiscard]] bool isAtMinScale() const noexcept {
+    return m_scale <= m_settings.minScale;
+  }
+  [[nodiscard]] int getWidth() const noexcept { return m_width; }
+  [[nodiscard]] int getHeight() const noexcept { return m_height; }
+  // Smoothed frame time in milliseconds
+  [[nodiscard]] float getFrameTime() const noexcept { return m_frameTime; }
+
+ private:
+  DynamicResolutionSettings m_settings{};
+
+  Program m_program;
+  GLuint m_VAO{};
+  int m_samples{};
+
+  // Framebuffer drawn by paintGL, and the single-sampled framebuffer it is
+  // resolved to (the same one if not multisampled)
+  GLuint m_framebuffer{};
+  GLuint m_resolveFramebuffer{};
+  GLuint m_colorTexture{};
+  std::vector<GLuint> m_renderbuffers;
+
+  int m_windowWidth{};
+  int m_windowHeight{};
+  int m_width{};
+  int m_height{};
+
+  // Scale computed by the controller, and the scale of the target
+  float m_scale{1.0f};
+  float m_appliedScale{1.0f};
+  float m_frameTime{};
+  // Last two errors of the controller
+  float m_error{};
+  float m_previousError{};
+
+  // Timestamp queries issued before and after paintGL, not yet available
+  std::vector<std::pair<GLuint, GLuint>> m_pendingQueries;
+  std::vector<GLuint> m_freeQueries;
+  // Milliseconds, negative if not available
+  float m_gpuTime{-1.0f};
+
+  void createTarget();
+  void destroyTarget();
+  [[nodiscard]] GLuint getQuery();
+  void collectQueries();
+};
+
+#endif
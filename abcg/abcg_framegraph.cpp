@@ -0,0 +1,719 @@
+/**
+ * @file abcg_framegraph.cpp
+ * @brief Definition of abcg::FrameGraph class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_framegraph.hpp"
+
+#include <fmt/core.h>
+#include <imgui.h>
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <queue>
+
+#include "abcg_elapsedtimer.hpp"
+#include "abcg_exception.hpp"
+
+namespace {
+// Pool textures not used for this number of frames are deleted
+constexpr std::uint64_t maxUnusedFrames{8};
+// Weight of the last frame in the averaged timings
+constexpr float timingSmoothing{0.1f};
+
+struct FormatInfo {
+  GLenum internalFormat{};
+  GLenum format{};
+  GLenum type{};
+  std::size_t bytesPerPixel{};
+  // GL_COLOR_ATTACHMENT0 for color formats
+  GLenum attachment{};
+};
+
+// Formats that can be used for render targets
+const std::array<FormatInfo, 13> formats{{
+    {GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, 4, GL_COLOR_ATTACHMENT0},
+    {GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT, 8, GL_COLOR_ATTACHMENT0},
+    {GL_RGBA32F, GL_RGBA, GL_FLOAT, 16, GL_COLOR_ATTACHMENT0},
+    {GL_RG16F, GL_RG, GL_HALF_FLOAT, 4, GL_COLOR_ATTACHMENT0},
+    {GL_R8, GL_RED, GL_UNSIGNED_BYTE, 1, GL_COLOR_ATTACHMENT0},
+    {GL_R16F, GL_RED, GL_HALF_FLOAT, 2, GL_COLOR_ATTACHMENT0},
+    {GL_R32F, GL_RED, GL_FLOAT, 4, GL_COLOR_ATTACHMENT0},
+    {GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, 4, GL_COLOR_ATTACHMENT0},
+    {GL_DEPTH_COMPONENT16, GL_DEPTH_COMPONENT, GL_UNSIGNED_SHORT, 2,
+     GL_DEPTH_ATTACHMENT},
+    {GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, 4,
+     GL_DEPTH_ATTACHMENT},
+    {GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT, 4,
+     GL_DEPTH_ATTACHMENT},
+    {GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, 4,
+     GL_DEPTH_STENCIL_ATTACHMENT},
+    {GL_DEPTH32F_STENCIL8, GL_DEPTH_STENCIL, GL_FLOAT_32_UNSIGNED_INT_24_8_REV,
+     8, GL_DEPTH_STENCIL_ATTACHMENT},
+}};
+
+const FormatInfo &getFormatInfo(GLenum internalFormat) {
+  const auto format{std::find_if(formats.begin(), formats.end(),
+                                  [internalFormat](const auto &info) {
+                                    return info.internalFormat ==
+                                           internalFormat;
+                                  })};
+  if (format == formats.end()) {
+    throw abcg::Exception{abcg::Exception::Runtime(fmt::format(
+        "Unsupported render target format {:#x}", internalFormat))};
+  }
+  return *format;
+}
+
+// Exponential moving average. Negative or zero averages have no samples yet
+void smooth(float &average, float sample) {
+  average = average <= 0.0f
+                ? sample
+                : average + (sample - average) * timingSmoothing;
+}
+
+double toMiB(std::size_t bytes) {
+  return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+
+template <typename T>
+bool contains(const std::vector<T> &values, const T &value) {
+  return std::find(values.begin(), values.end(), value) != values.end();
+}
+}  // namespace
+
+/**
+ * @brief Creates a texture written by the pass.
+ *
+ * The texture is allocated only if the pass is not culled.
+ *
+ * @param name Name of the texture.
+ * @param description Size and internal format of the texture.
+ *
+ * @return Handle to the texture.
+ * @throw abcg::Exception if the format cannot be rendered to.
+ */
+abcg::FrameGraph::Handle abcg::FrameGraph::Builder::create(
+    std::string_view name, const TextureDescription &description) {
+  [[maybe_unused]] const auto &format{
+      getFormatInfo(description.internalFormat)};
+  m_graph.m_resources.push_back(
+      {.name = std::string{name}, .description = description});
+  return write(static_cast<Handle>(m_graph.m_resources.size() - 1));
+}
+
+/**
+ * @brief Declares that the pass reads a texture.
+ *
+ * The pass is executed after every pass that writes the texture. If the
+ * pass also writes it, only the writers declared before it are waited for.
+ *
+ * @param resource Handle to the texture.
+ *
+ * @return The same handle.
+ */
+abcg::FrameGraph::Handle abcg::FrameGraph::Builder::read(Handle resource) {
+  auto &node{m_graph.getResource(resource)};
+  auto &pass{m_graph.m_passes.at(m_pass)};
+  if (std::find(pass.reads.begin(), pass.reads.end(), resource) ==
+      pass.reads.end()) {
+    pass.reads.push_back(resource);
+    node.readers.push_back(m_pass);
+  }
+  return resource;
+}
+
+/**
+ * @brief Declares that the pass writes a texture.
+ *
+ * The textures written by a pass are attached to the framebuffer bound
+ * while it is executed, in the order they are declared. Writing an imported
+ * texture is a side effect.
+ *
+ * @param resource Handle to the texture.
+ *
+ * @return The same handle.
+ */
+abcg::FrameGraph::Handle abcg::FrameGraph::Builder::write(Handle resource) {
+  auto &node{m_graph.getResource(resource)};
+  auto &pass{m_graph.m_passes.at(m_pass)};
+  if (std::find(pass.writes.begin(), pass.writes.end(), resource) ==
+      pass.writes.end()) {
+    pass.writes.push_back(resource);
+    node.writers.push_back(m_pass);
+  }
+  if (node.imported) pass.sideEffects = true;
+  return resource;
+}
+
+/**
+ * @brief Prevents the pass from being culled.
+ *
+ * Used for passes that draw to the default framebuffer or have other
+ * effects not declared as writes.
+ */
+void abcg::FrameGraph::Builder::setSideEffects() {
+  m_graph.m_passes.at(m_pass).sideEffects = true;
+}
+
+/**
+ * @brief Returns the texture name of a resource.
+ *
+ * @param resource Handle to a texture read or written by the pass.
+ */
+GLuint abcg::FrameGraph::Resources::getTexture(Handle resource) const {
+  return m_graph.getResource(resource).texture;
+}
+
+/**
+ * @brief Returns the size and format of a resource.
+ *
+ * @param resource Handle to a texture read or written by the pass.
+ */
+const abcg::FrameGraph::TextureDescription &
+abcg::FrameGraph::Resources::getDescription(Handle resource) const {
+  return m_graph.getResource(resource).description;
+}
+
+/**
+ * @brief Returns a framebuffer with a resource as its only attachment.
+ *
+ * Used to read a texture with glReadPixels or glBlitFramebuffer.
+ *
+ * @param resource Handle to a texture read or written by the pass.
+ */
+GLuint abcg::FrameGraph::Resources::getFramebuffer(Handle resource) const {
+  const auto &node{m_graph.getResource(resource)};
+  const auto attachment{
+      getFormatInfo(node.description.internalFormat).attachment};
+  if (attachment == GL_COLOR_ATTACHMENT0) {
+    return m_graph.getFramebuffer({node.texture}, 0, GL_NONE);
+  }
+  return m_graph.getFramebuffer({}, node.texture, attachment);
+}
+
+/**
+ * @brief Adds a texture created outside the graph.
+ *
+ * Imported textures are neither allocated nor culled.
+ *
+ * @param name Name of the texture.
+ * @param texture Texture name.
+ * @param description Size and internal format of the texture.
+ *
+ * @return Handle to the texture.
+ */
+abcg::FrameGraph::Handle abcg::FrameGraph::importTexture(
+    std::string_view name, GLuint texture,
+    const TextureDescription &description) {
+  m_resources.push_back({.name = std::string{name},
+                         .description = description,
+                         .texture = texture,
+                         .imported = true});
+  return static_cast<Handle>(m_resources.size() - 1);
+}
+
+/**
+ * @brief Adds a pass to the frame.
+ *
+ * @param name Name of the pass. Timings are averaged over passes with the
+ * same name in consecutive frames.
+ * @param setup Function that declares the textures of the pass. Called
+ * before addPass returns.
+ * @param execute Function that renders the pass. Called by execute(), with
+ * the textures written by the pass attached to the bound framebuffer and
+ * the viewport set to their size. Passes that write no texture are executed
+ * with the framebuffer and viewport that were set when execute() was
+ * called (usually the default framebuffer).
+ */
+void abcg::FrameGraph::addPass(std::string_view name, const Setup &setup,
+                               const Execute &execute) {
+  m_passes.push_back({.name = std::string{name}, .execute = execute});
+  Builder builder{*this, m_passes.size() - 1};
+  setup(builder);
+}
+
+/**
+ * @brief Culls, sorts and executes the passes added since the last call.
+ *
+ * The framebuffer and the viewport set before the call are restored
+ * afterwards.
+ *
+ * @throw abcg::Exception if the passes depend on each other in a cycle, or
+ * if a framebuffer is incomplete.
+ */
+void abcg::FrameGraph::execute() {
+  collectQueries();
+
+  cull();
+  sort();
+  allocate();
+
+  // Output of the passes that write no texture
+  GLint output{};
+  abcg::glGetIntegerv(GL_FRAMEBUFFER_BINDING, &output);
+  std::array<GLint, 4> viewport{};
+  abcg::glGetIntegerv(GL_VIEWPORT, viewport.data());
+
+  const Resources resources{*this};
+  for (const auto index : m_order) {
+    const auto &pass{m_passes.at(index)};
+    bindFramebuffer(pass, static_cast<GLuint>(output), viewport.data());
+
+#if !defined(__EMSCRIPTEN__)
+    GLuint query{};
+    if (m_freeQueries.empty()) {
+      abcg::glGenQueries(1, &query);
+    } else {
+      query = m_freeQueries.back();
+      m_freeQueries.pop_back();
+    }
+    abcg::glBeginQuery(GL_TIME_ELAPSED, query);
+#endif
+
+    const ElapsedTimer timer;
+    pass.execute(resources);
+    smooth(m_timings[pass.name].cpuTime,
+           static_cast<float>(timer.elapsed() * 1000.0));
+
+#if !defined(__EMSCRIPTEN__)
+    abcg::glEndQuery(GL_TIME_ELAPSED);
+    m_pendingQueries.emplace_back(pass.name, query);
+#endif
+  }
+
+  abcg::glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(output));
+  abcg::glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+  // Executed passes first, then the culled ones
+  m_passInfos.clear();
+  for (const auto index : m_order) {
+    const auto &timing{m_timings[m_passes.at(index).name]};
+    m_passInfos.push_back({.name = m_passes.at(index).name,
+                           .cpuTime = timing.cpuTime,
+                           .gpuTime = timing.gpuTime});
+  }
+  for (const auto &pass : m_passes) {
+    if (pass.culled) m_passInfos.push_back({.name = pass.name, .culled = true});
+  }
+  m_stats.passes = m_passes.size();
+  m_stats.culledPasses = m_passes.size() - m_order.size();
+
+  releaseUnusedTextures();
+  ++m_frame;
+
+  m_resources.clear();
+  m_passes.clear();
+  m_order.clear();
+}
+
+/**
+ * @brief Deletes the pooled textures, framebuffers and queries.
+ */
+void abcg::FrameGraph::destroy() {
+  for (const auto &[attachments, framebuffer] : m_framebuffers) {
+    abcg::glDeleteFramebuffers(1, &framebuffer);
+  }
+  m_framebuffers.clear();
+
+  for (const auto &pooled : m_pool) {
+    abcg::glDeleteTextures(1, &pooled.texture);
+  }
+  m_pool.clear();
+
+  for (const auto &[name, query] : m_pendingQueries) {
+    m_freeQueries.push_back(query);
+  }
+  m_pendingQueries.clear();
+  if (!m_freeQueries.empty()) {
+    abcg::glDeleteQueries(static_cast<GLsizei>(m_freeQueries.size()),
+                          m_freeQueries.data());
+  }
+  m_freeQueries.clear();
+
+  m_timings.clear();
+  m_passInfos.clear();
+  m_stats = {};
+}
+
+/**
+ * @brief Shows the passes of the last frame with their timings.
+ */
+void abcg::FrameGraph::paintUI() {
+  ImGui::SetNextWindowSize(ImVec2(320, 200), ImGuiCond_FirstUseEver);
+  ImGui::Begin("Frame graph");
+
+  ImGui::Text("%zu textures in %zu pooled (%.1f of %.1f MiB)",
+              m_stats.transientTextures, m_stats.pooledTextures,
+              toMiB(m_stats.allocatedBytes), toMiB(m_stats.requestedBytes));
+
+  if (ImGui::BeginTable("Passes", 3,
+                        ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                            ImGuiTableFlags_ScrollY)) {
+    ImGui::TableSetupColumn("Pass");
+    ImGui::TableSetupColumn("CPU (ms)");
+    ImGui::TableSetupColumn("GPU (ms)");
+    ImGui::TableHeadersRow();
+
+    for (const auto &pass : m_passInfos) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      if (pass.culled) {
+        ImGui::TextDisabled("%s (culled)", pass.name.c_str());
+        continue;
+      }
+      ImGui::TextUnformatted(pass.name.c_str());
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", static_cast<double>(pass.cpuTime));
+      ImGui::TableNextColumn();
+      if (pass.gpuTime < 0.0f) {
+        ImGui::TextDisabled("n/a");
+      } else {
+        ImGui::Text("%.3f", static_cast<double>(pass.gpuTime));
+      }
+    }
+    ImGui::EndTable();
+  }
+
+  ImGui::End();
+}
+
+/**
+ * @brief Computes the memory used by a texture without mipmaps.
+ *
+ * @param description Size and internal format of the texture.
+ *
+ * @return Size in bytes.
+ */
+std::size_t abcg::FrameGraph::computeSize(
+    const TextureDescription &description) {
+  return static_cast<std::size_t>(description.width) *
+         static_cast<std::size_t>(description.height) *
+         getFormatInfo(description.internalFormat).bytesPerPixel;
+}
+
+abcg::FrameGraph::ResourceNode &abcg::FrameGraph::getResource(
+    Handle resource) {
+  if (resource < 0 ||
+      static_cast<std::size_t>(resource) >= m_resources.size()) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Invalid frame graph resource {}", resource))};
+  }
+  return m_resources[static_cast<std::size_t>(resource)];
+}
+
+void abcg::FrameGraph::cullPass(std::size_t pass,
+                                std::vector<Handle> &unreferenced) {
+  auto &node{m_passes.at(pass)};
+  node.culled = true;
+  for (const auto resource : node.reads) {
+    if (contains(node.writes, resource)) continue;
+    auto &resourceNode{getResource(resource)};
+    if (--resourceNode.refCount == 0 && !resourceNode.imported) {
+      unreferenced.push_back(resource);
+    }
+  }
+}
+
+// Culls the passes that do not contribute to a side effect, by reference
+// counting: a pass is referenced by the textures it writes, and a texture
+// by the passes that read it (except passes that also write it)
+void abcg::FrameGraph::cull() {
+  for (auto &pass : m_passes) {
+    pass.refCount = static_cast<int>(pass.writes.size());
+    pass.culled = false;
+  }
+  for (std::size_t index{}; index < m_resources.size(); ++index) {
+    auto &resource{m_resources.at(index)};
+    resource.refCount = static_cast<int>(std::count_if(
+        resource.readers.begin(), resource.readers.end(),
+        [&](std::size_t reader) {
+          return !contains(m_passes.at(reader).writes,
+                           static_cast<Handle>(index));
+        }));
+  }
+
+  std::vector<Handle> unreferenced;
+  for (std::size_t index{}; index < m_passes.size(); ++index) {
+    const auto &pass{m_passes.at(index)};
+    if (pass.refCount == 0 && !pass.sideEffects) cullPass(index, unreferenced);
+  }
+  for (std::size_t index{}; index < m_resources.size(); ++index) {
+    const auto &resource{m_resources.at(index)};
+    if (resource.refCount == 0 && !resource.imported) {
+      unreferenced.push_back(static_cast<Handle>(index));
+    }
+  }
+
+  while (!unreferenced.empty()) {
+    const auto resource{unreferenced.back()};
+    unreferenced.pop_back();
+    for (const auto writer : getResource(resource).writers) {
+      auto &pass{m_passes.at(writer)};
+      if (pass.culled) continue;
+      if (--pass.refCount == 0 && !pass.sideEffects) {
+        cullPass(writer, unreferenced);
+      }
+    }
+  }
+}
+
+// Topological sort of the passes not culled. Readers of a texture run after
+// its writers, and writers run in the order they were added. Independent
+// passes keep the order they were added.
+void abcg::FrameGraph::sort() {
+  std::vector<std::vector<std::size_t>> dependents(m_passes.size());
+  std::vector<int> dependencies(m_passes.size());
+  const auto addDependency{[&](std::size_t from, std::size_t to) {
+    dependents.at(from).push_back(to);
+    ++dependencies.at(to);
+  }};
+
+  for (std::size_t index{}; index < m_resources.size(); ++index) {
+    const auto &resource{m_resources.at(index)};
+    std::vector<std::size_t> writers;
+    std::copy_if(resource.writers.begin(), resource.writers.end(),
+                 std::back_inserter(writers),
+                 [&](std::size_t pass) { return !m_passes.at(pass).culled; });
+    std::sort(writers.begin(), writers.end());
+
+    for (std::size_t writer{1}; writer < writers.size(); ++writer) {
+      addDependency(writers.at(writer - 1), writers.at(writer));
+    }
+    for (const auto reader : resource.readers) {
+      const auto &pass{m_passes.at(reader)};
+      if (pass.culled) continue;
+      const auto readsOwnWrite{
+          contains(pass.writes, static_cast<Handle>(index))};
+      for (const auto writer : writers) {
+        if (writer == reader) continue;
+        if (readsOwnWrite && writer > reader) continue;
+        addDependency(writer, reader);
+      }
+    }
+  }
+
+  std::priority_queue<std::size_t, std::vector<std::size_t>,
+                      std::greater<std::size_t>>
+      ready;
+  std::size_t numPasses{};
+  for (std::size_t index{}; index < m_passes.size(); ++index) {
+    if (m_passes.at(index).culled) continue;
+    ++numPasses;
+    if (dependencies.at(index) == 0) ready.push(index);
+  }
+
+  m_order.clear();
+  while (!ready.empty()) {
+    const auto index{ready.top()};
+    ready.pop();
+    m_order.push_back(index);
+    for (const auto dependent : dependents.at(index)) {
+      if (--dependencies.at(dependent) == 0) ready.push(dependent);
+    }
+  }
+
+  if (m_order.size() != numPasses) {
+    std::string names;
+    for (std::size_t index{}; index < m_passes.size(); ++index) {
+      if (m_passes.at(index).culled || dependencies.at(index) == 0) continue;
+      names += fmt::format("{}{}", names.empty() ? "" : ", ",
+                           m_passes.at(index).name);
+    }
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Frame graph passes depend on each other ({})", names))};
+  }
+}
+
+// Assigns pooled textures to the transient resources used by the passes
+// not culled. Resources whose lifetimes do not overlap share textures.
+void abcg::FrameGraph::allocate() {
+  for (std::size_t position{}; position < m_order.size(); ++position) {
+    const auto &pass{m_passes.at(m_order.at(position))};
+    for (const auto &handles : {pass.reads, pass.writes}) {
+      for (const auto handle : handles) {
+        auto &resource{getResource(handle)};
+        if (!resource.used) resource.firstUse = position;
+        resource.lastUse = position;
+        resource.used = true;
+      }
+    }
+  }
+
+  std::vector<std::size_t> transient;
+  for (std::size_t index{}; index < m_resources.size(); ++index) {
+    const auto &resource{m_resources.at(index)};
+    if (resource.used && !resource.imported) transient.push_back(index);
+  }
+  std::stable_sort(transient.begin(), transient.end(),
+                   [&](std::size_t first, std::size_t second) {
+                     return m_resources.at(first).firstUse <
+                            m_resources.at(second).firstUse;
+                   });
+
+  for (auto &pooled : m_pool) pooled.busy = false;
+
+  m_stats.transientTextures = transient.size();
+  m_stats.requestedBytes = 0;
+  for (const auto index : transient) {
+    auto &resource{m_resources.at(index)};
+    m_stats.requestedBytes += computeSize(resource.description);
+
+    auto pooled{std::find_if(m_pool.begin(), m_pool.end(), [&](const auto &p) {
+      return p.description == resource.description &&
+             (!p.busy || p.busyUntil < resource.firstUse);
+    })};
+    if (pooled == m_pool.end()) {
+      const auto &format{getFormatInfo(resource.description.internalFormat)};
+      const auto filter{format.attachment == GL_COLOR_ATTACHMENT0 &&
+                                format.format != GL_RED_INTEGER
+                            ? GL_LINEAR
+                            : GL_NEAREST};
+
+      GLuint texture{};
+      abcg::glGenTextures(1, &texture);
+      abcg::glBindTexture(GL_TEXTURE_2D, texture);
+      abcg::glTexImage2D(GL_TEXTURE_2D, 0,
+                         static_cast<GLint>(format.internalFormat),
+                         resource.description.width,
+                         resource.description.height, 0, format.format,
+                         format.type, nullptr);
+      abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+      abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+      abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,
+                            GL_CLAMP_TO_EDGE);
+      abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T,
+                            GL_CLAMP_TO_EDGE);
+      abcg::glBindTexture(GL_TEXTURE_2D, 0);
+
+      m_pool.push_back(
+          {.description = resource.description, .texture = texture});
+      pooled = std::prev(m_pool.end());
+    }
+
+    pooled->busy = true;
+    pooled->busyUntil = resource.lastUse;
+    pooled->lastFrame = m_frame;
+    resource.texture = pooled->texture;
+  }
+
+  m_stats.pooledTextures = m_pool.size();
+  m_stats.allocatedBytes = 0;
+  for (const auto &pooled : m_pool) {
+    if (pooled.busy) m_stats.allocatedBytes += computeSize(pooled.description);
+  }
+}
+
+void abcg::FrameGraph::bindFramebuffer(const PassNode &pass, GLuint output,
+                                       const GLint *viewport) {
+  std::vector<GLuint> colors;
+  GLuint depth{};
+  GLenum depthAttachment{GL_NONE};
+  const TextureDescription *size{};
+  for (const auto handle : pass.writes) {
+    const auto &resource{getResource(handle)};
+    const auto attachment{
+        getFormatInfo(resource.description.internalFormat).attachment};
+    if (attachment == GL_COLOR_ATTACHMENT0) {
+      colors.push_back(resource.texture);
+    } else {
+      depth = resource.texture;
+      depthAttachment = attachment;
+    }
+    if (size == nullptr) size = &resource.description;
+  }
+
+  if (size == nullptr) {
+    abcg::glBindFramebuffer(GL_FRAMEBUFFER, output);
+    abcg::glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    return;
+  }
+
+  abcg::glBindFramebuffer(GL_FRAMEBUFFER,
+                          getFramebuffer(colors, depth, depthAttachment));
+  abcg::glViewport(0, 0, size->width, size->height);
+}
+
+GLuint abcg::FrameGraph::getFramebuffer(const std::vector<GLuint> &colors,
+                                        GLuint depth, GLenum depthAttachment) {
+  auto key{colors};
+  key.push_back(depth);
+  if (const auto iter{m_framebuffers.find(key)}; iter != m_framebuffers.end()) {
+    return iter->second;
+  }
+
+  // Passes may ask for framebuffers while their own is bound
+  GLint previous{};
+  abcg::glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous);
+
+  GLuint framebuffer{};
+  abcg::glGenFramebuffers(1, &framebuffer);
+  abcg::glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+  std::vector<GLenum> drawBuffers;
+  for (std::size_t index{}; index < colors.size(); ++index) {
+    const auto attachment{static_cast<GLenum>(GL_COLOR_ATTACHMENT0 + index)};
+    abcg::glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D,
+                                 colors.at(index), 0);
+    drawBuffers.push_back(attachment);
+  }
+  if (depth != 0) {
+    abcg::glFramebufferTexture2D(GL_FRAMEBUFFER, depthAttachment,
+                                 GL_TEXTURE_2D, depth, 0);
+  }
+  if (drawBuffers.empty()) drawBuffers.push_back(GL_NONE);
+  abcg::glDrawBuffers(static_cast<GLsizei>(drawBuffers.size()),
+                      drawBuffers.data());
+
+  const auto status{abcg::glCheckFramebufferStatus(GL_FRAMEBUFFER)};
+  abcg::glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(previous));
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
+    abcg::glDeleteFramebuffers(1, &framebuffer);
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Incomplete framebuffer ({:#x})", status))};
+  }
+
+  m_framebuffers.emplace(std::move(key), framebuffer);
+  return framebuffer;
+}
+
+// Reads the timer queries of previous frames that are already available,
+// without waiting for the GPU
+void abcg::FrameGraph::collectQueries() {
+  std::size_t collected{};
+  for (const auto &[name, query] : m_pendingQueries) {
+    GLuint available{};
+    abcg::glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+    // Queries finish in the order they were issued
+    if (available == GL_FALSE) break;
+
+    GLuint nanoseconds{};
+    abcg::glGetQueryObjectuiv(query, GL_QUERY_RESULT, &nanoseconds);
+    smooth(m_timings[name].gpuTime, static_cast<float>(nanoseconds) * 1.0e-6f);
+
+    m_freeQueries.push_back(query);
+    ++collected;
+  }
+  m_pendingQueries.erase(
+      m_pendingQueries.begin(),
+      std::next(m_pendingQueries.begin(),
+                static_cast<std::ptrdiff_t>(collected)));
+}
+
+void abcg::FrameGraph::releaseUnusedTextures() {
+  std::erase_if(m_pool, [this](const PooledTexture &pooled) {
+    if (m_frame - pooled.lastFrame < maxUnusedFrames) return false;
+
+    std::erase_if(m_framebuffers, [&](const auto &entry) {
+      const auto &[attachments, framebuffer] = entry;
+      if (!contains(attachments, pooled.texture)) return false;
+      abcg::glDeleteFramebuffers(1, &framebuffer);
+      return true;
+    });
+    abcg::glDeleteTextures(1, &pooled.texture);
+    return true;
+  });
+}
@@ -0,0 +1,225 @@
+/**
+ * @file abcg_framegraph.hpp
+ * @brief abcg::FrameGraph header file.
+ *
+ * Declaration of abcg::FrameGraph class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_FRAMEGRAPH_HPP_
+#define ABCG_FRAMEGRAPH_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "abcg_openglfunctions.hpp"
+
+namespace abcg {
+class FrameGraph;
+}  // namespace abcg
+
+/**
+ * @brief abcg::FrameGraph class.
+ *
+ * Render passes of a frame, declared with the textures they read and
+ * write, and executed in dependency order.
+ *
+ * The graph is declared again every frame with addPass() and run with
+ * execute(). Each pass has a setup function, called right away to declare
+ * its resources through a Builder, and an execute function, called by
+ * execute() with the textures bound to a framebuffer. Passes whose outputs
+ * are never read are culled, unless they have side effects (e.g., they draw
+ * to the default framebuffer or write an imported texture).
+ *
+ * Textures created by passes are transient: they are taken from a pool
+ * when first used and returned after their last use, so that textures with
+ * the same size and format whose lifetimes do not overlap share the same
+ * memory. Their contents are undefined when created, so the first pass
+ * writing them must clear them. Pool textures not used for a few frames are
+ * deleted.
+ *
+ * OpenGL has no way to place textures of different formats in the same
+ * memory, so aliasing is done by reusing whole textures.
+ *
+ * The CPU time and the GPU time (if timer queries are available) of each
+ * pass are measured, and can be shown with paintUI().
+ */
+class abcg::FrameGraph {
+ public:
+  // Identifies a texture of the graph
+  using Handle = std::int32_t;
+  static constexpr Handle nullHandle{-1};
+
+  struct TextureDescription {
+    GLsizei width{};
+    GLsizei height{};
+    GLenum internalFormat{GL_RGBA8};
+
+    bool operator==(const TextureDescription&) const = default;
+  };
+
+  class Builder;
+  class Resources;
+
+  using Setup = std::function<void(Builder&)>;
+  using Execute = std::function<void(const Resources&)>;
+
+  struct PassInfo {
+    std::string name;
+    bool culled{};
+    // Milliseconds, averaged over the last frames. The GPU time is negative
+    // if not available
+    float cpuTime{};
+    float gpuTime{-1.0f};
+  };
+
+  struct Stats {
+    std::size_t passes{};
+    std::size_t culledPasses{};
+    std::size_t transientTextures{};
+    std::size_t pooledTextures{};
+    // Memory of the transient textures with and without aliasing
+    std::size_t allocatedBytes{};
+    std::size_t requestedBytes{};
+  };
+
+  FrameGraph() = default;
+  FrameGraph(const FrameGraph&) = delete;
+  FrameGraph& operator=(const FrameGraph&) = delete;
+
+  [[nodiscard]] Handle importTexture(std::string_view name, GLuint texture,
+                                     const TextureDescription& description);
+  void addPass(std::string_view name, const Setup& setup,
+               const Execute& execute);
+  void execute();
+  void destroy();
+  void paintUI();
+
+  [[nodiscard]] const std::vector<PassInfo>& getPasses() const noexcept {
+    return m_passInfos;
+  }
+  [[nodiscard]] Stats getStats() const noexcept { return m_stats; }
+
+  [[nodiscard]] static std::size_t computeSize(
+      const TextureDescription& description);
+
+ private:
+  struct ResourceNode {
+    std::string name;
+    TextureDescription description;
+    GLuint texture{};
+    bool imported{};
+    std::vector<std::size_t> writers{};
+    std::vector<std::size_t> readers{};
+    // Positions of the first and last passes using the texture in the
+    // execution order
+    std::size_t firstUse{};
+    std::size_t lastUse{};
+    bool used{};
+    int refCount{};
+  };
+
+  struct PassNode {
+    std::string name;
+    Execute execute;
+    std::vector<Handle> reads{};
+    std::vector<Handle> writes{};
+    bool sideEffects{};
+    bool culled{};
+    int refCount{};
+  };
+
+  struct PooledTexture {
+    TextureDescription description;
+    GLuint texture{};
+    std::uint64_t lastFrame{};
+    // Position of the last pass using the texture in the current frame
+    std::size_t busyUntil{};
+    bool busy{};
+  };
+
+  struct Timing {
+    float cpuTime{};
+    float gpuTime{-1.0f};
+  };
+
+  std::vector<ResourceNode> m_resources;
+  std::vector<PassNode> m_passes;
+  // Indices of the passes not culled, in execution order
+  std::vector<std::size_t> m_order;
+
+  std::vector<PooledTexture> m_pool;
+  // Framebuffers keyed by their color attachments followed by the depth
+  // attachment
+  std::map<std::vector<GLuint>, GLuint> m_framebuffers;
+  std::uint64_t m_frame{};
+
+  std::unordered_map<std::string, Timing> m_timings;
+  std::vector<GLuint> m_freeQueries;
+  // Timer queries not yet available, with the names of their passes
+  std::vector<std::pair<std::string, GLuint>> m_pendingQueries;
+
+  std::vector<PassInfo> m_passInfos;
+  Stats m_stats{};
+
+  [[nodiscard]] ResourceNode& getResource(Handle resource);
+  void cullPass(std::size_t pass, std::vector<Handle>& unreferenced);
+  void cull();
+  void sort();
+  void allocate();
+  void bindFramebuffer(const PassNode& pass, GLuint output,
+                       const GLint* viewport);
+  [[nodiscard]] GLuint getFramebuffer(const std::vector<GLuint>& colors,
+                                      GLuint depth, GLenum depthAttachment);
+  void collectQueries();
+  void releaseUnusedTextures();
+};
+
+/**
+ * @brief Declares the resources of a pass of abcg::FrameGraph.
+ */
+class abcg::FrameGraph::Builder {
+ public:
+  [[nodiscard]] Handle create(std::string_view name,
+                              const TextureDescription& description);
+  Handle read(Handle resource);
+  Handle write(Handle resource);
+  void setSideEffects();
+
+ private:
+  friend class FrameGraph;
+
+  Builder(FrameGraph& graph, std::size_t pass)
+      : m_graph{graph}, m_pass{pass} {}
+
+  FrameGraph& m_graph;
+  std::size_t m_pass{};
+};
+
+/**
+ * @brief Textures of abcg::FrameGraph available to a pass being executed.
+ */
+class abcg::FrameGraph::Resources {
+ public:
+  [[nodiscard]] GLuint getTexture(Handle resource) const;
+  [[nodiscard]] const TextureDescription& getDescription(
+      Handle resource) const;
+  [[nodiscard]] GLuint getFramebuffer(Handle resource) const;
+
+ private:
+  friend class FrameGraph;
+
+  explicit Resources(FrameGraph& graph) : m_graph{graph} {}
+
+  FrameGraph& m_graph;
+};
+
+#endif
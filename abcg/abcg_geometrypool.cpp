@@ -0,0 +1,298 @@
+/**
+ * @file abcg_geometrypool.cpp
+ * @brief Definition of abcg::GeometryPool class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_geometrypool.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+#include <optional>
+#include <string>
+
+#include "abcg_exception.hpp"
+
+namespace {
+using FreeList = std::map<GLuint, GLuint>;
+
+// Takes the first free range that fits
+std::optional<GLuint> allocateRange(FreeList &freeList, GLuint size) {
+  for (auto iter{freeList.begin()}; iter != freeList.end(); ++iter) {
+    auto [offset, freeSize]{*iter};
+    if (freeSize < size) continue;
+    freeList.erase(iter);
+    if (freeSize > size) freeList.emplace(offset + size, freeSize - size);
+    return offset;
+  }
+  return std::nullopt;
+}
+
+// Returns a range to the free list, merging it with adjacent free ranges
+void releaseRange(FreeList &freeList, GLuint offset, GLuint size) {
+  if (size == 0) return;
+  auto next{freeList.lower_bound(offset)};
+  if (next != freeList.end() && offset + size == next->first) {
+    size += next->second;
+    next = freeList.erase(next);
+  }
+  if (next != freeList.begin()) {
+    auto previous{std::prev(next)};
+    if (previous->first + previous->second == offset) {
+      previous->second += size;
+      return;
+    }
+  }
+  freeList.emplace(offset, size);
+}
+
+void createBuffer(GLenum target, GLsizeiptr size, bool immutable) {
+#if !defined(__EMSCRIPTEN__)
+  if (immutable) {
+    abcg::glBufferStorage(target, size, nullptr, GL_DYNAMIC_STORAGE_BIT);
+    return;
+  }
+#endif
+  abcg::glBufferData(target, size, nullptr, GL_STATIC_DRAW);
+}
+}  // namespace
+
+/**
+ * @brief Creates the buffers and the VAO.
+ *
+ * @param program Program used to draw the meshes, from which the locations
+ * of the vertex attributes are queried.
+ * @param vertexStride Size of a vertex, in bytes.
+ * @param attributes Floating-point attributes of the vertex format.
+ * Attributes that are not active in the program are ignored.
+ * @param maxVertices Capacity of the vertex buffer.
+ * @param maxIndices Capacity of the index buffer.
+ */
+void abcg::GeometryPool::initializeGL(GLuint program, GLsizei vertexStride,
+                                      std::span<const Attribute> attributes,
+                                      GLuint maxVertices, GLuint maxIndices) {
+  terminateGL();
+
+  m_vertexStride = vertexStride;
+  m_freeVertices = {{0, maxVertices}};
+  m_freeIndices = {{0, maxIndices}};
+
+#if defined(__EMSCRIPTEN__)
+  const auto immutable{false};
+  m_multiDraw = false;
+#else
+  const auto immutable{GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage};
+  m_multiDraw = (GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect) &&
+                (GLEW_VERSION_4_2 || GLEW_ARB_base_instance);
+#endif
+
+  glGenVertexArrays(1, &m_VAO);
+  glBindVertexArray(m_VAO);
+
+  // Vertex buffer and attributes
+  glGenBuffers(1, &m_VBO);
+  glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+  createBuffer(GL_ARRAY_BUFFER,
+               static_cast<GLsizeiptr>(maxVertices) * vertexStride, immutable);
+  for (const auto &attribute : attributes) {
+    const auto location{
+        glGetAttribLocation(program, std::string{attribute.name}.c_str())};
+    if (location < 0) continue;
+    glEnableVertexAttribArray(static_cast<GLuint>(location));
+    glVertexAttribPointer(static_cast<GLuint>(location), attribute.size, GL_FLOAT, GL_FALSE,
+                          vertexStride,
+                          // NOLINTNEXTLINE(performance-no-int-to-ptr)
+                          reinterpret_cast<void *>(attribute.offset));
+  }
+
+  // Draw IDs are read from an instanced attribute. With multi-draw, each
+  // command selects its ID through the base instance. Otherwise, the
+  // attribute array is left disabled and the ID is set before each draw.
+  m_drawIDLocation = glGetAttribLocation(program, "inDrawID");
+  if (m_multiDraw) {
+    glGenBuffers(1, &m_drawIDBuffer);
+    glGenBuffers(1, &m_indirectBuffer);
+    reserveDrawIDs(256);
+    if (m_drawIDLocation >= 0) {
+      glBindBuffer(GL_ARRAY_BUFFER, m_drawIDBuffer);
+      const auto location{static_cast<GLuint>(m_drawIDLocation)};
+      glEnableVertexAttribArray(location);
+      glVertexAttribIPointer(location, 1, GL_UNSIGNED_INT, 0, nullptr);
+      glVertexAttribDivisor(location, 1);
+    }
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  // Index buffer (part of the VAO state)
+  glGenBuffers(1, &m_EBO);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+  createBuffer(GL_ELEMENT_ARRAY_BUFFER,
+               static_cast<GLsizeiptr>(maxIndices * sizeof(GLuint)),
+               immutable);
+
+  glBindVertexArray(0);
+}
+
+/**
+ * @brief Uploads a mesh to the pool.
+ *
+ * @param vertices Pointer to the vertices, with the format given to
+ * initializeGL().
+ * @param vertexCount Number of vertices.
+ * @param indices Triangle indices relative to the first vertex.
+ * @throw abcg::Exception if the pool does not have enough free space.
+ * @return Location of the mesh in the pool.
+ */
+abcg::GeometryPool::Mesh abcg::GeometryPool::allocate(
+    const void *vertices, GLuint vertexCount, std::span<const GLuint> indices) {
+  const auto indexCount{static_cast<GLuint>(indices.size())};
+  const auto firstVertex{allocateRange(m_freeVertices, vertexCount)};
+  const auto firstIndex{allocateRange(m_freeIndices, indexCount)};
+  if (!firstVertex || !firstIndex) {
+    if (firstVertex) releaseRange(m_freeVertices, *firstVertex, vertexCount);
+    if (firstIndex) releaseRange(m_freeIndices, *firstIndex, indexCount);
+    throw abcg::Exception{abcg::Exception::Runtime(fmt::format(
+        "Geometry pool is full ({} vertices and {} indices requested)",
+        vertexCount, indexCount))};
+  }
+
+  glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+  glBufferSubData(GL_ARRAY_BUFFER,
+                  static_cast<GLintptr>(*firstVertex) * m_vertexStride,
+                  static_cast<GLsizeiptr>(vertexCount) * m_vertexStride,
+                  vertices);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  // Indices are stored relative to the start of the pool, so that the
+  // meshes can also be drawn without base vertex support
+  std::vector<GLuint> poolIndices(indices.begin(), indices.end());
+  for (auto &index : poolIndices) index += *firstVertex;
+
+  glBindVertexArray(m_VAO);
+  glBufferSubData(GL_ELEMENT_ARRAY_BUFFER,
+                  static_cast<GLintptr>(*firstIndex * sizeof(GLuint)),
+                  static_cast<GLsizeiptr>(indexCount * sizeof(GLuint)),
+                  poolIndices.data());
+  glBindVertexArray(0);
+
+  return {.firstVertex = *firstVertex,
+          .vertexCount = vertexCount,
+          .firstIndex = *firstIndex,
+          .indexCount = indexCount};
+}
+
+/**
+ * @brief Returns the space used by a mesh to the pool.
+ *
+ * The mesh must not be drawn afterwards.
+ *
+ * @param mesh Mesh returned by allocate().
+ */
+void abcg::GeometryPool::release(const Mesh &mesh) {
+  releaseRange(m_freeVertices, mesh.firstVertex, mesh.vertexCount);
+  releaseRange(m_freeIndices, mesh.firstIndex, mesh.indexCount);
+}
+
+/**
+ * @brief Draws a list of meshes.
+ *
+ * The program must be in use. The i-th mesh is drawn with `inDrawID` = i.
+ *
+ * @param meshes Meshes to be drawn.
+ */
+void abcg::GeometryPool::draw(std::span<const Mesh> meshes) {
+  m_stats = {.draws = meshes.size()};
+  if (meshes.empty()) return;
+
+  glBindVertexArray(m_VAO);
+
+#if !defined(__EMSCRIPTEN__)
+  if (m_multiDraw) {
+    const auto drawCount{static_cast<GLuint>(meshes.size())};
+    reserveDrawIDs(drawCount);
+
+    m_commands.resize(meshes.size());
+    for (GLuint drawID{}; drawID < drawCount; ++drawID) {
+      const auto &mesh{meshes[drawID]};
+      m_commands[drawID] = {.count = mesh.indexCount,
+                            .instanceCount = 1,
+                            .firstIndex = mesh.firstIndex,
+                            .baseVertex = 0,
+                            .baseInstance = drawID};
+    }
+
+    // The command buffer is orphaned every frame
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER,
+                 static_cast<GLsizeiptr>(m_commands.size() *
+                                         sizeof(DrawElementsIndirectCommand)),
+                 m_commands.data(), GL_STREAM_DRAW);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr,
+                                static_cast<GLsizei>(drawCount), 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    m_stats.drawCalls = 1;
+    glBindVertexArray(0);
+    return;
+  }
+#endif
+
+  for (GLuint drawID{}; drawID < meshes.size(); ++drawID) {
+    const auto &mesh{meshes[drawID]};
+    if (m_drawIDLocation >= 0) {
+      glVertexAttribI4ui(static_cast<GLuint>(m_drawIDLocation), drawID, 0, 0,
+                         0);
+    }
+    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(mesh.indexCount),
+                   GL_UNSIGNED_INT,
+                   // NOLINTNEXTLINE(performance-no-int-to-ptr)
+                   reinterpret_cast<void *>(mesh.firstIndex * sizeof(GLuint)));
+    ++m_stats.drawCalls;
+  }
+
+  glBindVertexArray(0);
+}
+
+/**
+ * @brief Releases the buffers, the VAO, and every mesh of the pool.
+ */
+void abcg::GeometryPool::terminateGL() {
+  glDeleteBuffers(1, &m_VBO);
+  glDeleteBuffers(1, &m_EBO);
+  glDeleteBuffers(1, &m_indirectBuffer);
+  glDeleteBuffers(1, &m_drawIDBuffer);
+  glDeleteVertexArrays(1, &m_VAO);
+  m_VBO = m_EBO = m_indirectBuffer = m_drawIDBuffer = m_VAO = 0;
+  m_drawIDCapacity = 0;
+  m_freeVertices.clear();
+  m_freeIndices.clear();
+  m_commands.clear();
+}
+
+void abcg::GeometryPool::checkStride(std::size_t stride) const {
+  if (stride != static_cast<std::size_t>(m_vertexStride)) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Vertex size {} does not match the stride {} of the "
+                    "geometry pool",
+                    stride, m_vertexStride))};
+  }
+}
+
+// Makes the buffer of draw IDs (0, 1, 2, ...) hold at least count values
+void abcg::GeometryPool::reserveDrawIDs(GLuint count) {
+  if (count <= m_drawIDCapacity) return;
+  m_drawIDCapacity = std::max(count, m_drawIDCapacity * 2);
+
+  std::vector<GLuint> drawIDs(m_drawIDCapacity);
+  std::iota(drawIDs.begin(), drawIDs.end(), 0U);
+
+  // Reallocating the store of the same buffer keeps the VAO binding valid
+  glBindBuffer(GL_ARRAY_BUFFER, m_drawIDBuffer);
+  glBufferData(GL_ARRAY_BUFFER,
+               static_cast<GLsizeiptr>(drawIDs.size() * sizeof(GLuint)),
+               drawIDs.data(), GL_STATIC_DRAW);
+}
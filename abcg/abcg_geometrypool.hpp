@@ -0,0 +1,133 @@
+/**
+ * @file abcg_geometrypool.hpp
+ * @brief abcg::GeometryPool header file.
+ *
+ * Declaration of abcg::GeometryPool class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_GEOMETRYPOOL_HPP_
+#define ABCG_GEOMETRYPOOL_HPP_
+
+#include <cstddef>
+#include <map>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "abcg_openglfunctions.hpp"
+
+namespace abcg {
+class GeometryPool;
+}  // namespace abcg
+
+/**
+ * @brief abcg::GeometryPool class.
+ *
+ * Large vertex and index buffers shared by meshes with the same vertex
+ * format, so that they can all be drawn with a single VAO.
+ *
+ * The buffers are created once with a fixed capacity, as immutable storage
+ * (`glBufferStorage`) when available. Meshes are sub-allocated with a
+ * first-fit free list and can be released and replaced at any time.
+ *
+ * A list of meshes is drawn with one `glMultiDrawElementsIndirect` call
+ * when the context supports OpenGL 4.3 (see OpenGLSettings::minorVersion),
+ * or with one `glDrawElements` per mesh otherwise (e.g., WebGL 2.0 and
+ * macOS).
+ *
+ * The index of each mesh in the draw list is available to the vertex
+ * shader as the integer attribute `inDrawID`, which can be used to fetch
+ * per-draw data such as model matrices and materials from a uniform array
+ * or buffer. GLSL 4.10 has no `gl_DrawID`, so the ID comes from an instanced
+ * attribute offset by the base instance of each indirect command.
+ */
+class abcg::GeometryPool {
+ public:
+  // Floating-point vertex attribute
+  struct Attribute {
+    std::string_view name;
+    GLint size{};
+    std::size_t offset{};
+  };
+
+  // Location of a mesh in the pool
+  struct Mesh {
+    GLuint firstVertex{};
+    GLuint vertexCount{};
+    GLuint firstIndex{};
+    GLuint indexCount{};
+  };
+
+  struct Stats {
+    std::size_t draws{};
+    std::size_t drawCalls{};
+  };
+
+  void initializeGL(GLuint program, GLsizei vertexStride,
+                    std::span<const Attribute> attributes, GLuint maxVertices,
+                    GLuint maxIndices);
+  [[nodiscard]] Mesh allocate(const void* vertices, GLuint vertexCount,
+                              std::span<const GLuint> indices);
+  void release(const Mesh& mesh);
+  void draw(std::span<const Mesh> meshes);
+  void terminateGL();
+
+  /**
+   * @brief Uploads a mesh to the pool.
+   *
+   * @param vertices Vertices with the format given to initializeGL().
+   * @param indices Triangle indices relative to the first vertex.
+   * @return Location of the mesh in the pool.
+   */
+  template <typename T>
+  [[nodiscard]] Mesh allocate(std::span<const T> vertices,
+                              std::span<const GLuint> indices) {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "Vertex type must be trivially copyable");
+    checkStride(sizeof(T));
+    return allocate(vertices.data(), static_cast<GLuint>(vertices.size()),
+                    indices);
+  }
+
+  [[nodiscard]] bool isMultiDrawSupported() const noexcept {
+    return m_multiDraw;
+  }
+  [[nodiscard]] Stats getStats() const noexcept { return m_stats; }
+
+ private:
+  // Free ranges (offset, size) of a buffer, in elements
+  using FreeList = std::map<GLuint, GLuint>;
+
+  // Layout of the commands read by glMultiDrawElementsIndirect
+  struct DrawElementsIndirectCommand {
+    GLuint count{};
+    GLuint instanceCount{};
+    GLuint firstIndex{};
+    GLint baseVertex{};
+    GLuint baseInstance{};
+  };
+
+  GLuint m_VAO{};
+  GLuint m_VBO{};
+  GLuint m_EBO{};
+  GLuint m_indirectBuffer{};
+  GLuint m_drawIDBuffer{};
+  GLint m_drawIDLocation{-1};
+
+  GLsizei m_vertexStride{};
+  GLuint m_drawIDCapacity{};
+  bool m_multiDraw{};
+
+  FreeList m_freeVertices;
+  FreeList m_freeIndices;
+  std::vector<DrawElementsIndirectCommand> m_commands;
+  Stats m_stats{};
+
+  void checkStride(std::size_t stride) const;
+  void reserveDrawIDs(GLuint count);
+};
+
+#endif
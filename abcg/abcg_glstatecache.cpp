@@ -0,0 +1,226 @@
+/**
+ * @file abcg_glstatecache.cpp
+ * @brief Definition of abcg::GLStateCache class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_glstatecache.hpp"
+
+#include <algorithm>
+#include <span>
+
+namespace {
+std::optional<std::size_t> textureTargetIndex(GLenum target) {
+  switch (target) {
+    case GL_TEXTURE_2D:
+      return 0;
+    case GL_TEXTURE_CUBE_MAP:
+      return 1;
+    case GL_TEXTURE_2D_ARRAY:
+      return 2;
+    case GL_TEXTURE_3D:
+      return 3;
+    default:
+      return std::nullopt;
+  }
+}
+
+std::optional<std::size_t> capabilityIndex(GLenum cap) {
+  switch (cap) {
+    case GL_DEPTH_TEST:
+      return 0;
+    case GL_CULL_FACE:
+      return 1;
+    case GL_BLEND:
+      return 2;
+    case GL_SCISSOR_TEST:
+      return 3;
+    case GL_STENCIL_TEST:
+      return 4;
+    case GL_POLYGON_OFFSET_FILL:
+      return 5;
+    default:
+      return std::nullopt;
+  }
+}
+
+std::uint64_t texParameterKey(GLuint texture, GLenum pname) {
+  return (static_cast<std::uint64_t>(texture) << 32) | pname;
+}
+
+// Forgets the cached names that were deleted
+void forget(std::optional<GLuint> &cached, std::span<const GLuint> names) {
+  if (cached && std::find(names.begin(), names.end(), *cached) != names.end()) {
+    cached.reset();
+  }
+}
+}  // namespace
+
+template <typename T>
+bool abcg::GLStateCache::check(std::optional<T> &cached, const T &value) {
+  if (!m_enabled) return false;
+  if (cached == value) {
+    ++m_stats.elided;
+    return true;
+  }
+  cached = value;
+  ++m_stats.issued;
+  return false;
+}
+
+/**
+ * @brief Enables or disables the cache.
+ *
+ * The cached state is invalidated in both cases.
+ *
+ * @param enabled Whether redundant calls should be skipped.
+ */
+void abcg::GLStateCache::setEnabled(bool enabled) {
+  m_enabled = enabled;
+  invalidate();
+}
+
+/**
+ * @brief Marks the whole cached state as unknown.
+ */
+void abcg::GLStateCache::invalidate() {
+  m_program.reset();
+  m_vertexArray.reset();
+  m_arrayBuffer.reset();
+  m_uniformBuffer.reset();
+  m_activeTexture.reset();
+  m_textures = {};
+  m_samplers = {};
+  m_capabilities = {};
+  m_blendFunc.reset();
+  m_blendEquation.reset();
+  m_depthFunc.reset();
+  m_depthMask.reset();
+  m_texParameters.clear();
+}
+
+bool abcg::GLStateCache::useProgram(GLuint program) {
+  return check(m_program, program);
+}
+
+bool abcg::GLStateCache::bindVertexArray(GLuint array) {
+  return check(m_vertexArray, array);
+}
+
+bool abcg::GLStateCache::bindBuffer(GLenum target, GLuint buffer) {
+  // The element array buffer binding is part of the VAO state and is not
+  // cached
+  if (target == GL_ARRAY_BUFFER) return check(m_arrayBuffer, buffer);
+  if (target == GL_UNIFORM_BUFFER) return check(m_uniformBuffer, buffer);
+  return false;
+}
+
+bool abcg::GLStateCache::activeTexture(GLenum texture) {
+  return check(m_activeTexture, texture);
+}
+
+bool abcg::GLStateCache::bindTexture(GLenum target, GLuint texture) {
+  auto *cached{boundTexture(target)};
+  if (cached == nullptr) return false;
+  return check(*cached, texture);
+}
+
+bool abcg::GLStateCache::bindSampler(GLuint unit, GLuint sampler) {
+  if (unit >= m_maxTextureUnits) return false;
+  return check(m_samplers.at(unit), sampler);
+}
+
+bool abcg::GLStateCache::setCapability(GLenum cap, bool enabled) {
+  auto index{capabilityIndex(cap)};
+  if (!index) return false;
+  return check(m_capabilities.at(*index), enabled);
+}
+
+bool abcg::GLStateCache::blendFunc(GLenum srcRGB, GLenum dstRGB,
+                                   GLenum srcAlpha, GLenum dstAlpha) {
+  return check(m_blendFunc,
+               std::array<GLenum, 4>{srcRGB, dstRGB, srcAlpha, dstAlpha});
+}
+
+bool abcg::GLStateCache::blendEquation(GLenum modeRGB, GLenum modeAlpha) {
+  return check(m_blendEquation, std::array<GLenum, 2>{modeRGB, modeAlpha});
+}
+
+bool abcg::GLStateCache::depthFunc(GLenum func) {
+  return check(m_depthFunc, func);
+}
+
+bool abcg::GLStateCache::depthMask(GLboolean flag) {
+  return check(m_depthMask, flag);
+}
+
+bool abcg::GLStateCache::texParameter(GLenum target, GLenum pname,
+                                      GLint param) {
+  if (!m_enabled) return false;
+  auto *texture{boundTexture(target)};
+  if (texture == nullptr || !texture->has_value()) return false;
+
+  auto [iter, inserted]{
+      m_texParameters.try_emplace(texParameterKey(**texture, pname), param)};
+  if (!inserted && iter->second == param) {
+    ++m_stats.elided;
+    return true;
+  }
+  iter->second = param;
+  ++m_stats.issued;
+  return false;
+}
+
+void abcg::GLStateCache::bindBufferIndexed(GLenum target, GLuint buffer) {
+  // glBindBufferBase/Range also bind to the generic binding point
+  if (target == GL_UNIFORM_BUFFER && m_enabled) m_uniformBuffer = buffer;
+}
+
+void abcg::GLStateCache::forgetTexParameter(GLenum target, GLenum pname) {
+  auto *texture{boundTexture(target)};
+  if (texture == nullptr || !texture->has_value()) {
+    m_texParameters.clear();
+    return;
+  }
+  m_texParameters.erase(texParameterKey(**texture, pname));
+}
+
+void abcg::GLStateCache::deletePrograms(GLsizei n, const GLuint *programs) {
+  forget(m_program, {programs, static_cast<std::size_t>(n)});
+}
+
+void abcg::GLStateCache::deleteVertexArrays(GLsizei n, const GLuint *arrays) {
+  forget(m_vertexArray, {arrays, static_cast<std::size_t>(n)});
+}
+
+void abcg::GLStateCache::deleteBuffers(GLsizei n, const GLuint *buffers) {
+  std::span<const GLuint> names{buffers, static_cast<std::size_t>(n)};
+  forget(m_arrayBuffer, names);
+  forget(m_uniformBuffer, names);
+}
+
+void abcg::GLStateCache::deleteTextures(GLsizei n, const GLuint *textures) {
+  std::span<const GLuint> names{textures, static_cast<std::size_t>(n)};
+  for (auto &unit : m_textures) {
+    for (auto &texture : unit) forget(texture, names);
+  }
+  std::erase_if(m_texParameters, [&](const auto &entry) {
+    auto texture{static_cast<GLuint>(entry.first >> 32)};
+    return std::find(names.begin(), names.end(), texture) != names.end();
+  });
+}
+
+void abcg::GLStateCache::deleteSamplers(GLsizei n, const GLuint *samplers) {
+  std::span<const GLuint> names{samplers, static_cast<std::size_t>(n)};
+  for (auto &sampler : m_samplers) forget(sampler, names);
+}
+
+std::optional<GLuint> *abcg::GLStateCache::boundTexture(GLenum target) {
+  auto targetIndex{textureTargetIndex(target)};
+  if (!targetIndex || !m_activeTexture) return nullptr;
+
+  auto unit{static_cast<std::size_t>(*m_activeTexture - GL_TEXTURE0)};
+  if (unit >= m_maxTextureUnits) return nullptr;
+  return &m_textures.at(unit).at(*targetIndex);
+}
@@ -0,0 +1,117 @@
+/**
+ * @file abcg_glstatecache.hpp
+ * @brief abcg::GLStateCache header file.
+ *
+ * Declaration of abcg::GLStateCache class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_GLSTATECACHE_HPP_
+#define ABCG_GLSTATECACHE_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+
+#include "abcg_external.hpp"
+
+namespace abcg {
+class GLStateCache;
+}  // namespace abcg
+
+/**
+ * @brief abcg::GLStateCache class.
+ *
+ * Shadow copy of the OpenGL state set through the wrappers of
+ * abcg_openglfunctions.hpp, used to skip calls that would not change the
+ * state.
+ *
+ * The following state is tracked: current program, vertex array object,
+ * array and uniform buffer bindings, active texture unit, texture bindings
+ * of each unit, sampler bindings, the capabilities set with
+ * glEnable/glDisable, blend function and equation, depth function and mask,
+ * and integer texture parameters.
+ *
+ * The cache is disabled by default (see OpenGLSettings::stateCache). State
+ * not yet set through the wrappers is unknown, so the first call always
+ * goes through. Code that changes the state directly through the OpenGL API
+ * must call invalidate() afterwards. abcg::OpenGLWindow does so after
+ * rendering the user interface.
+ */
+class abcg::GLStateCache {
+ public:
+  struct Stats {
+    std::size_t issued{};
+    std::size_t elided{};
+  };
+
+  [[nodiscard]] static GLStateCache& getInstance() {
+    static GLStateCache instance;
+    return instance;
+  }
+
+  void setEnabled(bool enabled);
+  [[nodiscard]] bool isEnabled() const noexcept { return m_enabled; }
+  void invalidate();
+
+  [[nodiscard]] Stats getStats() const noexcept { return m_stats; }
+  void resetStats() noexcept { m_stats = {}; }
+
+  // The following functions return true if the call is redundant
+  [[nodiscard]] bool useProgram(GLuint program);
+  [[nodiscard]] bool bindVertexArray(GLuint array);
+  [[nodiscard]] bool bindBuffer(GLenum target, GLuint buffer);
+  [[nodiscard]] bool activeTexture(GLenum texture);
+  [[nodiscard]] bool bindTexture(GLenum target, GLuint texture);
+  [[nodiscard]] bool bindSampler(GLuint unit, GLuint sampler);
+  [[nodiscard]] bool setCapability(GLenum cap, bool enabled);
+  [[nodiscard]] bool blendFunc(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha,
+                               GLenum dstAlpha);
+  [[nodiscard]] bool blendEquation(GLenum modeRGB, GLenum modeAlpha);
+  [[nodiscard]] bool depthFunc(GLenum func);
+  [[nodiscard]] bool depthMask(GLboolean flag);
+  [[nodiscard]] bool texParameter(GLenum target, GLenum pname, GLint param);
+
+  // Bookkeeping of calls that cannot be skipped
+  void bindBufferIndexed(GLenum target, GLuint buffer);
+  void forgetTexParameter(GLenum target, GLenum pname);
+  void deletePrograms(GLsizei n, const GLuint* programs);
+  void deleteVertexArrays(GLsizei n, const GLuint* arrays);
+  void deleteBuffers(GLsizei n, const GLuint* buffers);
+  void deleteTextures(GLsizei n, const GLuint* textures);
+  void deleteSamplers(GLsizei n, const GLuint* samplers);
+
+ private:
+  static constexpr std::size_t m_maxTextureUnits{32};
+  static constexpr std::size_t m_numTextureTargets{4};
+  static constexpr std::size_t m_numCapabilities{6};
+
+  bool m_enabled{};
+  Stats m_stats{};
+
+  std::optional<GLuint> m_program;
+  std::optional<GLuint> m_vertexArray;
+  std::optional<GLuint> m_arrayBuffer;
+  std::optional<GLuint> m_uniformBuffer;
+  std::optional<GLenum> m_activeTexture;
+  std::array<std::array<std::optional<GLuint>, m_numTextureTargets>,
+             m_maxTextureUnits>
+      m_textures{};
+  std::array<std::optional<GLuint>, m_maxTextureUnits> m_samplers{};
+  std::array<std::optional<bool>, m_numCapabilities> m_capabilities{};
+  std::optional<std::array<GLenum, 4>> m_blendFunc;
+  std::optional<std::array<GLenum, 2>> m_blendEquation;
+  std::optional<GLenum> m_depthFunc;
+  std::optional<GLboolean> m_depthMask;
+  // Key is texture name (high bits) and parameter name (low bits)
+  std::unordered_map<std::uint64_t, GLint> m_texParameters;
+
+  template <typename T>
+  [[nodiscard]] bool check(std::optional<T>& cached, const T& value);
+  [[nodiscard]] std::optional<GLuint>* boundTexture(GLenum target);
+};
+
+#endif
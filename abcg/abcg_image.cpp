@@ -9,6 +9,8 @@
 
 #include <fmt/core.h>
 
+#include <algorithm>
+#include <cmath>
 #include <cppitertools/itertools.hpp>
 #include <fstream>
 #include <gsl/gsl>
@@ -18,6 +20,7 @@
 #include "SDL_image.h"
 #include "abcg_exception.hpp"
 #include "abcg_external.hpp"
+#include "abcg_texturebudget.hpp"
 
 void flipHorizontally(gsl::not_null<SDL_Surface*> surface) {
   auto width{static_cast<size_t>(surface->w * surface->format->BytesPerPixel)};
@@ -62,70 +65,186 @@ void flipVertically(gsl::not_null<SDL_Surface*> surface) {
   }
 }
 
-GLuint abcg::opengl::loadTexture(std::string_view path, bool generateMipmaps) {
-  GLuint textureID{};
-
-  // Copy file data into buffer
-  std::ifstream input(path.data(), std::ios::binary);
-  if (!input) {
+/**
+ * @brief Loads an image file into main memory as RGBA.
+ *
+ * @param path Path to the image file.
+ *
+ * @return Image flipped upside down and converted to RGBA.
+ *
+ * @throw abcg::Exception if the file cannot be opened or decoded.
+ */
+abcg::Image abcg::loadImage(std::string_view path) {
+  SDL_Surface* surface{IMG_Load(path.data())};
+  if (surface == nullptr) {
     throw abcg::Exception{abcg::Exception::Runtime(
-        fmt::format("Failed to open texture file {}", path))};
+        fmt::format("Failed to load image file {}", path))};
   }
-  std::vector<char> buffer((std::istreambuf_iterator<char>(input)),
-                           std::istreambuf_iterator<char>());
-
-  // Load the bitmap
-  if (SDL_Surface * surface{IMG_Load(path.data())}) {
-    // Enforce RGB/RGBA
-    GLenum format{0};
-    SDL_Surface* formattedSurface{nullptr};
-    if (surface->format->BytesPerPixel == 3) {
-      formattedSurface =
-          SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGB24, 0);
-      format = GL_RGB;
-    } else {
-      formattedSurface =
-          SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA32, 0);
-      format = GL_RGBA;
-    }
-    SDL_FreeSurface(surface);
 
-    // Flip upside down
-    flipVertically(formattedSurface);
+  SDL_Surface* formattedSurface{
+      SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA32, 0)};
+  SDL_FreeSurface(surface);
+  if (formattedSurface == nullptr) {
+    throw abcg::Exception{
+        abcg::Exception::SDL("SDL_ConvertSurfaceFormat failed")};
+  }
 
-    // Generate the texture
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_2D, textureID);
-    glTexImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(format),
-                 formattedSurface->w, formattedSurface->h, 0, format,
-                 GL_UNSIGNED_BYTE, formattedSurface->pixels);
+  flipVertically(formattedSurface);
 
-    SDL_FreeSurface(formattedSurface);
+  Image image;
+  image.width = formattedSurface->w;
+  image.height = formattedSurface->h;
 
-    // Set texture filtering
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  // Copy row by row as the surface may have a pitch larger than 4 * width
+  auto rowSize{static_cast<size_t>(image.width) * 4};
+  image.pixels.resize(rowSize * static_cast<size_t>(image.height));
+  for (auto rowIndex : iter::range(static_cast<size_t>(image.height))) {
+    memcpy(image.pixels.data() + rowIndex * rowSize,
+           static_cast<std::byte*>(formattedSurface->pixels) +
+               rowIndex * static_cast<size_t>(formattedSurface->pitch),
+           rowSize);
+  }
+
+  SDL_FreeSurface(formattedSurface);
 
-    // Generate the mipmap levels
-    if (generateMipmaps) {
-      glGenerateMipmap(GL_TEXTURE_2D);
+  return image;
+}
 
-      // Override minifying filtering
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
-                      GL_LINEAR_MIPMAP_LINEAR);
+namespace {
+// Source texels and weights that contribute to each output texel
+struct Contributions {
+  std::vector<int> first;
+  std::vector<int> count;
+  std::vector<float> weights;
+  int maxCount{};
+};
+
+Contributions computeContributions(int sourceSize, int size) {
+  auto scale{static_cast<float>(sourceSize) / static_cast<float>(size)};
+  auto support{std::max(scale, 1.0f)};
+
+  Contributions result;
+  result.maxCount = static_cast<int>(std::ceil(support)) * 2 + 1;
+  result.first.resize(static_cast<size_t>(size));
+  result.count.resize(static_cast<size_t>(size));
+  result.weights.assign(static_cast<size_t>(size * result.maxCount), 0.0f);
+
+  for (auto index : iter::range(size)) {
+    // Triangle filter centered at the output texel, scaled when minifying
+    auto center{(static_cast<float>(index) + 0.5f) * scale};
+    auto first{static_cast<int>(std::floor(center - support))};
+    auto* weights{result.weights.data() +
+                  static_cast<size_t>(index * result.maxCount)};
+
+    auto sum{0.0f};
+    auto count{0};
+    for (auto offset : iter::range(result.maxCount)) {
+      auto distance{
+          std::abs(static_cast<float>(first + offset) + 0.5f - center) /
+          support};
+      weights[offset] = std::max(0.0f, 1.0f - distance);
+      sum += weights[offset];
+      if (weights[offset] > 0.0f) count = offset + 1;
     }
+    for (auto offset : iter::range(count)) weights[offset] /= sum;
 
-    // Set texture wrapping
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  } else {
-    throw abcg::Exception{abcg::Exception::Runtime(
-        fmt::format("Failed to load texture file {}", path))};
+    result.first.at(static_cast<size_t>(index)) = first;
+    result.count.at(static_cast<size_t>(index)) = count;
   }
 
-  glBindTexture(GL_TEXTURE_2D, 0);
+  return result;
+}
+}  // namespace
 
-  return textureID;
+/**
+ * @brief Resamples an RGBA image with a separable triangle filter.
+ *
+ * When minifying, the filter is widened to cover every source texel, so
+ * that the result does not alias. The vertical pass processes whole rows
+ * at once so that it can be vectorized by the compiler.
+ *
+ * @param image Source image.
+ * @param width Width of the resulting image.
+ * @param height Height of the resulting image.
+ *
+ * @return Resampled image.
+ */
+abcg::Image abcg::resizeImage(const Image& image, int width, int height) {
+  // Horizontal pass, to a floating-point intermediate image
+  auto horizontal{computeContributions(image.width, width)};
+  auto rowFloats{static_cast<size_t>(width) * 4};
+  std::vector<float> intermediate(rowFloats *
+                                  static_cast<size_t>(image.height));
+  for (auto y : iter::range(image.height)) {
+    const auto* source{image.pixels.data() +
+                       static_cast<size_t>(y * image.width) * 4};
+    auto* destination{intermediate.data() + static_cast<size_t>(y) * rowFloats};
+    for (auto x : iter::range(width)) {
+      const auto* weights{horizontal.weights.data() +
+                          static_cast<size_t>(x * horizontal.maxCount)};
+      std::array<float, 4> sum{};
+      auto first{horizontal.first[static_cast<size_t>(x)]};
+      auto count{horizontal.count[static_cast<size_t>(x)]};
+      for (auto offset : iter::range(count)) {
+        auto sourceX{std::clamp(first + offset, 0, image.width - 1)};
+        for (auto channel : iter::range(4)) {
+          sum.at(static_cast<size_t>(channel)) +=
+              weights[offset] *
+              static_cast<float>(source[sourceX * 4 + channel]);
+        }
+      }
+      std::copy(sum.begin(), sum.end(), destination + x * 4);
+    }
+  }
+
+  // Vertical pass, accumulating whole rows
+  auto vertical{computeContributions(image.height, height)};
+  Image result{.width = width,
+               .height = height,
+               .pixels = std::vector<std::uint8_t>(
+                   rowFloats * static_cast<size_t>(height))};
+  std::vector<float> accumulator(rowFloats);
+  for (auto y : iter::range(height)) {
+    std::fill(accumulator.begin(), accumulator.end(), 0.0f);
+    const auto* weights{vertical.weights.data() +
+                        static_cast<size_t>(y * vertical.maxCount)};
+    for (auto offset : iter::range(vertical.count[static_cast<size_t>(y)])) {
+      auto sourceY{std::clamp(vertical.first[static_cast<size_t>(y)] + offset,
+                              0, image.height - 1)};
+      const auto* row{intermediate.data() +
+                      static_cast<size_t>(sourceY) * rowFloats};
+      auto weight{weights[offset]};
+      for (size_t index{}; index < rowFloats; ++index) {
+        accumulator[index] += weight * row[index];
+      }
+    }
+
+    auto* destination{result.pixels.data() +
+                      static_cast<size_t>(y) * rowFloats};
+    for (size_t index{}; index < rowFloats; ++index) {
+      destination[index] = static_cast<std::uint8_t>(
+          std::clamp(accumulator[index] + 0.5f, 0.0f, 255.0f));
+    }
+  }
+
+  return result;
+}
+
+/**
+ * @brief Loads a 2D texture from an image file.
+ *
+ * The texture is accounted for in the global abcg::TextureBudget, and is
+ * downscaled if it would not fit in the budget.
+ *
+ * @param path Path to the image file.
+ * @param generateMipmaps Whether to generate mipmaps.
+ *
+ * @return Name of the texture object.
+ *
+ * @throw abcg::Exception if the image cannot be loaded.
+ */
+GLuint abcg::opengl::loadTexture(std::string_view path, bool generateMipmaps) {
+  return TextureBudget::getInstance().loadTexture(path, generateMipmaps);
 }
 
 GLuint abcg::opengl::loadCubemap(std::array<std::string_view, 6> paths,
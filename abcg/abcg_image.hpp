@@ -10,7 +10,27 @@
 
 #include <abcg_external.hpp>
 #include <array>
+#include <cstdint>
 #include <string_view>
+#include <vector>
+
+namespace abcg {
+struct Image;
+[[nodiscard]] Image loadImage(std::string_view path);
+[[nodiscard]] Image resizeImage(const Image& image, int width, int height);
+}  // namespace abcg
+
+/**
+ * @brief RGBA image stored in main memory.
+ *
+ * Pixels are tightly packed, 4 bytes per pixel, with the first row at the
+ * bottom (as expected by glTexImage2D).
+ */
+struct abcg::Image {
+  int width{};
+  int height{};
+  std::vector<std::uint8_t> pixels;
+};
 
 namespace abcg::opengl {
 [[nodiscard]] GLuint loadTexture(std::string_view path,
@@ -0,0 +1,347 @@
+/**
+ * @file abcg_impostor.cpp
+ * @brief Definition of abcg::Impostor class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_impostor.hpp"
+
+#include <fmt/core.h>
+
+#include <array>
+#include <cmath>
+#include <cppitertools/itertools.hpp>
+#include <filesystem>
+#include <fstream>
+#include <glm/geometric.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <vector>
+
+#include "abcg_exception.hpp"
+
+namespace {
+// Identifies the files written by this version of the cache
+constexpr std::uint32_t fileMagic{0x314d4941};  // "AIM1"
+
+struct FileHeader {
+  std::uint32_t magic{};
+  std::uint32_t frames{};
+  std::uint32_t frameSize{};
+  std::uint32_t reserved{};
+  std::uint64_t hash{};
+};
+
+// 64-bit FNV-1a hash of a sequence of bytes, continuing from a previous
+// hash
+std::uint64_t hashBytes(const void *data, std::size_t size,
+                        std::uint64_t hash = 0xcbf29ce484222325) {
+  const auto *bytes{static_cast<const unsigned char *>(data)};
+  for (const auto index : iter::range(size)) {
+    hash ^= bytes[index];
+    hash *= 0x100000001b3;
+  }
+  return hash;
+}
+
+// Bytes of the two RGBA8 textures of an atlas
+std::size_t getAtlasBytes(GLsizei atlasSize) {
+  return static_cast<std::size_t>(atlasSize) *
+         static_cast<std::size_t>(atlasSize) * 4;
+}
+}  // namespace
+
+/**
+ * @brief Creates the atlas of an object, from the cache file if possible.
+ *
+ * Must be called with a current OpenGL context. The framebuffer binding,
+ * viewport, clear color, depth test and pixel pack and unpack alignments are
+ * restored afterwards.
+ *
+ * @param bounds Bounding sphere of the object, in the space of the vertices
+ * drawn by the callback.
+ * @param draw Callback that draws the object with the given camera.
+ * @param settings Number and size of the views.
+ * @param cachePath Path of the cache file. If empty, the atlas is always
+ * rendered and not stored.
+ * @param cacheKey Identifies the object and how it is drawn, e.g., the
+ * path of the mesh and of its texture. The cache file is only loaded if it
+ * was stored with the same key.
+ *
+ * @throw abcg::Exception if the settings are invalid or the framebuffer
+ * cannot be created.
+ */
+void abcg::Impostor::create(const BoundingSphere &bounds,
+                            const DrawCallback &draw,
+                            const ImpostorSettings &settings,
+                            std::string_view cachePath,
+                            std::string_view cacheKey) {
+  terminateGL();
+
+  if (settings.frames <= 0 || settings.frameSize <= 0) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Invalid impostor atlas of {}x{} views of {} texels",
+                    settings.frames, settings.frames, settings.frameSize))};
+  }
+  m_bounds = bounds;
+  m_settings = settings;
+
+  auto hash{hashBytes(cacheKey.data(), cacheKey.size())};
+  hash = hashBytes(&m_bounds.center, sizeof(m_bounds.center), hash);
+  hash = hashBytes(&m_bounds.radius, sizeof(m_bounds.radius), hash);
+
+  m_cached = !cachePath.empty() && load(cachePath, hash);
+  if (!m_cached) render(draw, cachePath, hash);
+}
+
+/**
+ * @brief Binds the atlas to a program.
+ *
+ * Sets the uniform variables `impostorColorTex`, `impostorNormalDepthTex`,
+ * `impostorFrames`, `impostorCenter` and `impostorRadius`. The textures are
+ * bound to two consecutive texture units, and the active texture unit is
+ * set back to `GL_TEXTURE0`.
+ *
+ * @param program Program in use.
+ * @param firstTextureUnit First of the texture units to use.
+ */
+void abcg::Impostor::bind(Program &program, GLint firstTextureUnit) const {
+  abcg::glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(firstTextureUnit));
+  abcg::glBindTexture(GL_TEXTURE_2D, m_colorTexture);
+  abcg::glActiveTexture(GL_TEXTURE0 +
+                        static_cast<GLenum>(firstTextureUnit + 1));
+  abcg::glBindTexture(GL_TEXTURE_2D, m_normalDepthTexture);
+  abcg::glActiveTexture(GL_TEXTURE0);
+
+  program.setUniform("impostorColorTex", firstTextureUnit);
+  program.setUniform("impostorNormalDepthTex", firstTextureUnit + 1);
+  program.setUniform("impostorFrames", m_settings.frames);
+  program.setUniform("impostorCenter", m_bounds.center);
+  program.setUniform("impostorRadius", m_bounds.radius);
+}
+
+void abcg::Impostor::terminateGL() {
+  abcg::glDeleteTextures(1, &m_colorTexture);
+  abcg::glDeleteTextures(1, &m_normalDepthTexture);
+  m_colorTexture = m_normalDepthTexture = 0;
+  m_cached = false;
+}
+
+/**
+ * @brief Returns the direction a view of the atlas is seen from.
+ *
+ * Maps the unit square to the octahedron |x| + |y| + |z| = 1, with +y at
+ * the center of the square and -y at its corners, and projects the point
+ * to the unit sphere.
+ *
+ * @param uv Coordinates in the atlas, in [0, 1].
+ *
+ * @return Unit vector from the center of the object to the camera.
+ */
+glm::vec3 abcg::Impostor::getFrameDirection(const glm::vec2 &uv) {
+  const auto point{uv * 2.0f - 1.0f};
+  glm::vec3 direction{point.x, 1.0f - std::abs(point.x) - std::abs(point.y),
+                      point.y};
+  if (direction.y < 0.0f) {
+    // Lower half, folded over the diagonals of the square
+    direction.x = (1.0f - std::abs(point.y)) * (point.x >= 0.0f ? 1.0f : -1.0f);
+    direction.z = (1.0f - std::abs(point.x)) * (point.y >= 0.0f ? 1.0f : -1.0f);
+  }
+  return glm::normalize(direction);
+}
+
+/**
+ * @brief Returns the view matrix of the camera of a view of the atlas.
+ *
+ * The camera looks at the center of the bounding sphere from the given
+ * direction, with the y axis of the object as the up vector, or the z axis
+ * if the direction is close to the y axis.
+ *
+ * @param bounds Bounding sphere of the object.
+ * @param direction Unit vector from the center to the camera.
+ *
+ * @return View matrix. Its x and y axes are the axes of the view in the
+ * atlas.
+ */
+glm::mat4 abcg::Impostor::getFrameViewMatrix(const BoundingSphere &bounds,
+                                             const glm::vec3 &direction) {
+  const glm::vec3 up{std::abs(direction.y) > 0.999f ? glm::vec3{0, 0, 1}
+                                                    : glm::vec3{0, 1, 0}};
+  return glm::lookAt(bounds.center + direction * bounds.radius, bounds.center,
+                     up);
+}
+
+void abcg::Impostor::createTextures(const void *colorData,
+                                    const void *normalDepthData) {
+  const auto size{getAtlasSize()};
+  for (auto [texture, data] : {std::pair{&m_colorTexture, colorData},
+                               std::pair{&m_normalDepthTexture,
+                                         normalDepthData}}) {
+    abcg::glGenTextures(1, texture);
+    abcg::glBindTexture(GL_TEXTURE_2D, *texture);
+    abcg::glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA,
+                       GL_UNSIGNED_BYTE, data);
+    abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  }
+  abcg::glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// Renders the views to the atlas and stores it in the cache file, if any
+void abcg::Impostor::render(const DrawCallback &draw,
+                            std::string_view cachePath, std::uint64_t hash) {
+  createTextures(nullptr, nullptr);
+  const auto size{getAtlasSize()};
+
+  // State restored at the end
+  GLint previousFramebuffer{};
+  abcg::glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+  std::array<GLint, 4> previousViewport{};
+  abcg::glGetIntegerv(GL_VIEWPORT, previousViewport.data());
+  std::array<GLfloat, 4> previousClearColor{};
+  abcg::glGetFloatv(GL_COLOR_CLEAR_VALUE, previousClearColor.data());
+  const auto depthTest{abcg::glIsEnabled(GL_DEPTH_TEST)};
+  GLint previousPackAlignment{};
+  abcg::glGetIntegerv(GL_PACK_ALIGNMENT, &previousPackAlignment);
+
+  GLuint depthRenderbuffer{};
+  abcg::glGenRenderbuffers(1, &depthRenderbuffer);
+  abcg::glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
+  abcg::glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, size,
+                              size);
+  abcg::glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  GLuint framebuffer{};
+  abcg::glGenFramebuffers(1, &framebuffer);
+  abcg::glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  abcg::glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                               GL_TEXTURE_2D, m_colorTexture, 0);
+  abcg::glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1,
+                               GL_TEXTURE_2D, m_normalDepthTexture, 0);
+  abcg::glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                                  GL_RENDERBUFFER, depthRenderbuffer);
+  const std::array<GLenum, 2> drawBuffers{GL_COLOR_ATTACHMENT0,
+                                          GL_COLOR_ATTACHMENT1};
+  abcg::glDrawBuffers(static_cast<GLsizei>(drawBuffers.size()),
+                      drawBuffers.data());
+
+  const auto release{[&] {
+    abcg::glBindFramebuffer(GL_FRAMEBUFFER,
+                            static_cast<GLuint>(previousFramebuffer));
+    abcg::glDeleteFramebuffers(1, &framebuffer);
+    abcg::glDeleteRenderbuffers(1, &depthRenderbuffer);
+    abcg::glViewport(previousViewport[0], previousViewport[1],
+                     previousViewport[2], previousViewport[3]);
+    abcg::glClearColor(previousClearColor[0], previousClearColor[1],
+                       previousClearColor[2], previousClearColor[3]);
+    if (depthTest == GL_FALSE) abcg::glDisable(GL_DEPTH_TEST);
+    abcg::glPixelStorei(GL_PACK_ALIGNMENT, previousPackAlignment);
+  }};
+
+  const auto status{abcg::glCheckFramebufferStatus(GL_FRAMEBUFFER)};
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
+    release();
+    terminateGL();
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Incomplete impostor framebuffer ({:#x})", status))};
+  }
+
+  // Uncovered texels have zero alpha
+  abcg::glEnable(GL_DEPTH_TEST);
+  abcg::glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+  abcg::glViewport(0, 0, size, size);
+  abcg::glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+  // Orthographic projection of the bounding sphere, from the front of the
+  // sphere to its back
+  const auto radius{m_bounds.radius};
+  const auto projMatrix{
+      glm::ortho(-radius, radius, -radius, radius, 0.0f, 2.0f * radius)};
+  const auto frames{m_settings.frames};
+  const auto frameSize{m_settings.frameSize};
+  for (const auto y : iter::range(frames)) {
+    for (const auto x : iter::range(frames)) {
+      const glm::vec2 uv{
+          (static_cast<float>(x) + 0.5f) / static_cast<float>(frames),
+          (static_cast<float>(y) + 0.5f) / static_cast<float>(frames)};
+      abcg::glViewport(x * frameSize, y * frameSize, frameSize, frameSize);
+      draw(getFrameViewMatrix(m_bounds, getFrameDirection(uv)), projMatrix);
+    }
+  }
+
+  if (!cachePath.empty()) {
+    std::vector<std::uint8_t> colorData(getAtlasBytes(size));
+    std::vector<std::uint8_t> normalDepthData(getAtlasBytes(size));
+    abcg::glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    abcg::glReadBuffer(GL_COLOR_ATTACHMENT0);
+    abcg::glReadPixels(0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE,
+                       colorData.data());
+    abcg::glReadBuffer(GL_COLOR_ATTACHMENT1);
+    abcg::glReadPixels(0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE,
+                       normalDepthData.data());
+    abcg::glReadBuffer(GL_COLOR_ATTACHMENT0);
+    store(cachePath, hash, colorData, normalDepthData);
+  }
+
+  release();
+}
+
+// Creates the textures from the cache file. Returns false if the file does
+// not exist or was stored for another object or with other settings
+bool abcg::Impostor::load(std::string_view path, std::uint64_t hash) {
+  std::ifstream stream(path.data(), std::ios::binary);
+  if (!stream) return false;
+
+  FileHeader header{};
+  stream.read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (!stream || header.magic != fileMagic || header.hash != hash ||
+      header.frames != static_cast<std::uint32_t>(m_settings.frames) ||
+      header.frameSize != static_cast<std::uint32_t>(m_settings.frameSize)) {
+    return false;
+  }
+
+  const auto bytes{getAtlasBytes(getAtlasSize())};
+  std::vector<char> colorData(bytes);
+  std::vector<char> normalDepthData(bytes);
+  stream.read(colorData.data(), static_cast<std::streamsize>(bytes));
+  stream.read(normalDepthData.data(), static_cast<std::streamsize>(bytes));
+  if (!stream) return false;
+
+  GLint previousUnpackAlignment{};
+  abcg::glGetIntegerv(GL_UNPACK_ALIGNMENT, &previousUnpackAlignment);
+  abcg::glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  createTextures(colorData.data(), normalDepthData.data());
+  abcg::glPixelStorei(GL_UNPACK_ALIGNMENT, previousUnpackAlignment);
+  return true;
+}
+
+// Writes the atlas to the cache file. Failures only print a warning
+void abcg::Impostor::store(
+    std::string_view path, std::uint64_t hash,
+    std::span<const std::uint8_t> colorData,
+    std::span<const std::uint8_t> normalDepthData) const {
+  // Write to a temporary file first so that an interrupted write never
+  // leaves a truncated atlas behind
+  const std::string temporaryPath{fmt::format("{}.tmp", path)};
+  {
+    std::ofstream stream(temporaryPath, std::ios::binary | std::ios::trunc);
+    const FileHeader header{
+        .magic = fileMagic,
+        .frames = static_cast<std::uint32_t>(m_settings.frames),
+        .frameSize = static_cast<std::uint32_t>(m_settings.frameSize),
+        .hash = hash};
+    stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    for (const auto data : {colorData, normalDepthData}) {
+      stream.write(reinterpret_cast<const char *>(data.data()),
+                   static_cast<std::streamsize>(data.size()));
+    }
+    if (!stream) {
+      fmt::print("Warning: failed to write impostor atlas to {}\n", path);
+      return;
+    }
+  }
+  std::error_code errorCode;
+  std::filesystem::rename(temporaryPath, path, errorCode);
+}
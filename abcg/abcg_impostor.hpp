@@ -0,0 +1,114 @@
+/**
+ * @file abcg_impostor.hpp
+ * @brief abcg::Impostor header file.
+ *
+ * Declaration of abcg::Impostor class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_IMPOSTOR_HPP_
+#define ABCG_IMPOSTOR_HPP_
+
+#include <cstdint>
+#include <functional>
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <span>
+#include <string_view>
+
+#include "abcg_bounds.hpp"
+#include "abcg_openglfunctions.hpp"
+#include "abcg_program.hpp"
+
+namespace abcg {
+class Impostor;
+struct ImpostorSettings;
+}  // namespace abcg
+
+/**
+ * @brief Settings of abcg::Impostor.
+ */
+struct abcg::ImpostorSettings {
+  // Number of views along each side of the atlas
+  int frames{8};
+  // Size of each view, in texels
+  int frameSize{128};
+};
+
+/**
+ * @brief abcg::Impostor class.
+ *
+ * Octahedral impostor: views of an object from directions spread over the
+ * sphere, rendered to an atlas so that the object can be drawn far away as
+ * a single quad.
+ *
+ * The views are laid out in a grid of ImpostorSettings::frames by
+ * ImpostorSettings::frames. The center of each cell of the grid, mapped from
+ * the unit square to the octahedron and projected to the sphere (see
+ * getFrameDirection()), is the direction the object is seen from. Each view
+ * is an orthographic projection of the bounding sphere of the object.
+ *
+ * The atlas has two textures. The first is the color of the object, with
+ * coverage in alpha. The second is the normal in object space, mapped to
+ * [0, 1], and the depth within the bounding sphere along the view
+ * direction, from 0 at the front to 1 at the back. The views are drawn by
+ * a callback, with a program that writes the two textures to outputs 0 and
+ * 1, so any mesh and vertex layout can be used.
+ *
+ * Baking reads the atlas back to write it to a cache file. When the file
+ * exists and was written for the same key, settings and bounds, the atlas
+ * is loaded from it instead of rendered.
+ *
+ * To draw an instance, a shader converts the direction of the camera in
+ * object space to the nearest view with the same octahedral mapping, and
+ * orients a quad as the camera of that view was oriented (see
+ * getFrameViewMatrix()). The depth can be used to write the depth of the
+ * surface, and the normal to light the impostor like the mesh.
+ */
+class abcg::Impostor {
+ public:
+  // Draws the object with the given camera. The viewport and the
+  // framebuffer are already set
+  using DrawCallback = std::function<void(const glm::mat4& viewMatrix,
+                                          const glm::mat4& projMatrix)>;
+
+  void create(const BoundingSphere& bounds, const DrawCallback& draw,
+              const ImpostorSettings& settings = {},
+              std::string_view cachePath = {}, std::string_view cacheKey = {});
+  void bind(Program& program, GLint firstTextureUnit) const;
+  void terminateGL();
+
+  [[nodiscard]] BoundingSphere getBounds() const noexcept { return m_bounds; }
+  [[nodiscard]] ImpostorSettings getSettings() const noexcept {
+    return m_settings;
+  }
+  // Whether the atlas was loaded from the cache file instead of rendered
+  [[nodiscard]] bool isCached() const noexcept { return m_cached; }
+
+  [[nodiscard]] static glm::vec3 getFrameDirection(const glm::vec2& uv);
+  [[nodiscard]] static glm::mat4 getFrameViewMatrix(
+      const BoundingSphere& bounds, const glm::vec3& direction);
+
+ private:
+  BoundingSphere m_bounds{};
+  ImpostorSettings m_settings{};
+  bool m_cached{};
+
+  GLuint m_colorTexture{};
+  GLuint m_normalDepthTexture{};
+
+  void createTextures(const void* colorData, const void* normalDepthData);
+  void render(const DrawCallback& draw, std::string_view cachePath,
+              std::uint64_t hash);
+  [[nodiscard]] bool load(std::string_view path, std::uint64_t hash);
+  void store(std::string_view path, std::uint64_t hash,
+             std::span<const std::uint8_t> colorData,
+             std::span<const std::uint8_t> normalDepthData) const;
+  [[nodiscard]] GLsizei getAtlasSize() const noexcept {
+    return m_settings.frames * m_settings.frameSize;
+  }
+};
+
+#endif
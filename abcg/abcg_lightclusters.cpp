@@ -0,0 +1,394 @@
+/**
+ * @file abcg_lightclusters.cpp
+ * @brief Definition of abcg::LightClusters class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_lightclusters.hpp"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cppitertools/itertools.hpp>
+#include <glm/common.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/matrix.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vector_relational.hpp>
+#include <limits>
+
+#include "abcg_elapsedtimer.hpp"
+
+namespace {
+// Width of the data textures. Texels are filled row by row
+constexpr GLsizei textureWidth{1024};
+
+// Number of clusters tested at once against a light
+constexpr int lanes{8};
+
+// Point in view space at the given normalized device coordinates
+glm::vec3 unproject(const glm::mat4 &inverseProjMatrix, float x, float y,
+                    float z) {
+  const auto point{inverseProjMatrix * glm::vec4(x, y, z, 1.0f)};
+  return glm::vec3(point) / point.w;
+}
+}  // namespace
+
+/**
+ * @brief Creates the textures of the light lists.
+ *
+ * @param gridSize Number of clusters along the x and y axes of the screen
+ * and along the view depth.
+ */
+void abcg::LightClusters::initializeGL(const glm::ivec3 &gridSize) {
+  m_gridSize = glm::max(gridSize, glm::ivec3{1});
+
+  // Projection of the bounds, computed on the first update
+  m_projMatrix = glm::mat4{0.0f};
+
+  const auto numClusters{static_cast<std::size_t>(m_gridSize.x) *
+                         static_cast<std::size_t>(m_gridSize.y) *
+                         static_cast<std::size_t>(m_gridSize.z)};
+  // Padded so that the last clusters can be tested a whole lane array at a
+  // time
+  for (auto *bounds : {&m_minX, &m_minY, &m_minZ, &m_maxX, &m_maxY, &m_maxZ}) {
+    bounds->assign(numClusters + lanes, 0.0f);
+  }
+  m_clusterData.assign(numClusters * 2, 0);
+  m_cursors.assign(numClusters, 0);
+
+  update({}, glm::mat4{1.0f}, glm::mat4{1.0f}, 1.0f, 2.0f);
+}
+
+/**
+ * @brief Bins the lights into clusters and uploads the light lists.
+ *
+ * Called once per frame, before the lights are drawn.
+ *
+ * @param lights Lights of the scene.
+ * @param viewMatrix View matrix of the camera.
+ * @param projMatrix Projection matrix of the camera (perspective or
+ * orthographic).
+ * @param nearPlane Distance to the near plane of the projection.
+ * @param farPlane Distance to the far plane of the projection.
+ */
+void abcg::LightClusters::update(std::span<const PointLight> lights,
+                                 const glm::mat4 &viewMatrix,
+                                 const glm::mat4 &projMatrix, float nearPlane,
+                                 float farPlane) {
+  const ElapsedTimer timer;
+
+  if (projMatrix != m_projMatrix || nearPlane != m_nearPlane ||
+      farPlane != m_farPlane) {
+    computeBounds(projMatrix, nearPlane, farPlane);
+  }
+
+  m_stats = {.lights = lights.size()};
+  m_references.clear();
+  m_lightData.clear();
+  for (const auto index : iter::range(lights.size())) {
+    const auto &light{lights[index]};
+    const glm::vec3 position{viewMatrix * glm::vec4(light.position, 1.0f)};
+    m_lightData.emplace_back(position, light.radius);
+    m_lightData.emplace_back(light.color, 0.0f);
+
+    const auto references{m_references.size()};
+    binLight(position, light.radius, static_cast<std::uint32_t>(index));
+    if (m_references.size() > references) ++m_stats.visibleLights;
+  }
+
+  // Sort the references by cluster (counting sort), keeping the order of
+  // the lights within each cluster
+  const auto numClusters{m_cursors.size()};
+  std::fill(m_cursors.begin(), m_cursors.end(), 0);
+  for (const auto &[cluster, light] : m_references) ++m_cursors.at(cluster);
+
+  std::uint32_t offset{};
+  for (const auto cluster : iter::range(numClusters)) {
+    const auto count{m_cursors.at(cluster)};
+    const auto kept{std::min(count, static_cast<std::uint32_t>(
+                                        maxLightsPerCluster))};
+    m_stats.droppedReferences += count - kept;
+    m_stats.maxLightsPerCluster =
+        std::max(m_stats.maxLightsPerCluster, static_cast<std::size_t>(count));
+
+    m_clusterData.at(cluster * 2) = offset;
+    m_clusterData.at(cluster * 2 + 1) = kept;
+    m_cursors.at(cluster) = 0;
+    offset += kept;
+  }
+
+  m_indexData.resize(offset);
+  for (const auto &[cluster, light] : m_references) {
+    auto &cursor{m_cursors.at(cluster)};
+    if (cursor == m_clusterData.at(cluster * 2 + 1)) continue;
+    m_indexData.at(m_clusterData.at(cluster * 2) + cursor) = light;
+    ++cursor;
+  }
+  m_stats.references = m_indexData.size();
+
+  upload(m_lightTexture, GL_RGBA32F, GL_RGBA, GL_FLOAT, sizeof(glm::vec4),
+         m_lightData.data(), m_lightData.size());
+  upload(m_clusterTexture, GL_RG32UI, GL_RG_INTEGER, GL_UNSIGNED_INT,
+         sizeof(std::uint32_t) * 2, m_clusterData.data(), numClusters);
+  upload(m_indexTexture, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT,
+         sizeof(std::uint32_t), m_indexData.data(), m_indexData.size());
+
+  m_stats.binningTime = static_cast<float>(timer.elapsed() * 1000.0);
+}
+
+/**
+ * @brief Binds the light lists to a program.
+ *
+ * Sets the uniform variables declared in `clusters.glsl`. The textures are
+ * bound to three consecutive texture units, and the active texture unit is
+ * set back to `GL_TEXTURE0`.
+ *
+ * @param program Program in use.
+ * @param firstTextureUnit First of the texture units to use.
+ */
+void abcg::LightClusters::bind(Program &program,
+                               GLint firstTextureUnit) const {
+  const std::array textures{std::pair{"lightTex", m_lightTexture.texture},
+                            std::pair{"clusterTex", m_clusterTexture.texture},
+                            std::pair{"lightIndexTex", m_indexTexture.texture}};
+  for (const auto index : iter::range(textures.size())) {
+    const auto &[name, texture] = textures.at(index);
+    const auto unit{firstTextureUnit + static_cast<GLint>(index)};
+    abcg::glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(unit));
+    abcg::glBindTexture(GL_TEXTURE_2D, texture);
+    program.setUniform(name, unit);
+  }
+  abcg::glActiveTexture(GL_TEXTURE0);
+
+  // The depth slice of a point is log(depth) * scale + bias
+  const auto slices{static_cast<float>(m_gridSize.z)};
+  const auto logRatio{std::log(m_farPlane / m_nearPlane)};
+  program.setUniform("clusterGridSize", m_gridSize);
+  program.setUniform(
+      "clusterDepthParams",
+      glm::vec2{slices / logRatio, -slices * std::log(m_nearPlane) / logRatio});
+}
+
+void abcg::LightClusters::terminateGL() {
+  for (auto *texture : {&m_lightTexture, &m_clusterTexture, &m_indexTexture}) {
+    abcg::glDeleteTextures(1, &texture->texture);
+    *texture = {};
+  }
+}
+
+void abcg::LightClusters::paintUI() const {
+  ImGui::SetNextWindowSize(ImVec2(300, 160), ImGuiCond_FirstUseEver);
+  ImGui::Begin("Light clusters");
+
+  const auto numClusters{m_cursors.size()};
+  ImGui::Text("Grid: %dx%dx%d", m_gridSize.x, m_gridSize.y, m_gridSize.z);
+  ImGui::Text("Lights: %zu (%zu visible)", m_stats.lights,
+              m_stats.visibleLights);
+  ImGui::Text("Lights per cluster: %.1f avg, %zu max",
+              numClusters == 0 ? 0.0
+                               : static_cast<double>(m_stats.references) /
+                                     static_cast<double>(numClusters),
+              m_stats.maxLightsPerCluster);
+  ImGui::Text("Dropped references: %zu", m_stats.droppedReferences);
+  ImGui::Text("Binning: %.3f ms", static_cast<double>(m_stats.binningTime));
+
+  ImGui::End();
+}
+
+// Computes the bounds in view space of the clusters of a projection
+void abcg::LightClusters::computeBounds(const glm::mat4 &projMatrix,
+                                        float nearPlane, float farPlane) {
+  m_projMatrix = projMatrix;
+  m_nearPlane = nearPlane;
+  m_farPlane = farPlane;
+
+  // Lines through the corners of the tiles, from the near plane to the far
+  // plane
+  const auto inverseProjMatrix{glm::inverse(projMatrix)};
+  std::vector<std::pair<glm::vec3, glm::vec3>> lines;
+  for (const auto y : iter::range(m_gridSize.y + 1)) {
+    for (const auto x : iter::range(m_gridSize.x + 1)) {
+      const auto ndcX{-1.0f + 2.0f * static_cast<float>(x) /
+                                  static_cast<float>(m_gridSize.x)};
+      const auto ndcY{-1.0f + 2.0f * static_cast<float>(y) /
+                                  static_cast<float>(m_gridSize.y)};
+      lines.emplace_back(unproject(inverseProjMatrix, ndcX, ndcY, -1.0f),
+                         unproject(inverseProjMatrix, ndcX, ndcY, 1.0f));
+    }
+  }
+  // Point of a line at the given view depth
+  const auto pointAt{[](const std::pair<glm::vec3, glm::vec3> &line,
+                        float depth) {
+    const auto &[nearPoint, farPoint] = line;
+    const auto t{(depth + nearPoint.z) / (nearPoint.z - farPoint.z)};
+    return glm::mix(nearPoint, farPoint, t);
+  }};
+
+  for (const auto z : iter::range(m_gridSize.z)) {
+    // Slices are spaced exponentially, as in the shaders
+    const auto slices{static_cast<float>(m_gridSize.z)};
+    const auto ratio{farPlane / nearPlane};
+    const std::array depths{
+        nearPlane * std::pow(ratio, static_cast<float>(z) / slices),
+        nearPlane * std::pow(ratio, static_cast<float>(z + 1) / slices)};
+
+    for (const auto y : iter::range(m_gridSize.y)) {
+      for (const auto x : iter::range(m_gridSize.x)) {
+        glm::vec3 minBounds{std::numeric_limits<float>::max()};
+        glm::vec3 maxBounds{std::numeric_limits<float>::lowest()};
+        for (const auto corner : iter::range(4)) {
+          const auto lineX{x + corner % 2};
+          const auto lineY{y + corner / 2};
+          const auto &line{lines.at(
+              static_cast<std::size_t>(lineY * (m_gridSize.x + 1) + lineX))};
+          for (const auto depth : depths) {
+            const auto point{pointAt(line, depth)};
+            minBounds = glm::min(minBounds, point);
+            maxBounds = glm::max(maxBounds, point);
+          }
+        }
+
+        const auto index{static_cast<std::size_t>(
+            (z * m_gridSize.y + y) * m_gridSize.x + x)};
+        m_minX.at(index) = minBounds.x;
+        m_minY.at(index) = minBounds.y;
+        m_minZ.at(index) = minBounds.z;
+        m_maxX.at(index) = maxBounds.x;
+        m_maxY.at(index) = maxBounds.y;
+        m_maxZ.at(index) = maxBounds.z;
+      }
+    }
+  }
+}
+
+// Adds a reference to the light in every cluster its bounding sphere
+// touches
+void abcg::LightClusters::binLight(const glm::vec3 &position, float radius,
+                                   std::uint32_t light) {
+  // Range of depth slices
+  const auto depth{-position.z};
+  if (radius <= 0.0f || depth + radius < m_nearPlane ||
+      depth - radius > m_farPlane) {
+    return;
+  }
+  const auto getSlice{[this](float sliceDepth) {
+    const auto slice{std::log(sliceDepth / m_nearPlane) /
+                     std::log(m_farPlane / m_nearPlane) *
+                     static_cast<float>(m_gridSize.z)};
+    return std::clamp(static_cast<int>(slice), 0, m_gridSize.z - 1);
+  }};
+  const auto firstSlice{getSlice(std::max(depth - radius, m_nearPlane))};
+  const auto lastSlice{getSlice(std::min(depth + radius, m_farPlane))};
+
+  // Range of tiles, from the projection of the bounding box of the sphere.
+  // If the box crosses the plane of the eye, all tiles are tested
+  glm::vec2 minNDC{-1.0f};
+  glm::vec2 maxNDC{1.0f};
+  auto projected{true};
+  glm::vec2 boxMin{std::numeric_limits<float>::max()};
+  glm::vec2 boxMax{std::numeric_limits<float>::lowest()};
+  for (const auto corner : iter::range(8)) {
+    const glm::vec3 offset{corner % 2 == 0 ? -radius : radius,
+                           (corner / 2) % 2 == 0 ? -radius : radius,
+                           corner / 4 == 0 ? -radius : radius};
+    const auto clip{m_projMatrix * glm::vec4(position + offset, 1.0f)};
+    if (clip.w <= 1.0e-5f) {
+      projected = false;
+      break;
+    }
+    const glm::vec2 ndc{glm::vec2(clip) / clip.w};
+    boxMin = glm::min(boxMin, ndc);
+    boxMax = glm::max(boxMax, ndc);
+  }
+  if (projected) {
+    if (glm::any(glm::greaterThan(boxMin, maxNDC)) ||
+        glm::any(glm::lessThan(boxMax, minNDC))) {
+      return;
+    }
+    minNDC = glm::max(boxMin, minNDC);
+    maxNDC = glm::min(boxMax, maxNDC);
+  }
+  const glm::vec2 gridSize{m_gridSize.x, m_gridSize.y};
+  const glm::ivec2 firstTile{
+      glm::clamp(glm::ivec2((minNDC * 0.5f + 0.5f) * gridSize), glm::ivec2{0},
+                 glm::ivec2{m_gridSize} - 1)};
+  const glm::ivec2 lastTile{
+      glm::clamp(glm::ivec2((maxNDC * 0.5f + 0.5f) * gridSize), glm::ivec2{0},
+                 glm::ivec2{m_gridSize} - 1)};
+
+  // Test the rows of clusters in lane arrays of squared distances from the
+  // center of the sphere to the bounds
+  const auto radiusSquared{radius * radius};
+  for (const auto z : iter::range(firstSlice, lastSlice + 1)) {
+    for (const auto y : iter::range(firstTile.y, lastTile.y + 1)) {
+      const auto row{(z * m_gridSize.y + y) * m_gridSize.x};
+      for (auto x{firstTile.x}; x <= lastTile.x; x += lanes) {
+        const auto first{static_cast<std::size_t>(row + x)};
+        std::array<float, lanes> distances{};
+        for (const auto lane : iter::range(std::size_t{lanes})) {
+          const auto index{first + lane};
+          const auto dx{std::max(std::max(m_minX[index] - position.x, 0.0f),
+                                 position.x - m_maxX[index])};
+          const auto dy{std::max(std::max(m_minY[index] - position.y, 0.0f),
+                                 position.y - m_maxY[index])};
+          const auto dz{std::max(std::max(m_minZ[index] - position.z, 0.0f),
+                                 position.z - m_maxZ[index])};
+          distances[lane] = dx * dx + dy * dy + dz * dz;
+        }
+
+        const auto count{
+            static_cast<std::size_t>(std::min(lanes, lastTile.x - x + 1))};
+        for (const auto lane : iter::range(count)) {
+          if (distances[lane] <= radiusSquared) {
+            m_references.emplace_back(static_cast<std::uint32_t>(first + lane),
+                                      light);
+          }
+        }
+      }
+    }
+  }
+}
+
+// Uploads texels to a texture, filling it row by row. The texture grows as
+// needed and is never shrunk
+void abcg::LightClusters::upload(DataTexture &texture, GLenum internalFormat,
+                                 GLenum format, GLenum type,
+                                 std::size_t texelSize, const void *data,
+                                 std::size_t texels) {
+  const auto width{static_cast<std::size_t>(textureWidth)};
+  const auto rows{static_cast<GLsizei>(
+      std::max<std::size_t>((texels + width - 1) / width, 1))};
+
+  if (texture.texture == 0 || rows > texture.rows) {
+    abcg::glDeleteTextures(1, &texture.texture);
+    texture.rows = std::max(rows, texture.rows * 2);
+
+    abcg::glGenTextures(1, &texture.texture);
+    abcg::glBindTexture(GL_TEXTURE_2D, texture.texture);
+    abcg::glTexImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(internalFormat),
+                       textureWidth, texture.rows, 0, format, type, nullptr);
+    // Integer textures cannot be filtered
+    abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  } else {
+    abcg::glBindTexture(GL_TEXTURE_2D, texture.texture);
+  }
+
+  // Whole rows, then the last partial row
+  const auto *bytes{static_cast<const std::byte *>(data)};
+  const auto fullRows{texels / width};
+  if (fullRows > 0) {
+    abcg::glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, textureWidth,
+                          static_cast<GLsizei>(fullRows), format, type, bytes);
+  }
+  if (const auto remainder{texels % width}; remainder > 0) {
+    abcg::glTexSubImage2D(GL_TEXTURE_2D, 0, 0, static_cast<GLint>(fullRows),
+                          static_cast<GLsizei>(remainder), 1, format, type,
+                          bytes + fullRows * width * texelSize);
+  }
+  abcg::glBindTexture(GL_TEXTURE_2D, 0);
+}
@@ -0,0 +1,138 @@
+/**
+ * @file abcg_lightclusters.hpp
+ * @brief abcg::LightClusters header file.
+ *
+ * Declaration of abcg::LightClusters class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_LIGHTCLUSTERS_HPP_
+#define ABCG_LIGHTCLUSTERS_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "abcg_openglfunctions.hpp"
+#include "abcg_program.hpp"
+
+namespace abcg {
+class LightClusters;
+struct PointLight;
+}  // namespace abcg
+
+/**
+ * @brief Point light with a finite range.
+ */
+struct abcg::PointLight {
+  // Position in world space
+  glm::vec3 position{};
+  // Distance at which the light fades to zero
+  float radius{1.0f};
+  glm::vec3 color{1.0f};
+};
+
+/**
+ * @brief abcg::LightClusters class.
+ *
+ * Point lights binned into a grid of clusters for clustered forward
+ * shading.
+ *
+ * The view frustum is split into a grid of tiles in screen space and of
+ * slices in view depth, spaced exponentially between the near and far
+ * planes. Every frame, update() tests the bounding sphere of each light
+ * against the clusters its screen and depth extent can touch, and builds
+ * the list of lights of each cluster. A fragment shader looks up the
+ * cluster of the fragment and loops only over its lights, so the cost of
+ * shading depends on the number of lights nearby rather than on the total.
+ *
+ * Clusters are stored as arrays of bounds along each axis, and the lights
+ * are tested against a row of clusters at a time, so that the test compiles
+ * to SIMD instructions.
+ *
+ * The lights, the range of each cluster in the light list and the list
+ * itself are uploaded to 2D textures, read in the shaders with texelFetch
+ * (OpenGL 4.1 has no shader storage buffers, and WebGL has no texture
+ * buffers). See the `clusters.glsl` shader include of viewer4 for the
+ * matching shader code.
+ */
+class abcg::LightClusters {
+ public:
+  struct Stats {
+    std::size_t lights{};
+    // Lights that touch at least one cluster
+    std::size_t visibleLights{};
+    // Entries of the light list, and entries dropped because a cluster was
+    // full
+    std::size_t references{};
+    std::size_t droppedReferences{};
+    std::size_t maxLightsPerCluster{};
+    // Milliseconds spent binning the lights
+    float binningTime{};
+  };
+
+  // Lights in a single cluster beyond this number are ignored
+  static constexpr std::size_t maxLightsPerCluster{256};
+
+  void initializeGL(const glm::ivec3& gridSize = {16, 9, 24});
+  void update(std::span<const PointLight> lights, const glm::mat4& viewMatrix,
+              const glm::mat4& projMatrix, float nearPlane, float farPlane);
+  void bind(Program& program, GLint firstTextureUnit) const;
+  void terminateGL();
+  void paintUI() const;
+
+  [[nodiscard]] glm::ivec3 getGridSize() const noexcept { return m_gridSize; }
+  [[nodiscard]] Stats getStats() const noexcept { return m_stats; }
+
+ private:
+  // Texture whose texels are filled row by row
+  struct DataTexture {
+    GLuint texture{};
+    GLsizei rows{};
+  };
+
+  glm::ivec3 m_gridSize{};
+
+  // Projection the bounds of the clusters were computed for
+  glm::mat4 m_projMatrix{};
+  float m_nearPlane{};
+  float m_farPlane{};
+
+  // Bounds of the clusters in view space, indexed by (z * Y + y) * X + x
+  std::vector<float> m_minX;
+  std::vector<float> m_minY;
+  std::vector<float> m_minZ;
+  std::vector<float> m_maxX;
+  std::vector<float> m_maxY;
+  std::vector<float> m_maxZ;
+
+  // Cluster and light index of each light that touches a cluster
+  std::vector<std::pair<std::uint32_t, std::uint32_t>> m_references;
+  // Number of references of each cluster, then the position of the next
+  // one written
+  std::vector<std::uint32_t> m_cursors;
+  // Data uploaded to the textures
+  std::vector<glm::vec4> m_lightData;
+  std::vector<std::uint32_t> m_clusterData;
+  std::vector<std::uint32_t> m_indexData;
+
+  DataTexture m_lightTexture;
+  DataTexture m_clusterTexture;
+  DataTexture m_indexTexture;
+
+  Stats m_stats{};
+
+  void computeBounds(const glm::mat4& projMatrix, float nearPlane,
+                     float farPlane);
+  void binLight(const glm::vec3& position, float radius, std::uint32_t light);
+  static void upload(DataTexture& texture, GLenum internalFormat,
+                     GLenum format, GLenum type, std::size_t texelSize,
+                     const void* data, std::size_t texels);
+};
+
+#endif
@@ -0,0 +1,296 @@
+/**
+ * @file abcg_occlusionculler.cpp
+ * @brief Definition of abcg::OcclusionCuller class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_occlusionculler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/common.hpp>
+#include <limits>
+
+namespace {
+constexpr auto tileSize{abcg::OcclusionCuller::tileSize};
+
+// Signed distance to the near plane (z = -w) in clip space
+float nearDistance(const glm::vec4 &vertex) { return vertex.z + vertex.w; }
+}  // namespace
+
+/**
+ * @brief Sets the resolution of the depth buffer.
+ *
+ * The buffer covers the whole viewport at any resolution. A quarter of the
+ * viewport size in each direction is usually enough.
+ *
+ * @param width Width in pixels, rounded up to a multiple of the tile size.
+ * @param height Height in pixels, rounded up to a multiple of the tile
+ * size.
+ */
+void abcg::OcclusionCuller::resize(int width, int height) {
+  m_tilesX = std::max(1, (width + tileSize - 1) / tileSize);
+  m_tilesY = std::max(1, (height + tileSize - 1) / tileSize);
+  m_width = m_tilesX * tileSize;
+  m_height = m_tilesY * tileSize;
+  m_depth.assign(
+      static_cast<std::size_t>(m_width) * static_cast<std::size_t>(m_height),
+      0.0f);
+  m_tileDepth.assign(
+      static_cast<std::size_t>(m_tilesX) * static_cast<std::size_t>(m_tilesY),
+      0.0f);
+}
+
+/**
+ * @brief Clears the depth buffer and the occluders of the previous frame.
+ *
+ * @param clipMatrix Transformation from world space to clip space, i.e.,
+ * the projection matrix times the view matrix.
+ */
+void abcg::OcclusionCuller::beginFrame(const glm::mat4 &clipMatrix) {
+  m_clipMatrix = clipMatrix;
+  m_triangles.clear();
+  m_stats = {};
+  std::fill(m_depth.begin(), m_depth.end(), 0.0f);
+  std::fill(m_tileDepth.begin(), m_tileDepth.end(), 0.0f);
+}
+
+/**
+ * @brief Adds the hull of an occluder.
+ *
+ * @param vertices Vertex positions of the hull in model space.
+ * @param indices Triangle indices of the hull.
+ * @param modelMatrix Transformation from model space to world space.
+ */
+void abcg::OcclusionCuller::addOccluder(std::span<const glm::vec3> vertices,
+                                        std::span<const std::uint32_t> indices,
+                                        const glm::mat4 &modelMatrix) {
+  const auto matrix{m_clipMatrix * modelMatrix};
+  for (std::size_t index{}; index + 2 < indices.size(); index += 3) {
+    addTriangle({matrix * glm::vec4{vertices[indices[index + 0]], 1.0f},
+                 matrix * glm::vec4{vertices[indices[index + 1]], 1.0f},
+                 matrix * glm::vec4{vertices[indices[index + 2]], 1.0f}});
+  }
+}
+
+/**
+ * @brief Rasterizes the occluders added since beginFrame().
+ *
+ * Must be called before isVisible().
+ */
+void abcg::OcclusionCuller::rasterize() {
+  if (m_depth.empty()) return;
+  m_stats.occluderTriangles = m_triangles.size();
+
+  const auto numWorkers{static_cast<int>(getNumWorkers())};
+  m_threadPool.run([this, numWorkers](std::size_t workerIndex) {
+    const auto index{static_cast<int>(workerIndex)};
+    rasterizeBand(m_tilesY * index / numWorkers,
+                  m_tilesY * (index + 1) / numWorkers);
+  });
+}
+
+/**
+ * @brief Tests whether a box might be visible behind the occluders.
+ *
+ * Boxes that cross the near plane are always visible. Boxes outside the
+ * viewport are rejected.
+ *
+ * @param box Bounding box in world space.
+ * @return False if the box is entirely hidden by the occluders.
+ */
+bool abcg::OcclusionCuller::isVisible(const AABB &box) {
+  ++m_stats.tested;
+  if (m_depth.empty()) return true;
+
+  // Screen rectangle and nearest depth of the box
+  auto minX{std::numeric_limits<float>::max()};
+  auto minY{std::numeric_limits<float>::max()};
+  auto maxX{std::numeric_limits<float>::lowest()};
+  auto maxY{std::numeric_limits<float>::lowest()};
+  auto nearestDepth{0.0f};
+  for (const auto corner : {0, 1, 2, 3, 4, 5, 6, 7}) {
+    const glm::vec4 position{(corner & 1) != 0 ? box.max.x : box.min.x,
+                             (corner & 2) != 0 ? box.max.y : box.min.y,
+                             (corner & 4) != 0 ? box.max.z : box.min.z, 1.0f};
+    const auto clip{m_clipMatrix * position};
+    if (nearDistance(clip) <= 0.0f) return true;
+
+    const auto inverseW{1.0f / clip.w};
+    const auto x{(clip.x * inverseW * 0.5f + 0.5f) *
+                 static_cast<float>(m_width)};
+    const auto y{(clip.y * inverseW * 0.5f + 0.5f) *
+                 static_cast<float>(m_height)};
+    minX = std::min(minX, x);
+    minY = std::min(minY, y);
+    maxX = std::max(maxX, x);
+    maxY = std::max(maxY, y);
+    nearestDepth = std::max(nearestDepth, inverseW);
+  }
+
+  const auto firstX{std::max(0, static_cast<int>(std::floor(minX)))};
+  const auto firstY{std::max(0, static_cast<int>(std::floor(minY)))};
+  const auto lastX{std::min(m_width - 1, static_cast<int>(std::floor(maxX)))};
+  const auto lastY{std::min(m_height - 1, static_cast<int>(std::floor(maxY)))};
+  if (firstX > lastX || firstY > lastY) {
+    ++m_stats.occluded;
+    return false;
+  }
+
+  for (auto tileY{firstY / tileSize}; tileY <= lastY / tileSize; ++tileY) {
+    for (auto tileX{firstX / tileSize}; tileX <= lastX / tileSize; ++tileX) {
+      // The whole tile is nearer than the box
+      if (m_tileDepth[static_cast<std::size_t>(tileY * m_tilesX + tileX)] >
+          nearestDepth) {
+        continue;
+      }
+
+      const auto rowBegin{std::max(firstY, tileY * tileSize)};
+      const auto rowEnd{std::min(lastY + 1, (tileY + 1) * tileSize)};
+      const auto columnBegin{std::max(firstX, tileX * tileSize)};
+      const auto columnEnd{std::min(lastX + 1, (tileX + 1) * tileSize)};
+      for (auto row{rowBegin}; row < rowEnd; ++row) {
+        const auto *depth{&m_depth[static_cast<std::size_t>(row * m_width)]};
+        for (auto column{columnBegin}; column < columnEnd; ++column) {
+          if (depth[column] <= nearestDepth) return true;
+        }
+      }
+    }
+  }
+
+  ++m_stats.occluded;
+  return false;
+}
+
+// Clips a triangle against the near plane and sets it up for rasterization
+void abcg::OcclusionCuller::addTriangle(
+    const std::array<glm::vec4, 3> &clipVertices) {
+  // Sutherland-Hodgman against a single plane: at most 4 vertices
+  std::array<glm::vec4, 4> polygon{};
+  std::size_t count{};
+  for (std::size_t index{}; index < 3; ++index) {
+    const auto &current{clipVertices.at(index)};
+    const auto &next{clipVertices.at((index + 1) % 3)};
+    const auto currentDistance{nearDistance(current)};
+    const auto nextDistance{nearDistance(next)};
+    if (currentDistance >= 0.0f) polygon.at(count++) = current;
+    if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f)) {
+      const auto t{currentDistance / (currentDistance - nextDistance)};
+      polygon.at(count++) = glm::mix(current, next, t);
+    }
+  }
+  if (count < 3) return;
+
+  // Pixel coordinates and 1/w
+  std::array<glm::vec3, 4> screen{};
+  for (std::size_t index{}; index < count; ++index) {
+    const auto &vertex{polygon.at(index)};
+    const auto inverseW{1.0f / vertex.w};
+    screen.at(index) = {
+        (vertex.x * inverseW * 0.5f + 0.5f) * static_cast<float>(m_width),
+        (vertex.y * inverseW * 0.5f + 0.5f) * static_cast<float>(m_height),
+        inverseW};
+  }
+
+  for (std::size_t index{2}; index < count; ++index) {
+    ScreenTriangle triangle{
+        .vertices = {screen.at(0), screen.at(index - 1), screen.at(index)}};
+    auto &[a, b, c]{triangle.vertices};
+
+    // Counterclockwise order, so that the edge functions are positive
+    // inside. Both faces of the hull are rasterized.
+    const auto area{(b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x)};
+    if (area == 0.0f) continue;
+    if (area < 0.0f) std::swap(b, c);
+
+    // Bounding rectangle of the pixel centers covered
+    const auto minX{std::min({a.x, b.x, c.x})};
+    const auto minY{std::min({a.y, b.y, c.y})};
+    const auto maxX{std::max({a.x, b.x, c.x})};
+    const auto maxY{std::max({a.y, b.y, c.y})};
+    if (maxX < 0.0f || maxY < 0.0f || minX > static_cast<float>(m_width) ||
+        minY > static_cast<float>(m_height)) {
+      continue;
+    }
+    triangle.minX = std::max(0, static_cast<int>(std::floor(minX)));
+    triangle.minY = std::max(0, static_cast<int>(std::floor(minY)));
+    triangle.maxX = std::min(m_width - 1, static_cast<int>(std::floor(maxX)));
+    triangle.maxY = std::min(m_height - 1, static_cast<int>(std::floor(maxY)));
+    m_triangles.push_back(triangle);
+  }
+}
+
+// Rasterizes the triangles that overlap a band of tile rows and updates the
+// depth of its tiles
+void abcg::OcclusionCuller::rasterizeBand(int firstTileRow, int lastTileRow) {
+  const auto firstRow{firstTileRow * tileSize};
+  const auto lastRow{lastTileRow * tileSize - 1};
+  if (firstRow > lastRow) return;
+
+  for (const auto &triangle : m_triangles) {
+    if (triangle.maxY < firstRow || triangle.minY > lastRow) continue;
+    rasterizeTriangle(triangle, std::max(firstRow, triangle.minY),
+                      std::min(lastRow, triangle.maxY));
+  }
+
+  for (auto tileY{firstTileRow}; tileY < lastTileRow; ++tileY) {
+    for (auto tileX{0}; tileX < m_tilesX; ++tileX) {
+      auto farthest{std::numeric_limits<float>::max()};
+      for (auto row{tileY * tileSize}; row < (tileY + 1) * tileSize; ++row) {
+        const auto *depth{&m_depth[static_cast<std::size_t>(
+            row * m_width + tileX * tileSize)]};
+        for (auto column{0}; column < tileSize; ++column) {
+          farthest = std::min(farthest, depth[column]);
+        }
+      }
+      m_tileDepth[static_cast<std::size_t>(tileY * m_tilesX + tileX)] =
+          farthest;
+    }
+  }
+}
+
+void abcg::OcclusionCuller::rasterizeTriangle(const ScreenTriangle &triangle,
+                                              int firstRow, int lastRow) {
+  const auto &[a, b, c]{triangle.vertices};
+
+  // Edge functions w0 = (c - b) x (p - b), w1 = (a - c) x (p - c) and
+  // w2 = (b - a) x (p - a), written as w = A * p.x + B * p.y + C
+  const std::array<glm::vec3, 3> edges{
+      glm::vec3{b.y - c.y, c.x - b.x, b.x * c.y - b.y * c.x},
+      glm::vec3{c.y - a.y, a.x - c.x, c.x * a.y - c.y * a.x},
+      glm::vec3{a.y - b.y, b.x - a.x, a.x * b.y - a.y * b.x}};
+  const auto inverseArea{1.0f / (edges[0].z + edges[1].z + edges[2].z)};
+
+  // 1/w is interpolated from the barycentric coordinates. As a plane:
+  // z = zA * p.x + zB * p.y + zC
+  const glm::vec3 depthPlane{
+      (edges[0] * a.z + edges[1] * b.z + edges[2] * c.z) * inverseArea};
+
+  const auto firstBlock{triangle.minX / tileSize * tileSize};
+  for (auto row{firstRow}; row <= lastRow; ++row) {
+    const auto y{static_cast<float>(row) + 0.5f};
+    auto *depthRow{&m_depth[static_cast<std::size_t>(row * m_width)]};
+
+    for (auto block{firstBlock}; block <= triangle.maxX; block += tileSize) {
+      std::array<float, tileSize> w0{};
+      std::array<float, tileSize> w1{};
+      std::array<float, tileSize> w2{};
+      std::array<float, tileSize> z{};
+      for (std::size_t lane{}; lane < tileSize; ++lane) {
+        const auto x{static_cast<float>(block + static_cast<int>(lane)) + 0.5f};
+        w0[lane] = edges[0].x * x + edges[0].y * y + edges[0].z;
+        w1[lane] = edges[1].x * x + edges[1].y * y + edges[1].z;
+        w2[lane] = edges[2].x * x + edges[2].y * y + edges[2].z;
+        z[lane] = depthPlane.x * x + depthPlane.y * y + depthPlane.z;
+      }
+
+      auto *depth{depthRow + block};
+      for (std::size_t lane{}; lane < tileSize; ++lane) {
+        const auto inside{w0[lane] >= 0.0f && w1[lane] >= 0.0f &&
+                          w2[lane] >= 0.0f};
+        depth[lane] = inside ? std::max(depth[lane], z[lane]) : depth[lane];
+      }
+    }
+  }
+}
@@ -0,0 +1,112 @@
+/**
+ * @file abcg_occlusionculler.hpp
+ * @brief abcg::OcclusionCuller header file.
+ *
+ * Declaration of abcg::OcclusionCuller class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_OCCLUSIONCULLER_HPP_
+#define ABCG_OCCLUSIONCULLER_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <span>
+#include <vector>
+
+#include "abcg_bounds.hpp"
+#include "abcg_threadpool.hpp"
+
+namespace abcg {
+class OcclusionCuller;
+}  // namespace abcg
+
+/**
+ * @brief abcg::OcclusionCuller class.
+ *
+ * Software occlusion culling on the CPU, without reading anything back
+ * from the GPU.
+ *
+ * A few large objects near the camera (occluders) are rasterized as
+ * low-poly hulls into a low-resolution depth buffer. The bounding boxes of
+ * other objects are then tested against it before they are submitted for
+ * drawing. The hulls must be inside the objects they stand for, so that
+ * nothing visible is ever rejected.
+ *
+ * The buffer stores the reciprocal of the clip-space w of the nearest
+ * occluder of each pixel, which interpolates linearly in screen space. It
+ * is split into tiles of 8x8 pixels, and the farthest depth of each tile is
+ * kept so that most boxes are rejected without reading single pixels.
+ *
+ * Occluders are rasterized in parallel, each worker thread owning a band
+ * of tile rows. Rows are processed 8 pixels at a time in separate arrays,
+ * so that the edge functions compile to SIMD instructions (8-wide with
+ * AVX2 if enabled by the compiler flags).
+ */
+class abcg::OcclusionCuller {
+ public:
+  struct Stats {
+    std::size_t occluderTriangles{};
+    std::size_t tested{};
+    std::size_t occluded{};
+
+    [[nodiscard]] float getOccludedPercentage() const noexcept {
+      return tested == 0 ? 0.0f
+                         : 100.0f * static_cast<float>(occluded) /
+                               static_cast<float>(tested);
+    }
+  };
+
+  // Width and height of a tile, and number of pixels processed together
+  static constexpr int tileSize{8};
+
+  void resize(int width, int height);
+  void beginFrame(const glm::mat4& clipMatrix);
+  void addOccluder(std::span<const glm::vec3> vertices,
+                   std::span<const std::uint32_t> indices,
+                   const glm::mat4& modelMatrix);
+  void rasterize();
+  [[nodiscard]] bool isVisible(const AABB& box);
+
+  [[nodiscard]] Stats getStats() const noexcept { return m_stats; }
+  [[nodiscard]] std::size_t getNumWorkers() const noexcept {
+    return m_threadPool.size();
+  }
+  [[nodiscard]] int getWidth() const noexcept { return m_width; }
+  [[nodiscard]] int getHeight() const noexcept { return m_height; }
+
+ private:
+  // Triangle in pixel coordinates, with the reciprocal of w as z
+  struct ScreenTriangle {
+    std::array<glm::vec3, 3> vertices{};
+    int minX{};
+    int minY{};
+    int maxX{};
+    int maxY{};
+  };
+
+  int m_width{};
+  int m_height{};
+  int m_tilesX{};
+  int m_tilesY{};
+  glm::mat4 m_clipMatrix{1.0f};
+
+  std::vector<float> m_depth;
+  // Farthest depth (smallest 1/w) of each tile
+  std::vector<float> m_tileDepth;
+  std::vector<ScreenTriangle> m_triangles;
+  Stats m_stats{};
+
+  ThreadPool m_threadPool;
+
+  void addTriangle(const std::array<glm::vec4, 3>& clipVertices);
+  void rasterizeBand(int firstTileRow, int lastTileRow);
+  void rasterizeTriangle(const ScreenTriangle& triangle, int firstRow,
+                         int lastRow);
+};
+
+#endif
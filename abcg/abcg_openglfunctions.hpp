@@ -18,8 +18,11 @@
 #include <string_view>
 
 #include "abcg_external.hpp"
+#include "abcg_glstatecache.hpp"
 
 namespace abcg {
+void releaseTextureMemory(GLsizei n, const GLuint* textures);
+
 #if !defined(NDEBUG) && !defined(__EMSCRIPTEN__) && !defined(__APPLE__)
 using sl = std::experimental::source_location;
 
@@ -82,6 +85,7 @@ auto callGL([[maybe_unused]] sl /*unused*/, TFun&& function, TArgs&&... args) {
 
 inline void glActiveTexture(GLenum texture,
                             const sl& sourceLocation = sl::current()) {
+  if (GLStateCache::getInstance().activeTexture(texture)) return;
   callGL(sourceLocation, ::glActiveTexture, texture);
 }
 inline void glAttachShader(GLuint program, GLuint shader,
@@ -95,6 +99,7 @@ inline void glBindAttribLocation(GLuint program, GLuint index,
 }
 inline void glBindBuffer(GLenum target, GLuint buffer,
                          const sl& sourceLocation = sl::current()) {
+  if (GLStateCache::getInstance().bindBuffer(target, buffer)) return;
   callGL(sourceLocation, ::glBindBuffer, target, buffer);
 }
 inline void glBindFramebuffer(GLenum target, GLuint framebuffer,
@@ -107,6 +112,7 @@ inline void glBindRenderbuffer(GLenum target, GLuint renderbuffer,
 }
 inline void glBindTexture(GLenum target, GLuint texture,
                           const sl& sourceLocation = sl::current()) {
+  if (GLStateCache::getInstance().bindTexture(target, texture)) return;
   callGL(sourceLocation, ::glBindTexture, target, texture);
 }
 inline void glBlendColor(GLfloat red, GLfloat green, GLfloat blue,
@@ -116,19 +122,29 @@ inline void glBlendColor(GLfloat red, GLfloat green, GLfloat blue,
 }
 inline void glBlendEquation(GLenum mode,
                             const sl& sourceLocation = sl::current()) {
+  if (GLStateCache::getInstance().blendEquation(mode, mode)) return;
   callGL(sourceLocation, ::glBlendEquation, mode);
 }
 inline void glBlendEquationSeparate(GLenum modeRGB, GLenum modeAlpha,
                                     const sl& sourceLocation = sl::current()) {
+  if (GLStateCache::getInstance().blendEquation(modeRGB, modeAlpha)) return;
   callGL(sourceLocation, ::glBlendEquationSeparate, modeRGB, modeAlpha);
 }
 inline void glBlendFunc(GLenum sfactor, GLenum dfactor,
                         const sl& sourceLocation = sl::current()) {
+  if (GLStateCache::getInstance().blendFunc(sfactor, dfactor, sfactor,
+                                             dfactor)) {
+    return;
+  }
   callGL(sourceLocation, ::glBlendFunc, sfactor, dfactor);
 }
 inline void glBlendFuncSeparate(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha,
                                 GLenum dstAlpha,
                                 const sl& sourceLocation = sl::current()) {
+  if (GLStateCache::getInstance().blendFunc(srcRGB, dstRGB, srcAlpha,
+                                             dstAlpha)) {
+    return;
+  }
   callGL(sourceLocation, ::glBlendFuncSeparate, srcRGB, dstRGB, srcAlpha,
          dstAlpha);
 }
@@ -211,6 +227,7 @@ inline void glCullFace(GLenum mode, const sl& sourceLocation = sl::current()) {
 inline void glDeleteBuffers(GLsizei n, const GLuint* buffers,
                             const sl& sourceLocation = sl::current()) {
   if (buffers == nullptr || *buffers == 0) return;
+  GLStateCache::getInstance().deleteBuffers(n, buffers);
   callGL(sourceLocation, ::glDeleteBuffers, n, buffers);
 }
 inline void glDeleteFramebuffers(GLsizei n, const GLuint* framebuffers,
@@ -221,6 +238,7 @@ inline void glDeleteFramebuffers(GLsizei n, const GLuint* framebuffers,
 inline void glDeleteProgram(GLuint program,
                             const sl& sourceLocation = sl::current()) {
   if (program == 0) return;
+  GLStateCache::getInstance().deletePrograms(1, &program);
   callGL(sourceLocation, ::glDeleteProgram, program);
 }
 inline void glDeleteRenderbuffers(GLsizei n, GLuint* renderbuffers,
@@ -236,13 +254,17 @@ inline void glDeleteShader(GLuint shader,
 inline void glDeleteTextures(GLsizei n, const GLuint* textures,
                              const sl& sourceLocation = sl::current()) {
   if (textures == nullptr || *textures == 0) return;
+  releaseTextureMemory(n, textures);
+  GLStateCache::getInstance().deleteTextures(n, textures);
   callGL(sourceLocation, ::glDeleteTextures, n, textures);
 }
 inline void glDepthFunc(GLenum func, const sl& sourceLocation = sl::current()) {
+  if (GLStateCache::getInstance().depthFunc(func)) return;
   callGL(sourceLocation, ::glDepthFunc, func);
 }
 inline void glDepthMask(GLboolean flag,
                         const sl& sourceLocation = sl::current()) {
+  if (GLStateCache::getInstance().depthMask(flag)) return;
   callGL(sourceLocation, ::glDepthMask, flag);
 }
 inline void glDepthRangef(GLfloat n, GLfloat f,
@@ -254,6 +276,7 @@ inline void glDetachShader(GLuint program, GLuint shader,
   callGL(sourceLocation, ::glDetachShader, program, shader);
 }
 inline void glDisable(GLenum cap, const sl& sourceLocation = sl::current()) {
+  if (GLStateCache::getInstance().setCapability(cap, false)) return;
   callGL(sourceLocation, ::glDisable, cap);
 }
 inline void glDisableVertexAttribArray(
@@ -270,6 +293,7 @@ inline void glDrawElements(GLenum mode, GLsizei count, GLenum type,
   callGL(sourceLocation, ::glDrawElements, mode, count, type, indices);
 }
 inline void glEnable(GLenum cap, const sl& sourceLocation = sl::current()) {
+  if (GLStateCache::getInstance().setCapability(cap, true)) return;
   callGL(sourceLocation, ::glEnable, cap);
 }
 inline void glEnableVertexAttribArray(
@@ -556,18 +580,22 @@ inline void glTexImage2D(GLenum target, GLint level, GLint internalformat,
 
 inline void glTexParameterf(GLenum target, GLenum pname, GLfloat param,
                             const sl& sourceLocation = sl::current()) {
+  GLStateCache::getInstance().forgetTexParameter(target, pname);
   callGL(sourceLocation, ::glTexParameterf, target, pname, param);
 }
 inline void glTexParameterfv(GLenum target, GLenum pname, const GLfloat* params,
                              const sl& sourceLocation = sl::current()) {
+  GLStateCache::getInstance().forgetTexParameter(target, pname);
   callGL(sourceLocation, ::glTexParameterfv, target, pname, params);
 }
 inline void glTexParameteri(GLenum target, GLenum pname, GLint param,
                             const sl& sourceLocation = sl::current()) {
+  if (GLStateCache::getInstance().texParameter(target, pname, param)) return;
   callGL(sourceLocation, ::glTexParameteri, target, pname, param);
 }
 inline void glTexParameteriv(GLenum target, GLenum pname, const GLint* params,
                              const sl& sourceLocation = sl::current()) {
+  GLStateCache::getInstance().forgetTexParameter(target, pname);
   callGL(sourceLocation, ::glTexParameteriv, target, pname, params);
 }
 inline void glTexSubImage2D(GLenum target, GLint level, GLint xoffset,
@@ -661,6 +689,7 @@ inline void glUniformMatrix4fv(GLint location, GLsizei count,
 }
 inline void glUseProgram(GLuint program,
                          const sl& sourceLocation = sl::current()) {
+  if (GLStateCache::getInstance().useProgram(program)) return;
   callGL(sourceLocation, ::glUseProgram, program);
 }
 inline void glValidateProgram(GLuint program,
@@ -871,10 +900,12 @@ inline void glFlushMappedBufferRange(GLenum target, GLintptr offset,
 }
 inline void glBindVertexArray(GLuint array,
                               const sl& sourceLocation = sl::current()) {
+  if (GLStateCache::getInstance().bindVertexArray(array)) return;
   callGL(sourceLocation, ::glBindVertexArray, array);
 }
 inline void glDeleteVertexArrays(GLsizei n, const GLuint* arrays,
                                  const sl& sourceLocation = sl::current()) {
+  GLStateCache::getInstance().deleteVertexArrays(n, arrays);
   callGL(sourceLocation, ::glDeleteVertexArrays, n, arrays);
 }
 inline void glGenVertexArrays(GLsizei n, GLuint* arrays,
@@ -899,11 +930,13 @@ inline void glEndTransformFeedback(const sl& sourceLocation = sl::current()) {
 inline void glBindBufferRange(GLenum target, GLuint index, GLuint buffer,
                               GLintptr offset, GLsizeiptr size,
                               const sl& sourceLocation = sl::current()) {
+  GLStateCache::getInstance().bindBufferIndexed(target, buffer);
   callGL(sourceLocation, ::glBindBufferRange, target, index, buffer, offset,
          size);
 }
 inline void glBindBufferBase(GLenum target, GLuint index, GLuint buffer,
                              const sl& sourceLocation = sl::current()) {
+  GLStateCache::getInstance().bindBufferIndexed(target, buffer);
   callGL(sourceLocation, ::glBindBufferBase, target, index, buffer);
 }
 inline void glTransformFeedbackVaryings(
@@ -1115,6 +1148,7 @@ inline void glGenSamplers(GLsizei count, GLuint* samplers,
 }
 inline void glDeleteSamplers(GLsizei count, const GLuint* samplers,
                              const sl& sourceLocation = sl::current()) {
+  GLStateCache::getInstance().deleteSamplers(count, samplers);
   callGL(sourceLocation, ::glDeleteSamplers, count, samplers);
 }
 inline GLboolean glIsSampler(GLuint sampler,
@@ -1123,6 +1157,7 @@ inline GLboolean glIsSampler(GLuint sampler,
 }
 inline void glBindSampler(GLuint unit, GLuint sampler,
                           const sl& sourceLocation = sl::current()) {
+  if (GLStateCache::getInstance().bindSampler(unit, sampler)) return;
   callGL(sourceLocation, ::glBindSampler, unit, sampler);
 }
 inline void glSamplerParameteri(GLuint sampler, GLenum pname, GLint param,
@@ -1227,6 +1262,45 @@ inline void glGetInternalformativ(GLenum target, GLenum internalformat,
          count, params);
 }
 
+#if !defined(__EMSCRIPTEN__)
+
+// OpenGL 3.3+ function definitions
+
+inline void glQueryCounter(GLuint id, GLenum target,
+                           const sl& sourceLocation = sl::current()) {
+  callGL(sourceLocation, ::glQueryCounter, id, target);
+}
+inline void glGetQueryObjectui64v(GLuint id, GLenum pname, GLuint64* params,
+                                  const sl& sourceLocation = sl::current()) {
+  callGL(sourceLocation, ::glGetQueryObjectui64v, id, pname, params);
+}
+
+// OpenGL 4.3+ function definitions
+
+inline void glMultiDrawElementsIndirect(
+    GLenum mode, GLenum type, const void* indirect, GLsizei drawcount,
+    GLsizei stride, const sl& sourceLocation = sl::current()) {
+  callGL(sourceLocation, ::glMultiDrawElementsIndirect, mode, type, indirect,
+         drawcount, stride);
+}
+
+// OpenGL 4.4+ function definitions
+
+inline void glBufferStorage(GLenum target, GLsizeiptr size, const void* data,
+                            GLbitfield flags,
+                            const sl& sourceLocation = sl::current()) {
+  callGL(sourceLocation, ::glBufferStorage, target, size, data, flags);
+}
+
+// KHR_parallel_shader_compile function definitions
+
+inline void glMaxShaderCompilerThreadsKHR(
+    GLuint count, const sl& sourceLocation = sl::current()) {
+  callGL(sourceLocation, ::glMaxShaderCompilerThreadsKHR, count);
+}
+
+#endif
+
 #if !defined(NDEBUG) && !defined(__EMSCRIPTEN__) && !defined(__APPLE__)
 
 // OpenGL 3.0+ function definitions
@@ -13,40 +13,18 @@
 #include <imgui_impl_sdl.h>
 
 #include <algorithm>
+#include <filesystem>
 #include <fstream>
-#include <regex>
 #include <sstream>
 #include <string_view>
 
 #include "SDL_events.h"
+#include "SDL_filesystem.h"
 #include "SDL_video.h"
 #include "abcg_application.hpp"
 #include "abcg_embeddedfonts.hpp"
-#include "abcg_string.hpp"
-
-void printShaderInfoLog(GLuint shader, std::string_view prefix) {
-  GLint infoLogLength{};
-  glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLogLength);
-
-  if (infoLogLength > 0) {
-    std::vector<GLchar> infoLog{};
-    infoLog.reserve(static_cast<size_t>(infoLogLength));
-    glGetShaderInfoLog(shader, infoLogLength, nullptr, infoLog.data());
-    fmt::print("{} information log:\n{}\n", prefix, infoLog.data());
-  }
-}
-
-void printProgramInfoLog(GLuint program) {
-  GLint infoLogLength{};
-  glGetProgramiv(program, GL_INFO_LOG_LENGTH, &infoLogLength);
-
-  if (infoLogLength > 0) {
-    std::vector<GLchar> infoLog{};
-    infoLog.reserve(static_cast<size_t>(infoLogLength));
-    glGetProgramInfoLog(program, infoLogLength, nullptr, infoLog.data());
-    fmt::print("Program information log:\n{}\n", infoLog.data());
-  }
-}
+#include "abcg_shaderpreprocessor.hpp"
+#include "abcg_texturebudget.hpp"
 
 ImVec4 ColorAlpha(const ImVec4 &color, float alpha) {
   return ImVec4(color.x, color.y, color.z, alpha);
@@ -165,6 +143,9 @@ abcg::OpenGLWindow::~OpenGLWindow() {
   if (m_window != nullptr) {
     if (ImGui::GetCurrentContext() != nullptr) {
       terminateGL();
+      if (m_openGLSettings.dynamicResolution) {
+        m_dynamicResolution.terminateGL();
+      }
       ImGui_ImplOpenGL3_Shutdown();
       ImGui_ImplSDL2_Shutdown();
       ImGui::DestroyContext();
@@ -273,6 +254,17 @@ void abcg::OpenGLWindow::paintUI() {
       ImGui::End();
     }
   }
+
+  // Texture memory budget
+  if (m_windowSettings.showTextureBudget) {
+    TextureBudget::getInstance().paintUI();
+  }
+
+  // Resolution scale of the scene
+  if (m_windowSettings.showDynamicResolution &&
+      m_openGLSettings.dynamicResolution) {
+    m_dynamicResolution.paintUI();
+  }
 }
 
 void abcg::OpenGLWindow::resizeGL(int width, int height) {
@@ -281,116 +273,114 @@ void abcg::OpenGLWindow::resizeGL(int width, int height) {
 
 void abcg::OpenGLWindow::terminateGL() {}
 
-GLuint abcg::OpenGLWindow::createProgramFromFile(
-    std::string_view pathToVertexShader,
-    std::string_view pathToFragmentShader) {
-  std::stringstream vertexShaderSource;
-  if (std::ifstream stream(pathToVertexShader.data()); stream) {
-    vertexShaderSource << stream.rdbuf();
-    stream.close();
+namespace {
+std::string readShaderFile(std::string_view path, std::string_view type) {
+  std::stringstream source;
+  if (std::ifstream stream(path.data()); stream) {
+    source << stream.rdbuf();
   } else {
-    throw abcg::Exception{abcg::Exception::Runtime(fmt::format(
-        "Failed to read vertex shader file {}", pathToVertexShader))};
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Failed to read {} shader file {}", type, path))};
   }
+  return source.str();
+}
 
-  std::stringstream fragmentShaderSource;
-  if (std::ifstream stream(pathToFragmentShader.data()); stream) {
-    fragmentShaderSource << stream.rdbuf();
-    stream.close();
-  } else {
-    throw abcg::Exception{abcg::Exception::Runtime(fmt::format(
-        "Failed to read fragment shader file {}", pathToFragmentShader))};
-  }
+std::string getParentPath(std::string_view path) {
+  return std::filesystem::path{path}.parent_path().string();
+}
+}  // namespace
 
-  return createProgramFromString(vertexShaderSource.str(),
-                                 fragmentShaderSource.str());
+/**
+ * @brief Creates a program from shader files, blocking until it is linked.
+ *
+ * @throw abcg::Exception if a file cannot be read or the program fails to
+ * compile or link.
+ */
+abcg::Program abcg::OpenGLWindow::createProgramFromFile(
+    std::string_view pathToVertexShader, std::string_view pathToFragmentShader,
+    const ShaderDefines &defines) {
+  return createProgramFromFileAsync(pathToVertexShader, pathToFragmentShader,
+                                    defines)
+      .get();
 }
 
-GLuint abcg::OpenGLWindow::createProgramFromString(
-    std::string_view vertexShaderSource,
-    std::string_view fragmentShaderSource) {
-  using namespace std::string_literals;
+/**
+ * @brief Creates a program from shader source code, blocking until it is
+ * linked.
+ *
+ * @throw abcg::Exception if the program fails to compile or link.
+ */
+abcg::Program abcg::OpenGLWindow::createProgramFromString(
+    std::string_view vertexShaderSource, std::string_view fragmentShaderSource,
+    const ShaderDefines &defines) {
+  return createProgramFromStringAsync(vertexShaderSource, fragmentShaderSource,
+                                      defines)
+      .get();
+}
 
-  std::string vsSource{abcg::trimCopy(std::string{vertexShaderSource})};
-#if defined(__EMSCRIPTEN__) || defined(__APPLE__)
-  // Remove version header, if any
-  vsSource =
-      std::regex_replace(vsSource, std::regex("#version.*[\r\n|\n|\r]"), "");
-  // Add new header
-  vsSource = m_GLSLVersion + "\n" + vsSource;
-#else
-  // Add version header only if missing
-  if (!vsSource.starts_with("#version"))
-    vsSource = m_GLSLVersion + "\n\n" + vsSource;
-#endif
+/**
+ * @brief Creates a program from shader files without waiting for it.
+ *
+ * Files included by the shaders are relative to the directory of each
+ * shader.
+ *
+ * @throw abcg::Exception if a file cannot be read.
+ * @return Handle to the program. See createProgramFromStringAsync().
+ */
+abcg::AsyncProgram abcg::OpenGLWindow::createProgramFromFileAsync(
+    std::string_view pathToVertexShader, std::string_view pathToFragmentShader,
+    const ShaderDefines &defines) {
+  return createProgramAsync(
+      {readShaderFile(pathToVertexShader, "vertex"),
+       getParentPath(pathToVertexShader)},
+      {readShaderFile(pathToFragmentShader, "fragment"),
+       getParentPath(pathToFragmentShader)},
+      defines);
+}
 
-  std::string fsSource{abcg::trimCopy(std::string{fragmentShaderSource})};
+/**
+ * @brief Creates a program from shader source code without waiting for it.
+ *
+ * The source code is prepared by abcg::preprocessShader. Files included by
+ * the shaders are relative to the assets directory.
+ *
+ * If the context supports KHR_parallel_shader_compile, the program is
+ * submitted immediately and compiled by the driver in the background.
+ * Otherwise, it is compiled on first use, so that programs that are never
+ * used cost nothing.
+ *
+ * @throw abcg::Exception if an included file cannot be read.
+ * @return Handle to the program.
+ */
+abcg::AsyncProgram abcg::OpenGLWindow::createProgramFromStringAsync(
+    std::string_view vertexShaderSource, std::string_view fragmentShaderSource,
+    const ShaderDefines &defines) {
+  return createProgramAsync({vertexShaderSource, m_assetsPath},
+                            {fragmentShaderSource, m_assetsPath}, defines);
+}
+
+abcg::AsyncProgram abcg::OpenGLWindow::createProgramAsync(
+    const ShaderFile &vertexShader, const ShaderFile &fragmentShader,
+    const ShaderDefines &defines) {
+  ShaderPreprocessorSettings settings;
+  settings.version = m_GLSLVersion;
+  settings.defines = defines;
+  settings.includeDirectory = vertexShader.directory;
 #if defined(__EMSCRIPTEN__) || defined(__APPLE__)
-  // Remove version header, if any
-  fsSource =
-      std::regex_replace(fsSource, std::regex("#version.*[\r\n|\n|\r]"), "");
+  settings.replaceVersion = true;
+#endif
+  auto vsSource{preprocessShader(vertexShader.source, settings)};
 
   if (m_openGLSettings.profile == OpenGLProfile::ES) {
-    // c++20
-    // if (auto regex{std::regex("^precision.*float$", std::multiline)};
-    if (auto regex{std::regex("(^|\r\n|\n|\r)precision.*float")};
-        !std::regex_search(fsSource, regex)) {
-      fsSource = "precision mediump float;\n" + fsSource;
-    }
+    settings.defaultPrecision = "precision mediump float;";
   }
-  // Add new header
-  fsSource = m_GLSLVersion + "\n" + fsSource;
-#else
-  // Add version header only if missing
-  if (!fsSource.starts_with("#version")) {
-    if (m_openGLSettings.profile == OpenGLProfile::ES)
-      fsSource = "precision mediump float;\n\n" + fsSource;
-    fsSource = m_GLSLVersion + "\n\n" + fsSource;
-  }
-#endif
+  settings.includeDirectory = fragmentShader.directory;
+  auto fsSource{preprocessShader(fragmentShader.source, settings)};
 
-  GLint compileStatus{};
-  GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-  const char *vsSourceConstChar = vsSource.c_str();
-  glShaderSource(vertexShader, 1, &vsSourceConstChar, nullptr);
-  glCompileShader(vertexShader);
-  glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &compileStatus);
-  if (compileStatus == 0) {
-    printShaderInfoLog(vertexShader, "Vertex shader");
-    throw abcg::Exception{
-        abcg::Exception::Runtime("Failed to compile vertex shader")};
-  }
-
-  GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-  const char *fsSourceConstChar = fsSource.c_str();
-  glShaderSource(fragmentShader, 1, &fsSourceConstChar, nullptr);
-  glCompileShader(fragmentShader);
-  glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &compileStatus);
-  if (compileStatus == 0) {
-    printShaderInfoLog(fragmentShader, "Fragment shader");
-    glDeleteShader(vertexShader);
-    throw abcg::Exception{
-        abcg::Exception::Runtime("Failed to compile fragment shader")};
-  }
-
-  GLuint shaderProgram = glCreateProgram();
-  glAttachShader(shaderProgram, vertexShader);
-  glAttachShader(shaderProgram, fragmentShader);
-
-  glLinkProgram(shaderProgram);
-  GLint linkStatus{};
-  glGetProgramiv(shaderProgram, GL_LINK_STATUS, &linkStatus);
-  if (linkStatus == 0) {
-    printProgramInfoLog(shaderProgram);
-    glDeleteShader(fragmentShader);
-    glDeleteShader(vertexShader);
-    throw abcg::Exception{abcg::Exception::Runtime("Failed to link program")};
-  }
-
-  glDeleteShader(fragmentShader);
-  glDeleteShader(vertexShader);
-
-  return shaderProgram;
+  AsyncProgram program{std::move(vsSource), std::move(fsSource),
+                       &m_programCache};
+  if (AsyncProgram::isParallelCompileSupported()) program.submit();
+  return program;
 }
 
 std::string abcg::OpenGLWindow::getAssetsPath() { return m_assetsPath; }
@@ -444,9 +434,7 @@ void abcg::OpenGLWindow::handleEvent(SDL_Event &event, bool &done) {
         auto &newHeight{event.window.data2};
         if (newWidth >= 0 && newHeight >= 0 &&
             (newWidth != m_viewportWidth || newHeight != m_viewportHeight)) {
-          m_viewportWidth = newWidth;
-          m_viewportHeight = newHeight;
-          resizeGL(newWidth, newHeight);
+          resizeViewport(newWidth, newHeight);
         }
       } break;
       case SDL_WINDOWEVENT_RESIZED: {
@@ -462,9 +450,7 @@ void abcg::OpenGLWindow::handleEvent(SDL_Event &event, bool &done) {
         SDL_SetWindowSize(m_window, m_windowSettings.width,
                           m_windowSettings.height);
 #endif
-        m_viewportWidth = event.window.data1;
-        m_viewportHeight = event.window.data2;
-        resizeGL(event.window.data1, event.window.data2);
+        resizeViewport(event.window.data1, event.window.data2);
       } break;
     }
   }
@@ -499,7 +485,39 @@ void abcg::OpenGLWindow::handleEvent(SDL_Event &event, bool &done) {
     useCustomEventHandler = false;
   }
 
-  if (useCustomEventHandler) handleEvent(event);
+  if (useCustomEventHandler) {
+    scaleMouseEvent(event);
+    handleEvent(event);
+  }
+}
+
+// With dynamic resolution, paintGL draws to a target smaller than the
+// window, and resizeGL is given the size of the target. Mouse coordinates
+// are scaled so that they match that size.
+void abcg::OpenGLWindow::scaleMouseEvent(SDL_Event &event) const {
+  if (!m_openGLSettings.dynamicResolution || m_viewportWidth <= 0 ||
+      m_viewportHeight <= 0) {
+    return;
+  }
+
+  const auto scaleX{static_cast<float>(m_dynamicResolution.getWidth()) /
+                    static_cast<float>(m_viewportWidth)};
+  const auto scaleY{static_cast<float>(m_dynamicResolution.getHeight()) /
+                    static_cast<float>(m_viewportHeight)};
+  const auto scale{[](Sint32 &coordinate, float factor) {
+    coordinate = static_cast<Sint32>(static_cast<float>(coordinate) * factor);
+  }};
+
+  if (event.type == SDL_MOUSEMOTION) {
+    scale(event.motion.x, scaleX);
+    scale(event.motion.y, scaleY);
+    scale(event.motion.xrel, scaleX);
+    scale(event.motion.yrel, scaleY);
+  } else if (event.type == SDL_MOUSEBUTTONDOWN ||
+             event.type == SDL_MOUSEBUTTONUP) {
+    scale(event.button.x, scaleX);
+    scale(event.button.y, scaleY);
+  }
 }
 
 void abcg::OpenGLWindow::initialize(std::string_view basePath) {
@@ -571,7 +589,11 @@ void abcg::OpenGLWindow::initialize(std::string_view basePath) {
   else SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
   SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, m_openGLSettings.depthBufferSize);
   SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, m_openGLSettings.stencilSize);
-  if (m_openGLSettings.samples > 0) {
+  // With dynamic resolution, the samples are used by the offscreen target,
+  // and the window only receives the resolved and upscaled image
+  auto multisampleWindow{m_openGLSettings.samples > 0 &&
+                         !m_openGLSettings.dynamicResolution};
+  if (multisampleWindow) {
     // Enable multisample
     SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 1);
     // Can be 2, 4, 8 or 16
@@ -586,8 +608,9 @@ void abcg::OpenGLWindow::initialize(std::string_view basePath) {
                                 SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
                                 m_windowSettings.width, m_windowSettings.height,
                                 SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE);
-    if (m_window == nullptr && m_openGLSettings.samples > 0) {
+    if (m_window == nullptr && multisampleWindow) {
       // Try again, but this time with multisampling disabled
+      multisampleWindow = false;
       m_openGLSettings.samples = 0;
       SDL_GL_SetAttribute(SDL_GL_MULTISAMPLESAMPLES, 0);
       SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 0);
@@ -633,6 +656,34 @@ void abcg::OpenGLWindow::initialize(std::string_view basePath) {
   fmt::print("OpenGL version.: {}\n", glGetString(GL_VERSION));
   fmt::print("GLSL version...: {}\n", glGetString(GL_SHADING_LANGUAGE_VERSION));
 
+  // Skip redundant state changes made through the OpenGL wrappers
+  GLStateCache::getInstance().setEnabled(m_openGLSettings.stateCache);
+
+  // Reuse the programs linked in previous runs
+  if (m_openGLSettings.programCache) {
+    std::string cachePath;
+    if (auto *prefPath{SDL_GetPrefPath("abcg", "programcache")}) {
+      cachePath = prefPath;
+      SDL_free(prefPath);
+    }
+    m_programCache.initialize(
+        cachePath,
+        fmt::format("{}\n{}\n{}", m_GLSLVersion,
+                    reinterpret_cast<const char *>(glGetString(GL_RENDERER)),
+                    reinterpret_cast<const char *>(glGetString(GL_VERSION))));
+    if (m_programCache.isEnabled()) {
+      fmt::print("Program cache..: {}\n", cachePath);
+    }
+  }
+
+#if !defined(__EMSCRIPTEN__)
+  // Let the driver choose how many threads compile shaders in the
+  // background (see createProgramFromStringAsync)
+  if (AsyncProgram::isParallelCompileSupported()) {
+    glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+  }
+#endif
+
   // Setup Dear ImGui context
   IMGUI_CHECKVERSION();
   ImGui::CreateContext();
@@ -665,16 +716,21 @@ void abcg::OpenGLWindow::initialize(std::string_view basePath) {
     throw abcg::Exception{abcg::Exception::Runtime("Failed to load font file")};
   }
 
+  // Offscreen target of paintGL
+  if (m_openGLSettings.dynamicResolution) {
+    m_dynamicResolution.initializeGL(
+        createProgramFromString(DynamicResolution::vertexShaderSource,
+                                DynamicResolution::fragmentShaderSource),
+        m_openGLSettings.samples);
+  }
+
   initializeGL();
 
   if (io.DisplaySize.x >= 0 && io.DisplaySize.y >= 0) {
-    int width{static_cast<int>(io.DisplaySize.x)};
-    int height{static_cast<int>(io.DisplaySize.y)};
-    m_viewportWidth = width;
-    m_viewportHeight = height;
-    resizeGL(width, height);
+    resizeViewport(static_cast<int>(io.DisplaySize.x),
+                   static_cast<int>(io.DisplaySize.y));
   } else {
-    resizeGL(m_windowSettings.width, m_windowSettings.height);
+    resizeViewport(m_windowSettings.width, m_windowSettings.height);
   }
 }
 
@@ -691,13 +747,28 @@ void abcg::OpenGLWindow::paint() {
   }
 #endif
 
+  TextureBudget::getInstance().update();
+
   ImGui_ImplOpenGL3_NewFrame();
   ImGui_ImplSDL2_NewFrame();
   ImGui::NewFrame();
   paintUI();
   ImGui::Render();
-  paintGL();
+  if (m_openGLSettings.dynamicResolution) {
+    if (m_dynamicResolution.update(m_lastDeltaTime)) {
+      resizeGL(m_dynamicResolution.getWidth(),
+               m_dynamicResolution.getHeight());
+    }
+    // Draw the scene offscreen and upscale it before the UI
+    m_dynamicResolution.begin();
+    paintGL();
+    m_dynamicResolution.end();
+  } else {
+    paintGL();
+  }
   ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+  // The UI renderer calls OpenGL directly
+  GLStateCache::getInstance().invalidate();
   if(m_openGLSettings.preserveWebGLDrawingBuffer) glFinish();
   else SDL_GL_SwapWindow(m_window);
 
@@ -706,4 +777,17 @@ void abcg::OpenGLWindow::paint() {
     m_lastDeltaTime = m_deltaTime.restart();
   } else
     m_lastDeltaTime = 0.0;
+}
+
+// Calls resizeGL with the size paintGL draws to: the size of the window, or
+// the size of the dynamic resolution target
+void abcg::OpenGLWindow::resizeViewport(int width, int height) {
+  m_viewportWidth = width;
+  m_viewportHeight = height;
+  if (m_openGLSettings.dynamicResolution) {
+    m_dynamicResolution.resize(width, height);
+    resizeGL(m_dynamicResolution.getWidth(), m_dynamicResolution.getHeight());
+  } else {
+    resizeGL(width, height);
+  }
 }
\ No newline at end of file
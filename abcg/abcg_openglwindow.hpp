@@ -12,8 +12,13 @@
 
 #include <string>
 
+#include "abcg_asyncprogram.hpp"
+#include "abcg_dynamicresolution.hpp"
 #include "abcg_elapsedtimer.hpp"
 #include "abcg_openglfunctions.hpp"
+#include "abcg_program.hpp"
+#include "abcg_programcache.hpp"
+#include "abcg_shaderpreprocessor.hpp"
 
 namespace abcg {
 enum class OpenGLProfile;
@@ -43,6 +48,14 @@ struct alignas(32) abcg::OpenGLSettings {
   int samples{0};
   bool vsync{false};
   bool preserveWebGLDrawingBuffer{false};
+  bool stateCache{false};
+  bool programCache{false};
+  // Render paintGL offscreen, at a resolution that follows the frame time.
+  // resizeGL() and the mouse events passed to handleEvent() then use the
+  // size of the offscreen target, while SDL_GetMouseState() and the UI
+  // still use window pixels. The samples are then used by the offscreen
+  // target, and the default framebuffer is single-sampled
+  bool dynamicResolution{false};
 };
 
 struct alignas(64) abcg::WindowSettings {
@@ -50,6 +63,8 @@ struct alignas(64) abcg::WindowSettings {
   int height{600};
   bool showFPS{true};
   bool showFullscreenButton{true};
+  bool showTextureBudget{false};
+  bool showDynamicResolution{false};
   std::string title{"ABCg Window"};
 };
 
@@ -80,27 +95,48 @@ class abcg::OpenGLWindow {
   virtual void resizeGL(int width, int height);
   virtual void terminateGL();
 
-  [[nodiscard]] GLuint createProgramFromFile(
+  [[nodiscard]] Program createProgramFromFile(
       std::string_view pathToVertexShader,
-      std::string_view pathToFragmentShader);
-  [[nodiscard]] GLuint createProgramFromString(
+      std::string_view pathToFragmentShader, const ShaderDefines& defines = {});
+  [[nodiscard]] Program createProgramFromString(
       std::string_view vertexShaderSource,
-      std::string_view fragmentShaderSource);
+      std::string_view fragmentShaderSource, const ShaderDefines& defines = {});
+  [[nodiscard]] AsyncProgram createProgramFromFileAsync(
+      std::string_view pathToVertexShader,
+      std::string_view pathToFragmentShader, const ShaderDefines& defines = {});
+  [[nodiscard]] AsyncProgram createProgramFromStringAsync(
+      std::string_view vertexShaderSource,
+      std::string_view fragmentShaderSource, const ShaderDefines& defines = {});
   std::string getAssetsPath();
   [[nodiscard]] double getDeltaTime() const;
   [[nodiscard]] double getElapsedTime() const;
+  [[nodiscard]] DynamicResolution& getDynamicResolution() noexcept {
+    return m_dynamicResolution;
+  }
   void toggleFullscreen();
 
  private:
+  // Shader source code and directory of the files it includes
+  struct ShaderFile {
+    std::string_view source;
+    std::string_view directory;
+  };
+
   void handleEvent(SDL_Event& event, bool& done);
+  void scaleMouseEvent(SDL_Event& event) const;
   void initialize(std::string_view basePath);
   void paint();
+  void resizeViewport(int width, int height);
+  [[nodiscard]] AsyncProgram createProgramAsync(const ShaderFile& vertexShader,
+                                                const ShaderFile& fragmentShader,
+                                                const ShaderDefines& defines);
 
   WindowSettings m_windowSettings{};
   OpenGLSettings m_openGLSettings{};
 
   std::string m_assetsPath{};
   std::string m_GLSLVersion{};
+  ProgramCache m_programCache;
 
   SDL_Window* m_window{};
   SDL_GLContext m_GLContext{};
@@ -109,6 +145,8 @@ class abcg::OpenGLWindow {
   int m_viewportWidth{};
   int m_viewportHeight{};
 
+  DynamicResolution m_dynamicResolution;
+
   ElapsedTimer m_deltaTime;
   ElapsedTimer m_windowStartTime;
   double m_lastDeltaTime{0.0};
@@ -0,0 +1,168 @@
+/**
+ * @file abcg_program.cpp
+ * @brief Definition of abcg::Program class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_program.hpp"
+
+#include <algorithm>
+#include <cppitertools/itertools.hpp>
+
+namespace {
+template <typename TGetActive>
+std::vector<abcg::Program::Variable> reflect(GLuint program, GLenum countName,
+                                             GLenum maxLengthName,
+                                             TGetActive &&getActive) {
+  GLint count{};
+  GLint maxLength{};
+  abcg::glGetProgramiv(program, countName, &count);
+  abcg::glGetProgramiv(program, maxLengthName, &maxLength);
+
+  std::vector<abcg::Program::Variable> variables;
+  std::vector<GLchar> name(static_cast<std::size_t>(std::max(maxLength, 1)));
+  for (auto index : iter::range(count)) {
+    abcg::Program::Variable variable;
+    GLsizei length{};
+    getActive(program, static_cast<GLuint>(index), maxLength, &length,
+              &variable.size, &variable.type, name.data());
+    variable.name.assign(name.data(), static_cast<std::size_t>(length));
+
+    // Arrays are reported as "name[0]"
+    if (variable.name.ends_with("[0]")) {
+      variable.name.resize(variable.name.size() - 3);
+    }
+    variables.push_back(std::move(variable));
+  }
+
+  // Sorted for binary search
+  std::sort(variables.begin(), variables.end(),
+            [](const auto &lhs, const auto &rhs) {
+              return lhs.name < rhs.name;
+            });
+  return variables;
+}
+
+const abcg::Program::Variable *find(
+    const std::vector<abcg::Program::Variable> &variables,
+    std::string_view name) {
+  auto iter{std::lower_bound(
+      variables.begin(), variables.end(), name,
+      [](const auto &variable, auto value) { return variable.name < value; })};
+  if (iter == variables.end() || iter->name != name) return nullptr;
+  return &*iter;
+}
+}  // namespace
+
+/**
+ * @brief Creates a handle to a linked program.
+ *
+ * Queries the active uniform variables and attributes of the program.
+ *
+ * @param program Name of a linked program object.
+ */
+abcg::Program::Program(GLuint program)
+    : m_program(program), m_state(std::make_shared<State>()) {
+  m_state->uniforms =
+      reflect(program, GL_ACTIVE_UNIFORMS, GL_ACTIVE_UNIFORM_MAX_LENGTH,
+              [](auto &&...args) { glGetActiveUniform(args...); });
+  for (auto &uniform : m_state->uniforms) {
+    // Members of uniform blocks have no location
+    uniform.location = glGetUniformLocation(program, uniform.name.c_str());
+  }
+
+  m_state->attributes =
+      reflect(program, GL_ACTIVE_ATTRIBUTES, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH,
+              [](auto &&...args) { glGetActiveAttrib(args...); });
+  for (auto &attribute : m_state->attributes) {
+    attribute.location = glGetAttribLocation(program, attribute.name.c_str());
+  }
+}
+
+/**
+ * @brief Returns the location of a uniform variable.
+ *
+ * @param name Name of the uniform variable. Array elements can be given as
+ * `name[index]`.
+ *
+ * @return Location of the variable, or -1 if the variable is not active.
+ */
+GLint abcg::Program::getUniformLocation(std::string_view name) const {
+  if (!m_state) return -1;
+  if (const auto *uniform{find(m_state->uniforms, name)}) {
+    return uniform->location;
+  }
+
+  std::string key{name};
+  auto iter{m_state->extraLocations.find(key)};
+  if (iter == m_state->extraLocations.end()) {
+    iter = m_state->extraLocations
+               .emplace(key, glGetUniformLocation(m_program, key.c_str()))
+               .first;
+  }
+  return iter->second;
+}
+
+/**
+ * @brief Returns the location of a vertex attribute.
+ *
+ * @param name Name of the attribute.
+ *
+ * @return Location of the attribute, or -1 if the attribute is not active.
+ */
+GLint abcg::Program::getAttribLocation(std::string_view name) const {
+  if (!m_state) return -1;
+  const auto *attribute{find(m_state->attributes, name)};
+  return attribute != nullptr ? attribute->location : -1;
+}
+
+const std::vector<abcg::Program::Variable> &abcg::Program::getUniforms()
+    const {
+  static const std::vector<Variable> empty;
+  return m_state ? m_state->uniforms : empty;
+}
+
+const std::vector<abcg::Program::Variable> &abcg::Program::getAttributes()
+    const {
+  static const std::vector<Variable> empty;
+  return m_state ? m_state->attributes : empty;
+}
+
+/**
+ * @brief Returns the number of uniform uploads done and skipped since the
+ * last call to resetStats().
+ */
+abcg::Program::Stats abcg::Program::getStats() const {
+  return m_state ? m_state->stats : Stats{};
+}
+
+void abcg::Program::resetStats() {
+  if (m_state) m_state->stats = {};
+}
+
+/**
+ * @brief Forgets the cached uniform values.
+ *
+ * The next call to setUniform() for each location will always upload the
+ * value.
+ */
+void abcg::Program::invalidateUniforms() {
+  if (m_state) m_state->values.clear();
+}
+
+void abcg::Program::use() const { glUseProgram(m_program); }
+
+bool abcg::Program::isCached(GLint location, const void *value,
+                             std::size_t size) {
+  auto [iter, inserted]{m_state->values.try_emplace(location)};
+  auto &cached{iter->second};
+  if (!inserted && memcmp(cached.data(), value, size) == 0) {
+    ++m_state->stats.skipped;
+    return true;
+  }
+
+  memcpy(cached.data(), value, size);
+  ++m_state->stats.uploads;
+  return false;
+}
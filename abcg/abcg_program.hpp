@@ -0,0 +1,171 @@
+/**
+ * @file abcg_program.hpp
+ * @brief abcg::Program header file.
+ *
+ * Declaration of abcg::Program class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_PROGRAM_HPP_
+#define ABCG_PROGRAM_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <glm/mat2x2.hpp>
+#include <glm/mat3x3.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "abcg_openglfunctions.hpp"
+
+namespace abcg {
+class Program;
+}  // namespace abcg
+
+/**
+ * @brief abcg::Program class.
+ *
+ * Handle to a linked shader program, with the locations of its active
+ * uniform variables and attributes queried once at creation.
+ *
+ * The uniform setters keep a copy of the last value uploaded to each
+ * location and skip the call to `glUniform*` when the value has not changed.
+ * As uniform values are part of the program state, the cache remains valid
+ * when other programs are used in between. Uniforms modified directly with
+ * `glUniform*` must be followed by a call to invalidateUniforms().
+ *
+ * The handle converts implicitly to the program name (GLuint) and does not
+ * own the program object: it must still be deleted with glDeleteProgram.
+ * Copies of the handle share the same locations and cache.
+ */
+class abcg::Program {
+ public:
+  struct Variable {
+    std::string name;
+    GLint location{-1};
+    GLenum type{};
+    GLint size{};
+  };
+
+  struct Stats {
+    std::size_t uploads{};
+    std::size_t skipped{};
+  };
+
+  Program() = default;
+  explicit Program(GLuint program);
+
+  // NOLINTNEXTLINE(google-explicit-constructor)
+  operator GLuint() const noexcept { return m_program; }
+
+  [[nodiscard]] GLuint getID() const noexcept { return m_program; }
+  [[nodiscard]] GLint getUniformLocation(std::string_view name) const;
+  [[nodiscard]] GLint getAttribLocation(std::string_view name) const;
+  [[nodiscard]] const std::vector<Variable>& getUniforms() const;
+  [[nodiscard]] const std::vector<Variable>& getAttributes() const;
+
+  [[nodiscard]] Stats getStats() const;
+  void resetStats();
+  void invalidateUniforms();
+  void use() const;
+
+  template <typename T>
+  void setUniform(GLint location, const T& value);
+
+  /**
+   * @brief Sets a uniform variable of the program, which must be in use.
+   *
+   * @param name Name of the uniform variable.
+   * @param value Value to be uploaded.
+   */
+  template <typename T>
+  void setUniform(std::string_view name, const T& value) {
+    setUniform(getUniformLocation(name), value);
+  }
+
+ private:
+  struct State {
+    std::vector<Variable> uniforms;
+    std::vector<Variable> attributes;
+    // Locations not reported by glGetActiveUniform, e.g., array elements
+    std::unordered_map<std::string, GLint> extraLocations;
+    std::unordered_map<GLint, std::array<std::byte, sizeof(glm::mat4)>>
+        values;
+    Stats stats;
+  };
+
+  GLuint m_program{};
+  std::shared_ptr<State> m_state;
+
+  [[nodiscard]] bool isCached(GLint location, const void* value,
+                              std::size_t size);
+};
+
+/**
+ * @brief Sets a uniform variable of the program, which must be in use.
+ *
+ * Supported types are bool, GLint, GLuint, float, and the glm vectors and
+ * square matrices of these types.
+ *
+ * @param location Location of the uniform variable. Negative locations are
+ * ignored, as in `glUniform*`.
+ * @param value Value to be uploaded.
+ */
+template <typename T>
+void abcg::Program::setUniform(GLint location, const T& value) {
+  static_assert(sizeof(T) <= sizeof(glm::mat4), "Unsupported uniform type");
+  if (location < 0 || !m_state) return;
+
+  if constexpr (std::is_same_v<T, bool>) {
+    setUniform(location, static_cast<GLint>(value));
+    return;
+  } else {
+    if (isCached(location, &value, sizeof(T))) return;
+
+    if constexpr (std::is_same_v<T, GLint>) {
+      glUniform1i(location, value);
+    } else if constexpr (std::is_same_v<T, GLuint>) {
+      glUniform1ui(location, value);
+    } else if constexpr (std::is_same_v<T, float>) {
+      glUniform1f(location, value);
+    } else if constexpr (std::is_same_v<T, glm::vec2>) {
+      glUniform2fv(location, 1, &value.x);
+    } else if constexpr (std::is_same_v<T, glm::vec3>) {
+      glUniform3fv(location, 1, &value.x);
+    } else if constexpr (std::is_same_v<T, glm::vec4>) {
+      glUniform4fv(location, 1, &value.x);
+    } else if constexpr (std::is_same_v<T, glm::ivec2>) {
+      glUniform2iv(location, 1, &value.x);
+    } else if constexpr (std::is_same_v<T, glm::ivec3>) {
+      glUniform3iv(location, 1, &value.x);
+    } else if constexpr (std::is_same_v<T, glm::ivec4>) {
+      glUniform4iv(location, 1, &value.x);
+    } else if constexpr (std::is_same_v<T, glm::uvec2>) {
+      glUniform2uiv(location, 1, &value.x);
+    } else if constexpr (std::is_same_v<T, glm::uvec3>) {
+      glUniform3uiv(location, 1, &value.x);
+    } else if constexpr (std::is_same_v<T, glm::uvec4>) {
+      glUniform4uiv(location, 1, &value.x);
+    } else if constexpr (std::is_same_v<T, glm::mat2>) {
+      glUniformMatrix2fv(location, 1, GL_FALSE, &value[0][0]);
+    } else if constexpr (std::is_same_v<T, glm::mat3>) {
+      glUniformMatrix3fv(location, 1, GL_FALSE, &value[0][0]);
+    } else if constexpr (std::is_same_v<T, glm::mat4>) {
+      glUniformMatrix4fv(location, 1, GL_FALSE, &value[0][0]);
+    } else {
+      static_assert(!sizeof(T), "Unsupported uniform type");
+    }
+  }
+}
+
+#endif
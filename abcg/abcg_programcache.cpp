@@ -0,0 +1,182 @@
+/**
+ * @file abcg_programcache.cpp
+ * @brief Definition of abcg::ProgramCache class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_programcache.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <vector>
+
+namespace {
+// Identifies the files written by this version of the cache
+constexpr std::uint32_t fileMagic{0x31425041};  // "APB1"
+
+struct FileHeader {
+  std::uint32_t magic{};
+  std::uint32_t binaryFormat{};
+  std::uint32_t length{};
+};
+
+// 64-bit FNV-1a hash of a sequence of strings. A null byte is hashed after
+// each string so that different splits of the same text do not collide.
+std::uint64_t hashStrings(std::initializer_list<std::string_view> strings) {
+  std::uint64_t hash{0xcbf29ce484222325};
+  for (const auto string : strings) {
+    for (const auto character : string) {
+      hash ^= static_cast<unsigned char>(character);
+      hash *= 0x100000001b3;
+    }
+    hash *= 0x100000001b3;
+  }
+  return hash;
+}
+}  // namespace
+
+/**
+ * @brief Enables the cache if program binaries are supported.
+ *
+ * Must be called with a current OpenGL context.
+ *
+ * @param directory Directory of the cache files. It must exist.
+ * @param contextID Description of the context. Binaries created with a
+ * different description are never loaded.
+ */
+void abcg::ProgramCache::initialize(std::string_view directory,
+                                    std::string_view contextID) {
+  m_enabled = false;
+  m_binaryFormats.clear();
+  m_directory = directory;
+  m_contextID = contextID;
+  m_stats = {};
+
+#if !defined(__EMSCRIPTEN__)
+  if (m_directory.empty() ||
+      !(GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary)) {
+    return;
+  }
+  GLint numFormats{};
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+  if (numFormats <= 0) return;
+  m_binaryFormats.resize(static_cast<std::size_t>(numFormats));
+  glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, m_binaryFormats.data());
+  m_enabled = true;
+#endif
+}
+
+/**
+ * @brief Creates a program from a cached binary.
+ *
+ * @param vertexShaderSource Final source code of the vertex shader.
+ * @param fragmentShaderSource Final source code of the fragment shader.
+ * @return Linked program, or 0 if the binary is not in the cache or was
+ * rejected by the driver.
+ */
+GLuint abcg::ProgramCache::load(std::string_view vertexShaderSource,
+                                std::string_view fragmentShaderSource) {
+  if (!m_enabled) return 0;
+
+  const auto path{getPath(vertexShaderSource, fragmentShaderSource)};
+  std::ifstream stream(path, std::ios::binary);
+  FileHeader header{};
+  std::vector<char> binary;
+  if (stream) {
+    stream.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (stream && header.magic == fileMagic) {
+      binary.resize(header.length);
+      stream.read(binary.data(), static_cast<std::streamsize>(binary.size()));
+    }
+  }
+  if (!stream || binary.empty()) {
+    ++m_stats.misses;
+    return 0;
+  }
+  stream.close();
+
+  const auto reject{[&] {
+    std::error_code errorCode;
+    std::filesystem::remove(path, errorCode);
+    ++m_stats.rejected;
+    return 0U;
+  }};
+
+  // glProgramBinary raises GL_INVALID_ENUM for a format the driver no longer
+  // supports (e.g., after an update), which callGL turns into an exception
+  if (std::ranges::find(m_binaryFormats,
+                        static_cast<GLint>(header.binaryFormat)) ==
+      m_binaryFormats.end()) {
+    return reject();
+  }
+
+  const auto program{glCreateProgram()};
+  glProgramBinary(program, header.binaryFormat, binary.data(),
+                  static_cast<GLsizei>(binary.size()));
+  GLint linkStatus{};
+  glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+  if (linkStatus == 0) {
+    glDeleteProgram(program);
+    return reject();
+  }
+
+  ++m_stats.hits;
+  return program;
+}
+
+/**
+ * @brief Writes the binary of a linked program to the cache.
+ *
+ * The program should be linked with `GL_PROGRAM_BINARY_RETRIEVABLE_HINT`
+ * set. Failures to write the file only print a warning.
+ *
+ * @param program Linked program.
+ * @param vertexShaderSource Final source code of the vertex shader.
+ * @param fragmentShaderSource Final source code of the fragment shader.
+ */
+void abcg::ProgramCache::store(GLuint program,
+                               std::string_view vertexShaderSource,
+                               std::string_view fragmentShaderSource) {
+  if (!m_enabled) return;
+
+  GLint length{};
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) return;
+
+  std::vector<char> binary(static_cast<std::size_t>(length));
+  GLenum binaryFormat{};
+  glGetProgramBinary(program, length, &length, &binaryFormat, binary.data());
+
+  // Write to a temporary file first so that an interrupted write never
+  // leaves a truncated binary behind
+  const auto path{getPath(vertexShaderSource, fragmentShaderSource)};
+  const auto temporaryPath{path + ".tmp"};
+  {
+    std::ofstream stream(temporaryPath, std::ios::binary | std::ios::trunc);
+    const FileHeader header{.magic = fileMagic,
+                            .binaryFormat = binaryFormat,
+                            .length = static_cast<std::uint32_t>(length)};
+    stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    stream.write(binary.data(), length);
+    if (!stream) {
+      fmt::print("Warning: failed to write program binary to {}\n", path);
+      return;
+    }
+  }
+  std::error_code errorCode;
+  std::filesystem::rename(temporaryPath, path, errorCode);
+}
+
+std::string abcg::ProgramCache::getPath(
+    std::string_view vertexShaderSource,
+    std::string_view fragmentShaderSource) const {
+  const auto hash{
+      hashStrings({m_contextID, vertexShaderSource, fragmentShaderSource})};
+  const auto fileName{fmt::format("{:016x}.bin", hash)};
+  return (std::filesystem::path{m_directory} / fileName).string();
+}
@@ -0,0 +1,71 @@
+/**
+ * @file abcg_programcache.hpp
+ * @brief abcg::ProgramCache header file.
+ *
+ * Declaration of abcg::ProgramCache class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_PROGRAMCACHE_HPP_
+#define ABCG_PROGRAMCACHE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "abcg_openglfunctions.hpp"
+
+namespace abcg {
+class ProgramCache;
+}  // namespace abcg
+
+/**
+ * @brief abcg::ProgramCache class.
+ *
+ * On-disk cache of linked program binaries (`glGetProgramBinary`).
+ *
+ * Each binary is stored in its own file, named after the FNV-1a hash of
+ * the context description (GLSL version, `GL_RENDERER` and `GL_VERSION`)
+ * and the final source code of the shaders. Binaries rejected by the
+ * driver, e.g., after a driver update, are deleted so that the program is
+ * compiled and stored again.
+ *
+ * The cache is disabled when the context does not support program
+ * binaries (OpenGL < 4.1 without ARB_get_program_binary, drivers with no
+ * binary formats, and WebGL).
+ */
+class abcg::ProgramCache {
+ public:
+  struct Stats {
+    std::size_t hits{};
+    std::size_t misses{};
+    std::size_t rejected{};
+  };
+
+  void initialize(std::string_view directory, std::string_view contextID);
+
+  [[nodiscard]] GLuint load(std::string_view vertexShaderSource,
+                            std::string_view fragmentShaderSource);
+  void store(GLuint program, std::string_view vertexShaderSource,
+             std::string_view fragmentShaderSource);
+
+  [[nodiscard]] bool isEnabled() const noexcept { return m_enabled; }
+  [[nodiscard]] Stats getStats() const noexcept { return m_stats; }
+
+ private:
+  bool m_enabled{};
+  // Binary formats accepted by glProgramBinary in this context
+  std::vector<GLint> m_binaryFormats;
+  std::string m_directory;
+  std::string m_contextID;
+  Stats m_stats{};
+
+  [[nodiscard]] std::string getPath(
+      std::string_view vertexShaderSource,
+      std::string_view fragmentShaderSource) const;
+};
+
+#endif
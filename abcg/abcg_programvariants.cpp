@@ -0,0 +1,42 @@
+/**
+ * @file abcg_programvariants.cpp
+ * @brief Definition of abcg::ProgramVariants class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_programvariants.hpp"
+
+#include <utility>
+
+/**
+ * @brief Creates an empty cache.
+ *
+ * @param factory Function that creates the program of a variant.
+ */
+abcg::ProgramVariants::ProgramVariants(Factory factory)
+    : m_factory{std::move(factory)} {}
+
+/**
+ * @brief Returns the variant specialized with the given macros, creating it
+ * if needed.
+ *
+ * @param defines Macros of the variant. Their order does not matter.
+ * @return Handle to the program of the variant, which might still be
+ * compiling.
+ */
+abcg::AsyncProgram &abcg::ProgramVariants::get(const ShaderDefines &defines) {
+  auto key{getShaderDefinesKey(defines)};
+  if (auto iter{m_variants.find(key)}; iter != m_variants.end()) {
+    return iter->second;
+  }
+  return m_variants.emplace(std::move(key), m_factory(defines)).first->second;
+}
+
+/**
+ * @brief Releases the programs of every variant.
+ */
+void abcg::ProgramVariants::destroy() {
+  for (auto &[key, program] : m_variants) program.destroy();
+  m_variants.clear();
+}
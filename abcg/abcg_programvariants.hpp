@@ -0,0 +1,55 @@
+/**
+ * @file abcg_programvariants.hpp
+ * @brief abcg::ProgramVariants header file.
+ *
+ * Declaration of abcg::ProgramVariants class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_PROGRAMVARIANTS_HPP_
+#define ABCG_PROGRAMVARIANTS_HPP_
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+#include "abcg_asyncprogram.hpp"
+#include "abcg_shaderpreprocessor.hpp"
+
+namespace abcg {
+class ProgramVariants;
+}  // namespace abcg
+
+/**
+ * @brief abcg::ProgramVariants class.
+ *
+ * Cache of the permutations of a program specialized with different
+ * preprocessor macros, such as `MAPPING_MODE=2`.
+ *
+ * Each variant is created on the first request for its set of macros, so
+ * only the permutations actually used are compiled. Specializing with
+ * macros instead of uniform variables removes the runtime branches from
+ * the shaders.
+ */
+class abcg::ProgramVariants {
+ public:
+  // Creates the program of a variant, e.g., through
+  // OpenGLWindow::createProgramFromFileAsync
+  using Factory = std::function<AsyncProgram(const ShaderDefines&)>;
+
+  ProgramVariants() = default;
+  explicit ProgramVariants(Factory factory);
+
+  [[nodiscard]] AsyncProgram& get(const ShaderDefines& defines);
+  void destroy();
+
+  [[nodiscard]] std::size_t size() const noexcept { return m_variants.size(); }
+
+ private:
+  Factory m_factory;
+  std::unordered_map<std::string, AsyncProgram> m_variants;
+};
+
+#endif
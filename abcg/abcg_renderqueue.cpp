@@ -0,0 +1,185 @@
+/**
+ * @file abcg_renderqueue.cpp
+ * @brief Definition of abcg::RenderQueue class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_renderqueue.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <limits>
+#include <utility>
+
+namespace {
+// Number of bits of each field of the sort key
+constexpr int idBits{10};
+constexpr int depthBits{24};
+constexpr std::uint64_t maxID{(1U << idBits) - 1};
+constexpr std::uint64_t translucentBit{std::uint64_t{1} << 63};
+
+// Maps a state object to a small ID, in order of first use. IDs that do
+// not fit in the key share the last value, which only weakens grouping.
+std::uint64_t denseID(std::unordered_map<GLuint, std::uint64_t> &ids,
+                      GLuint name) {
+  auto [iter, inserted]{ids.try_emplace(name, ids.size())};
+  return std::min(iter->second, maxID);
+}
+
+// The bit pattern of a non-negative float increases with its value, so the
+// most significant bits can be used as a fixed-size depth key
+std::uint64_t quantizeDepth(float depth) {
+  if (!(depth > 0.0f)) return 0;
+  return std::bit_cast<std::uint32_t>(depth) >> (32 - depthBits);
+}
+}  // namespace
+
+/**
+ * @brief Removes all packets and resets the statistics.
+ */
+void abcg::RenderQueue::clear() {
+  m_packets.clear();
+  m_items.clear();
+  m_programIDs.clear();
+  m_vertexArrayIDs.clear();
+  m_textureIDs.clear();
+  m_sorted = true;
+  m_stats = {};
+}
+
+/**
+ * @brief Adds a draw packet to the queue.
+ *
+ * @param packet Draw packet. The program must remain valid until execute()
+ * is called.
+ */
+void abcg::RenderQueue::submit(const DrawPacket &packet) {
+  m_items.push_back(
+      {.key = makeKey(packet), .index = static_cast<std::uint32_t>(size())});
+  m_packets.push_back(packet);
+  m_sorted = false;
+}
+
+/**
+ * @brief Sorts the packets by key.
+ *
+ * The radix sort processes one byte per pass and skips the passes in which
+ * every key has the same byte.
+ */
+void abcg::RenderQueue::sort() {
+  if (m_sorted) return;
+  m_sorted = true;
+
+  m_scratch.resize(m_items.size());
+  for (auto shift{0}; shift < 64; shift += 8) {
+    std::array<std::size_t, 256> offsets{};
+    for (const auto &item : m_items) {
+      ++offsets.at((item.key >> shift) & 0xFF);
+    }
+    if (std::ranges::find(offsets, m_items.size()) != offsets.end()) continue;
+
+    std::size_t sum{};
+    for (auto &offset : offsets) {
+      sum += std::exchange(offset, sum);
+    }
+    for (const auto &item : m_items) {
+      m_scratch.at(offsets.at((item.key >> shift) & 0xFF)++) = item;
+    }
+    m_items.swap(m_scratch);
+  }
+}
+
+/**
+ * @brief Draws the packets in sorted order.
+ *
+ * The program, vertex array object and texture are only changed when they
+ * differ from those of the previous packet. Translucent packets are drawn
+ * with alpha blending and without depth writes. The queue is not cleared.
+ *
+ * @param onDraw Function called before each draw call, with the program of
+ * the packet in use. It can be used to set per-object uniform variables
+ * identified by DrawPacket::userData.
+ */
+void abcg::RenderQueue::execute(const DrawCallback &onDraw) {
+  sort();
+  m_stats = {};
+  if (m_items.empty()) return;
+
+  // Names that no packet uses, so that the first packet binds its vertex
+  // array and texture even if they are 0
+  constexpr auto unbound{std::numeric_limits<GLuint>::max()};
+  const Program *currentProgram{};
+  GLuint currentVertexArray{unbound};
+  GLuint currentTexture{unbound};
+  bool blending{};
+
+  glActiveTexture(GL_TEXTURE0);
+
+  for (const auto &item : m_items) {
+    const auto &packet{m_packets.at(item.index)};
+
+    if (packet.translucent && !blending) {
+      glEnable(GL_BLEND);
+      glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+      glDepthMask(GL_FALSE);
+      blending = true;
+    }
+    if (packet.program != currentProgram && packet.program != nullptr) {
+      packet.program->use();
+      currentProgram = packet.program;
+      ++m_stats.programChanges;
+    }
+    if (packet.vertexArray != currentVertexArray) {
+      glBindVertexArray(packet.vertexArray);
+      currentVertexArray = packet.vertexArray;
+      ++m_stats.vertexArrayChanges;
+    }
+    if (packet.texture != currentTexture) {
+      glBindTexture(GL_TEXTURE_2D, packet.texture);
+      currentTexture = packet.texture;
+      ++m_stats.textureChanges;
+    }
+
+    if (onDraw) onDraw(packet);
+
+    // NOLINTNEXTLINE(performance-no-int-to-ptr)
+    auto *indices{reinterpret_cast<void *>(packet.indexOffset)};
+    if (packet.instanceCount == 1) {
+      glDrawElements(packet.mode, packet.count, packet.indexType, indices);
+    } else {
+      glDrawElementsInstanced(packet.mode, packet.count, packet.indexType,
+                              indices, packet.instanceCount);
+    }
+    ++m_stats.drawCalls;
+  }
+
+  if (blending) {
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+  }
+  glBindVertexArray(0);
+}
+
+/**
+ * @brief Computes the sort key of a packet.
+ *
+ * Opaque packets: | 0 | program | VAO | texture | depth |
+ *
+ * Translucent packets: | 1 | inverted depth | program | VAO | texture |
+ */
+std::uint64_t abcg::RenderQueue::makeKey(const DrawPacket &packet) {
+  const auto programName{packet.program != nullptr ? packet.program->getID()
+                                                   : 0U};
+  const auto state{(denseID(m_programIDs, programName) << (2 * idBits)) |
+                   (denseID(m_vertexArrayIDs, packet.vertexArray) << idBits) |
+                   denseID(m_textureIDs, packet.texture)};
+  const auto depth{quantizeDepth(packet.depth)};
+
+  if (packet.translucent) {
+    const auto invertedDepth{((std::uint64_t{1} << depthBits) - 1) - depth};
+    return translucentBit | (invertedDepth << (3 * idBits)) | state;
+  }
+  return (state << depthBits) | depth;
+}
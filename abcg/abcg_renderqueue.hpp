@@ -0,0 +1,100 @@
+/**
+ * @file abcg_renderqueue.hpp
+ * @brief abcg::RenderQueue header file.
+ *
+ * Declaration of abcg::RenderQueue class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_RENDERQUEUE_HPP_
+#define ABCG_RENDERQUEUE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "abcg_program.hpp"
+
+namespace abcg {
+class RenderQueue;
+}  // namespace abcg
+
+/**
+ * @brief abcg::RenderQueue class.
+ *
+ * List of draw packets collected during a frame and submitted in an order
+ * that minimizes state changes.
+ *
+ * Each packet is assigned a 64-bit sort key. Opaque packets come first,
+ * grouped by program, vertex array object, and texture, and sorted
+ * front-to-back within each group to reduce overdraw. Translucent packets
+ * come last, sorted back-to-front so that blending is correct. Keys are
+ * sorted with an LSD radix sort, which is linear in the number of packets.
+ */
+class abcg::RenderQueue {
+ public:
+  struct DrawPacket {
+    // Program used to draw the packet
+    Program* program{};
+    GLuint vertexArray{};
+    // 2D texture bound to texture unit 0 (0 for none)
+    GLuint texture{};
+    // Distance from the camera, used for front-to-back and back-to-front
+    // ordering
+    float depth{};
+    bool translucent{};
+    GLenum mode{GL_TRIANGLES};
+    GLsizei count{};
+    // Number of instances (glDrawElementsInstanced is used if not 1)
+    GLsizei instanceCount{1};
+    GLenum indexType{GL_UNSIGNED_INT};
+    // Offset of the first index in the element array buffer, in bytes
+    std::size_t indexOffset{};
+    // Application data forwarded to the per-draw callback of execute()
+    std::uint32_t userData{};
+  };
+
+  struct Stats {
+    std::size_t drawCalls{};
+    std::size_t programChanges{};
+    std::size_t vertexArrayChanges{};
+    std::size_t textureChanges{};
+  };
+
+  using DrawCallback = std::function<void(const DrawPacket&)>;
+
+  void clear();
+  void submit(const DrawPacket& packet);
+  void sort();
+  void execute(const DrawCallback& onDraw = {});
+
+  [[nodiscard]] std::size_t size() const noexcept { return m_packets.size(); }
+  [[nodiscard]] const std::vector<DrawPacket>& getPackets() const noexcept {
+    return m_packets;
+  }
+  [[nodiscard]] Stats getStats() const noexcept { return m_stats; }
+
+ private:
+  struct SortItem {
+    std::uint64_t key{};
+    std::uint32_t index{};
+  };
+
+  std::vector<DrawPacket> m_packets;
+  std::vector<SortItem> m_items;
+  std::vector<SortItem> m_scratch;
+  bool m_sorted{};
+  Stats m_stats{};
+
+  // Dense IDs of the state objects used in the current frame
+  std::unordered_map<GLuint, std::uint64_t> m_programIDs;
+  std::unordered_map<GLuint, std::uint64_t> m_vertexArrayIDs;
+  std::unordered_map<GLuint, std::uint64_t> m_textureIDs;
+
+  [[nodiscard]] std::uint64_t makeKey(const DrawPacket& packet);
+};
+
+#endif
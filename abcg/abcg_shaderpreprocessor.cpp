@@ -0,0 +1,199 @@
+/**
+ * @file abcg_shaderpreprocessor.cpp
+ * @brief Definition of the shader preprocessor.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_shaderpreprocessor.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <set>
+#include <sstream>
+
+#include "abcg_exception.hpp"
+
+namespace {
+// Includes nested deeper than this are assumed to be recursive
+constexpr int maxIncludeDepth{32};
+
+struct IncludeState {
+  std::set<std::filesystem::path> includedFiles;
+  // Source string numbers of #line directives. 0 is the main source.
+  int numSources{1};
+};
+
+std::string_view trimView(std::string_view string) {
+  const auto first{string.find_first_not_of(" \t\r")};
+  if (first == std::string_view::npos) return {};
+  const auto last{string.find_last_not_of(" \t\r")};
+  return string.substr(first, last - first + 1);
+}
+
+// Returns the argument of a directive such as "#  include", if the line is
+// that directive
+std::optional<std::string_view> parseDirective(std::string_view line,
+                                               std::string_view name) {
+  line = trimView(line);
+  if (!line.starts_with('#')) return std::nullopt;
+  line = trimView(line.substr(1));
+  if (!line.starts_with(name)) return std::nullopt;
+  const auto argument{line.substr(name.size())};
+  if (!argument.empty() && argument.front() != ' ' &&
+      argument.front() != '\t') {
+    return std::nullopt;
+  }
+  return trimView(argument);
+}
+
+std::string readFile(const std::filesystem::path &path) {
+  std::ifstream stream(path);
+  if (!stream) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Failed to read shader include file {}", path.string()))};
+  }
+  std::stringstream contents;
+  contents << stream.rdbuf();
+  return contents.str();
+}
+
+// Replaces #include "file" directives with the contents of the file, once
+// per file, followed by #line directives that restore the line numbers of
+// the including source
+void expandIncludes(std::string_view source,
+                    const std::filesystem::path &directory, int sourceNumber,
+                    int depth, IncludeState &state, std::string &output) {
+  if (depth > maxIncludeDepth) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        "Shader #include nesting is too deep (recursive include?)")};
+  }
+
+  auto lineNumber{0};
+  while (!source.empty()) {
+    const auto end{source.find('\n')};
+    const auto line{source.substr(0, end)};
+    source.remove_prefix(end == std::string_view::npos ? source.size()
+                                                       : end + 1);
+    ++lineNumber;
+
+    const auto argument{parseDirective(line, "include")};
+    if (!argument) {
+      output.append(line);
+      output.push_back('\n');
+      continue;
+    }
+
+    if (argument->size() < 2 || !argument->starts_with('"') ||
+        !argument->ends_with('"')) {
+      throw abcg::Exception{abcg::Exception::Runtime(
+          fmt::format("Invalid shader directive: {}", trimView(line)))};
+    }
+    const auto path{
+        (directory / argument->substr(1, argument->size() - 2))
+            .lexically_normal()};
+
+    // Files already included are skipped, as with #pragma once
+    if (!state.includedFiles.insert(path).second) {
+      output.push_back('\n');
+      continue;
+    }
+
+    const auto includeNumber{state.numSources++};
+    output.append(fmt::format("#line 1 {}\n", includeNumber));
+    expandIncludes(readFile(path), path.parent_path(), includeNumber,
+                   depth + 1, state, output);
+    output.append(fmt::format("#line {} {}\n", lineNumber + 1, sourceNumber));
+  }
+}
+
+bool hasDefaultFloatPrecision(std::string_view source) {
+  while (!source.empty()) {
+    const auto end{source.find('\n')};
+    const auto line{trimView(source.substr(0, end))};
+    if (line.starts_with("precision") &&
+        line.find("float") != std::string_view::npos) {
+      return true;
+    }
+    if (end == std::string_view::npos) break;
+    source.remove_prefix(end + 1);
+  }
+  return false;
+}
+}  // namespace
+
+/**
+ * @brief Prepares shader source code for compilation.
+ *
+ * - Sets the version directive (see ShaderPreprocessorSettings::version);
+ * - Adds the default float precision, if required;
+ * - Adds a `#define` for each macro of the settings;
+ * - Replaces each `#include "file"` directive with the contents of the
+ *   file, relative to the directory of the including file. Each file is
+ *   included at most once.
+ *
+ * `#line` directives are inserted so that compiler messages refer to the
+ * lines of the original files. The source string number is 0 for the main
+ * source and increases with each included file.
+ *
+ * @param source Shader source code.
+ * @param settings Preprocessor settings.
+ * @throw abcg::Exception if an included file cannot be read.
+ * @return Source code ready to be compiled.
+ */
+std::string abcg::preprocessShader(std::string_view source,
+                                   const ShaderPreprocessorSettings &settings) {
+  // Skip leading blank lines, keeping count of them
+  auto firstLine{1};
+  while (true) {
+    const auto end{source.find('\n')};
+    if (end == std::string_view::npos ||
+        !trimView(source.substr(0, end)).empty()) {
+      break;
+    }
+    source.remove_prefix(end + 1);
+    ++firstLine;
+  }
+
+  auto version{settings.version};
+  if (const auto end{source.find('\n')};
+      parseDirective(source.substr(0, end), "version")) {
+    if (!settings.replaceVersion) {
+      version = trimView(source.substr(0, end));
+    }
+    source.remove_prefix(end == std::string_view::npos ? source.size()
+                                                       : end + 1);
+    ++firstLine;
+  }
+
+  std::string output{version + "\n"};
+  if (!settings.defaultPrecision.empty() && !hasDefaultFloatPrecision(source)) {
+    output.append(settings.defaultPrecision).push_back('\n');
+  }
+  for (const auto &[name, value] : settings.defines) {
+    output.append(fmt::format("#define {} {}\n", name, value));
+  }
+  output.append(fmt::format("#line {} 0\n", firstLine));
+
+  IncludeState state;
+  expandIncludes(source, settings.includeDirectory, 0, 0, state, output);
+  return output;
+}
+
+/**
+ * @brief Returns a string that identifies a set of macros regardless of
+ * their order.
+ */
+std::string abcg::getShaderDefinesKey(const ShaderDefines &defines) {
+  auto sortedDefines{defines};
+  std::sort(sortedDefines.begin(), sortedDefines.end());
+  std::string key;
+  for (const auto &[name, value] : sortedDefines) {
+    key.append(name).append("=").append(value).append("\n");
+  }
+  return key;
+}
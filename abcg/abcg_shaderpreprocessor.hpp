@@ -0,0 +1,41 @@
+/**
+ * @file abcg_shaderpreprocessor.hpp
+ * @brief Declaration of the shader preprocessor.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_SHADERPREPROCESSOR_HPP_
+#define ABCG_SHADERPREPROCESSOR_HPP_
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace abcg {
+// Macros (name, value) defined before the shader source
+using ShaderDefines = std::vector<std::pair<std::string, std::string>>;
+struct ShaderPreprocessorSettings;
+
+[[nodiscard]] std::string preprocessShader(
+    std::string_view source, const ShaderPreprocessorSettings& settings);
+[[nodiscard]] std::string getShaderDefinesKey(const ShaderDefines& defines);
+}  // namespace abcg
+
+/**
+ * @brief Settings of abcg::preprocessShader.
+ */
+struct abcg::ShaderPreprocessorSettings {
+  // Version directive added if the source has none
+  std::string version;
+  // Whether the version directive of the source is replaced with version
+  bool replaceVersion{};
+  // Statement added if the source does not set the default float precision
+  std::string defaultPrecision;
+  ShaderDefines defines;
+  // Directory of the files included by the source
+  std::string includeDirectory;
+};
+
+#endif
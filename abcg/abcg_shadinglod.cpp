@@ -0,0 +1,146 @@
+/**
+ * @file abcg_shadinglod.cpp
+ * @brief Definition of abcg::ShadingLOD class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_shadinglod.hpp"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <glm/geometric.hpp>
+#include <glm/vec4.hpp>
+#include <limits>
+
+namespace {
+// Change of the bias per frame while the frame time is off target
+constexpr float biasRate{0.05f};
+
+// Fraction of the target frame time within which the bias is kept, so that
+// it does not oscillate around the target
+constexpr float tolerance{0.1f};
+}  // namespace
+
+/**
+ * @brief Sets the number of objects, resetting their levels.
+ *
+ * @param objects Number of objects. The index given to select() must be
+ * less than this number.
+ */
+void abcg::ShadingLOD::resize(std::size_t objects) {
+  m_levels.assign(objects, Level::PerFragment);
+}
+
+/**
+ * @brief Adjusts the bias of the thresholds and resets the statistics.
+ *
+ * Called once per frame, before select().
+ *
+ * @param frameTime Time of the last frame, in milliseconds.
+ * @param canIncreaseBias Whether a frame slower than the target may raise
+ * the bias. The bias can always decay.
+ */
+void abcg::ShadingLOD::beginFrame(float frameTime, bool canIncreaseBias) {
+  if (frameTime > 0.0f) {
+    const auto ratio{frameTime / m_settings.targetFrameTime};
+    if (ratio > 1.0f + tolerance) {
+      if (canIncreaseBias) m_bias *= 1.0f + biasRate;
+    } else if (ratio < 1.0f - tolerance) {
+      m_bias /= 1.0f + biasRate;
+    }
+  }
+  m_bias = std::clamp(m_bias, 1.0f, std::max(m_settings.maxBias, 1.0f));
+
+  m_stats = {.bias = m_bias};
+}
+
+/**
+ * @brief Selects the shading level of an object.
+ *
+ * @param object Index of the object.
+ * @param projectedSize Diameter of the object on the screen, in pixels (see
+ * getProjectedSize()).
+ *
+ * @return Level the object should be drawn with in this frame.
+ */
+abcg::ShadingLOD::Level abcg::ShadingLOD::select(std::size_t object,
+                                                 float projectedSize) {
+  auto &level{m_levels.at(object)};
+
+  // Move to a coarser level as soon as the object is below its threshold,
+  // but to a finer level only when it is above the enlarged threshold
+  const auto coarsest{classify(projectedSize, 1.0f + m_settings.hysteresis)};
+  const auto finest{classify(projectedSize, 1.0f)};
+  const auto selected{std::clamp(level, finest, coarsest)};
+
+  if (selected != level) ++m_stats.transitions;
+  level = selected;
+  ++m_stats.objects.at(static_cast<std::size_t>(level));
+  return level;
+}
+
+void abcg::ShadingLOD::paintUI() {
+  ImGui::SetNextWindowSize(ImVec2(300, 200), ImGuiCond_FirstUseEver);
+  ImGui::Begin("Shading LOD");
+
+  const auto &objects{m_stats.objects};
+  ImGui::Text("Per fragment: %zu", objects.at(0));
+  ImGui::Text("Per vertex: %zu", objects.at(1));
+  ImGui::Text("Unlit: %zu", objects.at(2));
+  ImGui::Text("Transitions: %zu", m_stats.transitions);
+  ImGui::Text("Bias: %.2f", static_cast<double>(m_stats.bias));
+
+  auto settings{m_settings};
+  ImGui::SliderFloat("Per vertex below", &settings.perVertexSize, 0.0f,
+                     256.0f, "%.0f px");
+  ImGui::SliderFloat("Unlit below", &settings.unlitSize, 0.0f, 64.0f,
+                     "%.0f px");
+  ImGui::SliderFloat("Hysteresis", &settings.hysteresis, 0.0f, 1.0f, "%.2f");
+  settings.perVertexSize = std::max(settings.perVertexSize, settings.unlitSize);
+  setSettings(settings);
+
+  ImGui::End();
+}
+
+/**
+ * @brief Returns the diameter in pixels of a sphere projected on the screen.
+ *
+ * The size is measured at the center of the sphere, which is accurate
+ * enough for small spheres and for orthographic projections.
+ *
+ * @param clipMatrix Transformation from the space of the sphere to clip
+ * space.
+ * @param center Center of the sphere.
+ * @param radius Radius of the sphere.
+ * @param viewportHeight Height of the viewport, in pixels.
+ *
+ * @return Projected diameter. If the center is behind the camera, the size
+ * is infinite.
+ */
+float abcg::ShadingLOD::getProjectedSize(const glm::mat4 &clipMatrix,
+                                         const glm::vec3 &center, float radius,
+                                         float viewportHeight) {
+  const glm::vec4 wRow{clipMatrix[0][3], clipMatrix[1][3], clipMatrix[2][3],
+                       clipMatrix[3][3]};
+  const auto w{glm::dot(wRow, glm::vec4(center, 1.0f))};
+  if (w <= 0.0f) return std::numeric_limits<float>::infinity();
+
+  // Vertical scale of the projection, measured on the y axis of the sphere
+  const auto scale{glm::length(glm::vec3(clipMatrix[0][1], clipMatrix[1][1],
+                                         clipMatrix[2][1]))};
+  return radius * scale / w * viewportHeight;
+}
+
+// Level of an object of the given size, with the thresholds multiplied by
+// the bias and by a scale
+abcg::ShadingLOD::Level abcg::ShadingLOD::classify(float projectedSize,
+                                                   float scale) const {
+  const auto factor{m_bias * scale};
+  if (projectedSize < m_settings.unlitSize * factor) return Level::Unlit;
+  if (projectedSize < m_settings.perVertexSize * factor) {
+    return Level::PerVertex;
+  }
+  return Level::PerFragment;
+}
@@ -0,0 +1,105 @@
+/**
+ * @file abcg_shadinglod.hpp
+ * @brief abcg::ShadingLOD header file.
+ *
+ * Declaration of abcg::ShadingLOD class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_SHADINGLOD_HPP_
+#define ABCG_SHADINGLOD_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <vector>
+
+namespace abcg {
+class ShadingLOD;
+struct ShadingLODSettings;
+}  // namespace abcg
+
+/**
+ * @brief Settings of abcg::ShadingLOD.
+ */
+struct abcg::ShadingLODSettings {
+  // Projected diameters, in pixels, below which an object is shaded per
+  // vertex and unlit
+  float perVertexSize{64.0f};
+  float unlitSize{12.0f};
+  // Fraction by which an object must exceed a size to be shaded at the finer
+  // level again
+  float hysteresis{0.25f};
+  // Frame time the sizes are adjusted for, in milliseconds
+  float targetFrameTime{1000.0f / 60.0f};
+  // Largest factor applied to the sizes when the frame time is above the
+  // target
+  float maxBias{8.0f};
+};
+
+/**
+ * @brief abcg::ShadingLOD class.
+ *
+ * Per-object choice between shading programs of decreasing cost: per
+ * fragment (e.g., Phong), per vertex (Gouraud), and unlit.
+ *
+ * Each frame, select() is called with the projected size of each visible
+ * object and returns the level it should be drawn with. Objects covering
+ * few pixels are shaded per vertex or unlit, since the difference is not
+ * visible at that size. To avoid objects switching back and forth near a
+ * threshold, an object only returns to a finer level once its size exceeds
+ * the threshold by ShadingLODSettings::hysteresis.
+ *
+ * The thresholds are scaled by a bias driven by the frame time given to
+ * beginFrame(). While the frame time is above the target, as in a crowded
+ * scene, the bias grows and more objects move to the cheaper levels; once
+ * it is below, the bias decays back to one. When another controller acts
+ * on the same frame time, such as abcg::DynamicResolution, the bias should
+ * only grow once that controller has reached its limit, so that both do
+ * not overshoot together.
+ */
+class abcg::ShadingLOD {
+ public:
+  enum class Level : std::uint8_t { PerFragment, PerVertex, Unlit };
+  static constexpr std::size_t numLevels{3};
+
+  struct Stats {
+    // Objects selected at each level in the last frame
+    std::array<std::size_t, numLevels> objects{};
+    // Objects whose level changed in the last frame
+    std::size_t transitions{};
+    float bias{1.0f};
+  };
+
+  void resize(std::size_t objects);
+  void beginFrame(float frameTime, bool canIncreaseBias = true);
+  [[nodiscard]] Level select(std::size_t object, float projectedSize);
+  void paintUI();
+
+  void setSettings(const ShadingLODSettings& settings) noexcept {
+    m_settings = settings;
+  }
+  [[nodiscard]] ShadingLODSettings getSettings() const noexcept {
+    return m_settings;
+  }
+  [[nodiscard]] Stats getStats() const noexcept { return m_stats; }
+
+  [[nodiscard]] static float getProjectedSize(const glm::mat4& clipMatrix,
+                                              const glm::vec3& center,
+                                              float radius,
+                                              float viewportHeight);
+
+ private:
+  ShadingLODSettings m_settings{};
+  // Level of each object, kept between frames for the hysteresis
+  std::vector<Level> m_levels;
+  float m_bias{1.0f};
+  Stats m_stats{};
+
+  [[nodiscard]] Level classify(float projectedSize, float scale) const;
+};
+
+#endif
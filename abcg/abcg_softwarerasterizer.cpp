@@ -0,0 +1,533 @@
+/**
+ * @file abcg_softwarerasterizer.cpp
+ * @brief Definition of abcg::SoftwareRasterizer class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_softwarerasterizer.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/vec3.hpp>
+#include <string>
+
+#include "SDL.h"
+#include "abcg_exception.hpp"
+
+namespace {
+constexpr auto tileSize{abcg::SoftwareRasterizer::tileSize};
+// Pixels processed together in a row
+constexpr int lanes{8};
+
+// Bits of subpixel precision of the vertices
+constexpr int subpixelBits{8};
+constexpr float subpixelScale{1 << subpixelBits};
+// Extent of the guard band in normalized device coordinates. Triangles are
+// clipped to it, which keeps the edge functions well within 64 bits.
+constexpr float guardBand{16.0f};
+
+// Planes the vertices are clipped against, as dot(plane, position) >= 0:
+// near plane (z >= -w) and guard band (|x| <= guardBand * w, same for y)
+const std::array<glm::vec4, 5> clipPlanes{
+    glm::vec4{0.0f, 0.0f, 1.0f, 1.0f}, glm::vec4{-1.0f, 0.0f, 0.0f, guardBand},
+    glm::vec4{1.0f, 0.0f, 0.0f, guardBand},
+    glm::vec4{0.0f, -1.0f, 0.0f, guardBand},
+    glm::vec4{0.0f, 1.0f, 0.0f, guardBand}};
+
+// Center of a pixel in fixed point
+std::int64_t toFixedPoint(int pixel) {
+  return (static_cast<std::int64_t>(pixel) << subpixelBits) +
+         (1 << (subpixelBits - 1));
+}
+
+std::uint32_t packColor(const glm::vec4 &color) {
+  const auto clamped{glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f};
+  // RGBA in memory order
+  return static_cast<std::uint32_t>(clamped.r) |
+         static_cast<std::uint32_t>(clamped.g) << 8U |
+         static_cast<std::uint32_t>(clamped.b) << 16U |
+         static_cast<std::uint32_t>(clamped.a) << 24U;
+}
+
+glm::vec4 unpackTexel(const abcg::Image &image, int x, int y) {
+  const auto *texel{
+      &image.pixels[(static_cast<std::size_t>(y) *
+                         static_cast<std::size_t>(image.width) +
+                     static_cast<std::size_t>(x)) *
+                    4]};
+  return glm::vec4{texel[0], texel[1], texel[2], texel[3]} / 255.0f;
+}
+}  // namespace
+
+/**
+ * @brief Samples an image with bilinear filtering and repeat wrapping.
+ *
+ * Equivalent to `texture()` on a texture with `GL_LINEAR` filters and
+ * `GL_REPEAT` wrap modes, without mipmaps.
+ *
+ * @param image RGBA image, with the first row at the bottom.
+ * @param texCoord Texture coordinates.
+ * @return Color of the image at the coordinates, or white if the image is
+ * empty.
+ */
+glm::vec4 abcg::sampleImage(const Image &image, glm::vec2 texCoord) {
+  if (image.width <= 0 || image.height <= 0) return glm::vec4{1.0f};
+
+  const auto x{(texCoord.x - std::floor(texCoord.x)) *
+                   static_cast<float>(image.width) -
+               0.5f};
+  const auto y{(texCoord.y - std::floor(texCoord.y)) *
+                   static_cast<float>(image.height) -
+               0.5f};
+  const auto x0{static_cast<int>(std::floor(x))};
+  const auto y0{static_cast<int>(std::floor(y))};
+  const auto fractionX{x - static_cast<float>(x0)};
+  const auto fractionY{y - static_cast<float>(y0)};
+
+  const auto wrap{[](int value, int size) {
+    value %= size;
+    return value < 0 ? value + size : value;
+  }};
+  const auto left{wrap(x0, image.width)};
+  const auto right{wrap(x0 + 1, image.width)};
+  const auto bottom{wrap(y0, image.height)};
+  const auto top{wrap(y0 + 1, image.height)};
+
+  return glm::mix(glm::mix(unpackTexel(image, left, bottom),
+                           unpackTexel(image, right, bottom), fractionX),
+                  glm::mix(unpackTexel(image, left, top),
+                           unpackTexel(image, right, top), fractionX),
+                  fractionY);
+}
+
+/**
+ * @brief Sets the size of the color and depth buffers.
+ *
+ * @param width Width in pixels.
+ * @param height Height in pixels.
+ */
+void abcg::SoftwareRasterizer::resize(int width, int height) {
+  m_width = std::max(width, 1);
+  m_height = std::max(height, 1);
+  m_tilesX = (m_width + tileSize - 1) / tileSize;
+  m_tilesY = (m_height + tileSize - 1) / tileSize;
+  m_stride = m_tilesX * tileSize;
+
+  const auto size{static_cast<std::size_t>(m_stride) *
+                  static_cast<std::size_t>(m_tilesY * tileSize)};
+  m_color.assign(size, 0);
+  m_depth.assign(size, 1.0f);
+}
+
+/**
+ * @brief Clears the color and depth buffers.
+ *
+ * @param color Clear color, as in `glClearColor`.
+ * @param depth Clear depth, as in `glClearDepth`.
+ */
+void abcg::SoftwareRasterizer::clear(const glm::vec4 &color, float depth) {
+  std::fill(m_color.begin(), m_color.end(), packColor(color));
+  std::fill(m_depth.begin(), m_depth.end(), depth);
+}
+
+/**
+ * @brief Draws indexed triangles, as in `glDrawElements(GL_TRIANGLES, ...)`.
+ *
+ * @param numVertices Number of vertices referenced by the indices. Each one
+ * is shaded once.
+ * @param indices Three indices per triangle.
+ * @param numVaryings Number of varyings written by the vertex shader and
+ * interpolated for the fragment shader (at most maxVaryings).
+ * @param vertexShader Function that computes the clip-space position and
+ * varyings of a vertex. Called concurrently from several threads.
+ * @param fragmentShader Function that computes the color of a fragment.
+ * Called concurrently from several threads.
+ * @throw abcg::Exception if numVaryings exceeds maxVaryings.
+ */
+void abcg::SoftwareRasterizer::drawIndexed(
+    std::size_t numVertices, std::span<const std::uint32_t> indices,
+    std::size_t numVaryings, const VertexShader &vertexShader,
+    const FragmentShader &fragmentShader) {
+  if (numVaryings > maxVaryings) {
+    throw abcg::Exception{abcg::Exception::Runtime(fmt::format(
+        "Too many varyings ({} given, {} supported)", numVaryings,
+        maxVaryings))};
+  }
+  if (m_color.empty()) return;
+
+  const auto numWorkers{m_threadPool.size()};
+  const auto numTriangles{indices.size() / 3};
+  const auto numTiles{static_cast<std::size_t>(m_tilesX) *
+                      static_cast<std::size_t>(m_tilesY)};
+  m_shadedVertices.resize(numVertices);
+  m_bins.resize(numWorkers);
+
+  // Vertex shading, then setup and binning of the triangles of each worker.
+  // Consecutive ranges keep the submission order across workers.
+  m_threadPool.run([&](std::size_t workerIndex) {
+    const auto first{numVertices * workerIndex / numWorkers};
+    const auto last{numVertices * (workerIndex + 1) / numWorkers};
+    for (auto vertex{first}; vertex < last; ++vertex) {
+      m_shadedVertices[vertex] = {};
+      vertexShader(static_cast<std::uint32_t>(vertex),
+                   m_shadedVertices[vertex]);
+    }
+  });
+
+  m_threadPool.run([&](std::size_t workerIndex) {
+    auto &bins{m_bins.at(workerIndex)};
+    bins.triangles.clear();
+    bins.tiles.resize(numTiles);
+    for (auto &tile : bins.tiles) tile.clear();
+    bins.fragmentsShaded = 0;
+
+    const auto first{numTriangles * workerIndex / numWorkers};
+    const auto last{numTriangles * (workerIndex + 1) / numWorkers};
+    for (auto triangle{first}; triangle < last; ++triangle) {
+      const auto *triangleIndices{&indices[triangle * 3]};
+      if (triangleIndices[0] >= numVertices ||
+          triangleIndices[1] >= numVertices ||
+          triangleIndices[2] >= numVertices) {
+        continue;
+      }
+      setupTriangle({m_shadedVertices[triangleIndices[0]],
+                     m_shadedVertices[triangleIndices[1]],
+                     m_shadedVertices[triangleIndices[2]]},
+                    numVaryings, bins);
+    }
+  });
+
+  // Rasterization of whole tiles
+  m_nextTile = 0;
+  m_threadPool.run([&](std::size_t workerIndex) {
+    auto &fragmentsShaded{m_bins.at(workerIndex).fragmentsShaded};
+    for (auto tile{m_nextTile++}; tile < static_cast<int>(numTiles);
+         tile = m_nextTile++) {
+      rasterizeTile(tile, numVaryings, fragmentShader, fragmentsShaded);
+    }
+  });
+
+  m_stats.triangles = numTriangles;
+  m_stats.trianglesBinned = 0;
+  m_stats.fragmentsShaded = 0;
+  for (const auto &bins : m_bins) {
+    m_stats.trianglesBinned += bins.triangles.size();
+    m_stats.fragmentsShaded += bins.fragmentsShaded;
+  }
+}
+
+/**
+ * @brief Copies the color buffer to the surface of a window.
+ *
+ * The window must not have an OpenGL context. The image is scaled to the
+ * size of the window.
+ *
+ * @param window Window to present to.
+ * @throw abcg::Exception if the surface of the window is not available.
+ */
+void abcg::SoftwareRasterizer::present(SDL_Window *window) const {
+  auto *windowSurface{SDL_GetWindowSurface(window)};
+  if (windowSurface == nullptr) {
+    throw abcg::Exception{abcg::Exception::SDL("SDL_GetWindowSurface failed")};
+  }
+
+  auto pixels{getTopDownPixels()};
+  auto *surface{SDL_CreateRGBSurfaceWithFormatFrom(
+      pixels.data(), m_width, m_height, 32, m_width * 4,
+      SDL_PIXELFORMAT_RGBA32)};
+  if (surface == nullptr) {
+    throw abcg::Exception{
+        abcg::Exception::SDL("SDL_CreateRGBSurfaceWithFormatFrom failed")};
+  }
+  SDL_BlitScaled(surface, nullptr, windowSurface, nullptr);
+  SDL_FreeSurface(surface);
+  SDL_UpdateWindowSurface(window);
+}
+
+/**
+ * @brief Saves the color buffer to a BMP file.
+ *
+ * @param path Path to the file.
+ * @throw abcg::Exception if the file cannot be written.
+ */
+void abcg::SoftwareRasterizer::saveBMP(std::string_view path) const {
+  auto pixels{getTopDownPixels()};
+  auto *surface{SDL_CreateRGBSurfaceWithFormatFrom(
+      pixels.data(), m_width, m_height, 32, m_width * 4,
+      SDL_PIXELFORMAT_RGBA32)};
+  if (surface == nullptr) {
+    throw abcg::Exception{
+        abcg::Exception::SDL("SDL_CreateRGBSurfaceWithFormatFrom failed")};
+  }
+  const auto result{SDL_SaveBMP(surface, std::string{path}.c_str())};
+  SDL_FreeSurface(surface);
+  if (result != 0) {
+    throw abcg::Exception{abcg::Exception::SDL(
+        fmt::format("Failed to save image file {}", path))};
+  }
+}
+
+/**
+ * @brief Returns a copy of the color buffer, with the first row at the
+ * bottom.
+ */
+abcg::Image abcg::SoftwareRasterizer::getImage() const {
+  Image image{.width = m_width, .height = m_height, .pixels = {}};
+  const auto rowSize{static_cast<std::size_t>(m_width) * 4};
+  image.pixels.resize(rowSize * static_cast<std::size_t>(m_height));
+  for (auto row{0}; row < m_height; ++row) {
+    std::memcpy(&image.pixels[static_cast<std::size_t>(row) * rowSize],
+                &m_color[static_cast<std::size_t>(row) *
+                         static_cast<std::size_t>(m_stride)],
+                rowSize);
+  }
+  return image;
+}
+
+// Clips a triangle against the near plane and the guard band, snaps it to
+// fixed point and adds it to the tiles it overlaps
+void abcg::SoftwareRasterizer::setupTriangle(
+    const std::array<ShadedVertex, 3> &clipVertices, std::size_t numVaryings,
+    Bins &bins) const {
+  // Sutherland-Hodgman: each plane adds at most one vertex
+  std::array<ShadedVertex, 3 + clipPlanes.size()> polygon{};
+  std::array<ShadedVertex, 3 + clipPlanes.size()> clipped{};
+  std::copy(clipVertices.begin(), clipVertices.end(), polygon.begin());
+  std::size_t count{3};
+  for (const auto &plane : clipPlanes) {
+    std::size_t clippedCount{};
+    for (std::size_t index{}; index < count; ++index) {
+      const auto &current{polygon.at(index)};
+      const auto &next{polygon.at((index + 1) % count)};
+      const auto currentDistance{glm::dot(plane, current.position)};
+      const auto nextDistance{glm::dot(plane, next.position)};
+      if (currentDistance >= 0.0f) clipped.at(clippedCount++) = current;
+      if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f)) {
+        const auto t{currentDistance / (currentDistance - nextDistance)};
+        auto &vertex{clipped.at(clippedCount++)};
+        vertex.position = glm::mix(current.position, next.position, t);
+        for (std::size_t varying{}; varying < numVaryings; ++varying) {
+          vertex.varyings[varying] =
+              current.varyings[varying] +
+              (next.varyings[varying] - current.varyings[varying]) * t;
+        }
+      }
+    }
+    if (clippedCount < 3) return;
+    std::swap(polygon, clipped);
+    count = clippedCount;
+  }
+
+  // Window coordinates, as set by glViewport and glDepthRange(0, 1), with x
+  // and y in fixed point
+  std::array<std::int64_t, polygon.size()> fixedX{};
+  std::array<std::int64_t, polygon.size()> fixedY{};
+  std::array<float, polygon.size()> depth{};
+  std::array<float, polygon.size()> inverseW{};
+  for (std::size_t index{}; index < count; ++index) {
+    const auto &position{polygon.at(index).position};
+    inverseW.at(index) = 1.0f / position.w;
+    const auto x{(position.x * inverseW.at(index) * 0.5f + 0.5f) *
+                 static_cast<float>(m_width)};
+    const auto y{(position.y * inverseW.at(index) * 0.5f + 0.5f) *
+                 static_cast<float>(m_height)};
+    depth.at(index) = position.z * inverseW.at(index) * 0.5f + 0.5f;
+    if (!std::isfinite(x) || !std::isfinite(y)) return;
+    fixedX.at(index) = std::llround(x * subpixelScale);
+    fixedY.at(index) = std::llround(y * subpixelScale);
+  }
+
+  for (std::size_t index{2}; index < count; ++index) {
+    std::array<std::size_t, 3> corners{0, index - 1, index};
+    const auto area{(fixedX.at(corners[1]) - fixedX.at(corners[0])) *
+                        (fixedY.at(corners[2]) - fixedY.at(corners[0])) -
+                    (fixedY.at(corners[1]) - fixedY.at(corners[0])) *
+                        (fixedX.at(corners[2]) - fixedX.at(corners[0]))};
+    if (area == 0) continue;
+
+    // Counterclockwise triangles are front-facing (glFrontFace(GL_CCW)).
+    // Back faces are flipped so that the edge functions are positive
+    // inside.
+    Triangle triangle;
+    triangle.frontFacing = area > 0;
+    if (!triangle.frontFacing) std::swap(corners[1], corners[2]);
+
+    const std::array<std::int64_t, 3> x{
+        fixedX.at(corners[0]), fixedX.at(corners[1]), fixedX.at(corners[2])};
+    const std::array<std::int64_t, 3> y{
+        fixedY.at(corners[0]), fixedY.at(corners[1]), fixedY.at(corners[2])};
+    glm::dvec3 depthPlane{};
+    for (std::size_t corner{}; corner < 3; ++corner) {
+      // Edge from the next vertex to the one after it, so that the edge
+      // function is zero at both and equals 2 * area at this vertex
+      const auto from{(corner + 1) % 3};
+      const auto to{(corner + 2) % 3};
+      auto &edge{triangle.edges.at(corner)};
+      edge.a = y.at(from) - y.at(to);
+      edge.b = x.at(to) - x.at(from);
+      edge.c = x.at(from) * y.at(to) - y.at(from) * x.at(to);
+      // Top-left fill rule (with y up, top edges go left and left edges go
+      // down), so that pixels centered on shared edges are drawn once
+      const auto isTopLeft{(edge.a == 0 && edge.b < 0) || edge.a > 0};
+      edge.bias = isTopLeft ? 1 : 0;
+
+      const auto vertexDepth{
+          static_cast<double>(depth.at(corners.at(corner)))};
+      constexpr auto scale{static_cast<double>(subpixelScale)};
+      depthPlane += glm::dvec3{static_cast<double>(edge.a) * scale,
+                               static_cast<double>(edge.b) * scale,
+                               static_cast<double>(edge.c)} *
+                    vertexDepth;
+
+      triangle.inverseW[static_cast<glm::length_t>(corner)] =
+          inverseW.at(corners.at(corner));
+      const auto &varyings{polygon.at(corners.at(corner)).varyings};
+      for (std::size_t varying{}; varying < numVaryings; ++varying) {
+        triangle.varyings.at(corner)[varying] =
+            varyings[varying] * inverseW.at(corners.at(corner));
+      }
+    }
+    triangle.depthPlane =
+        glm::vec3{depthPlane / static_cast<double>(std::abs(area))};
+
+    // Pixels whose centers may be covered
+    const auto [minX, maxX]{std::minmax({x[0], x[1], x[2]})};
+    const auto [minY, maxY]{std::minmax({y[0], y[1], y[2]})};
+    triangle.minX =
+        static_cast<int>(std::max<std::int64_t>(minX >> subpixelBits, 0));
+    triangle.minY =
+        static_cast<int>(std::max<std::int64_t>(minY >> subpixelBits, 0));
+    triangle.maxX = static_cast<int>(
+        std::min<std::int64_t>(maxX >> subpixelBits, m_width - 1));
+    triangle.maxY = static_cast<int>(
+        std::min<std::int64_t>(maxY >> subpixelBits, m_height - 1));
+    if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) {
+      continue;
+    }
+
+    const auto triangleIndex{static_cast<std::uint32_t>(bins.triangles.size())};
+    bins.triangles.push_back(triangle);
+    for (auto tileY{triangle.minY / tileSize};
+         tileY <= triangle.maxY / tileSize; ++tileY) {
+      for (auto tileX{triangle.minX / tileSize};
+           tileX <= triangle.maxX / tileSize; ++tileX) {
+        bins.tiles[static_cast<std::size_t>(tileY * m_tilesX + tileX)]
+            .push_back(triangleIndex);
+      }
+    }
+  }
+}
+
+void abcg::SoftwareRasterizer::rasterizeTile(
+    int tile, std::size_t numVaryings, const FragmentShader &fragmentShader,
+    std::size_t &fragmentsShaded) {
+  const auto tileX{tile % m_tilesX};
+  const auto tileY{tile / m_tilesX};
+  // Workers set up consecutive ranges of triangles
+  for (const auto &bins : m_bins) {
+    for (const auto index : bins.tiles[static_cast<std::size_t>(tile)]) {
+      rasterizeTriangle(bins.triangles[index], tileX, tileY, numVaryings,
+                        fragmentShader, fragmentsShaded);
+    }
+  }
+}
+
+void abcg::SoftwareRasterizer::rasterizeTriangle(
+    const Triangle &triangle, int tileX, int tileY, std::size_t numVaryings,
+    const FragmentShader &fragmentShader, std::size_t &fragmentsShaded) {
+  const auto &[edge0, edge1, edge2]{triangle.edges};
+  const auto &depthPlane{triangle.depthPlane};
+
+  const auto firstRow{std::max(triangle.minY, tileY * tileSize)};
+  const auto lastRow{std::min(triangle.maxY, (tileY + 1) * tileSize - 1)};
+  const auto firstColumn{std::max(triangle.minX, tileX * tileSize)};
+  const auto lastColumn{std::min(triangle.maxX, (tileX + 1) * tileSize - 1)};
+  const auto firstBlock{firstColumn / lanes * lanes};
+
+  Varyings varyings{};
+  for (auto row{firstRow}; row <= lastRow; ++row) {
+    const auto y{static_cast<float>(row) + 0.5f};
+    const auto fixedY{toFixedPoint(row)};
+    const auto rowOffset{static_cast<std::size_t>(row) *
+                         static_cast<std::size_t>(m_stride)};
+
+    for (auto block{firstBlock}; block <= lastColumn; block += lanes) {
+      std::array<std::int64_t, lanes> w0{};
+      std::array<std::int64_t, lanes> w1{};
+      std::array<std::int64_t, lanes> w2{};
+      std::array<float, lanes> z{};
+      for (std::size_t lane{}; lane < lanes; ++lane) {
+        const auto column{block + static_cast<int>(lane)};
+        const auto fixedX{toFixedPoint(column)};
+        w0[lane] = edge0.a * fixedX + edge0.b * fixedY + edge0.c;
+        w1[lane] = edge1.a * fixedX + edge1.b * fixedY + edge1.c;
+        w2[lane] = edge2.a * fixedX + edge2.b * fixedY + edge2.c;
+        const auto x{static_cast<float>(column) + 0.5f};
+        z[lane] = depthPlane.x * x + depthPlane.y * y + depthPlane.z;
+      }
+
+      // Coverage, clipped to the bounding box (blocks may extend into the
+      // padding of the buffer), and early depth test
+      auto *depth{&m_depth[rowOffset + static_cast<std::size_t>(block)]};
+      std::array<bool, lanes> mask{};
+      auto covered{false};
+      for (std::size_t lane{}; lane < lanes; ++lane) {
+        const auto column{block + static_cast<int>(lane)};
+        const auto inside{column >= firstColumn && column <= lastColumn &&
+                          w0[lane] + edge0.bias > 0 &&
+                          w1[lane] + edge1.bias > 0 &&
+                          w2[lane] + edge2.bias > 0};
+        mask[lane] = inside && z[lane] >= 0.0f && z[lane] < depth[lane];
+        covered = covered || mask[lane];
+      }
+      if (!covered) continue;
+
+      auto *color{&m_color[rowOffset + static_cast<std::size_t>(block)]};
+      for (std::size_t lane{}; lane < lanes; ++lane) {
+        if (!mask[lane]) continue;
+
+        // Perspective-correct barycentric coordinates. Varyings were
+        // divided by w at setup, so the weights are the screen-space ones
+        // divided by the interpolated 1/w.
+        const auto weight0{static_cast<float>(w0[lane])};
+        const auto weight1{static_cast<float>(w1[lane])};
+        const auto weight2{static_cast<float>(w2[lane])};
+        const auto scale{1.0f / (weight0 * triangle.inverseW[0] +
+                                 weight1 * triangle.inverseW[1] +
+                                 weight2 * triangle.inverseW[2])};
+        for (std::size_t varying{}; varying < numVaryings; ++varying) {
+          varyings[varying] = (weight0 * triangle.varyings[0][varying] +
+                               weight1 * triangle.varyings[1][varying] +
+                               weight2 * triangle.varyings[2][varying]) *
+                              scale;
+        }
+
+        color[lane] = packColor(fragmentShader(varyings, triangle.frontFacing));
+        depth[lane] = z[lane];
+        ++fragmentsShaded;
+      }
+    }
+  }
+}
+
+// Color buffer without padding and with the first row at the top, as
+// expected by SDL surfaces
+std::vector<std::uint32_t> abcg::SoftwareRasterizer::getTopDownPixels() const {
+  std::vector<std::uint32_t> pixels(static_cast<std::size_t>(m_width) *
+                                    static_cast<std::size_t>(m_height));
+  for (auto row{0}; row < m_height; ++row) {
+    std::memcpy(
+        &pixels[static_cast<std::size_t>(m_height - 1 - row) *
+                static_cast<std::size_t>(m_width)],
+        &m_color[static_cast<std::size_t>(row) *
+                 static_cast<std::size_t>(m_stride)],
+        static_cast<std::size_t>(m_width) * sizeof(std::uint32_t));
+  }
+  return pixels;
+}
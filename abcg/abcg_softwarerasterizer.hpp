@@ -0,0 +1,166 @@
+/**
+ * @file abcg_softwarerasterizer.hpp
+ * @brief abcg::SoftwareRasterizer header file.
+ *
+ * Declaration of abcg::SoftwareRasterizer class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_SOFTWARERASTERIZER_HPP_
+#define ABCG_SOFTWARERASTERIZER_HPP_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "abcg_image.hpp"
+#include "abcg_threadpool.hpp"
+
+struct SDL_Window;
+
+namespace abcg {
+class SoftwareRasterizer;
+
+[[nodiscard]] glm::vec4 sampleImage(const Image& image, glm::vec2 texCoord);
+}  // namespace abcg
+
+/**
+ * @brief abcg::SoftwareRasterizer class.
+ *
+ * Triangle rasterizer that runs entirely on the CPU, for machines without
+ * an OpenGL driver or to measure the cost of GL emulation.
+ *
+ * It follows the pipeline of the examples: a vertex shader and a fragment
+ * shader written as C++ functions, indexed triangles, depth testing with
+ * `GL_LESS`, and perspective-correct interpolation of up to maxVaryings
+ * values. Triangles are clipped against the near plane. Both faces are
+ * drawn, and the fragment shader is told which one it is shading. Vertices
+ * are snapped to 1/256 of a pixel and edges are evaluated in integers, so
+ * that triangles sharing an edge leave no gaps and draw no pixel twice.
+ *
+ * Each draw runs in three parallel phases: vertex shading, triangle setup
+ * with binning into tiles of 32x32 pixels, and rasterization of whole
+ * tiles. Tiles are taken by the workers one at a time, so no two threads
+ * write the same pixel, and triangles are drawn in submission order within
+ * each tile. Tile rows are processed 8 pixels at a time in separate lane
+ * arrays, so that coverage and depth tests compile to SIMD instructions.
+ *
+ * Colors are stored as RGBA8 with the first row at the bottom, as in
+ * OpenGL and abcg::Image. The result can be shown in an SDL window without
+ * an OpenGL context, or saved to a BMP file.
+ */
+class abcg::SoftwareRasterizer {
+ public:
+  static constexpr std::size_t maxVaryings{16};
+  using Varyings = std::array<float, maxVaryings>;
+
+  // Output of the vertex shader (gl_Position and the out variables)
+  struct ShadedVertex {
+    glm::vec4 position{};
+    Varyings varyings{};
+  };
+
+  // Shades the vertex with the given index
+  using VertexShader = std::function<void(std::uint32_t, ShadedVertex&)>;
+  // Returns the color of a fragment from its interpolated varyings
+  using FragmentShader =
+      std::function<glm::vec4(const Varyings&, bool frontFacing)>;
+
+  struct Stats {
+    std::size_t triangles{};
+    std::size_t trianglesBinned{};
+    std::size_t fragmentsShaded{};
+  };
+
+  // Width and height of the tiles triangles are binned into
+  static constexpr int tileSize{32};
+
+  void resize(int width, int height);
+  void clear(const glm::vec4& color, float depth = 1.0f);
+  void drawIndexed(std::size_t numVertices,
+                   std::span<const std::uint32_t> indices,
+                   std::size_t numVaryings, const VertexShader& vertexShader,
+                   const FragmentShader& fragmentShader);
+
+  void present(SDL_Window* window) const;
+  void saveBMP(std::string_view path) const;
+  [[nodiscard]] Image getImage() const;
+
+  [[nodiscard]] int getWidth() const noexcept { return m_width; }
+  [[nodiscard]] int getHeight() const noexcept { return m_height; }
+  [[nodiscard]] Stats getStats() const noexcept { return m_stats; }
+  [[nodiscard]] std::size_t getNumWorkers() const noexcept {
+    return m_threadPool.size();
+  }
+
+ private:
+  // Edge function a * x + b * y + c of a triangle, in fixed point. A pixel
+  // center is inside the edge if the function plus the bias is positive.
+  struct Edge {
+    std::int64_t a{};
+    std::int64_t b{};
+    std::int64_t c{};
+    std::int64_t bias{};
+  };
+
+  // Triangle in window coordinates, ready to be rasterized
+  struct Triangle {
+    // Edges opposite to each vertex
+    std::array<Edge, 3> edges{};
+    // Depth in [0, 1] as a plane in pixel coordinates
+    glm::vec3 depthPlane{};
+    // 1/w and varyings divided by w of each vertex
+    glm::vec3 inverseW{};
+    std::array<Varyings, 3> varyings{};
+    bool frontFacing{};
+    int minX{};
+    int minY{};
+    int maxX{};
+    int maxY{};
+  };
+
+  // Triangles set up by a worker, and their indices in each tile
+  struct Bins {
+    std::vector<Triangle> triangles;
+    std::vector<std::vector<std::uint32_t>> tiles;
+    std::size_t fragmentsShaded{};
+  };
+
+  int m_width{};
+  int m_height{};
+  // Size of the buffers, rounded up to whole tiles
+  int m_stride{};
+  int m_tilesX{};
+  int m_tilesY{};
+  std::vector<std::uint32_t> m_color;
+  std::vector<float> m_depth;
+
+  std::vector<ShadedVertex> m_shadedVertices;
+  std::vector<Bins> m_bins;
+  std::atomic<int> m_nextTile{};
+  Stats m_stats{};
+
+  ThreadPool m_threadPool;
+
+  void setupTriangle(const std::array<ShadedVertex, 3>& clipVertices,
+                     std::size_t numVaryings, Bins& bins) const;
+  void rasterizeTile(int tile, std::size_t numVaryings,
+                     const FragmentShader& fragmentShader,
+                     std::size_t& fragmentsShaded);
+  void rasterizeTriangle(const Triangle& triangle, int tileX, int tileY,
+                         std::size_t numVaryings,
+                         const FragmentShader& fragmentShader,
+                         std::size_t& fragmentsShaded);
+  [[nodiscard]] std::vector<std::uint32_t> getTopDownPixels() const;
+};
+
+#endif
@@ -0,0 +1,146 @@
+/**
+ * @file abcg_staticbatch.cpp
+ * @brief Definition of abcg::StaticBatch class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_staticbatch.hpp"
+
+#include <cstddef>
+#include <fmt/core.h>
+#include <glm/mat3x3.hpp>
+#include <glm/matrix.hpp>
+#include <limits>
+
+#include "abcg_exception.hpp"
+
+/**
+ * @brief Adds a triangle mesh to the batch.
+ *
+ * @param positions Vertex positions in model space.
+ * @param indices Indices of the triangles, relative to the first element of
+ * `positions`.
+ * @param modelMatrix Transform from model space to world space.
+ * @param color Color of every vertex of the mesh.
+ */
+void abcg::StaticBatch::add(std::span<const glm::vec3> positions,
+                            std::span<const GLuint> indices,
+                            const glm::mat4 &modelMatrix,
+                            const glm::vec4 &color) {
+  const auto baseVertex{m_vertices.size()};
+  if (baseVertex + positions.size() > std::numeric_limits<GLuint>::max()) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Static batch exceeds {} vertices",
+                    std::numeric_limits<GLuint>::max()))};
+  }
+
+  m_vertices.reserve(baseVertex + positions.size());
+  for (const auto &position : positions) {
+    m_vertices.push_back(
+        {.position = glm::vec3(modelMatrix * glm::vec4(position, 1.0f)),
+         .color = color});
+  }
+
+  // Mirroring transforms flip the winding of the triangles
+  const auto mirrored{glm::determinant(glm::mat3(modelMatrix)) < 0.0f};
+
+  m_indices.reserve(m_indices.size() + indices.size());
+  for (std::size_t i{}; i + 2 < indices.size(); i += 3) {
+    const auto a{static_cast<GLuint>(baseVertex + indices[i])};
+    const auto b{static_cast<GLuint>(baseVertex + indices[i + 1])};
+    const auto c{static_cast<GLuint>(baseVertex + indices[i + 2])};
+    m_indices.insert(m_indices.end(), {a, mirrored ? c : b, mirrored ? b : c});
+  }
+
+  ++m_stats.meshes;
+  m_stats.vertices = m_vertices.size();
+  m_stats.indices = m_indices.size();
+}
+
+/**
+ * @brief Uploads the merged meshes and creates the VAO.
+ *
+ * @param program Program used to render the batch, from which the
+ * locations of the vertex attributes are queried.
+ */
+void abcg::StaticBatch::initializeGL(GLuint program) {
+  glDeleteBuffers(1, &m_VBO);
+  glDeleteBuffers(1, &m_EBO);
+  glDeleteVertexArrays(1, &m_VAO);
+
+  // Generate VBO
+  glGenBuffers(1, &m_VBO);
+  glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+  glBufferData(GL_ARRAY_BUFFER,
+               static_cast<GLsizeiptr>(sizeof(Vertex) * m_vertices.size()),
+               m_vertices.data(), GL_STATIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  // Generate EBO
+  glGenBuffers(1, &m_EBO);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+               static_cast<GLsizeiptr>(sizeof(GLuint) * m_indices.size()),
+               m_indices.data(), GL_STATIC_DRAW);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+  // Create VAO and bind vertex attributes
+  glGenVertexArrays(1, &m_VAO);
+  glBindVertexArray(m_VAO);
+  glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+
+  const GLint positionAttribute{glGetAttribLocation(program, "inPosition")};
+  if (positionAttribute >= 0) {
+    const auto location{static_cast<GLuint>(positionAttribute)};
+    glEnableVertexAttribArray(location);
+    glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE,
+                          sizeof(Vertex), nullptr);
+  }
+
+  const GLint colorAttribute{glGetAttribLocation(program, "inColor")};
+  if (colorAttribute >= 0) {
+    const auto location{static_cast<GLuint>(colorAttribute)};
+    glEnableVertexAttribArray(location);
+    const auto offset{offsetof(Vertex, color)};
+    glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE,
+                          sizeof(Vertex),
+                          // NOLINTNEXTLINE(performance-no-int-to-ptr)
+                          reinterpret_cast<void *>(offset));
+  }
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+  glBindVertexArray(0);
+
+  m_indexCount = static_cast<GLsizei>(m_indices.size());
+
+  // The geometry now lives only on the GPU
+  m_vertices = {};
+  m_indices = {};
+}
+
+/**
+ * @brief Draws every mesh of the batch with a single draw call.
+ */
+void abcg::StaticBatch::render() const {
+  if (m_indexCount == 0) return;
+
+  glBindVertexArray(m_VAO);
+  glDrawElements(GL_TRIANGLES, m_indexCount, GL_UNSIGNED_INT, nullptr);
+  glBindVertexArray(0);
+}
+
+/**
+ * @brief Releases the OpenGL resources and removes every mesh.
+ */
+void abcg::StaticBatch::terminateGL() {
+  glDeleteBuffers(1, &m_VBO);
+  glDeleteBuffers(1, &m_EBO);
+  glDeleteVertexArrays(1, &m_VAO);
+  m_VBO = m_EBO = m_VAO = 0;
+  m_vertices = {};
+  m_indices = {};
+  m_indexCount = 0;
+  m_stats = {};
+}
@@ -0,0 +1,77 @@
+/**
+ * @file abcg_staticbatch.hpp
+ * @brief abcg::StaticBatch header file.
+ *
+ * Declaration of abcg::StaticBatch class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_STATICBATCH_HPP_
+#define ABCG_STATICBATCH_HPP_
+
+#include <cstddef>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <span>
+#include <vector>
+
+#include "abcg_openglfunctions.hpp"
+
+namespace abcg {
+class StaticBatch;
+}  // namespace abcg
+
+/**
+ * @brief abcg::StaticBatch class.
+ *
+ * Merges meshes that never move into a single vertex buffer and index
+ * buffer, so that they are drawn with one draw call.
+ *
+ * The model transform and color of each mesh are applied to its vertices
+ * when the mesh is added, so the shader does not need per-object uniform
+ * variables. Vertices have a position (attribute `inPosition`) and a color
+ * (attribute `inColor`) in world space.
+ *
+ * Meshes are added with add() and uploaded with initializeGL(). The data
+ * kept on the CPU is released after the upload.
+ */
+class abcg::StaticBatch {
+ public:
+  struct Vertex {
+    glm::vec3 position{};
+    glm::vec4 color{};
+  };
+
+  struct Stats {
+    // Number of meshes merged, i.e., draw calls without batching
+    std::size_t meshes{};
+    std::size_t vertices{};
+    std::size_t indices{};
+  };
+
+  void add(std::span<const glm::vec3> positions,
+           std::span<const GLuint> indices, const glm::mat4& modelMatrix,
+           const glm::vec4& color);
+  void initializeGL(GLuint program);
+  void render() const;
+  void terminateGL();
+
+  [[nodiscard]] Stats getStats() const noexcept { return m_stats; }
+  [[nodiscard]] std::size_t getDrawCallsSaved() const noexcept {
+    return m_stats.meshes > 1 ? m_stats.meshes - 1 : 0;
+  }
+
+ private:
+  GLuint m_VAO{};
+  GLuint m_VBO{};
+  GLuint m_EBO{};
+
+  std::vector<Vertex> m_vertices;
+  std::vector<GLuint> m_indices;
+  GLsizei m_indexCount{};
+  Stats m_stats{};
+};
+
+#endif
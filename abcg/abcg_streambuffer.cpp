@@ -0,0 +1,193 @@
+/**
+ * @file abcg_streambuffer.cpp
+ * @brief Definition of abcg::StreamBuffer class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_streambuffer.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "abcg_exception.hpp"
+
+namespace {
+// Blocks until the commands before the fence have completed
+void waitFence(GLsync fence) {
+  constexpr GLuint64 timeout{1'000'000'000};  // 1 second, in nanoseconds
+  while (true) {
+    const auto result{
+        abcg::glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout)};
+    if (result != GL_TIMEOUT_EXPIRED) break;
+  }
+}
+}  // namespace
+
+/**
+ * @brief Creates the buffer.
+ *
+ * @param target Target to which the buffer is bound for uploads, e.g.,
+ * `GL_ARRAY_BUFFER`.
+ * @param segmentSize Maximum number of bytes allocated in a frame.
+ * @param numSegments Number of frames in flight, from 1 to 4.
+ */
+void abcg::StreamBuffer::initializeGL(GLenum target, GLsizeiptr segmentSize,
+                                      int numSegments) {
+  terminateGL();
+
+  m_target = target;
+  m_segmentSize = segmentSize;
+  m_numSegments = std::clamp(numSegments, 1, m_maxSegments);
+  m_currentSegment = 0;
+  m_used = 0;
+
+  const auto totalSize{m_segmentSize * m_numSegments};
+
+  glGenBuffers(1, &m_buffer);
+  glBindBuffer(m_target, m_buffer);
+
+#if defined(__EMSCRIPTEN__)
+  m_mode = Mode::SubData;
+#else
+  if (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage) {
+    m_mode = Mode::PersistentMapping;
+  } else {
+    m_mode = Mode::RangeMapping;
+  }
+#endif
+
+#if !defined(__EMSCRIPTEN__)
+  if (m_mode == Mode::PersistentMapping) {
+    const GLbitfield flags{GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT |
+                           GL_MAP_COHERENT_BIT};
+    glBufferStorage(m_target, totalSize, nullptr, flags);
+    m_mapping =
+        static_cast<std::byte *>(glMapBufferRange(m_target, 0, totalSize, flags));
+    glBindBuffer(m_target, 0);
+    return;
+  }
+#endif
+
+  glBufferData(m_target, totalSize, nullptr, GL_STREAM_DRAW);
+  glBindBuffer(m_target, 0);
+  m_staging.resize(static_cast<std::size_t>(m_segmentSize));
+}
+
+/**
+ * @brief Allocates a range of the current frame segment.
+ *
+ * @param size Size of the range, in bytes.
+ * @param alignment Alignment of the offset of the range. Use the vertex
+ * size to draw from the range with the `first` argument of `glDrawArrays`.
+ * @throw abcg::Exception if the segment has no room for the range.
+ * @return Allocated range.
+ */
+abcg::StreamBuffer::Allocation abcg::StreamBuffer::allocate(
+    GLsizeiptr size, GLsizeiptr alignment) {
+  if (!canAllocate(size, alignment)) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Stream buffer segment of {} bytes is full ({} bytes "
+                    "requested)",
+                    m_segmentSize, size))};
+  }
+  const auto segmentOffset{(m_used + alignment - 1) / alignment * alignment};
+  m_used = segmentOffset + size;
+
+  const auto offset{m_currentSegment * m_segmentSize + segmentOffset};
+  auto *data{m_mode == Mode::PersistentMapping ? m_mapping + offset
+                                               : m_staging.data() +
+                                                     segmentOffset};
+  return {.data = data, .offset = offset, .size = size};
+}
+
+/**
+ * @brief Returns whether the current frame segment has room for a range.
+ *
+ * @param size Size of the range, in bytes.
+ * @param alignment Alignment of the offset of the range.
+ */
+bool abcg::StreamBuffer::canAllocate(GLsizeiptr size,
+                                     GLsizeiptr alignment) const noexcept {
+  const auto segmentOffset{(m_used + alignment - 1) / alignment * alignment};
+  return segmentOffset + size <= m_segmentSize;
+}
+
+/**
+ * @brief Makes the data written to an allocation visible to the GPU.
+ *
+ * @param allocation Range returned by allocate() in the current frame.
+ */
+void abcg::StreamBuffer::commit(const Allocation &allocation) {
+  // Writes to a coherent mapping need no further action
+  if (m_mode == Mode::PersistentMapping || allocation.size == 0) return;
+
+  glBindBuffer(m_target, m_buffer);
+  if (m_mode == Mode::RangeMapping) {
+    // The fences guarantee that the GPU is not reading this range
+    auto *destination{glMapBufferRange(
+        m_target, allocation.offset, allocation.size,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+            GL_MAP_UNSYNCHRONIZED_BIT)};
+    if (destination != nullptr) {
+      std::memcpy(destination, allocation.data,
+                  static_cast<std::size_t>(allocation.size));
+      glUnmapBuffer(m_target);
+    }
+  } else {
+    glBufferSubData(m_target, allocation.offset, allocation.size,
+                    allocation.data);
+  }
+  glBindBuffer(m_target, 0);
+}
+
+/**
+ * @brief Finishes the current frame segment and starts the next one.
+ *
+ * Must be called after the draw calls that read the allocations of the
+ * frame.
+ */
+void abcg::StreamBuffer::endFrame() {
+  if (m_buffer == 0) return;
+
+  // glBufferSubData already synchronizes with pending draw calls
+  if (m_mode != Mode::SubData) {
+    auto &fence{m_fences.at(static_cast<std::size_t>(m_currentSegment))};
+    if (fence != nullptr) abcg::glDeleteSync(fence);
+    fence = abcg::glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+
+  m_currentSegment = (m_currentSegment + 1) % m_numSegments;
+  m_used = 0;
+
+  // Wait until the GPU is done with the next segment
+  auto &fence{m_fences.at(static_cast<std::size_t>(m_currentSegment))};
+  if (fence != nullptr) {
+    waitFence(fence);
+    abcg::glDeleteSync(fence);
+    fence = nullptr;
+  }
+}
+
+/**
+ * @brief Releases the buffer and the fences.
+ */
+void abcg::StreamBuffer::terminateGL() {
+  for (auto &fence : m_fences) {
+    if (fence != nullptr) abcg::glDeleteSync(fence);
+    fence = nullptr;
+  }
+
+  if (m_mapping != nullptr) {
+    glBindBuffer(m_target, m_buffer);
+    glUnmapBuffer(m_target);
+    glBindBuffer(m_target, 0);
+    m_mapping = nullptr;
+  }
+
+  glDeleteBuffers(1, &m_buffer);
+  m_buffer = 0;
+  m_staging.clear();
+}
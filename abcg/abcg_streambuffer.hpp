@@ -0,0 +1,88 @@
+/**
+ * @file abcg_streambuffer.hpp
+ * @brief abcg::StreamBuffer header file.
+ *
+ * Declaration of abcg::StreamBuffer class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_STREAMBUFFER_HPP_
+#define ABCG_STREAMBUFFER_HPP_
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include "abcg_openglfunctions.hpp"
+
+namespace abcg {
+class StreamBuffer;
+}  // namespace abcg
+
+/**
+ * @brief abcg::StreamBuffer class.
+ *
+ * Ring buffer for geometry that changes every frame.
+ *
+ * The buffer is split in segments, one per frame in flight. Each frame,
+ * allocate() hands out sub-ranges of the current segment to be written by
+ * the CPU, and endFrame() places a fence after the commands that read the
+ * segment and moves on to the next one, waiting only if the GPU has not
+ * finished with it yet. No OpenGL objects are created after
+ * initializeGL().
+ *
+ * Depending on the context, the data is written:
+ * - Directly to a persistent coherent mapping (OpenGL 4.4 or
+ *   ARB_buffer_storage);
+ * - To a range mapped without synchronization (other desktop contexts);
+ * - To a CPU copy uploaded with `glBufferSubData` (WebGL 2.0).
+ *
+ * In every case, commit() must be called after writing an allocation and
+ * before drawing from it.
+ */
+class abcg::StreamBuffer {
+ public:
+  enum class Mode { PersistentMapping, RangeMapping, SubData };
+
+  struct Allocation {
+    // Write-only pointer to the allocated range
+    void* data{};
+    // Offset of the range from the start of the buffer, in bytes
+    GLintptr offset{};
+    GLsizeiptr size{};
+  };
+
+  void initializeGL(GLenum target, GLsizeiptr segmentSize,
+                    int numSegments = 3);
+  [[nodiscard]] Allocation allocate(GLsizeiptr size,
+                                    GLsizeiptr alignment = 16);
+  [[nodiscard]] bool canAllocate(GLsizeiptr size,
+                                 GLsizeiptr alignment = 16) const noexcept;
+  void commit(const Allocation& allocation);
+  void endFrame();
+  void terminateGL();
+
+  [[nodiscard]] GLuint getBuffer() const noexcept { return m_buffer; }
+  [[nodiscard]] Mode getMode() const noexcept { return m_mode; }
+
+ private:
+  static constexpr int m_maxSegments{4};
+
+  GLuint m_buffer{};
+  GLenum m_target{};
+  Mode m_mode{Mode::SubData};
+
+  GLsizeiptr m_segmentSize{};
+  int m_numSegments{};
+  int m_currentSegment{};
+  // Bytes used in the current segment
+  GLsizeiptr m_used{};
+
+  std::array<GLsync, m_maxSegments> m_fences{};
+  // Start of the persistent mapping, or CPU copy of the current segment
+  std::byte* m_mapping{};
+  std::vector<std::byte> m_staging;
+};
+
+#endif
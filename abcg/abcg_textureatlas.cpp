@@ -0,0 +1,320 @@
+/**
+ * @file abcg_textureatlas.cpp
+ * @brief Definition of abcg::SkylinePacker and abcg::TextureAtlas members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_textureatlas.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <bit>
+#include <cppitertools/itertools.hpp>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+#include "abcg_exception.hpp"
+
+abcg::SkylinePacker::SkylinePacker(int width, int height)
+    : m_width(width), m_height(height) {
+  reset();
+}
+
+/**
+ * @brief Finds a position for a rectangle and marks it as occupied.
+ *
+ * @param width Width of the rectangle.
+ * @param height Height of the rectangle.
+ *
+ * @return Bottom-left corner of the rectangle, or std::nullopt if the
+ * rectangle does not fit.
+ */
+std::optional<abcg::SkylinePacker::Position> abcg::SkylinePacker::insert(
+    int width, int height) {
+  auto bestIndex{m_skyline.size()};
+  auto bestTop{std::numeric_limits<int>::max()};
+  auto bestWidth{std::numeric_limits<int>::max()};
+  int bestY{};
+
+  for (auto index : iter::range(m_skyline.size())) {
+    if (auto y{fit(index, width, height)}) {
+      // Bottom-left: lowest top edge first, then narrowest segment
+      auto top{*y + height};
+      if (top < bestTop ||
+          (top == bestTop && m_skyline[index].width < bestWidth)) {
+        bestIndex = index;
+        bestTop = top;
+        bestWidth = m_skyline[index].width;
+        bestY = *y;
+      }
+    }
+  }
+
+  if (bestIndex == m_skyline.size()) return std::nullopt;
+
+  Position position{m_skyline[bestIndex].x, bestY};
+  addSegment(bestIndex, position.x, position.y, width, height);
+  m_usedArea += static_cast<long>(width) * height;
+
+  return position;
+}
+
+void abcg::SkylinePacker::reset() {
+  m_skyline.clear();
+  m_skyline.push_back({0, 0, m_width});
+  m_usedArea = 0;
+}
+
+float abcg::SkylinePacker::getOccupancy() const {
+  return static_cast<float>(m_usedArea) /
+         (static_cast<float>(m_width) * static_cast<float>(m_height));
+}
+
+std::optional<int> abcg::SkylinePacker::fit(std::size_t index, int width,
+                                            int height) const {
+  auto x{m_skyline[index].x};
+  if (x + width > m_width) return std::nullopt;
+
+  auto y{m_skyline[index].y};
+  auto widthLeft{width};
+  while (widthLeft > 0) {
+    if (index == m_skyline.size()) return std::nullopt;
+    y = std::max(y, m_skyline[index].y);
+    if (y + height > m_height) return std::nullopt;
+    widthLeft -= m_skyline[index].width;
+    ++index;
+  }
+
+  return y;
+}
+
+void abcg::SkylinePacker::addSegment(std::size_t index, int x, int y,
+                                     int width, int height) {
+  m_skyline.insert(m_skyline.begin() + static_cast<std::ptrdiff_t>(index),
+                   {x, y + height, width});
+
+  // Shrink or remove the segments covered by the new one
+  for (auto i{index + 1}; i < m_skyline.size();) {
+    auto &previous{m_skyline[i - 1]};
+    auto &current{m_skyline[i]};
+    auto previousEnd{previous.x + previous.width};
+    if (current.x >= previousEnd) break;
+
+    auto shrink{previousEnd - current.x};
+    current.x += shrink;
+    current.width -= shrink;
+    if (current.width > 0) break;
+    m_skyline.erase(m_skyline.begin() + static_cast<std::ptrdiff_t>(i));
+  }
+
+  // Merge neighbors at the same height
+  for (std::size_t i{1}; i < m_skyline.size();) {
+    if (m_skyline[i - 1].y == m_skyline[i].y) {
+      m_skyline[i - 1].width += m_skyline[i].width;
+      m_skyline.erase(m_skyline.begin() + static_cast<std::ptrdiff_t>(i));
+    } else {
+      ++i;
+    }
+  }
+}
+
+/**
+ * @brief Adds an image file to the atlas.
+ *
+ * @param path Path to the image file.
+ *
+ * @return Identifier of the image, used in getRegion() and getLayer().
+ */
+int abcg::TextureAtlas::add(std::string_view path) {
+  return add(abcg::loadImage(path));
+}
+
+/**
+ * @brief Adds an RGBA image to the atlas.
+ *
+ * @param image Image to be added.
+ *
+ * @return Identifier of the image, used in getRegion() and getLayer().
+ */
+int abcg::TextureAtlas::add(Image image) {
+  m_entries.push_back({.image = std::move(image)});
+  return static_cast<int>(m_entries.size()) - 1;
+}
+
+/**
+ * @brief Packs the images and creates the texture object.
+ *
+ * For `GL_TEXTURE_2D`, the atlas size is the smallest power of two that fits
+ * every image in a single texture. For `GL_TEXTURE_2D_ARRAY`, images that do
+ * not fit in a layer overflow to new layers.
+ *
+ * @param target `GL_TEXTURE_2D` or `GL_TEXTURE_2D_ARRAY`.
+ * @param maxSize Maximum width and height of the atlas.
+ * @param padding Number of texels extruded around each image to avoid
+ * bleeding between neighbors when filtering.
+ * @param generateMipmaps Whether to generate mipmaps. The number of levels is
+ * limited by the padding size.
+ *
+ * @throw abcg::Exception if the images do not fit in the atlas.
+ */
+void abcg::TextureAtlas::build(GLenum target, int maxSize, int padding,
+                               bool generateMipmaps) {
+  if (m_entries.empty()) {
+    throw abcg::Exception{abcg::Exception::Runtime("Texture atlas is empty")};
+  }
+  if (target != GL_TEXTURE_2D && target != GL_TEXTURE_2D_ARRAY) {
+    throw abcg::Exception{
+        abcg::Exception::Runtime("Invalid texture atlas target")};
+  }
+
+  GLint maxTextureSize{};
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+  maxSize = std::min(maxSize, maxTextureSize);
+
+  auto maxLayers{1};
+  if (target == GL_TEXTURE_2D_ARRAY) {
+    GLint maxArrayLayers{};
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxArrayLayers);
+    maxLayers = maxArrayLayers;
+  }
+
+  // Smallest power of two that holds the largest image
+  auto largest{0};
+  for (const auto &entry : m_entries) {
+    largest = std::max({largest, entry.image.width, entry.image.height});
+  }
+  auto size{static_cast<int>(
+      std::bit_ceil(static_cast<unsigned>(largest + 2 * padding)))};
+
+  while (size <= maxSize && !pack(size, padding, maxLayers)) {
+    size *= 2;
+  }
+  if (size > maxSize) {
+    throw abcg::Exception{abcg::Exception::Runtime(fmt::format(
+        "Failed to pack {} images in a {}x{} texture atlas", m_entries.size(),
+        maxSize, maxSize))};
+  }
+
+  terminateGL();
+  m_target = target;
+  m_size = size;
+
+  // Copy images to the layers, extruding the borders into the padding
+  auto layerSize{static_cast<size_t>(size) * static_cast<size_t>(size) * 4};
+  std::vector<std::uint8_t> texels(layerSize *
+                                   static_cast<size_t>(m_numLayers));
+  for (const auto &entry : m_entries) {
+    const auto &image{entry.image};
+    auto x0{static_cast<int>(entry.region.x * static_cast<float>(size))};
+    auto y0{static_cast<int>(entry.region.y * static_cast<float>(size))};
+    auto *layer{texels.data() + layerSize * static_cast<size_t>(entry.layer)};
+
+    for (auto y : iter::range(-padding, image.height + padding)) {
+      auto srcRow{std::clamp(y, 0, image.height - 1)};
+      const auto *src{image.pixels.data() +
+                      static_cast<size_t>(srcRow * image.width) * 4};
+      auto *dst{layer + (static_cast<size_t>(y0 + y) *
+                             static_cast<size_t>(size) +
+                         static_cast<size_t>(x0)) *
+                            4};
+
+      memcpy(dst, src, static_cast<size_t>(image.width) * 4);
+      for (auto x : iter::range(1, padding + 1)) {
+        memcpy(dst - x * 4, src, 4);
+        memcpy(dst + (image.width - 1 + x) * 4,
+               src + (image.width - 1) * 4, 4);
+      }
+    }
+  }
+
+  glGenTextures(1, &m_texture);
+  glBindTexture(m_target, m_texture);
+  if (m_target == GL_TEXTURE_2D) {
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA,
+                 GL_UNSIGNED_BYTE, texels.data());
+  } else {
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, size, size, m_numLayers, 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+  }
+
+  glTexParameteri(m_target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(m_target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(m_target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+  if (generateMipmaps && padding > 1) {
+    // Stop before neighbors start to bleed into each other
+    auto maxLevel{
+        static_cast<GLint>(std::bit_width(static_cast<unsigned>(padding))) - 1};
+    glTexParameteri(m_target, GL_TEXTURE_MAX_LEVEL, maxLevel);
+    glGenerateMipmap(m_target);
+    glTexParameteri(m_target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  } else {
+    glTexParameteri(m_target, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexParameteri(m_target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  }
+
+  glBindTexture(m_target, 0);
+}
+
+void abcg::TextureAtlas::terminateGL() {
+  glDeleteTextures(1, &m_texture);
+  m_texture = 0;
+}
+
+/**
+ * @brief Returns the texture coordinate transform of an image.
+ *
+ * @param id Identifier returned by add().
+ *
+ * @return Offset (xy) and scale (zw) of the image in the atlas.
+ */
+glm::vec4 abcg::TextureAtlas::getRegion(int id) const {
+  return m_entries.at(static_cast<size_t>(id)).region;
+}
+
+int abcg::TextureAtlas::getLayer(int id) const {
+  return m_entries.at(static_cast<size_t>(id)).layer;
+}
+
+bool abcg::TextureAtlas::pack(int size, int padding, int maxLayers) {
+  // Place the tallest images first
+  std::vector<size_t> order(m_entries.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](auto lhs, auto rhs) {
+    return m_entries[lhs].image.height > m_entries[rhs].image.height;
+  });
+
+  std::vector<SkylinePacker> layers;
+  for (auto index : order) {
+    auto &entry{m_entries[index]};
+    auto width{entry.image.width + 2 * padding};
+    auto height{entry.image.height + 2 * padding};
+
+    std::optional<SkylinePacker::Position> position;
+    for (auto &&[layerIndex, layer] : iter::enumerate(layers)) {
+      if ((position = layer.insert(width, height))) {
+        entry.layer = static_cast<int>(layerIndex);
+        break;
+      }
+    }
+
+    if (!position) {
+      if (static_cast<int>(layers.size()) == maxLayers) return false;
+      position = layers.emplace_back(size, size).insert(width, height);
+      if (!position) return false;
+      entry.layer = static_cast<int>(layers.size()) - 1;
+    }
+
+    auto invSize{1.0f / static_cast<float>(size)};
+    entry.region = {static_cast<float>(position->x + padding) * invSize,
+                    static_cast<float>(position->y + padding) * invSize,
+                    static_cast<float>(entry.image.width) * invSize,
+                    static_cast<float>(entry.image.height) * invSize};
+  }
+
+  m_numLayers = static_cast<int>(layers.size());
+  return true;
+}
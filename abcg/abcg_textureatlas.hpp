@@ -0,0 +1,107 @@
+/**
+ * @file abcg_textureatlas.hpp
+ * @brief abcg::TextureAtlas header file.
+ *
+ * Declaration of abcg::SkylinePacker and abcg::TextureAtlas classes.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_TEXTUREATLAS_HPP_
+#define ABCG_TEXTUREATLAS_HPP_
+
+#include <glm/vec4.hpp>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "abcg_image.hpp"
+#include "abcg_openglfunctions.hpp"
+
+namespace abcg {
+class SkylinePacker;
+class TextureAtlas;
+}  // namespace abcg
+
+/**
+ * @brief abcg::SkylinePacker class.
+ *
+ * Rectangle packer using the skyline bottom-left heuristic.
+ */
+class abcg::SkylinePacker {
+ public:
+  struct Position {
+    int x{};
+    int y{};
+  };
+
+  SkylinePacker(int width, int height);
+
+  [[nodiscard]] std::optional<Position> insert(int width, int height);
+  void reset();
+
+  [[nodiscard]] float getOccupancy() const;
+
+ private:
+  struct Segment {
+    int x{};
+    int y{};
+    int width{};
+  };
+
+  int m_width{};
+  int m_height{};
+  long m_usedArea{};
+  std::vector<Segment> m_skyline;
+
+  [[nodiscard]] std::optional<int> fit(std::size_t index, int width,
+                                       int height) const;
+  void addSegment(std::size_t index, int x, int y, int width, int height);
+};
+
+/**
+ * @brief abcg::TextureAtlas class.
+ *
+ * Packs many small images into a single 2D texture or into the layers of a
+ * 2D texture array, so that objects with different textures can share the
+ * same texture binding.
+ *
+ * Texture coordinates must be remapped in the shader as
+ * `fract(uv) * region.zw + region.xy` where `region` is the value returned by
+ * getRegion(). When the target is `GL_TEXTURE_2D_ARRAY`, the layer returned
+ * by getLayer() is used as the third texture coordinate.
+ */
+class abcg::TextureAtlas {
+ public:
+  int add(std::string_view path);
+  int add(Image image);
+
+  void build(GLenum target = GL_TEXTURE_2D, int maxSize = 4096,
+             int padding = 4, bool generateMipmaps = true);
+  void terminateGL();
+
+  [[nodiscard]] GLuint getTexture() const { return m_texture; }
+  [[nodiscard]] GLenum getTarget() const { return m_target; }
+  [[nodiscard]] int getNumLayers() const { return m_numLayers; }
+  [[nodiscard]] std::size_t getNumImages() const { return m_entries.size(); }
+  [[nodiscard]] glm::vec4 getRegion(int id) const;
+  [[nodiscard]] int getLayer(int id) const;
+
+ private:
+  struct Entry {
+    Image image;
+    glm::vec4 region{0.0f, 0.0f, 1.0f, 1.0f};
+    int layer{};
+  };
+
+  std::vector<Entry> m_entries;
+
+  GLuint m_texture{};
+  GLenum m_target{GL_TEXTURE_2D};
+  int m_size{};
+  int m_numLayers{};
+
+  [[nodiscard]] bool pack(int size, int padding, int maxLayers);
+};
+
+#endif
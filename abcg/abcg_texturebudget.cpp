@@ -0,0 +1,295 @@
+/**
+ * @file abcg_texturebudget.cpp
+ * @brief Definition of abcg::TextureBudget class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_texturebudget.hpp"
+
+#include <fmt/core.h>
+#include <imgui.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cppitertools/itertools.hpp>
+#include <utility>
+
+#include "abcg_exception.hpp"
+
+namespace {
+// Textures are not downscaled below this size, even if over budget
+constexpr int minTextureSize{32};
+
+double toMiB(std::size_t bytes) {
+  return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+}  // namespace
+
+/**
+ * @brief Releases the budget of deleted textures.
+ *
+ * Called by abcg::glDeleteTextures.
+ *
+ * @param n Number of textures.
+ * @param textures Array of texture names.
+ */
+void abcg::releaseTextureMemory(GLsizei n, const GLuint *textures) {
+  for (auto index : iter::range(n)) {
+    TextureBudget::getInstance().release(textures[index]);
+  }
+}
+
+abcg::TextureBudget &abcg::TextureBudget::getInstance() {
+  static TextureBudget instance;
+  return instance;
+}
+
+/**
+ * @brief Sets the maximum amount of memory used by textures.
+ *
+ * Textures already loaded are not downscaled. The new budget applies to
+ * subsequent loads and upgrades.
+ *
+ * @param bytes Budget in bytes, or zero for no limit.
+ */
+void abcg::TextureBudget::setBudget(std::size_t bytes) { m_budget = bytes; }
+
+/**
+ * @brief Loads a texture, downscaling it if the budget would be exceeded.
+ *
+ * @param path Path to the image file.
+ * @param generateMipmaps Whether to generate mipmaps.
+ *
+ * @return Name of the texture object.
+ *
+ * @throw abcg::Exception if the image cannot be loaded.
+ */
+GLuint abcg::TextureBudget::loadTexture(std::string_view path,
+                                        bool generateMipmaps) {
+  auto image{abcg::loadImage(path)};
+
+  Entry entry{.path = std::string{path},
+              .fullWidth = image.width,
+              .fullHeight = image.height,
+              .mipmapped = generateMipmaps};
+  entry.droppedLevels = chooseDroppedLevels(image.width, image.height,
+                                            generateMipmaps, m_usage);
+
+  glGenTextures(1, &entry.texture);
+  upload(entry, image);
+
+  glBindTexture(GL_TEXTURE_2D, entry.texture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                  generateMipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  m_usage += entry.bytes;
+  m_entries.push_back(std::move(entry));
+
+  return m_entries.back().texture;
+}
+
+/**
+ * @brief Stops tracking a texture and frees its budget.
+ *
+ * The texture object is not deleted.
+ *
+ * @param texture Name of the texture object.
+ */
+void abcg::TextureBudget::release(GLuint texture) {
+  auto iter{std::find_if(m_entries.begin(), m_entries.end(),
+                         [=](const auto &entry) {
+                           return entry.texture == texture;
+                         })};
+  if (iter == m_entries.end()) return;
+
+  // The name may be reused by a new texture before the upgrade finishes
+  if (m_upgrade.texture == texture) m_upgrade.texture = 0;
+  m_usage -= iter->bytes;
+  m_entries.erase(iter);
+}
+
+/**
+ * @brief Upgrades a downscaled texture if there is enough free memory.
+ *
+ * Does not block: the image is loaded in the background, and uploaded by
+ * the first call after it is ready. One texture is upgraded at a time.
+ * Called once per frame by abcg::OpenGLWindow.
+ */
+void abcg::TextureBudget::update() {
+  if (!m_upgrade.image.valid()) {
+    startUpgrade();
+  } else if (m_upgrade.image.wait_for(std::chrono::seconds{0}) !=
+             std::future_status::timeout) {
+    finishUpgrade();
+  }
+}
+
+/**
+ * @brief Shows the memory used by each texture in an ImGui window.
+ */
+void abcg::TextureBudget::paintUI() {
+  ImGui::SetNextWindowSize(ImVec2(420, 200), ImGuiCond_FirstUseEver);
+  ImGui::Begin("Texture budget");
+
+  if (m_budget == 0) {
+    ImGui::Text("%.1f MiB (no budget)", toMiB(m_usage));
+  } else {
+    auto label{fmt::format("{:.1f} / {:.1f} MiB", toMiB(m_usage),
+                           toMiB(m_budget))};
+    ImGui::ProgressBar(
+        static_cast<float>(m_usage) / static_cast<float>(m_budget),
+        ImVec2(-1, 0), label.c_str());
+  }
+
+  if (ImGui::BeginTable("Textures", 4,
+                        ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                            ImGuiTableFlags_ScrollY)) {
+    ImGui::TableSetupColumn("File");
+    ImGui::TableSetupColumn("Size");
+    ImGui::TableSetupColumn("Full size");
+    ImGui::TableSetupColumn("MiB");
+    ImGui::TableHeadersRow();
+
+    for (const auto &entry : m_entries) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(entry.path.c_str());
+      ImGui::TableNextColumn();
+      ImGui::Text("%dx%d",
+                  std::max(1, entry.fullWidth >> entry.droppedLevels),
+                  std::max(1, entry.fullHeight >> entry.droppedLevels));
+      ImGui::TableNextColumn();
+      ImGui::Text("%dx%d", entry.fullWidth, entry.fullHeight);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.2f", toMiB(entry.bytes));
+    }
+    ImGui::EndTable();
+  }
+
+  ImGui::End();
+}
+
+/**
+ * @brief Computes the memory used by an RGBA8 texture.
+ *
+ * @param width Width of the base level.
+ * @param height Height of the base level.
+ * @param mipmapped Whether the texture has a full mipmap chain.
+ *
+ * @return Size in bytes.
+ */
+std::size_t abcg::TextureBudget::computeSize(int width, int height,
+                                             bool mipmapped) {
+  std::size_t size{};
+  while (true) {
+    size += static_cast<std::size_t>(width * height) * 4;
+    if (!mipmapped || (width == 1 && height == 1)) break;
+    width = std::max(1, width / 2);
+    height = std::max(1, height / 2);
+  }
+  return size;
+}
+
+// Starts loading the image of the first downscaled texture that fits in
+// the budget at a higher resolution
+void abcg::TextureBudget::startUpgrade() {
+  for (auto &entry : m_entries) {
+    if (entry.droppedLevels == 0 || entry.reloadFailed) continue;
+
+    auto droppedLevels{chooseDroppedLevels(entry.fullWidth, entry.fullHeight,
+                                           entry.mipmapped,
+                                           m_usage - entry.bytes)};
+    if (droppedLevels >= entry.droppedLevels) continue;
+
+    // Without pthreads, the image is loaded by the next update()
+#if defined(__EMSCRIPTEN__)
+    const auto policy{std::launch::deferred};
+#else
+    const auto policy{std::launch::async};
+#endif
+    const auto width{std::max(1, entry.fullWidth >> droppedLevels)};
+    const auto height{std::max(1, entry.fullHeight >> droppedLevels)};
+    m_upgrade.texture = entry.texture;
+    m_upgrade.droppedLevels = droppedLevels;
+    m_upgrade.image = std::async(policy, [path = entry.path, width, height] {
+      auto image{abcg::loadImage(path)};
+      if (image.width == width && image.height == height) return image;
+      return abcg::resizeImage(image, width, height);
+    });
+    return;
+  }
+}
+
+// Uploads the image of the pending upgrade, unless the texture was released
+// or no longer fits in the budget
+void abcg::TextureBudget::finishUpgrade() {
+  const auto texture{std::exchange(m_upgrade.texture, 0U)};
+  auto iter{texture == 0 ? m_entries.end()
+                         : std::find_if(m_entries.begin(), m_entries.end(),
+                                        [=](const auto &entry) {
+                                          return entry.texture == texture;
+                                        })};
+
+  Image image;
+  try {
+    image = m_upgrade.image.get();
+  } catch (const abcg::Exception &exception) {
+    fmt::print(stderr, "{}\n", exception.what());
+    if (iter != m_entries.end()) iter->reloadFailed = true;
+    return;
+  }
+  if (iter == m_entries.end()) return;
+
+  auto &entry{*iter};
+  if (chooseDroppedLevels(entry.fullWidth, entry.fullHeight, entry.mipmapped,
+                          m_usage - entry.bytes) > m_upgrade.droppedLevels) {
+    return;
+  }
+
+  m_usage -= entry.bytes;
+  entry.droppedLevels = m_upgrade.droppedLevels;
+  upload(entry, image);
+  m_usage += entry.bytes;
+}
+
+int abcg::TextureBudget::chooseDroppedLevels(int width, int height,
+                                             bool mipmapped,
+                                             std::size_t usage) const {
+  if (m_budget == 0) return 0;
+
+  // Drop top levels until the texture fits
+  auto droppedLevels{0};
+  while (std::min(width, height) / 2 >= minTextureSize &&
+         usage + computeSize(width, height, mipmapped) > m_budget) {
+    width /= 2;
+    height /= 2;
+    ++droppedLevels;
+  }
+  return droppedLevels;
+}
+
+void abcg::TextureBudget::upload(Entry &entry, const Image &image) {
+  auto width{std::max(1, entry.fullWidth >> entry.droppedLevels)};
+  auto height{std::max(1, entry.fullHeight >> entry.droppedLevels)};
+
+  GLint boundTexture{};
+  glGetIntegerv(GL_TEXTURE_BINDING_2D, &boundTexture);
+  glBindTexture(GL_TEXTURE_2D, entry.texture);
+
+  // Images loaded by upgrades are already resampled
+  const auto resample{image.width != width || image.height != height};
+  auto resized{resample ? abcg::resizeImage(image, width, height) : Image{}};
+  const auto &source{resample ? resized : image};
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA,
+               GL_UNSIGNED_BYTE, source.pixels.data());
+  if (entry.mipmapped) glGenerateMipmap(GL_TEXTURE_2D);
+
+  glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(boundTexture));
+
+  entry.bytes = computeSize(width, height, entry.mipmapped);
+}
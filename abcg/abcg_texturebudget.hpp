@@ -0,0 +1,93 @@
+/**
+ * @file abcg_texturebudget.hpp
+ * @brief abcg::TextureBudget header file.
+ *
+ * Declaration of abcg::TextureBudget class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_TEXTUREBUDGET_HPP_
+#define ABCG_TEXTUREBUDGET_HPP_
+
+#include <cstddef>
+#include <future>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "abcg_image.hpp"
+#include "abcg_openglfunctions.hpp"
+
+namespace abcg {
+class TextureBudget;
+}  // namespace abcg
+
+/**
+ * @brief abcg::TextureBudget class.
+ *
+ * Global budget of texture memory used by abcg::opengl::loadTexture.
+ *
+ * A texture that would exceed the budget is uploaded at a lower resolution,
+ * halving its size (i.e., dropping its top mip level) until it fits. When
+ * memory is freed, update() reloads the downscaled textures one level at a
+ * time, in place, so that texture names held by the application remain
+ * valid. The image of an upgrade is loaded and resampled in a background
+ * thread, and uploaded by a later call to update().
+ *
+ * Memory is released when the texture is deleted with abcg::glDeleteTextures.
+ */
+class abcg::TextureBudget {
+ public:
+  struct Entry {
+    GLuint texture{};
+    std::string path;
+    int fullWidth{};
+    int fullHeight{};
+    int droppedLevels{};
+    bool mipmapped{};
+    std::size_t bytes{};
+    // The image could not be reloaded, so the texture is not upgraded again
+    bool reloadFailed{};
+  };
+
+  [[nodiscard]] static TextureBudget& getInstance();
+
+  void setBudget(std::size_t bytes);
+  [[nodiscard]] std::size_t getBudget() const noexcept { return m_budget; }
+  [[nodiscard]] std::size_t getUsage() const noexcept { return m_usage; }
+  [[nodiscard]] const std::vector<Entry>& getEntries() const noexcept {
+    return m_entries;
+  }
+
+  [[nodiscard]] GLuint loadTexture(std::string_view path,
+                                   bool generateMipmaps);
+  void release(GLuint texture);
+  void update();
+  void paintUI();
+
+  [[nodiscard]] static std::size_t computeSize(int width, int height,
+                                               bool mipmapped);
+
+ private:
+  // Texture being upgraded, or zero if none (e.g., if it was released
+  // while its image was loading)
+  struct Upgrade {
+    GLuint texture{};
+    int droppedLevels{};
+    std::future<Image> image;
+  };
+
+  std::size_t m_budget{};
+  std::size_t m_usage{};
+  std::vector<Entry> m_entries;
+  Upgrade m_upgrade;
+
+  [[nodiscard]] int chooseDroppedLevels(int width, int height, bool mipmapped,
+                                        std::size_t usage) const;
+  void startUpgrade();
+  void finishUpgrade();
+  void upload(Entry& entry, const Image& image);
+};
+
+#endif
@@ -0,0 +1,73 @@
+/**
+ * @file abcg_threadpool.cpp
+ * @brief Definition of abcg::ThreadPool class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_threadpool.hpp"
+
+#include <algorithm>
+
+/**
+ * @brief Creates the worker threads.
+ */
+abcg::ThreadPool::ThreadPool() {
+  // Without pthreads, every job runs on the calling thread
+#if defined(__EMSCRIPTEN__)
+  const std::size_t numWorkers{1};
+#else
+  const std::size_t numWorkers{
+      std::max(1U, std::thread::hardware_concurrency())};
+#endif
+
+  for (std::size_t workerIndex{1}; workerIndex < numWorkers; ++workerIndex) {
+    m_threads.emplace_back([this, workerIndex] {
+      std::uint64_t jobGeneration{};
+      while (true) {
+        std::unique_lock lock{m_mutex};
+        m_jobCondition.wait(lock, [&] {
+          return m_stop || m_jobGeneration != jobGeneration;
+        });
+        if (m_stop) return;
+        jobGeneration = m_jobGeneration;
+        lock.unlock();
+
+        m_job(workerIndex);
+
+        lock.lock();
+        if (--m_pendingJobs == 0) m_doneCondition.notify_one();
+      }
+    });
+  }
+}
+
+abcg::ThreadPool::~ThreadPool() {
+  {
+    const std::lock_guard lock{m_mutex};
+    m_stop = true;
+  }
+  m_jobCondition.notify_all();
+  for (auto &thread : m_threads) thread.join();
+}
+
+/**
+ * @brief Runs a job on every worker and waits for all of them.
+ *
+ * @param job Function called once by each worker with its index, from 0 to
+ * size() - 1.
+ */
+void abcg::ThreadPool::run(const Job &job) {
+  {
+    const std::lock_guard lock{m_mutex};
+    m_job = job;
+    m_pendingJobs = m_threads.size();
+    ++m_jobGeneration;
+  }
+  m_jobCondition.notify_all();
+
+  job(0);
+
+  std::unique_lock lock{m_mutex};
+  m_doneCondition.wait(lock, [this] { return m_pendingJobs == 0; });
+}
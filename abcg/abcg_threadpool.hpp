@@ -0,0 +1,60 @@
+/**
+ * @file abcg_threadpool.hpp
+ * @brief abcg::ThreadPool header file.
+ *
+ * Declaration of abcg::ThreadPool class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_THREADPOOL_HPP_
+#define ABCG_THREADPOOL_HPP_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace abcg {
+class ThreadPool;
+}  // namespace abcg
+
+/**
+ * @brief abcg::ThreadPool class.
+ *
+ * Persistent worker threads that run the same job in parallel, one call
+ * per worker, for data-parallel work split by worker index.
+ *
+ * Worker 0 is the calling thread. There is a worker for each hardware
+ * thread, or a single worker when threads are not available (WebAssembly).
+ */
+class abcg::ThreadPool {
+ public:
+  using Job = std::function<void(std::size_t workerIndex)>;
+
+  ThreadPool();
+  ~ThreadPool();
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  void run(const Job& job);
+
+  [[nodiscard]] std::size_t size() const noexcept {
+    return m_threads.size() + 1;
+  }
+
+ private:
+  std::vector<std::thread> m_threads;
+  std::mutex m_mutex;
+  std::condition_variable m_jobCondition;
+  std::condition_variable m_doneCondition;
+  Job m_job;
+  std::uint64_t m_jobGeneration{};
+  std::size_t m_pendingJobs{};
+  bool m_stop{};
+};
+
+#endif
@@ -0,0 +1,43 @@
+/**
+ * @file abcg_uniformbuffer.cpp
+ * @brief Definition of uniform block helper functions.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_uniformbuffer.hpp"
+
+#include <algorithm>
+#include <string>
+
+/**
+ * @brief Connects a uniform block of a program to a binding point.
+ *
+ * GLSL 4.10 and GLSL ES 3.00 do not support the `binding` layout qualifier,
+ * so the binding must be set from the application after linking.
+ *
+ * @param program Linked program.
+ * @param blockName Name of the uniform block. Programs that do not declare
+ * the block are ignored.
+ * @param bindingPoint Uniform buffer binding point.
+ */
+void abcg::bindUniformBlock(GLuint program, std::string_view blockName,
+                            GLuint bindingPoint) {
+  auto blockIndex{
+      glGetUniformBlockIndex(program, std::string{blockName}.c_str())};
+  if (blockIndex == GL_INVALID_INDEX) return;
+  glUniformBlockBinding(program, blockIndex, bindingPoint);
+}
+
+/**
+ * @brief Returns the alignment required for offsets of uniform buffer
+ * ranges.
+ */
+GLsizeiptr abcg::getUniformBufferOffsetAlignment() {
+  static GLint alignment{};
+  if (alignment == 0) {
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    alignment = std::max(alignment, 1);
+  }
+  return alignment;
+}
@@ -0,0 +1,129 @@
+/**
+ * @file abcg_uniformbuffer.hpp
+ * @brief abcg::UniformBuffer header file.
+ *
+ * Declaration of abcg::UniformBuffer class template and uniform block
+ * helper functions.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_UNIFORMBUFFER_HPP_
+#define ABCG_UNIFORMBUFFER_HPP_
+
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+#include "abcg_openglfunctions.hpp"
+
+namespace abcg {
+template <typename T>
+class UniformBuffer;
+void bindUniformBlock(GLuint program, std::string_view blockName,
+                      GLuint bindingPoint);
+[[nodiscard]] GLsizeiptr getUniformBufferOffsetAlignment();
+}  // namespace abcg
+
+/**
+ * @brief abcg::UniformBuffer class template.
+ *
+ * Uniform buffer object holding a block of uniform variables shared by
+ * several programs, such as camera and light data.
+ *
+ * The buffer is a ring of copies of the block. Each call to update() writes
+ * the next copy with glBufferSubData and binds it to the binding point with
+ * glBindBufferRange, so that the driver does not have to wait for draw
+ * calls that still read the previous copy.
+ *
+ * Programs are connected to the binding point with abcg::bindUniformBlock.
+ *
+ * @tparam T Trivially copyable struct matching the std140 layout of the
+ * block. Using only `glm::vec4`, `glm::mat4`, and scalars in groups of four
+ * is the simplest way to avoid padding mismatches.
+ */
+template <typename T>
+class abcg::UniformBuffer {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "Uniform block type must be trivially copyable");
+  static_assert(sizeof(T) % 16 == 0,
+                "std140 block size must be a multiple of 16 bytes");
+
+ public:
+  void initializeGL(GLuint bindingPoint, int numCopies = 3);
+  void update(const T& data);
+  void terminateGL();
+
+  [[nodiscard]] GLuint getBuffer() const noexcept { return m_buffer; }
+  [[nodiscard]] GLuint getBindingPoint() const noexcept {
+    return m_bindingPoint;
+  }
+
+ private:
+  GLuint m_buffer{};
+  GLuint m_bindingPoint{};
+  GLsizeiptr m_stride{};
+  int m_numCopies{};
+  int m_currentCopy{};
+
+  T m_data{};
+  bool m_valid{};
+};
+
+/**
+ * @brief Creates the buffer object.
+ *
+ * @param bindingPoint Uniform buffer binding point.
+ * @param numCopies Number of copies of the block in the ring.
+ */
+template <typename T>
+void abcg::UniformBuffer<T>::initializeGL(GLuint bindingPoint, int numCopies) {
+  terminateGL();
+
+  m_bindingPoint = bindingPoint;
+  m_numCopies = numCopies;
+  m_currentCopy = 0;
+
+  // Each copy starts at a multiple of the offset alignment
+  auto alignment{getUniformBufferOffsetAlignment()};
+  m_stride = (static_cast<GLsizeiptr>(sizeof(T)) + alignment - 1) /
+             alignment * alignment;
+
+  abcg::glGenBuffers(1, &m_buffer);
+  abcg::glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+  abcg::glBufferData(GL_UNIFORM_BUFFER, m_stride * m_numCopies, nullptr,
+                     GL_DYNAMIC_DRAW);
+  abcg::glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+/**
+ * @brief Uploads the block and binds it to the binding point.
+ *
+ * Nothing is done if the data did not change since the last call.
+ *
+ * @param data Values of the uniform block.
+ */
+template <typename T>
+void abcg::UniformBuffer<T>::update(const T& data) {
+  if (m_valid && memcmp(&m_data, &data, sizeof(T)) == 0) return;
+  m_data = data;
+  m_valid = true;
+
+  m_currentCopy = (m_currentCopy + 1) % m_numCopies;
+  const GLintptr offset{m_stride * m_currentCopy};
+
+  abcg::glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+  abcg::glBufferSubData(GL_UNIFORM_BUFFER, offset, sizeof(T), &m_data);
+  abcg::glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  abcg::glBindBufferRange(GL_UNIFORM_BUFFER, m_bindingPoint, m_buffer, offset,
+                          sizeof(T));
+}
+
+template <typename T>
+void abcg::UniformBuffer<T>::terminateGL() {
+  abcg::glDeleteBuffers(1, &m_buffer);
+  m_buffer = 0;
+  m_valid = false;
+}
+
+#endif
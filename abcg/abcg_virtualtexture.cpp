@@ -0,0 +1,614 @@
+/**
+ * @file abcg_virtualtexture.cpp
+ * @brief Definition of abcg::VirtualTexture class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_virtualtexture.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cppitertools/itertools.hpp>
+#include <cstring>
+#include <limits>
+
+#include "abcg_exception.hpp"
+#include "abcg_image.hpp"
+
+namespace {
+constexpr std::array<char, 8> tileFileMagic{'A', 'B', 'C', 'G',
+                                            'V', 'T', '0', '1'};
+
+struct TileFileHeader {
+  std::int32_t width{};
+  std::int32_t height{};
+  std::int32_t tileSize{};
+  std::int32_t border{};
+  std::int32_t numLevels{};
+  std::int32_t tilesPerSide{};
+};
+
+constexpr std::uint64_t tileKey(int level, int x, int y) {
+  return (static_cast<std::uint64_t>(level) << 48) |
+         (static_cast<std::uint64_t>(y) << 24) | static_cast<std::uint64_t>(x);
+}
+
+constexpr int tileLevel(std::uint64_t key) {
+  return static_cast<int>(key >> 48);
+}
+constexpr int tileY(std::uint64_t key) {
+  return static_cast<int>((key >> 24) & 0xFFFFFF);
+}
+constexpr int tileX(std::uint64_t key) {
+  return static_cast<int>(key & 0xFFFFFF);
+}
+
+int levelSize(int size, int level) {
+  return std::max(1, (size + (1 << level) - 1) >> level);
+}
+
+int divideRoundUp(int value, int divisor) {
+  return (value + divisor - 1) / divisor;
+}
+
+// Offset of texel (x, y) in an RGBA8 array of the given width. Computed in
+// size_t, as the product overflows int for the largest images.
+size_t texelOffset(int x, int y, int width) {
+  return (static_cast<size_t>(y) * static_cast<size_t>(width) +
+          static_cast<size_t>(x)) *
+         4;
+}
+
+// 2x2 box filter. Odd sizes replicate the last row/column.
+abcg::Image downsample(const abcg::Image &image) {
+  abcg::Image result;
+  result.width = std::max(1, (image.width + 1) / 2);
+  result.height = std::max(1, (image.height + 1) / 2);
+  result.pixels.resize(texelOffset(0, result.height, result.width));
+
+  auto texel{[&](int x, int y, int channel) {
+    x = std::min(x, image.width - 1);
+    y = std::min(y, image.height - 1);
+    return static_cast<unsigned>(
+        image.pixels[texelOffset(x, y, image.width) +
+                     static_cast<size_t>(channel)]);
+  }};
+
+  for (auto y : iter::range(result.height)) {
+    for (auto x : iter::range(result.width)) {
+      for (auto channel : iter::range(4)) {
+        auto sum{texel(2 * x, 2 * y, channel) +
+                 texel(2 * x + 1, 2 * y, channel) +
+                 texel(2 * x, 2 * y + 1, channel) +
+                 texel(2 * x + 1, 2 * y + 1, channel)};
+        result.pixels[texelOffset(x, y, result.width) +
+                      static_cast<size_t>(channel)] =
+            static_cast<std::uint8_t>((sum + 2) / 4);
+      }
+    }
+  }
+
+  return result;
+}
+}  // namespace
+
+/**
+ * @brief Splits an image into the tile pyramid read by initializeGL().
+ *
+ * This is an offline step: the whole source image is decoded in memory.
+ *
+ * @param imagePath Path to the source image.
+ * @param outputPath Path to the tile file to be written.
+ * @param tileSize Size of each tile, in texels, excluding borders.
+ * @param border Number of texels replicated from neighbor tiles on each side,
+ * used for bilinear filtering across tile boundaries.
+ *
+ * @throw abcg::Exception if the image cannot be loaded or the file cannot be
+ * written.
+ */
+void abcg::VirtualTexture::buildTiles(std::string_view imagePath,
+                                      std::string_view outputPath,
+                                      int tileSize, int border) {
+  auto image{abcg::loadImage(imagePath)};
+
+  std::ofstream output(outputPath.data(), std::ios::binary);
+  if (!output) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Failed to create tile file {}", outputPath))};
+  }
+
+  auto tilesPerSide{static_cast<int>(std::bit_ceil(static_cast<unsigned>(
+      std::max(divideRoundUp(image.width, tileSize),
+               divideRoundUp(image.height, tileSize)))))};
+
+  TileFileHeader header{.width = image.width,
+                        .height = image.height,
+                        .tileSize = tileSize,
+                        .border = border,
+                        .numLevels = static_cast<int>(std::bit_width(
+                            static_cast<unsigned>(tilesPerSide))),
+                        .tilesPerSide = tilesPerSide};
+  output.write(tileFileMagic.data(), tileFileMagic.size());
+  output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+  auto pageSize{tileSize + 2 * border};
+  std::vector<std::uint8_t> page(texelOffset(0, pageSize, pageSize));
+
+  for (auto level : iter::range(header.numLevels)) {
+    if (level > 0) image = downsample(image);
+
+    for (auto tileY : iter::range(divideRoundUp(image.height, tileSize))) {
+      for (auto tileX : iter::range(divideRoundUp(image.width, tileSize))) {
+        for (auto y : iter::range(pageSize)) {
+          auto sourceY{std::clamp(tileY * tileSize + y - border, 0,
+                                  image.height - 1)};
+          for (auto x : iter::range(pageSize)) {
+            auto sourceX{std::clamp(tileX * tileSize + x - border, 0,
+                                    image.width - 1)};
+            memcpy(page.data() + texelOffset(x, y, pageSize),
+                   image.pixels.data() +
+                       texelOffset(sourceX, sourceY, image.width),
+                   4);
+          }
+        }
+        output.write(reinterpret_cast<const char *>(page.data()),
+                     static_cast<std::streamsize>(page.size()));
+      }
+    }
+  }
+
+  if (!output) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Failed to write tile file {}", outputPath))};
+  }
+}
+
+abcg::VirtualTexture::~VirtualTexture() { stopWorker(); }
+
+/**
+ * @brief Opens a tile file and creates the page cache.
+ *
+ * @param path Path to a file created with buildTiles().
+ * @param pagesPerSide Number of pages on each side of the physical texture,
+ * from 1 to 256. Video memory use is constant and depends only on this value
+ * and on the tile size.
+ *
+ * @throw abcg::Exception if the number of pages is out of range or the file
+ * cannot be read.
+ */
+void abcg::VirtualTexture::initializeGL(std::string_view path,
+                                        int pagesPerSide) {
+  terminateGL();
+
+  // Page coordinates are stored in 8-bit channels of the indirection texture
+  if (pagesPerSide < 1 || pagesPerSide > 256) {
+    throw abcg::Exception{abcg::Exception::Runtime(fmt::format(
+        "Invalid number of pages per side {} (must be 1 to 256)",
+        pagesPerSide))};
+  }
+
+  std::ifstream input(path.data(), std::ios::binary);
+  std::array<char, 8> magic{};
+  TileFileHeader header{};
+  input.read(magic.data(), magic.size());
+  input.read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (!input || magic != tileFileMagic) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Failed to read tile file {}", path))};
+  }
+
+  m_path = path;
+  m_width = header.width;
+  m_height = header.height;
+  m_tileSize = header.tileSize;
+  m_border = header.border;
+  m_pageSize = m_tileSize + 2 * m_border;
+  m_numLevels = header.numLevels;
+  m_tilesPerSide = header.tilesPerSide;
+  m_pagesPerSide = pagesPerSide;
+
+  // Tiles are stored level by level, in row-major order
+  auto pageBytes{static_cast<std::streamoff>(m_pageSize) * m_pageSize * 4};
+  auto offset{static_cast<std::streamoff>(tileFileMagic.size() +
+                                          sizeof(TileFileHeader))};
+  m_levels.clear();
+  for (auto level : iter::range(m_numLevels)) {
+    Level info{.width = levelSize(m_width, level),
+               .height = levelSize(m_height, level)};
+    info.tilesX = divideRoundUp(info.width, m_tileSize);
+    info.tilesY = divideRoundUp(info.height, m_tileSize);
+    info.offset = offset;
+    offset += pageBytes * info.tilesX * info.tilesY;
+    m_levels.push_back(info);
+  }
+
+  // Physical page cache
+  auto physicalSize{m_pagesPerSide * m_pageSize};
+  glGenTextures(1, &m_physicalTexture);
+  glBindTexture(GL_TEXTURE_2D, m_physicalTexture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, physicalSize, physicalSize, 0,
+               GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+  // Indirection texture, one texel per virtual tile, one mip per level
+  glGenTextures(1, &m_indirectionTexture);
+  glBindTexture(GL_TEXTURE_2D, m_indirectionTexture);
+  m_indirection.resize(static_cast<size_t>(m_numLevels));
+  for (auto level : iter::range(m_numLevels)) {
+    auto tiles{std::max(1, m_tilesPerSide >> level)};
+    auto &entries{m_indirection.at(static_cast<size_t>(level))};
+    entries.assign(texelOffset(0, tiles, tiles), 0);
+    glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, tiles, tiles, 0, GL_RGBA,
+                 GL_UNSIGNED_BYTE, entries.data());
+  }
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, m_numLevels - 1);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                  GL_NEAREST_MIPMAP_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  m_pages.assign(static_cast<size_t>(m_pagesPerSide) *
+                     static_cast<size_t>(m_pagesPerSide),
+                 {});
+  m_residentTiles.clear();
+  m_requestedTiles.clear();
+  m_pendingTiles.clear();
+  m_frame = 0;
+  m_stats = {};
+  m_stats.totalPages = static_cast<int>(m_pages.size());
+
+  // The coarsest tile is pinned to the first page and never evicted
+  auto rootKey{tileKey(m_numLevels - 1, 0, 0)};
+  uploadTile({rootKey, readTile(input, rootKey)}, 0);
+  m_pages.front().lastUsed = std::numeric_limits<std::uint64_t>::max();
+  updateIndirection();
+
+  startWorker();
+}
+
+/**
+ * @brief Binds the page cache and indirection textures to a program.
+ *
+ * The program must be in use and must include glslSource.
+ *
+ * @param program Shader program.
+ * @param physicalUnit Texture unit used by the physical page cache.
+ * @param indirectionUnit Texture unit used by the indirection texture.
+ */
+void abcg::VirtualTexture::bind(GLuint program, GLint physicalUnit,
+                                GLint indirectionUnit) const {
+  glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(physicalUnit));
+  glBindTexture(GL_TEXTURE_2D, m_physicalTexture);
+  glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(indirectionUnit));
+  glBindTexture(GL_TEXTURE_2D, m_indirectionTexture);
+
+  auto virtualSize{static_cast<float>(m_tilesPerSide * m_tileSize)};
+  glUniform1i(glGetUniformLocation(program, "vtPhysical"), physicalUnit);
+  glUniform1i(glGetUniformLocation(program, "vtIndirection"),
+              indirectionUnit);
+  glUniform4f(glGetUniformLocation(program, "vtParams"),
+              static_cast<float>(m_width) / virtualSize,
+              static_cast<float>(m_height) / virtualSize,
+              static_cast<float>(m_tilesPerSide),
+              static_cast<float>(m_numLevels));
+  glUniform4f(glGetUniformLocation(program, "vtPageParams"),
+              static_cast<float>(m_tileSize), static_cast<float>(m_border),
+              static_cast<float>(m_pageSize),
+              static_cast<float>(m_pagesPerSide * m_pageSize));
+}
+
+/**
+ * @brief Marks a tile as visible in the current frame.
+ *
+ * @param level Mip level of the tile.
+ * @param x Horizontal tile index at this level.
+ * @param y Vertical tile index at this level.
+ */
+void abcg::VirtualTexture::request(int level, int x, int y) {
+  if (level < 0 || level >= m_numLevels) return;
+  const auto &info{m_levels.at(static_cast<size_t>(level))};
+  if (x < 0 || y < 0 || x >= info.tilesX || y >= info.tilesY) return;
+  m_requestedTiles.insert(tileKey(level, x, y));
+}
+
+/**
+ * @brief Marks every tile of a texture coordinate rectangle as visible.
+ *
+ * @param uvMin Lower-left texture coordinate.
+ * @param uvMax Upper-right texture coordinate.
+ * @param level Mip level.
+ */
+void abcg::VirtualTexture::requestRegion(glm::vec2 uvMin, glm::vec2 uvMax,
+                                         int level) {
+  level = std::clamp(level, 0, m_numLevels - 1);
+  const auto &info{m_levels.at(static_cast<size_t>(level))};
+  auto tileIndex{[&](float uv, int size, int tiles) {
+    auto index{static_cast<int>(uv * static_cast<float>(size) /
+                                static_cast<float>(m_tileSize))};
+    return std::clamp(index, 0, tiles - 1);
+  }};
+  glm::ivec2 first{tileIndex(uvMin.x, info.width, info.tilesX),
+                   tileIndex(uvMin.y, info.height, info.tilesY)};
+  glm::ivec2 last{tileIndex(uvMax.x, info.width, info.tilesX),
+                  tileIndex(uvMax.y, info.height, info.tilesY)};
+  for (auto y : iter::range(first.y, last.y + 1)) {
+    for (auto x : iter::range(first.x, last.x + 1)) {
+      m_requestedTiles.insert(tileKey(level, x, y));
+    }
+  }
+}
+
+/**
+ * @brief Marks the tiles found in a feedback buffer as visible.
+ *
+ * @param pixels RGBA8 pixels read back from a framebuffer rendered with
+ * `vtFeedback()`. Pixels with alpha equal to zero are ignored.
+ */
+void abcg::VirtualTexture::processFeedback(
+    std::span<const std::uint8_t> pixels) {
+  for (std::size_t index{}; index + 3 < pixels.size(); index += 4) {
+    auto levelPlusOne{pixels[index + 3]};
+    if (levelPlusOne == 0) continue;
+    auto high{pixels[index + 2]};
+    request(levelPlusOne - 1, pixels[index] | ((high >> 4) << 8),
+            pixels[index + 1] | ((high & 0xF) << 8));
+  }
+}
+
+/**
+ * @brief Streams the requested tiles and updates the page cache.
+ *
+ * Must be called once per frame, after the visible tiles were requested.
+ *
+ * @param maxUploadsPerFrame Maximum number of tiles uploaded to the page
+ * cache in this call.
+ */
+void abcg::VirtualTexture::update(int maxUploadsPerFrame) {
+  ++m_frame;
+  m_stats.uploads = 0;
+  m_stats.evictions = 0;
+
+  // Touch resident tiles and queue the missing ones, coarser levels first
+  std::vector<std::uint64_t> newRequests;
+  for (auto key : m_requestedTiles) {
+    if (auto iter{m_residentTiles.find(key)}; iter != m_residentTiles.end()) {
+      m_pages.at(iter->second).lastUsed =
+          std::max(m_pages.at(iter->second).lastUsed, m_frame);
+    } else if (!m_pendingTiles.contains(key)) {
+      newRequests.push_back(key);
+    }
+  }
+  std::sort(newRequests.begin(), newRequests.end(),
+            [](auto lhs, auto rhs) { return tileLevel(lhs) > tileLevel(rhs); });
+
+  std::vector<LoadedTile> loadedTiles;
+  {
+    const std::lock_guard lock{m_mutex};
+
+    // Forget queued tiles that are no longer visible
+    std::erase_if(m_loadQueue, [&](auto key) {
+      if (m_requestedTiles.contains(key)) return false;
+      m_pendingTiles.erase(key);
+      return true;
+    });
+
+    for (auto key : newRequests) {
+      m_loadQueue.push_back(key);
+      m_pendingTiles.insert(key);
+    }
+
+    while (!m_loadedTiles.empty() &&
+           static_cast<int>(loadedTiles.size()) < maxUploadsPerFrame) {
+      loadedTiles.push_back(std::move(m_loadedTiles.front()));
+      m_loadedTiles.pop_front();
+    }
+    m_stats.pendingRequests = static_cast<int>(m_pendingTiles.size());
+  }
+  m_condition.notify_one();
+
+#if defined(__EMSCRIPTEN__)
+  // No worker thread: load synchronously
+  if (std::ifstream input(m_path, std::ios::binary); input) {
+    while (!m_loadQueue.empty() &&
+           static_cast<int>(loadedTiles.size()) < maxUploadsPerFrame) {
+      auto key{m_loadQueue.front()};
+      m_loadQueue.pop_front();
+      try {
+        loadedTiles.push_back(
+            {.key = key, .texels = readTile(input, key), .failed = false});
+      } catch (const abcg::Exception &exception) {
+        fmt::print(stderr, "{}\n", exception.what());
+        input.clear();
+        loadedTiles.push_back({.key = key, .texels = {}, .failed = true});
+      }
+    }
+  }
+#endif
+
+  for (auto &&[index, tile] : iter::enumerate(loadedTiles)) {
+    m_pendingTiles.erase(tile.key);
+    if (tile.failed || m_residentTiles.contains(tile.key)) continue;
+
+    // Free page, or least recently used page not needed in this frame
+    auto victim{m_pages.size()};
+    for (auto &&[pageIndex, page] : iter::enumerate(m_pages)) {
+      if (!page.used) {
+        victim = pageIndex;
+        break;
+      }
+      if (page.lastUsed < m_frame &&
+          (victim == m_pages.size() ||
+           page.lastUsed < m_pages.at(victim).lastUsed)) {
+        victim = pageIndex;
+      }
+    }
+    if (victim == m_pages.size()) {
+      // Cache is full of visible tiles. Drop this and the remaining tiles;
+      // they are requested again if still visible in the next frames.
+      for (const auto &dropped : std::span{loadedTiles}.subspan(index + 1)) {
+        m_pendingTiles.erase(dropped.key);
+      }
+      break;
+    }
+
+    if (m_pages.at(victim).used) {
+      m_residentTiles.erase(m_pages.at(victim).key);
+      ++m_stats.evictions;
+    }
+    uploadTile(tile, victim);
+    ++m_stats.uploads;
+  }
+
+  if (m_dirtyLevel >= 0) updateIndirection();
+
+  m_requestedTiles.clear();
+  m_stats.residentPages = static_cast<int>(m_residentTiles.size());
+}
+
+void abcg::VirtualTexture::terminateGL() {
+  stopWorker();
+
+  glDeleteTextures(1, &m_physicalTexture);
+  glDeleteTextures(1, &m_indirectionTexture);
+  m_physicalTexture = 0;
+  m_indirectionTexture = 0;
+
+  m_pages.clear();
+  m_residentTiles.clear();
+  m_requestedTiles.clear();
+  m_pendingTiles.clear();
+  m_loadQueue.clear();
+  m_loadedTiles.clear();
+  m_dirtyLevel = -1;
+}
+
+std::vector<std::uint8_t> abcg::VirtualTexture::readTile(
+    std::ifstream &stream, std::uint64_t key) const {
+  const auto &info{m_levels.at(static_cast<size_t>(tileLevel(key)))};
+  auto pageBytes{static_cast<std::streamoff>(m_pageSize) * m_pageSize * 4};
+  auto index{static_cast<std::streamoff>(tileY(key)) * info.tilesX +
+             tileX(key)};
+
+  std::vector<std::uint8_t> texels(static_cast<size_t>(pageBytes));
+  stream.seekg(info.offset + index * pageBytes);
+  stream.read(reinterpret_cast<char *>(texels.data()), pageBytes);
+  if (!stream) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Failed to read tile from {}", m_path))};
+  }
+  return texels;
+}
+
+void abcg::VirtualTexture::startWorker() {
+#if !defined(__EMSCRIPTEN__)
+  m_stopWorker = false;
+  m_worker = std::thread([this] {
+    std::ifstream input(m_path, std::ios::binary);
+    while (true) {
+      std::uint64_t key{};
+      {
+        std::unique_lock lock{m_mutex};
+        m_condition.wait(
+            lock, [this] { return m_stopWorker || !m_loadQueue.empty(); });
+        if (m_stopWorker) return;
+        key = m_loadQueue.front();
+        m_loadQueue.pop_front();
+      }
+
+      LoadedTile tile{.key = key, .texels = {}};
+      try {
+        tile.texels = readTile(input, key);
+      } catch (const abcg::Exception &exception) {
+        // Reported to update() so that the tile is no longer pending
+        fmt::print(stderr, "{}\n", exception.what());
+        input.clear();
+        tile.failed = true;
+      }
+
+      const std::lock_guard lock{m_mutex};
+      m_loadedTiles.push_back(std::move(tile));
+    }
+  });
+#endif
+}
+
+void abcg::VirtualTexture::stopWorker() {
+  if (!m_worker.joinable()) return;
+  {
+    const std::lock_guard lock{m_mutex};
+    m_stopWorker = true;
+  }
+  m_condition.notify_all();
+  m_worker.join();
+}
+
+void abcg::VirtualTexture::uploadTile(const LoadedTile &tile,
+                                      std::size_t pageIndex) {
+  auto &page{m_pages.at(pageIndex)};
+  if (page.used) m_dirtyLevel = std::max(m_dirtyLevel, tileLevel(page.key));
+  m_dirtyLevel = std::max(m_dirtyLevel, tileLevel(tile.key));
+  page = {.key = tile.key, .lastUsed = m_frame, .used = true};
+  m_residentTiles[tile.key] = pageIndex;
+
+  auto pageX{static_cast<int>(pageIndex) % m_pagesPerSide};
+  auto pageY{static_cast<int>(pageIndex) / m_pagesPerSide};
+  glBindTexture(GL_TEXTURE_2D, m_physicalTexture);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, pageX * m_pageSize, pageY * m_pageSize,
+                  m_pageSize, m_pageSize, GL_RGBA, GL_UNSIGNED_BYTE,
+                  tile.texels.data());
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void abcg::VirtualTexture::updateIndirection() {
+  // From the coarsest level with a new or evicted tile down, point each tile
+  // to its own page or to the page of its parent. Coarser levels did not
+  // change, and only the levels with a changed entry are uploaded.
+  glBindTexture(GL_TEXTURE_2D, m_indirectionTexture);
+  for (auto level{m_dirtyLevel}; level >= 0; --level) {
+    auto tiles{std::max(1, m_tilesPerSide >> level)};
+    auto &entries{m_indirection.at(static_cast<size_t>(level))};
+    auto changed{false};
+
+    for (auto y : iter::range(tiles)) {
+      for (auto x : iter::range(tiles)) {
+        std::array<std::uint8_t, 4> value{};
+        if (auto iter{m_residentTiles.find(tileKey(level, x, y))};
+            iter != m_residentTiles.end()) {
+          auto pageIndex{static_cast<int>(iter->second)};
+          value = {static_cast<std::uint8_t>(pageIndex % m_pagesPerSide),
+                   static_cast<std::uint8_t>(pageIndex / m_pagesPerSide),
+                   static_cast<std::uint8_t>(level), 255};
+        } else if (level < m_numLevels - 1) {
+          auto parentTiles{std::max(1, m_tilesPerSide >> (level + 1))};
+          const auto &parent{m_indirection.at(static_cast<size_t>(level + 1))};
+          memcpy(value.data(),
+                 parent.data() + texelOffset(x / 2, y / 2, parentTiles),
+                 value.size());
+        } else {
+          continue;
+        }
+
+        auto *entry{entries.data() + texelOffset(x, y, tiles)};
+        if (memcmp(entry, value.data(), value.size()) != 0) {
+          memcpy(entry, value.data(), value.size());
+          changed = true;
+        }
+      }
+    }
+
+    if (changed) {
+      glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, tiles, tiles, GL_RGBA,
+                      GL_UNSIGNED_BYTE, entries.data());
+    }
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  m_dirtyLevel = -1;
+}
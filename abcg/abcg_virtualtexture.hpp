@@ -0,0 +1,191 @@
+/**
+ * @file abcg_virtualtexture.hpp
+ * @brief abcg::VirtualTexture header file.
+ *
+ * Declaration of abcg::VirtualTexture class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_VIRTUALTEXTURE_HPP_
+#define ABCG_VIRTUALTEXTURE_HPP_
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <glm/vec2.hpp>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "abcg_openglfunctions.hpp"
+
+namespace abcg {
+class VirtualTexture;
+}  // namespace abcg
+
+/**
+ * @brief abcg::VirtualTexture class.
+ *
+ * Sparse texture for images too large to fit in a single texture object.
+ *
+ * The source image is split offline into a mip-mapped pyramid of square
+ * tiles (see buildTiles()). At runtime, only the tiles that were requested
+ * are streamed from disk by a worker thread into a fixed-size physical page
+ * cache, with least-recently-used eviction. An indirection texture maps each
+ * virtual tile to its page in the cache, or to the page of the finest
+ * resident ancestor while the tile is not loaded. The coarsest tile is
+ * always resident.
+ *
+ * Visible tiles are reported either explicitly with request() and
+ * requestRegion(), or with processFeedback() using the output of a feedback
+ * pass rendered with `vtFeedback()`. Shaders sample the texture with
+ * `vtSample()`. Both GLSL functions are available in glslSource.
+ */
+class abcg::VirtualTexture {
+ public:
+  struct Stats {
+    int residentPages{};
+    int totalPages{};
+    int pendingRequests{};
+    int uploads{};
+    int evictions{};
+  };
+
+  static void buildTiles(std::string_view imagePath,
+                         std::string_view outputPath, int tileSize = 128,
+                         int border = 1);
+
+  VirtualTexture() = default;
+  ~VirtualTexture();
+
+  VirtualTexture(const VirtualTexture&) = delete;
+  VirtualTexture(VirtualTexture&&) = delete;
+  VirtualTexture& operator=(const VirtualTexture&) = delete;
+  VirtualTexture& operator=(VirtualTexture&&) = delete;
+
+  void initializeGL(std::string_view path, int pagesPerSide = 32);
+  void bind(GLuint program, GLint physicalUnit = 0,
+            GLint indirectionUnit = 1) const;
+  void request(int level, int x, int y);
+  void requestRegion(glm::vec2 uvMin, glm::vec2 uvMax, int level);
+  void processFeedback(std::span<const std::uint8_t> pixels);
+  void update(int maxUploadsPerFrame = 16);
+  void terminateGL();
+
+  [[nodiscard]] int getWidth() const { return m_width; }
+  [[nodiscard]] int getHeight() const { return m_height; }
+  [[nodiscard]] int getNumLevels() const { return m_numLevels; }
+  [[nodiscard]] Stats getStats() const { return m_stats; }
+
+  static constexpr auto glslSource{R"glsl(
+uniform sampler2D vtPhysical;
+uniform sampler2D vtIndirection;
+// x, y: virtual texture coordinate scale; z: tiles per side at level 0;
+// w: number of levels
+uniform vec4 vtParams;
+// x: tile size; y: border size; z: page size; w: physical texture size
+uniform vec4 vtPageParams;
+
+float vtLevel(vec2 uv) {
+  vec2 texel = uv * vtParams.xy * vtParams.z * vtPageParams.x;
+  vec2 dx = dFdx(texel);
+  vec2 dy = dFdy(texel);
+  float lod = 0.5 * log2(max(dot(dx, dx), dot(dy, dy)));
+  return clamp(lod, 0.0, vtParams.w - 1.0);
+}
+
+vec4 vtSample(vec2 uv) {
+  vec2 virtualUV = clamp(uv, 0.0, 1.0) * vtParams.xy;
+  int level = int(vtLevel(uv));
+  int tiles = max(int(vtParams.z) >> level, 1);
+  ivec2 tile = min(ivec2(virtualUV * float(tiles)), ivec2(tiles - 1));
+  vec4 entry = texelFetch(vtIndirection, tile, level) * 255.0;
+  float residentTiles = max(vtParams.z / exp2(entry.b), 1.0);
+  vec2 inTile = fract(virtualUV * residentTiles);
+  vec2 texel = entry.xy * vtPageParams.z + vtPageParams.y +
+               inTile * vtPageParams.x;
+  return textureLod(vtPhysical, texel / vtPageParams.w, 0.0);
+}
+
+vec4 vtFeedback(vec2 uv) {
+  vec2 virtualUV = clamp(uv, 0.0, 1.0) * vtParams.xy;
+  int level = int(vtLevel(uv));
+  int tiles = max(int(vtParams.z) >> level, 1);
+  ivec2 tile = min(ivec2(virtualUV * float(tiles)), ivec2(tiles - 1));
+  return vec4(float(tile.x & 255), float(tile.y & 255),
+              float(((tile.x >> 8) << 4) | (tile.y >> 8)),
+              float(level + 1)) / 255.0;
+}
+)glsl"};
+
+ private:
+  struct Level {
+    int width{};
+    int height{};
+    int tilesX{};
+    int tilesY{};
+    std::streamoff offset{};
+  };
+
+  struct Page {
+    std::uint64_t key{};
+    std::uint64_t lastUsed{};
+    bool used{};
+  };
+
+  struct LoadedTile {
+    std::uint64_t key{};
+    std::vector<std::uint8_t> texels;
+    // The tile could not be read. It is requested again when still visible
+    bool failed{};
+  };
+
+  std::string m_path;
+  int m_width{};
+  int m_height{};
+  int m_tileSize{};
+  int m_border{};
+  int m_pageSize{};
+  int m_numLevels{};
+  int m_tilesPerSide{};
+  std::vector<Level> m_levels;
+
+  GLuint m_physicalTexture{};
+  GLuint m_indirectionTexture{};
+  int m_pagesPerSide{};
+
+  std::vector<Page> m_pages;
+  std::unordered_map<std::uint64_t, std::size_t> m_residentTiles;
+  std::unordered_set<std::uint64_t> m_requestedTiles;
+  std::unordered_set<std::uint64_t> m_pendingTiles;
+  std::vector<std::vector<std::uint8_t>> m_indirection;
+  // Coarsest level with a tile uploaded or evicted since the last
+  // updateIndirection(), or -1
+  int m_dirtyLevel{-1};
+  std::uint64_t m_frame{};
+  Stats m_stats{};
+
+  // Streaming
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  std::deque<std::uint64_t> m_loadQueue;
+  std::deque<LoadedTile> m_loadedTiles;
+  std::thread m_worker;
+  bool m_stopWorker{};
+
+  [[nodiscard]] std::vector<std::uint8_t> readTile(std::ifstream& stream,
+                                                   std::uint64_t key) const;
+  void startWorker();
+  void stopWorker();
+  void uploadTile(const LoadedTile& tile, std::size_t pageIndex);
+  void updateIndirection();
+};
+
+#endif
@@ -42,11 +42,11 @@ void OpenGLWindow::initializeGL() {
   auto seed{std::chrono::steady_clock::now().time_since_epoch().count()};
   m_randomEngine.seed(seed);
 
+  // Create the batch; the triangle is streamed every frame
+  m_batch.initializeGL(m_program);
+
   //Habilitar modo de mistura de cores
-  glEnable(GL_BLEND);
-  glBlendEquation(GL_FUNC_ADD);
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
- 
+  m_batch.setBlendMode(abcg::Batch2D::BlendMode::Alpha);
 }
 
 
@@ -56,13 +56,11 @@ void OpenGLWindow::paintGL() {
 
   abcg::glViewport(0, 0, m_viewportWidth, m_viewportHeight);  // Set the viewport
 
-  abcg::glUseProgram(m_program);  // Start using the shader program
-  abcg::glBindVertexArray(m_vao);  // Start using VAO
-
-  abcg::glDrawArrays(GL_TRIANGLES, 0, 3);  // A função de renderização, glDrawArrays, dessa vez usa GL_TRIANGLES e 3 vértices, sendo que o índice inicial dos vértices no arranjo é 0. Isso significa que o pipeline desenhará apenas um triângulo.
-
-  abcg::glBindVertexArray(0);  // End using VAO
-  abcg::glUseProgram(0);  // End using the shader program
+  // Add the current triangle to the batch and draw it
+  m_batch.drawTriangle(m_positions[0], m_positions[1], m_positions[2],
+                       m_vertexColors[0], m_vertexColors[1],
+                       m_vertexColors[2]);
+  m_batch.endFrame();
 
   printf("cont %d delay %d\n", cont, delay);
   if(cont / delay >= 600)
@@ -108,24 +106,17 @@ void OpenGLWindow::resizeGL(int width, int height) {
 }
 
 void OpenGLWindow::terminateGL() {
-  // Release shader program, VBO and VAO
+  // Release shader program and batch
   abcg::glDeleteProgram(m_program);
-  abcg::glDeleteBuffers(1, &m_vboPositions);
-  abcg::glDeleteBuffers(1, &m_vboColors);
-  abcg::glDeleteVertexArrays(1, &m_vao);
+  m_batch.terminateGL();
 }
 
 void OpenGLWindow::setupModel() {
-  // Release previous VBO and VAO
-  abcg::glDeleteBuffers(1, &m_vboPositions);
-  abcg::glDeleteBuffers(1, &m_vboColors);
-  abcg::glDeleteVertexArrays(1, &m_vao);
-  //É importante fazer isso, pois a função setupModel é chamada continuamente em paintGL.
   //Create vertex positions
   std::uniform_real_distribution<float> rd(-1.5f, 1.5f); //Observe que as coordenadas das posições dos vértices são números pseudoaleatórios do intervalo  [−1.5,1.5] . Vimos no projeto anterior que, para uma primitiva ser vista no viewport, ela precisa ser especificada entre  [−1,−1]  e  [1,1] . Logo, nossos triângulos terão partes que ficarão para fora da janela. 
-  std::array<glm::vec2, 3> positions{glm::vec2(rd(m_randomEngine), rd(m_randomEngine)), //ALTEREI AQUI, DIFERENTE DO PROFESSOR
-                                    glm::vec2(rd(m_randomEngine), rd(m_randomEngine)),
-                                    glm::vec2(rd(m_randomEngine), rd(m_randomEngine))};
+  m_positions = {glm::vec2(rd(m_randomEngine), rd(m_randomEngine)), //ALTEREI AQUI, DIFERENTE DO PROFESSOR
+                 glm::vec2(rd(m_randomEngine), rd(m_randomEngine)),
+                 glm::vec2(rd(m_randomEngine), rd(m_randomEngine))};
                           
   //Cores aleatórias
   if(random_colors){
@@ -139,53 +130,4 @@ void OpenGLWindow::setupModel() {
   if(flat_colors){
     m_vertexColors[0] = m_vertexColors[1] = m_vertexColors[2];
   }
-
-  // Create vertex colors
-  std::vector<glm::vec4> colors(0);
-  colors.emplace_back(m_vertexColors[0]);
-  colors.emplace_back(m_vertexColors[1]);
-  colors.emplace_back(m_vertexColors[2]);
-
-  // Generate a new VBO of positions and get the associated ID
-  abcg::glGenBuffers(1, &m_vboPositions);
-  // Bind VBO in order to use it
-  abcg::glBindBuffer(GL_ARRAY_BUFFER, m_vboPositions);
-  // Upload data to VBO
-  abcg::glBufferData(GL_ARRAY_BUFFER, sizeof(positions), positions.data(), GL_STATIC_DRAW);
-  // Unbinding the VBO is allowed (data can be released now)
-  abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  // cria o identificador de um objeto de buffer (buffer object). Um objeto de buffer é um arranjo de dados alocado pelo OpenGL, geralmente na memória da GPU.
-  abcg::glGenBuffers(1, &m_vboColors);
-  // com o argumento GL_ARRAY_BUFFER vincula o objeto de buffer a um buffer de atributos de vértices. Isso define o objeto de buffer como um objeto de buffer de vértice (VBO). 
-  abcg::glBindBuffer(GL_ARRAY_BUFFER, m_vboColors);
-  // aloca a memória e inicializa o buffer com o conteúdo copiado de um ponteiro alocado na CPU. O primeiro parâmetro indica o tipo de objeto de buffer utilizado. O segundo parâmetro é o tamanho do buffer em bytes. O terceiro parâmetro é um ponteiro para os dados que serão copiados, na quantidade de bytes correspondente ao tamanho do buffer. O quarto parâmetro é uma “dica” ao driver de vídeo de como o buffer será usado. GL_STATIC_DRAW significa que o buffer será modificado apenas uma vez, potencialmente será utilizado muitas vezes, e que os dados serão usados para renderizar algo no framebuffer.
-  abcg::glBufferData(GL_ARRAY_BUFFER, colors.size() * sizeof(glm::vec4), colors.data(), GL_STATIC_DRAW);
-  // O objeto de buffer pode ser desvinculado com glBindBuffer(0), ou vinculando outro objeto de buffer.
-  abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  // Get location of attributes in the program
-  GLint positionAttribute{abcg::glGetAttribLocation(m_program, "inPosition")};
-  GLint colorAttribute{abcg::glGetAttribLocation(m_program, "inColor")};
-
-  // Create VAO
-  abcg::glGenVertexArrays(1, &m_vao);
-
-  // Bind vertex attributes to current VAO
-  abcg::glBindVertexArray(m_vao);
-
-  abcg::glEnableVertexAttribArray(positionAttribute);
-  abcg::glBindBuffer(GL_ARRAY_BUFFER, m_vboPositions);
-  abcg::glVertexAttribPointer(positionAttribute, 2, GL_FLOAT, GL_FALSE, 0,
-                              nullptr);
-  abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  abcg::glEnableVertexAttribArray(colorAttribute);
-  abcg::glBindBuffer(GL_ARRAY_BUFFER, m_vboColors);
-  abcg::glVertexAttribPointer(colorAttribute, 4, GL_FLOAT, GL_FALSE, 0,
-                              nullptr);
-  abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  // End of binding to current VAO
-  abcg::glBindVertexArray(0);
 }
\ No newline at end of file
@@ -16,11 +16,13 @@ class OpenGLWindow : public abcg::OpenGLWindow {
   void terminateGL() override;
 
  private:
-  GLuint m_vao{};
-  GLuint m_vboPositions{};
-  GLuint m_vboColors{};
   GLuint m_program{};
 
+  // Draws the triangle of each frame
+  abcg::Batch2D m_batch;
+  // Vertex positions of the current triangle
+  std::array<glm::vec2, 3> m_positions{};
+
   int m_viewportWidth{};
   int m_viewportHeight{};
 
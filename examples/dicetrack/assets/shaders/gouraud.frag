@@ -0,0 +1,33 @@
+#version 410
+
+in vec3 fragPObj;
+in vec3 fragNObj;
+in vec4 fragDiffuse;
+in vec4 fragSpecular;
+
+// Diffuse texture sampler
+uniform sampler2D diffuseTex;
+
+out vec4 outColor;
+
+// Planar mapping along the dominant axis of the normal. Cheaper than
+// triplanar mapping (one texture fetch instead of three) and close enough
+// on small objects
+vec2 DominantPlanarMapping(vec3 P, vec3 N) {
+  vec3 weight = abs(N);
+  if (weight.x >= weight.y && weight.x >= weight.z) return vec2(1.0 - P.z, P.y);
+  if (weight.y >= weight.z) return vec2(P.x, 1.0 - P.z);
+  return P.xy;
+}
+
+void main() {
+  vec4 map_Kd = texture(diffuseTex, DominantPlanarMapping(fragPObj, fragNObj));
+  vec4 color = map_Kd * fragDiffuse + fragSpecular;
+
+  if (gl_FrontFacing) {
+    outColor = color;
+  } else {
+    float i = (color.r + color.g + color.b) / 3.0;
+    outColor = vec4(i, i, i, 1.0);
+  }
+}
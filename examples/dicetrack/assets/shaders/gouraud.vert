@@ -0,0 +1,55 @@
+#version 410
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+// Material properties
+layout(location = 3) in vec4 inKa;
+layout(location = 4) in vec4 inKd;
+layout(location = 5) in vec4 inKs;
+layout(location = 6) in float inShininess;
+// Model matrix of the instance (locations 7 to 10)
+layout(location = 7) in mat4 inInstanceMatrix;
+
+// Camera and light data shared by every program
+layout(std140) uniform FrameData {
+  highp mat4 viewMatrix;
+  highp mat4 projMatrix;
+  highp vec4 lightDirWorldSpace;
+  highp vec4 Ia, Id, Is;
+};
+
+// Transformation applied to every instance (trackball rotation)
+uniform mat4 modelMatrix;
+
+out vec3 fragPObj;
+out vec3 fragNObj;
+// Ambient and diffuse light, modulated by the texture in the fragment
+// shader, and specular light
+out vec4 fragDiffuse;
+out vec4 fragSpecular;
+
+void main() {
+  mat4 modelViewMatrix = viewMatrix * modelMatrix * inInstanceMatrix;
+  mat3 normalMatrix = mat3(modelViewMatrix);
+
+  vec3 P = (modelViewMatrix * vec4(inPosition, 1.0)).xyz;
+  vec3 N = normalize(normalMatrix * inNormal);
+  vec3 L = normalize(-(viewMatrix * lightDirWorldSpace).xyz);
+
+  // Blinn-Phong reflection model, evaluated per vertex
+  float lambertian = max(dot(N, L), 0.0);
+  float specular = 0.0;
+  if (lambertian > 0.0) {
+    vec3 V = normalize(-P);
+    vec3 H = normalize(L + V);
+    float angle = max(dot(H, N), 0.0);
+    specular = pow(angle, inShininess);
+  }
+
+  fragDiffuse = inKa * Ia + inKd * Id * lambertian;
+  fragSpecular = inKs * Is * specular;
+  fragPObj = inPosition;
+  fragNObj = inNormal;
+
+  gl_Position = projMatrix * vec4(P, 1.0);
+}
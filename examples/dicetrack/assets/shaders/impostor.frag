@@ -0,0 +1,41 @@
+#version 410
+
+in vec2 fragTexCoord;
+in vec3 fragP;
+in vec3 fragL;
+in vec3 fragDepthOffset;
+in mat3 fragNormalMatrix;
+
+// Camera and light data shared by every program
+layout(std140) uniform FrameData {
+  highp mat4 viewMatrix;
+  highp mat4 projMatrix;
+  highp vec4 lightDirWorldSpace;
+  highp vec4 Ia, Id, Is;
+};
+
+// Impostor atlas (see abcg::Impostor)
+uniform sampler2D impostorColorTex;
+uniform sampler2D impostorNormalDepthTex;
+
+out vec4 outColor;
+
+void main() {
+  vec4 color = texture(impostorColorTex, fragTexCoord);
+  if (color.a < 0.5) discard;
+
+  // Surface point, moved back from the quad by the depth of the view, so
+  // that impostors intersect each other like the meshes
+  vec4 normalDepth = texture(impostorNormalDepthTex, fragTexCoord);
+  vec4 clipPosition =
+      projMatrix * vec4(fragP + fragDepthOffset * normalDepth.a, 1.0);
+  gl_FragDepth = clipPosition.z / clipPosition.w * 0.5 + 0.5;
+
+  // Diffuse and ambient light of the stored normal. The specular highlight
+  // is left out, as it is too small to see at this distance
+  vec3 N = normalize(fragNormalMatrix * (normalDepth.xyz * 2.0 - 1.0));
+  vec3 L = normalize(fragL);
+  float lambertian = max(dot(N, L), 0.0);
+
+  outColor = vec4(color.rgb * (Ia.rgb + Id.rgb * lambertian), 1.0);
+}
@@ -0,0 +1,88 @@
+#version 410
+
+// Model matrix of the instance (locations 7 to 10)
+layout(location = 7) in mat4 inInstanceMatrix;
+
+// Camera and light data shared by every program
+layout(std140) uniform FrameData {
+  highp mat4 viewMatrix;
+  highp mat4 projMatrix;
+  highp vec4 lightDirWorldSpace;
+  highp vec4 Ia, Id, Is;
+};
+
+// Transformation applied to every instance (trackball rotation)
+uniform mat4 modelMatrix;
+
+// Impostor atlas (see abcg::Impostor)
+uniform int impostorFrames;
+uniform vec3 impostorCenter;
+uniform float impostorRadius;
+
+out vec2 fragTexCoord;
+out vec3 fragP;
+out vec3 fragL;
+// Offset in view space from the front to the back of the bounding sphere
+out vec3 fragDepthOffset;
+// Transforms normals from object space to view space
+out mat3 fragNormalMatrix;
+
+// Inverse of abcg::Impostor::getFrameDirection
+vec2 OctahedralEncode(vec3 direction) {
+  vec3 d = direction / (abs(direction.x) + abs(direction.y) + abs(direction.z));
+  vec2 uv = d.xz;
+  if (d.y < 0.0) {
+    vec2 signs = vec2(d.x >= 0.0 ? 1.0 : -1.0, d.z >= 0.0 ? 1.0 : -1.0);
+    uv = (1.0 - abs(d.zx)) * signs;
+  }
+  return uv * 0.5 + 0.5;
+}
+
+// abcg::Impostor::getFrameDirection
+vec3 OctahedralDecode(vec2 uv) {
+  vec2 p = uv * 2.0 - 1.0;
+  vec3 direction = vec3(p.x, 1.0 - abs(p.x) - abs(p.y), p.y);
+  if (direction.y < 0.0) {
+    vec2 signs = vec2(p.x >= 0.0 ? 1.0 : -1.0, p.y >= 0.0 ? 1.0 : -1.0);
+    direction.xz = (1.0 - abs(p.yx)) * signs;
+  }
+  return normalize(direction);
+}
+
+void main() {
+  mat4 modelViewMatrix = viewMatrix * modelMatrix * inInstanceMatrix;
+
+  // View of the atlas nearest to the direction of the camera, in object
+  // space
+  vec3 cameraPosition = (inverse(modelViewMatrix) * vec4(0, 0, 0, 1)).xyz;
+  vec3 cameraDirection = normalize(cameraPosition - impostorCenter);
+  float frames = float(impostorFrames);
+  vec2 frame = clamp(floor(OctahedralEncode(cameraDirection) * frames),
+                     vec2(0.0), vec2(frames - 1.0));
+  vec3 frameDirection = OctahedralDecode((frame + 0.5) / frames);
+
+  // Axes of the view, as in abcg::Impostor::getFrameViewMatrix
+  vec3 up = abs(frameDirection.y) > 0.999 ? vec3(0, 0, 1) : vec3(0, 1, 0);
+  vec3 right = normalize(cross(up, frameDirection));
+  up = cross(frameDirection, right);
+
+  // Corners of the quad, drawn as a triangle strip of indices 0 to 3. The
+  // quad touches the front of the bounding sphere, where the depth of the
+  // view is zero
+  vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+  vec3 PObj = impostorCenter +
+              (frameDirection + right * corner.x + up * corner.y) *
+                  impostorRadius;
+
+  // The instances are only rotated and uniformly scaled (see texture.vert)
+  mat3 normalMatrix = mat3(modelViewMatrix);
+  vec3 P = (modelViewMatrix * vec4(PObj, 1.0)).xyz;
+
+  fragTexCoord = (frame + corner * 0.5 + 0.5) / frames;
+  fragP = P;
+  fragL = -(viewMatrix * lightDirWorldSpace).xyz;
+  fragDepthOffset = normalMatrix * (-2.0 * impostorRadius * frameDirection);
+  fragNormalMatrix = normalMatrix;
+
+  gl_Position = projMatrix * vec4(P, 1.0);
+}
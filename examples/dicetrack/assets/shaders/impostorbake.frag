@@ -0,0 +1,31 @@
+#version 410
+
+in vec3 fragPObj;
+in vec3 fragNObj;
+in vec4 fragKd;
+
+// Diffuse texture sampler
+uniform sampler2D diffuseTex;
+
+// Unlit color, with coverage in alpha
+layout(location = 0) out vec4 outColor;
+// Normal in object space mapped to [0, 1], and depth in the view
+layout(location = 1) out vec4 outNormalDepth;
+
+// Planar mapping
+vec2 PlanarMappingX(vec3 P) { return vec2(1.0 - P.z, P.y); }
+vec2 PlanarMappingY(vec3 P) { return vec2(P.x, 1.0 - P.z); }
+vec2 PlanarMappingZ(vec3 P) { return P.xy; }
+
+void main() {
+  vec3 N = normalize(fragNObj);
+
+  // Triplanar mapping, as in texture.frag
+  vec3 weight = abs(N);
+  vec4 map_Kd = texture(diffuseTex, PlanarMappingX(fragPObj)) * weight.x +
+                texture(diffuseTex, PlanarMappingY(fragPObj)) * weight.y +
+                texture(diffuseTex, PlanarMappingZ(fragPObj)) * weight.z;
+
+  outColor = vec4((map_Kd * fragKd).rgb, 1.0);
+  outNormalDepth = vec4(N * 0.5 + 0.5, gl_FragCoord.z);
+}
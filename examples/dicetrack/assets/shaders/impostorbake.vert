@@ -0,0 +1,21 @@
+#version 410
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+layout(location = 4) in vec4 inKd;
+
+// Camera of the view of the impostor atlas being rendered
+uniform mat4 viewMatrix;
+uniform mat4 projMatrix;
+
+out vec3 fragPObj;
+out vec3 fragNObj;
+out vec4 fragKd;
+
+void main() {
+  fragPObj = inPosition;
+  fragNObj = inNormal;
+  fragKd = inKd;
+
+  gl_Position = projMatrix * viewMatrix * vec4(inPosition, 1.0);
+}
@@ -12,8 +12,13 @@ in vec4 Kd;
 in vec4 Ks;
 in float shininess;
 
-// Light properties
-uniform vec4 Ia, Id, Is;
+// Camera and light data shared by every program
+layout(std140) uniform FrameData {
+  highp mat4 viewMatrix;
+  highp mat4 projMatrix;
+  highp vec4 lightDirWorldSpace;
+  highp vec4 Ia, Id, Is;
+};
 
 // Diffuse texture sampler
 uniform sampler2D diffuseTex;
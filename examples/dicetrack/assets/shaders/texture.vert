@@ -8,13 +8,19 @@ layout(location = 3) in vec4 inKa;
 layout(location = 4) in vec4 inKd;
 layout(location = 5) in vec4 inKs;
 layout(location = 6) in float inShininess;
+// Model matrix of the instance (locations 7 to 10)
+layout(location = 7) in mat4 inInstanceMatrix;
 
-uniform mat4 modelMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 projMatrix;
-uniform mat3 normalMatrix;
+// Camera and light data shared by every program
+layout(std140) uniform FrameData {
+  highp mat4 viewMatrix;
+  highp mat4 projMatrix;
+  highp vec4 lightDirWorldSpace;
+  highp vec4 Ia, Id, Is;
+};
 
-uniform vec4 lightDirWorldSpace;
+// Transformation applied to every instance (trackball rotation)
+uniform mat4 modelMatrix;
 
 out vec3 fragV;
 out vec3 fragL;
@@ -29,7 +35,13 @@ out vec4 Ks;
 out float shininess;
 
 void main() {
-  vec3 P = (viewMatrix * modelMatrix * vec4(inPosition, 1.0)).xyz;
+  mat4 modelViewMatrix = viewMatrix * modelMatrix * inInstanceMatrix;
+  // The instances are only rotated and uniformly scaled, so the normal
+  // matrix is the upper 3x3 of the model-view matrix up to a scale factor
+  // removed by the normalization in the fragment shader
+  mat3 normalMatrix = mat3(modelViewMatrix);
+
+  vec3 P = (modelViewMatrix * vec4(inPosition, 1.0)).xyz;
   vec3 N = normalMatrix * inNormal;
   vec3 L = -(viewMatrix * lightDirWorldSpace).xyz;
 
@@ -0,0 +1,23 @@
+#version 410
+
+in vec3 fragPObj;
+in vec3 fragNObj;
+in vec4 fragColor;
+
+// Diffuse texture sampler
+uniform sampler2D diffuseTex;
+
+out vec4 outColor;
+
+// Planar mapping along the dominant axis of the normal
+vec2 DominantPlanarMapping(vec3 P, vec3 N) {
+  vec3 weight = abs(N);
+  if (weight.x >= weight.y && weight.x >= weight.z) return vec2(1.0 - P.z, P.y);
+  if (weight.y >= weight.z) return vec2(P.x, 1.0 - P.z);
+  return P.xy;
+}
+
+void main() {
+  outColor = texture(diffuseTex, DominantPlanarMapping(fragPObj, fragNObj)) *
+             fragColor;
+}
@@ -0,0 +1,34 @@
+#version 410
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+// Material properties
+layout(location = 4) in vec4 inKd;
+// Model matrix of the instance (locations 7 to 10)
+layout(location = 7) in mat4 inInstanceMatrix;
+
+// Camera and light data shared by every program
+layout(std140) uniform FrameData {
+  highp mat4 viewMatrix;
+  highp mat4 projMatrix;
+  highp vec4 lightDirWorldSpace;
+  highp vec4 Ia, Id, Is;
+};
+
+// Transformation applied to every instance (trackball rotation)
+uniform mat4 modelMatrix;
+
+out vec3 fragPObj;
+out vec3 fragNObj;
+// Diffuse color at full light intensity
+out vec4 fragColor;
+
+void main() {
+  fragPObj = inPosition;
+  fragNObj = inNormal;
+  fragColor = inKd * Id;
+
+  gl_Position =
+      projMatrix * viewMatrix * modelMatrix * inInstanceMatrix *
+      vec4(inPosition, 1.0);
+}
@@ -2,8 +2,11 @@
 
 #include <fmt/core.h>
 #include <tiny_obj_loader.h>
+#include <glm/gtx/euler_angles.hpp>
 #include <glm/gtx/fast_trigonometry.hpp>
 #include <cppitertools/itertools.hpp>
+#include <algorithm>
+#include <cmath>
 #include <filesystem>
 #include <glm/gtx/hash.hpp>
 #include <unordered_map>
@@ -29,9 +32,37 @@ void Dices::initializeGL(int quantity){
   dices.clear();
   dices.resize(quantity);
 
+  // Shrink the dice when there are many of them so that they still fit in
+  // the [-1, 1] cube
+  m_diceScale = 0.5f * std::min(1.0f, std::cbrt(6.0f / quantity));
+
   for(auto &dice : dices) {
     dice = inicializarDado();
   }
+
+  // Rebuild the hierarchy used for frustum culling
+  m_bvh.clear();
+  m_bvhHandles.clear();
+  for (const auto index : iter::range(dices.size())) {
+    m_bvhHandles.push_back(m_bvh.insert(getDiceBox(dices.at(index)),
+                                        static_cast<std::uint32_t>(index)));
+  }
+  m_visibleDices.clear();
+  m_shadingLOD.resize(dices.size());
+}
+
+// Radius of a sphere around the position of the dice that contains it in
+// any orientation
+float Dices::getDiceRadius() const {
+  const auto& sphere{m_meshBounds.sphere};
+  return m_diceScale * (glm::length(sphere.center) + sphere.radius);
+}
+
+// Box that contains the dice in any orientation
+abcg::AABB Dices::getDiceBox(const Dice& dice) const {
+  return abcg::BoundingSphere{.center = dice.position,
+                              .radius = getDiceRadius()}
+      .getAABB();
 }
 
 //função para começar o dado numa posição e número aleatório, além de inicializar algumas outras variáveis necessárias
@@ -138,6 +169,21 @@ void Dices::createBuffers() {
                      sizeof(m_indices[0]) * m_indices.size(), m_indices.data(),
                      GL_STATIC_DRAW);
   abcg::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+  // Instance VBOs, filled every frame by updateInstances()
+  abcg::glDeleteBuffers(numShadingLevels, m_instanceVBOs.data());
+  abcg::glGenBuffers(numShadingLevels, m_instanceVBOs.data());
+  abcg::glDeleteBuffers(1, &m_impostorInstanceVBO);
+  abcg::glGenBuffers(1, &m_impostorInstanceVBO);
+
+  // Indices of the corners of the impostor quad
+  static constexpr std::array<GLuint, 4> impostorIndices{0, 1, 2, 3};
+  abcg::glDeleteBuffers(1, &m_impostorEBO);
+  abcg::glGenBuffers(1, &m_impostorEBO);
+  abcg::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_impostorEBO);
+  abcg::glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(impostorIndices),
+                     impostorIndices.data(), GL_STATIC_DRAW);
+  abcg::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
 void Dices::loadDiffuseTexture(std::string_view path) {
@@ -145,6 +191,18 @@ void Dices::loadDiffuseTexture(std::string_view path) {
 
   abcg::glDeleteTextures(1, &m_diffuseTexture);
   m_diffuseTexture = abcg::opengl::loadTexture(path);
+
+  abcg::glBindTexture(GL_TEXTURE_2D, m_diffuseTexture);
+
+  // Set minification and magnification parameters
+  abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+  // Set texture wrapping parameters
+  abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+  abcg::glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 void Dices::loadObj(std::string_view path, bool standardize) {
@@ -257,6 +315,11 @@ void Dices::loadObj(std::string_view path, bool standardize) {
     this->standardize();
   }
 
+  if (!m_vertices.empty()) {
+    m_meshBounds = abcg::computeBounds(&m_vertices.front().position.x,
+                                       m_vertices.size(), sizeof(Vertex));
+  }
+
   if (!m_hasNormals) {
     computeNormals();
   }
@@ -264,33 +327,216 @@ void Dices::loadObj(std::string_view path, bool standardize) {
   createBuffers();
 }
 
-void Dices::render() const {
-  abcg::glBindVertexArray(m_VAO);
+// Finds the dice inside the view frustum and, if occlusion culling is
+// enabled, discards those hidden behind the dice nearest to the camera
+void Dices::cull(const glm::mat4& clipMatrix) {
+  // Dice that moved out of their enlarged boxes are reinserted
+  for (const auto index : iter::range(m_bvhHandles.size())) {
+    m_bvh.update(m_bvhHandles.at(index), getDiceBox(dices.at(index)));
+  }
+  m_bvh.cull(abcg::Frustum{clipMatrix}, m_visibleDices);
+
+  if (!occlusionCulling || m_visibleDices.empty()) return;
+
+  // Occluders are the visible dice with the smallest clip-space w
+  const glm::vec4 wRow{clipMatrix[0][3], clipMatrix[1][3], clipMatrix[2][3],
+                       clipMatrix[3][3]};
+  const auto distance{[&](std::uint32_t index) {
+    return glm::dot(wRow, glm::vec4(dices.at(index).position, 1.0f));
+  }};
+  m_occluders = m_visibleDices;
+  const auto numOccluders{std::min(m_occluders.size(), m_maxOccluders)};
+  std::nth_element(m_occluders.begin(), m_occluders.begin() + numOccluders - 1,
+                   m_occluders.end(), [&](auto lhs, auto rhs) {
+                     return distance(lhs) < distance(rhs);
+                   });
+
+  // The hull of each occluder is a box inside the dice
+  const auto center{m_meshBounds.box.getCenter()};
+  const auto extents{m_meshBounds.box.getExtents() * m_occluderScale};
+  std::array<glm::vec3, 8> hullVertices{};
+  for (const auto corner : iter::range(8)) {
+    hullVertices.at(corner) =
+        center + extents * glm::vec3((corner & 1) != 0 ? 1.0f : -1.0f,
+                                     (corner & 2) != 0 ? 1.0f : -1.0f,
+                                     (corner & 4) != 0 ? 1.0f : -1.0f);
+  }
+  static constexpr std::array<std::uint32_t, 36> hullIndices{
+      0, 2, 1, 1, 2, 3,  // -z
+      4, 5, 6, 5, 7, 6,  // +z
+      0, 1, 4, 1, 5, 4,  // -y
+      2, 6, 3, 3, 6, 7,  // +y
+      0, 4, 2, 2, 4, 6,  // -x
+      1, 3, 5, 3, 7, 5   // +x
+  };
+
+  m_occlusionCuller.beginFrame(clipMatrix);
+  for (const auto index : iter::range(numOccluders)) {
+    m_occlusionCuller.addOccluder(
+        hullVertices, hullIndices,
+        getInstanceMatrix(dices.at(m_occluders.at(index))));
+  }
+  m_occlusionCuller.rasterize();
 
-  abcg::glActiveTexture(GL_TEXTURE0);
-  abcg::glBindTexture(GL_TEXTURE_2D, m_diffuseTexture);
+  std::erase_if(m_visibleDices, [&](std::uint32_t index) {
+    return !m_occlusionCuller.isVisible(getDiceBox(dices.at(index)));
+  });
+}
 
-  // Set minification and magnification parameters
-  abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+void Dices::resizeOcclusionBuffer(int width, int height) {
+  m_occlusionCuller.resize(width, height);
+}
 
-  // Set texture wrapping parameters
-  abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+// Same as translate * scale * rotateX * rotateY * rotateZ
+glm::mat4 Dices::getInstanceMatrix(const Dice& dice) const {
+  auto matrix{glm::eulerAngleXYZ(dice.rotationAngle.x, dice.rotationAngle.y,
+                                 dice.rotationAngle.z)};
+  matrix[0] *= m_diceScale;
+  matrix[1] *= m_diceScale;
+  matrix[2] *= m_diceScale;
+  matrix[3] = glm::vec4(dice.position, 1.0f);
+  return matrix;
+}
+
+// Computes the model matrix of each visible dice, groups the matrices by
+// the shading level of the dice, or by whether it is drawn as an impostor,
+// and uploads each group to its instance VBO at once
+void Dices::updateInstances(const glm::mat4& clipMatrix,
+                            float viewportHeight) {
+  for (auto& matrices : m_instanceMatrices) matrices.clear();
+  m_impostorMatrices.clear();
+
+  // Clip-space w is the distance to the camera along the view direction
+  const glm::vec4 wRow{clipMatrix[0][3], clipMatrix[1][3], clipMatrix[2][3],
+                       clipMatrix[3][3]};
+  const auto radius{getDiceRadius()};
+  for (const auto index : m_visibleDices) {
+    const auto& dice{dices.at(index)};
+    if (impostors &&
+        glm::dot(wRow, glm::vec4(dice.position, 1.0f)) > impostorDistance) {
+      m_impostorMatrices.push_back(getInstanceMatrix(dice));
+      continue;
+    }
+    auto level{abcg::ShadingLOD::Level::PerFragment};
+    if (shadingLOD) {
+      level = m_shadingLOD.select(
+          index, abcg::ShadingLOD::getProjectedSize(clipMatrix, dice.position,
+                                                    radius, viewportHeight));
+    }
+    m_instanceMatrices.at(static_cast<std::size_t>(level))
+        .push_back(getInstanceMatrix(dice));
+  }
+
+  // Orphan the previous storage so that the driver does not wait for the
+  // draw call of the last frame
+  for (const auto level : iter::range(numShadingLevels)) {
+    const auto& matrices{m_instanceMatrices.at(level)};
+    abcg::glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBOs.at(level));
+    abcg::glBufferData(GL_ARRAY_BUFFER, sizeof(glm::mat4) * matrices.size(),
+                       matrices.data(), GL_STREAM_DRAW);
+  }
+  abcg::glBindBuffer(GL_ARRAY_BUFFER, m_impostorInstanceVBO);
+  abcg::glBufferData(GL_ARRAY_BUFFER,
+                     sizeof(glm::mat4) * m_impostorMatrices.size(),
+                     m_impostorMatrices.data(), GL_STREAM_DRAW);
+  abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// Adds an instanced draw packet to the render queue for the visible dice of
+// each shading level, drawn with the program of the level, and one for the
+// impostors. The impostor program must have the atlas bound (see
+// abcg::Impostor::bind)
+void Dices::submit(abcg::RenderQueue& queue, std::span<abcg::Program> programs,
+                   abcg::Program& impostorProgram) const {
+  for (const auto level : iter::range(numShadingLevels)) {
+    const auto& matrices{m_instanceMatrices.at(level)};
+    if (matrices.empty()) continue;
+    queue.submit({.program = &programs[level],
+                  .vertexArray = m_VAOs.at(level),
+                  .texture = m_diffuseTexture,
+                  .count = static_cast<GLsizei>(m_indices.size()),
+                  .instanceCount = static_cast<GLsizei>(matrices.size())});
+  }
+  if (!m_impostorMatrices.empty()) {
+    queue.submit(
+        {.program = &impostorProgram,
+         .vertexArray = m_impostorVAO,
+         .mode = GL_TRIANGLE_STRIP,
+         .count = 4,
+         .instanceCount = static_cast<GLsizei>(m_impostorMatrices.size())});
+  }
+}
 
-  abcg::glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(m_indices.size()),
-                       GL_UNSIGNED_INT, nullptr);
+// Renders the impostor atlas of the mesh with a program that writes the
+// color and the normal and depth to outputs 0 and 1, or loads it from the
+// cache file
+void Dices::createImpostor(abcg::Program& program, std::string_view cachePath,
+                           std::string_view cacheKey) {
+  const auto vao{createVAO(program, 0)};
+  const auto draw{[&](const glm::mat4& viewMatrix,
+                      const glm::mat4& projMatrix) {
+    program.use();
+    program.setUniform("viewMatrix", viewMatrix);
+    program.setUniform("projMatrix", projMatrix);
+    program.setUniform("diffuseTex", 0);
+    abcg::glActiveTexture(GL_TEXTURE0);
+    abcg::glBindTexture(GL_TEXTURE_2D, m_diffuseTexture);
+    abcg::glBindVertexArray(vao);
+    abcg::glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(m_indices.size()),
+                         GL_UNSIGNED_INT, nullptr);
+  }};
+  m_impostor.create(m_meshBounds.sphere, draw, {}, cachePath, cacheKey);
 
   abcg::glBindVertexArray(0);
+  abcg::glBindTexture(GL_TEXTURE_2D, 0);
+  abcg::glUseProgram(0);
+  abcg::glDeleteVertexArrays(1, &vao);
 }
 
-void Dices::setupVAO(GLuint program) {
+// Sets up the VAO of a shading level for the program of the level
+void Dices::setupVAO(std::size_t level, GLuint program) {
+  auto& vao{m_VAOs.at(level)};
+
   // Release previous VAO
-  abcg::glDeleteVertexArrays(1, &m_VAO);
+  abcg::glDeleteVertexArrays(1, &vao);
+
+  vao = createVAO(program, m_instanceVBOs.at(level));
+}
 
-  // Create VAO
-  abcg::glGenVertexArrays(1, &m_VAO);
-  abcg::glBindVertexArray(m_VAO);
+// Sets up the VAO of the impostors. The quad has no vertex attributes
+// other than the instance matrix
+void Dices::setupImpostorVAO(GLuint program) {
+  abcg::glDeleteVertexArrays(1, &m_impostorVAO);
+
+  abcg::glGenVertexArrays(1, &m_impostorVAO);
+  abcg::glBindVertexArray(m_impostorVAO);
+  abcg::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_impostorEBO);
+
+  const GLint instanceMatrixAttribute{
+      abcg::glGetAttribLocation(program, "inInstanceMatrix")};
+  if (instanceMatrixAttribute >= 0) {
+    abcg::glBindBuffer(GL_ARRAY_BUFFER, m_impostorInstanceVBO);
+    for (const auto column : iter::range(4)) {
+      const auto location{static_cast<GLuint>(instanceMatrixAttribute + column)};
+      abcg::glEnableVertexAttribArray(location);
+      GLsizei offset{static_cast<GLsizei>(sizeof(glm::vec4)) * column};
+      abcg::glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE,
+                                  sizeof(glm::mat4),
+                                  reinterpret_cast<void*>(offset));
+      abcg::glVertexAttribDivisor(location, 1);
+    }
+  }
+
+  abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
+  abcg::glBindVertexArray(0);
+}
+
+// Creates a VAO of the mesh with the attributes used by a program. The
+// instance matrices are read from the given VBO
+GLuint Dices::createVAO(GLuint program, GLuint instanceVBO) const {
+  GLuint vao{};
+  abcg::glGenVertexArrays(1, &vao);
+  abcg::glBindVertexArray(vao);
 
   // Bind EBO and VBO
   abcg::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
@@ -360,10 +606,27 @@ void Dices::setupVAO(GLuint program) {
                                 sizeof(Vertex),
                                 reinterpret_cast<void*>(offset));
   }
+  //matriz de modelo de cada instância (uma coluna por atributo)
+  const GLint instanceMatrixAttribute{
+      abcg::glGetAttribLocation(program, "inInstanceMatrix")};
+  if (instanceMatrixAttribute >= 0) {
+    abcg::glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    for (const auto column : iter::range(4)) {
+      const auto location{static_cast<GLuint>(instanceMatrixAttribute + column)};
+      abcg::glEnableVertexAttribArray(location);
+      GLsizei offset{static_cast<GLsizei>(sizeof(glm::vec4)) * column};
+      abcg::glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE,
+                                  sizeof(glm::mat4),
+                                  reinterpret_cast<void*>(offset));
+      abcg::glVertexAttribDivisor(location, 1);
+    }
+  }
 
   // End of binding
   abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
   abcg::glBindVertexArray(0);
+
+  return vao;
 }
 
 void Dices::standardize() {
@@ -393,5 +656,10 @@ void Dices::terminateGL() {
   abcg::glDeleteTextures(1, &m_diffuseTexture);
   abcg::glDeleteBuffers(1, &m_EBO);
   abcg::glDeleteBuffers(1, &m_VBO);
-  abcg::glDeleteVertexArrays(1, &m_VAO);
+  abcg::glDeleteBuffers(numShadingLevels, m_instanceVBOs.data());
+  abcg::glDeleteVertexArrays(numShadingLevels, m_VAOs.data());
+  abcg::glDeleteBuffers(1, &m_impostorEBO);
+  abcg::glDeleteBuffers(1, &m_impostorInstanceVBO);
+  abcg::glDeleteVertexArrays(1, &m_impostorVAO);
+  m_impostor.terminateGL();
 }
\ No newline at end of file
@@ -1,8 +1,10 @@
 #ifndef DICES_HPP_
 #define DICES_HPP_
 
+#include <array>
 #include <vector>
 #include <random>
+#include <span>
 #include "abcg.hpp"
 
 struct Vertex {
@@ -26,7 +28,6 @@ struct Vertex {
 };
 
 struct Dice {
-  glm::mat4 modelMatrix{1.0f}; //a matriz do modelo do dado
   glm::vec3 position{0.0f}; //indica a posição tridimensional
   glm::vec3 rotationAngle{}; //indica o ângulo de rotação sobre cada um dos eixos X,Y,Z
   float timeLeft{0.0f}; //indica por quanto tempo o dado ainda continuará girando
@@ -40,18 +41,83 @@ class Dices {
   void initializeGL(int quantity);
   void loadDiffuseTexture(std::string_view path);
   void loadObj(std::string_view path, bool standardize = true);
-  void render() const;
-  void setupVAO(GLuint program);
+  void createImpostor(abcg::Program& program, std::string_view cachePath,
+                      std::string_view cacheKey);
+  void submit(abcg::RenderQueue& queue, std::span<abcg::Program> programs,
+              abcg::Program& impostorProgram) const;
+  void cull(const glm::mat4& clipMatrix);
+  void resizeOcclusionBuffer(int width, int height);
+  void updateInstances(const glm::mat4& clipMatrix, float viewportHeight);
+  void setupVAO(std::size_t level, GLuint program);
+  void setupImpostorVAO(GLuint program);
   void terminateGL();
   void update(float deltaTime);
   void jogarDado(Dice &);
 
+  [[nodiscard]] abcg::BVH::Stats getCullStats() const noexcept {
+    return m_bvh.getStats();
+  }
+  [[nodiscard]] abcg::OcclusionCuller::Stats getOcclusionStats() const {
+    return m_occlusionCuller.getStats();
+  }
+  [[nodiscard]] abcg::ShadingLOD& getShadingLOD() noexcept {
+    return m_shadingLOD;
+  }
+  [[nodiscard]] const abcg::Impostor& getImpostor() const noexcept {
+    return m_impostor;
+  }
+  [[nodiscard]] std::size_t getNumImpostors() const noexcept {
+    return m_impostorMatrices.size();
+  }
+
   std::vector<Dice> dices;
+  bool occlusionCulling{true};
+  bool shadingLOD{true};
+  bool impostors{true};
+  // Distance to the camera, in view space, beyond which dice are drawn as
+  // impostors
+  float impostorDistance{2.5f};
+
+  static constexpr std::size_t numShadingLevels{
+      abcg::ShadingLOD::numLevels};
 
  private:
-  GLuint m_VAO{};
   GLuint m_VBO{};
   GLuint m_EBO{};
+  // One VAO and one instance VBO per shading level, each drawn with the
+  // program of its level
+  std::array<GLuint, numShadingLevels> m_VAOs{};
+  std::array<GLuint, numShadingLevels> m_instanceVBOs{};
+  // Per-instance model matrices of the visible dice of each level
+  std::array<std::vector<glm::mat4>, numShadingLevels> m_instanceMatrices;
+  float m_diceScale{0.5f};
+
+  // Bounds of the mesh, computed when it is loaded
+  abcg::Bounds m_meshBounds;
+  // Hierarchy of the bounding boxes of the dice, and indices of the dice
+  // that passed the last frustum cull
+  abcg::BVH m_bvh;
+  std::vector<abcg::BVH::Handle> m_bvhHandles;
+  std::vector<std::uint32_t> m_visibleDices;
+
+  // Occlusion culling against the nearest visible dice. Their hulls are
+  // the mesh box shrunk to fit inside the rounded corners and pips.
+  abcg::OcclusionCuller m_occlusionCuller;
+  std::vector<std::uint32_t> m_occluders;
+  std::size_t m_maxOccluders{32};
+  float m_occluderScale{0.45f};
+
+  // Dice covering few pixels are shaded per vertex or unlit
+  abcg::ShadingLOD m_shadingLOD;
+
+  // Distant dice are drawn as quads textured with views of the mesh,
+  // rendered when the mesh is loaded. The quad is a triangle strip whose
+  // corners are computed from the indices in the vertex shader.
+  abcg::Impostor m_impostor;
+  GLuint m_impostorVAO{};
+  GLuint m_impostorEBO{};
+  GLuint m_impostorInstanceVBO{};
+  std::vector<glm::mat4> m_impostorMatrices;
 
   GLuint m_diffuseTexture{};
 
@@ -64,6 +130,10 @@ class Dices {
   bool m_hasTexCoords{false};
 
   Dice inicializarDado();
+  [[nodiscard]] float getDiceRadius() const;
+  [[nodiscard]] abcg::AABB getDiceBox(const Dice& dice) const;
+  [[nodiscard]] glm::mat4 getInstanceMatrix(const Dice& dice) const;
+  [[nodiscard]] GLuint createVAO(GLuint program, GLuint instanceVBO) const;
   void tempoGirandoAleatorio(Dice&);
   void eixoAlvoAleatorio(Dice&);
   void computeNormals();
@@ -8,9 +8,9 @@ int main(int argc, char **argv) {
     abcg::Application app(argc, argv);
 
     auto window{std::make_unique<OpenGLWindow>()};
-    window->setOpenGLSettings({.samples = 4});
+    window->setOpenGLSettings({.samples = 4, .stateCache = true, .programCache = true, .dynamicResolution = true});
     window->setWindowSettings(
-        {.width = 600, .height = 600, .showFPS = true, .showFullscreenButton = true, .title = "Dice 3D"});
+        {.width = 600, .height = 600, .showFPS = true, .showFullscreenButton = true, .showDynamicResolution = true, .title = "Dice 3D"});
 
     app.run(std::move(window));
   } catch (const abcg::Exception &exception) {
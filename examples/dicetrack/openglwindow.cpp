@@ -1,15 +1,47 @@
 #include "openglwindow.hpp"
 
+#include <fmt/core.h>
 #include <imgui.h>
 
 #include <cppitertools/itertools.hpp>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
 #include <glm/gtc/matrix_inverse.hpp>
 
 #include "imfilebrowser.h"
 
+namespace {
+// Path, size and modification time of a file, which change whenever the
+// file is replaced or edited. Empty if the file cannot be read.
+std::string describeFile(const std::filesystem::path& path) {
+  std::error_code errorCode;
+  const auto size{std::filesystem::file_size(path, errorCode)};
+  if (errorCode) return {};
+  const auto time{std::filesystem::last_write_time(path, errorCode)};
+  if (errorCode) return {};
+  return fmt::format("{}\n{}\n{}\n", path.string(), size,
+                     time.time_since_epoch().count());
+}
+
+std::string readFile(const std::filesystem::path& path) {
+  std::ifstream stream(path, std::ios::binary);
+  std::stringstream contents;
+  contents << stream.rdbuf();
+  return contents.str();
+}
+}  // namespace
+
 void OpenGLWindow::handleEvent(SDL_Event& event) {
-  glm::ivec2 mousePosition;
-  SDL_GetMouseState(&mousePosition.x, &mousePosition.y);
+  // Mouse position in the coordinates of the event, which follow the size
+  // given to resizeGL also when the scene is rendered at a lower resolution
+  glm::ivec2 mousePosition{};
+  if (event.type == SDL_MOUSEMOTION) {
+    mousePosition = {event.motion.x, event.motion.y};
+  } else if (event.type == SDL_MOUSEBUTTONDOWN ||
+             event.type == SDL_MOUSEBUTTONUP) {
+    mousePosition = {event.button.x, event.button.y};
+  }
 
   if (event.type == SDL_MOUSEMOTION) {
     m_trackBallModel.mouseMove(mousePosition);
@@ -54,8 +86,16 @@ void OpenGLWindow::initializeGL() {
   for (const auto& name : m_shaderNames) {
     const auto path{getAssetsPath() + "shaders/" + name};
     const auto program{createProgramFromFile(path + ".vert", path + ".frag")};
+    abcg::bindUniformBlock(program, "FrameData", 0);
     m_programs.push_back(program);
   }
+  const auto path{getAssetsPath() + "shaders/"};
+  m_impostorBakeProgram = createProgramFromFile(path + "impostorbake.vert",
+                                                path + "impostorbake.frag");
+  m_impostorProgram =
+      createProgramFromFile(path + "impostor.vert", path + "impostor.frag");
+  abcg::bindUniformBlock(m_impostorProgram, "FrameData", 0);
+  m_frameData.initializeGL(0);
 
   // Load default model
   loadModel(getAssetsPath() + "dice.obj");
@@ -67,67 +107,92 @@ void OpenGLWindow::initializeGL() {
 void OpenGLWindow::loadModel(std::string_view path) {
   m_dices.terminateGL();
 
-  m_dices.loadDiffuseTexture(getAssetsPath() + "maps/laminado-cumaru.jpg");
+  const auto texturePath{getAssetsPath() + "maps/laminado-cumaru.jpg"};
+  m_dices.loadDiffuseTexture(texturePath);
   m_dices.loadObj(path);
-  m_dices.setupVAO(m_programs.at(m_currentProgramIndex));
+  for (const auto level : iter::range(m_programs.size())) {
+    m_dices.setupVAO(level, m_programs.at(level));
+  }
+
+  // The impostor atlas is cached in the user's preference directory, keyed
+  // by everything it is baked from: the model and its texture (path, size
+  // and modification time) and the source of the bake shaders. The file
+  // name includes a hash of the model path, so that models with the same
+  // name in different directories have separate files.
+  std::string cachePath;
+  std::string cacheKey;
+  if (auto *prefPath{SDL_GetPrefPath("abcg", "impostors")}) {
+    const auto modelPath{std::filesystem::absolute(path)};
+    const auto modelDescription{describeFile(modelPath)};
+    if (!modelDescription.empty()) {
+      const auto shaderPath{getAssetsPath() + "shaders/impostorbake"};
+      cachePath = fmt::format(
+          "{}{}-{:016x}.impostor", prefPath, modelPath.stem().string(),
+          std::hash<std::string>{}(modelPath.string()));
+      cacheKey = modelDescription + describeFile(texturePath) +
+                 readFile(shaderPath + ".vert") +
+                 readFile(shaderPath + ".frag");
+    }
+    SDL_free(prefPath);
+  }
+  m_dices.createImpostor(m_impostorBakeProgram, cachePath, cacheKey);
+  m_dices.setupImpostorVAO(m_impostorProgram);
 }
 
 void OpenGLWindow::paintGL() {
   update();
 
+  // Count the state changes of this frame only
+  abcg::GLStateCache::getInstance().resetStats();
+
   // Clear color buffer and depth buffer
   abcg::glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
   abcg::glViewport(0, 0, m_viewportWidth, m_viewportHeight);
 
-  // Use currently selected program
-  const auto program{m_programs.at(m_currentProgramIndex)};
-  abcg::glUseProgram(program);
-
-  // Get location of uniform variables (could be precomputed)
-  const GLint viewMatrixLoc{abcg::glGetUniformLocation(program, "viewMatrix")};
-  const GLint projMatrixLoc{abcg::glGetUniformLocation(program, "projMatrix")};
-  const GLint modelMatrixLoc{abcg::glGetUniformLocation(program, "modelMatrix")};
-  const GLint normalMatrixLoc{abcg::glGetUniformLocation(program, "normalMatrix")};
-  const GLint lightDirLoc{abcg::glGetUniformLocation(program, "lightDirWorldSpace")};
-  const GLint IaLoc{abcg::glGetUniformLocation(program, "Ia")};
-  const GLint IdLoc{abcg::glGetUniformLocation(program, "Id")};
-  const GLint IsLoc{abcg::glGetUniformLocation(program, "Is")};
-  const GLint diffuseTexLoc{abcg::glGetUniformLocation(program, "diffuseTex")};
-  const GLint mappingModeLoc{abcg::glGetUniformLocation(program, "mappingMode")}; 
-
-  // Set uniform variables used by every scene object
-  abcg::glUniformMatrix4fv(viewMatrixLoc, 1, GL_FALSE, &m_viewMatrix[0][0]);
-  abcg::glUniformMatrix4fv(projMatrixLoc, 1, GL_FALSE, &m_projMatrix[0][0]);
-
-  const auto lightDirRotated{m_trackBallLight.getRotation() * m_lightDir};
-  abcg::glUniform4fv(lightDirLoc, 1, &lightDirRotated.x);
-  abcg::glUniform4fv(IaLoc, 1, &m_Ia.x);
-  abcg::glUniform4fv(IdLoc, 1, &m_Id.x);
-  abcg::glUniform4fv(IsLoc, 1, &m_Is.x);
-  abcg::glUniform1i(diffuseTexLoc, 0); //candidato a virar 0
-  abcg::glUniform1i(mappingModeLoc, m_mappingMode);
-  
-  // Set uniform variables of the current object
-  for(auto &dice : m_dices.dices){
-    // fmt::print("dice.modelMatrix.xyzw: {} {} {} {}\n", dice.modelMatrix[0][0], dice.modelMatrix[1][1], dice.modelMatrix[2][2], dice.modelMatrix[3][3]);
-    //dice.modelMatrix = m_dicesMatrix;
-    dice.modelMatrix = glm::translate(m_modelMatrix, dice.position);
-    dice.modelMatrix = glm::scale(dice.modelMatrix, glm::vec3(0.5f));
-    dice.modelMatrix = glm::rotate(dice.modelMatrix, dice.rotationAngle.x, glm::vec3(1.0f, 0.0f, 0.0f));
-    dice.modelMatrix = glm::rotate(dice.modelMatrix, dice.rotationAngle.y, glm::vec3(0.0f, 1.0f, 0.0f));
-    dice.modelMatrix = glm::rotate(dice.modelMatrix, dice.rotationAngle.z, glm::vec3(0.0f, 0.0f, 1.0f));
-    //debug
-    //fmt::print("dice.modelMatrix.xyzw: {} {} {} {}\n", dice.modelMatrix[0][0], dice.modelMatrix[1][1], dice.modelMatrix[2][2], dice.modelMatrix[3][3]);
-
-    abcg::glUniformMatrix4fv(modelMatrixLoc, 1, GL_FALSE, &dice.modelMatrix[0][0]);
-
-    const auto modelViewMatrix{glm::mat3(m_viewMatrix * dice.modelMatrix)};
-    glm::mat3 normalMatrix{glm::inverseTranspose(modelViewMatrix)};
-    abcg::glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, &normalMatrix[0][0]);
-
-    m_dices.render();
+  // Camera and light data, shared by every program through a uniform
+  // buffer bound to binding point 0
+  m_frameData.update({.viewMatrix = m_viewMatrix,
+                      .projMatrix = m_projMatrix,
+                      .lightDirWorldSpace =
+                          m_trackBallLight.getRotation() * m_lightDir,
+                      .Ia = m_Ia,
+                      .Id = m_Id,
+                      .Is = m_Is});
+
+  // Set uniform variables used by every scene object (locations are cached
+  // in the program and unchanged values are not uploaded again)
+  for (auto& program : m_programs) {
+    program.use();
+    program.setUniform("diffuseTex", 0);
+    program.setUniform("mappingMode", m_mappingMode);
+
+    // Transformation shared by every dice
+    program.setUniform("modelMatrix", m_modelMatrix);
   }
+  m_impostorProgram.use();
+  m_impostorProgram.setUniform("modelMatrix", m_modelMatrix);
+  m_dices.getImpostor().bind(m_impostorProgram, 1);
+
+  // Choose the shading level of each dice from its size on the screen,
+  // biased by the GPU time of the scene measured by the dynamic resolution
+  // controller. Dynamic resolution reacts to slow frames first: the bias
+  // only grows once the resolution cannot be lowered any further.
+  const auto& dynamicResolution{getDynamicResolution()};
+  m_dices.getShadingLOD().beginFrame(dynamicResolution.getFrameTime(),
+                                     dynamicResolution.isAtMinScale());
+
+  // Upload the model matrices of the dice inside the view frustum at once
+  // and draw them with one instanced draw call per shading level, plus one
+  // for the dice drawn as impostors
+  const auto clipMatrix{m_projMatrix * m_viewMatrix * m_modelMatrix};
+  m_dices.cull(clipMatrix);
+  // Sizes are measured in window pixels, so that they do not shrink with
+  // the resolution of the scene
+  m_dices.updateInstances(clipMatrix, ImGui::GetIO().DisplaySize.y);
+  m_renderQueue.clear();
+  m_dices.submit(m_renderQueue, m_programs, m_impostorProgram);
+  m_renderQueue.execute();
 
   abcg::glUseProgram(0);
 }
@@ -135,9 +200,13 @@ void OpenGLWindow::paintGL() {
 void OpenGLWindow::paintUI() {
   abcg::OpenGLWindow::paintUI();
 
+  // The UI is laid out in window pixels, which differ from the size given
+  // to resizeGL when the scene is rendered at a lower resolution
+  const auto windowSize{ImGui::GetIO().DisplaySize};
+
   //Janela de opções
   {
-    ImGui::SetNextWindowPos(ImVec2(m_viewportWidth / 3, m_viewportHeight - 100));
+    ImGui::SetNextWindowPos(ImVec2(windowSize.x / 3, windowSize.y - 120));
     ImGui::SetNextWindowSize(ImVec2(-1, -1));
     ImGui::Begin("Button window", nullptr, ImGuiWindowFlags_NoDecoration);
 
@@ -147,31 +216,22 @@ void OpenGLWindow::paintUI() {
         m_dices.jogarDado(dice);
       }
     }
-    // Number of dices combo box
+    // Number of dices slider (logarithmic, up to 100k instances)
     {
-      static std::size_t currentIndex{};
-      const std::vector<std::string> comboItems{"1", "2", "3", "4", "5", "6"};
-
-      ImGui::PushItemWidth(70);
-      if (ImGui::BeginCombo("Dados",
-                            comboItems.at(currentIndex).c_str())) {
-        for (const auto index : iter::range(comboItems.size())) {
-          const bool isSelected{currentIndex == index};
-          if (ImGui::Selectable(comboItems.at(index).c_str(), isSelected))
-            currentIndex = index;
-          if (isSelected) ImGui::SetItemDefaultFocus();
-        }
-        ImGui::EndCombo();
-      }
+      static int currentQuantity{quantity};
+
+      ImGui::PushItemWidth(windowSize.x / 3);
+      ImGui::SliderInt("Dados", &currentQuantity, 1, 100000, "%d",
+                       ImGuiSliderFlags_Logarithmic);
       ImGui::PopItemWidth();
-      if(quantity != (int)currentIndex + 1){ //se mudou
-        quantity = currentIndex + 1;
+      if(quantity != currentQuantity){ //se mudou
+        quantity = currentQuantity;
         m_dices.initializeGL(quantity);
       }
     }
     //Speed Slider 
     {
-      ImGui::PushItemWidth(m_viewportWidth / 3);
+      ImGui::PushItemWidth(windowSize.x / 3);
       static float spinSpeed{1.0f};
       ImGui::SliderFloat("Speed", &spinSpeed, 0.01f, 10.0f,
                        "%1f Degrees");
@@ -180,24 +240,77 @@ void OpenGLWindow::paintUI() {
       }
       ImGui::PopItemWidth();
     }
+    // Dice outside the view frustum in the last frame
+    {
+      const auto stats{m_dices.getCullStats()};
+      ImGui::Text("Culled: %zu of %zu dice (%zu nodes tested)", stats.culled,
+                  stats.visible + stats.culled, stats.nodesTested);
+    }
+    // Dice hidden behind the nearest dice in the last frame
+    {
+      ImGui::Checkbox("Occlusion culling", &m_dices.occlusionCulling);
+      if (m_dices.occlusionCulling) {
+        const auto stats{m_dices.getOcclusionStats()};
+        ImGui::SameLine();
+        ImGui::Text("%.1f%% of draws rejected", stats.getOccludedPercentage());
+      }
+    }
+    // Dice shaded per vertex or unlit in the last frame
+    {
+      ImGui::Checkbox("Shading LOD", &m_dices.shadingLOD);
+      if (m_dices.shadingLOD) {
+        const auto stats{m_dices.getShadingLOD().getStats()};
+        ImGui::SameLine();
+        ImGui::Text("%zu per vertex, %zu unlit", stats.objects.at(1),
+                    stats.objects.at(2));
+      }
+    }
+    // Dice drawn as impostors in the last frame
+    {
+      ImGui::Checkbox("Impostors", &m_dices.impostors);
+      if (m_dices.impostors) {
+        ImGui::SameLine();
+        ImGui::PushItemWidth(windowSize.x / 6);
+        ImGui::SliderFloat("##impostorDistance", &m_dices.impostorDistance,
+                           0.5f, 5.0f, "beyond %.2f");
+        ImGui::PopItemWidth();
+        ImGui::SameLine();
+        ImGui::Text("%zu impostors%s", m_dices.getNumImpostors(),
+                    m_dices.getImpostor().isCached() ? " (cached)" : "");
+      }
+    }
+    // Redundant state changes skipped in the last frame
+    {
+      const auto stats{abcg::GLStateCache::getInstance().getStats()};
+      ImGui::Text("GL state changes: %zu issued, %zu skipped", stats.issued,
+                  stats.elided);
+    }
 
     ImGui::End();
   }
+
+  if (m_dices.shadingLOD) m_dices.getShadingLOD().paintUI();
 }
 
 void OpenGLWindow::resizeGL(int width, int height) {
   m_viewportWidth = width;
   m_viewportHeight = height;
 
+  // Low-resolution depth buffer for occlusion culling
+  m_dices.resizeOcclusionBuffer(width / 4, height / 4);
+
   m_trackBallModel.resizeViewport(width, height);
   m_trackBallLight.resizeViewport(width, height);
 }
 
 void OpenGLWindow::terminateGL() {
   m_dices.terminateGL();
+  m_frameData.terminateGL();
   for (const auto& program : m_programs) {
     abcg::glDeleteProgram(program);
   }
+  abcg::glDeleteProgram(m_impostorBakeProgram);
+  abcg::glDeleteProgram(m_impostorProgram);
 }
 
 void OpenGLWindow::update() {
@@ -5,6 +5,16 @@
 #include "dices.hpp"
 #include "trackball.hpp"
 
+// Layout of the FrameData uniform block (std140)
+struct FrameData {
+  glm::mat4 viewMatrix{1.0f};
+  glm::mat4 projMatrix{1.0f};
+  glm::vec4 lightDirWorldSpace{};
+  glm::vec4 Ia{};
+  glm::vec4 Id{};
+  glm::vec4 Is{};
+};
+
 class OpenGLWindow : public abcg::OpenGLWindow {
  protected:
   void handleEvent(SDL_Event& ev) override;
@@ -20,6 +30,7 @@ class OpenGLWindow : public abcg::OpenGLWindow {
 
   Dices m_dices;
   int quantity{1}; //number of dices to be initialized
+  abcg::RenderQueue m_renderQueue;
 
   TrackBall m_trackBallModel;
   TrackBall m_trackBallLight;
@@ -29,10 +40,17 @@ class OpenGLWindow : public abcg::OpenGLWindow {
   glm::mat4 m_viewMatrix{1.0f};
   glm::mat4 m_projMatrix{1.0f};
 
-  // Shaders
-  std::vector<const char*> m_shaderNames{"texture"};
-  std::vector<GLuint> m_programs;
-  int m_currentProgramIndex{};
+  // Shaders, one for each level of abcg::ShadingLOD (per fragment, per
+  // vertex, and unlit)
+  std::vector<const char*> m_shaderNames{"texture", "gouraud", "unlit"};
+  std::vector<abcg::Program> m_programs;
+  // Programs that render the impostor atlas of the mesh and draw the
+  // distant dice with it
+  abcg::Program m_impostorBakeProgram;
+  abcg::Program m_impostorProgram;
+
+  // Camera and light data shared by every program
+  abcg::UniformBuffer<FrameData> m_frameData;
 
   // Mapping mode
   // 0: triplanar; 1: cylindrical; 2: spherical; 3: from mesh
@@ -1,19 +1,19 @@
 #version 410
 
+// Position in world space and color baked by the static batch
 layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec4 inColor;
 
-uniform vec4 color;
-uniform mat4 modelMatrix;
 uniform mat4 viewMatrix;
 uniform mat4 projMatrix;
 
 out vec4 fragColor;
 
 void main() {
-  vec4 posEyeSpace = viewMatrix * modelMatrix * vec4(inPosition, 1);
+  vec4 posEyeSpace = viewMatrix * vec4(inPosition, 1);
 
   float i = 1.0 - (-posEyeSpace.z / 5.0); //1 se estiver em cima da camera, 0 se estiver a 5 ou + de distancia da camera
-  fragColor = vec4(i, i, i, 1) * color;
+  fragColor = vec4(i, i, i, 1) * inColor;
 
   gl_Position = projMatrix * posEyeSpace;
 }
\ No newline at end of file
@@ -8,52 +8,28 @@ void Ground::initializeGL(GLuint program) {
                       glm::vec3(-0.5f, 0.0f, -0.5f),
                       glm::vec3( 0.5f, 0.0f,  0.5f),
                       glm::vec3( 0.5f, 0.0f, -0.5f)};
+  // Triangles of the former triangle strip
+  std::array<GLuint, 6> indices{0, 1, 2, 2, 1, 3};
 
-  // Generate VBO
-  abcg::glGenBuffers(1, &m_VBO);
-  abcg::glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
-  abcg::glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices.data(),
-                     GL_STATIC_DRAW);
-  abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  // Create VAO and bind vertex attributes
-  abcg::glGenVertexArrays(1, &m_VAO);
-  abcg::glBindVertexArray(m_VAO);
-  abcg::glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
-  const GLint posAttrib{abcg::glGetAttribLocation(program, "inPosition")};
-  abcg::glEnableVertexAttribArray(posAttrib);
-  abcg::glVertexAttribPointer(posAttrib, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
-  abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
-  abcg::glBindVertexArray(0);
-
-  // Save location of uniform variables
-  m_modelMatrixLoc = abcg::glGetUniformLocation(program, "modelMatrix");
-  m_colorLoc = abcg::glGetUniformLocation(program, "color");
-}
-
-void Ground::paintGL() {
-  // Draw a grid of tiles centered on the xz plane
+  // Bake a grid of tiles centered on the xz plane
   const int N{5};
 
-  abcg::glBindVertexArray(m_VAO);
   for (const auto z : iter::range(-N, N + 1)) {
     for (const auto x : iter::range(-N, N + 1)) {
-      // Set model matrix
+      // Model matrix of the tile
       glm::mat4 model{1.0f};
       model = glm::translate(model, glm::vec3(x, 0.0f, z));
-      abcg::glUniformMatrix4fv(m_modelMatrixLoc, 1, GL_FALSE, &model[0][0]);
 
-      // Set color (checkerboard pattern)
+      // Color of the tile (checkerboard pattern)
       const float gray{(z + x) % 2 == 0 ? 1.0f : 0.5f};
-      abcg::glUniform4f(m_colorLoc, gray, gray, gray, 1.0f);
 
-      abcg::glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+      m_batch.add(vertices, indices, model, glm::vec4(gray, gray, gray, 1.0f));
     }
   }
-  abcg::glBindVertexArray(0);
+
+  m_batch.initializeGL(program);
 }
 
-void Ground::terminateGL() {
-  abcg::glDeleteBuffers(1, &m_VBO);
-  abcg::glDeleteVertexArrays(1, &m_VAO);
-}
\ No newline at end of file
+void Ground::paintGL() { m_batch.render(); }
+
+void Ground::terminateGL() { m_batch.terminateGL(); }
\ No newline at end of file
@@ -9,12 +9,11 @@ class Ground {
   void paintGL();
   void terminateGL();
 
- private:
-  GLuint m_VAO{};
-  GLuint m_VBO{};
+  [[nodiscard]] const abcg::StaticBatch& getBatch() const { return m_batch; }
 
-  GLint m_modelMatrixLoc{};
-  GLint m_colorLoc{};
+ private:
+  // Every tile of the grid, merged into a single draw call
+  abcg::StaticBatch m_batch;
 };
 
 #endif
\ No newline at end of file
@@ -25,9 +25,6 @@ class OpenGLWindow : public abcg::OpenGLWindow {
   void terminateGL() override;
 
  private:
-  GLuint m_VAO{};
-  GLuint m_VBO{};
-  GLuint m_EBO{};
   GLuint m_program{};
 
   int m_viewportWidth{};
@@ -39,6 +36,8 @@ class OpenGLWindow : public abcg::OpenGLWindow {
   float m_panSpeed{0.0f};
 
   Ground m_ground;
+  // The four bunnies, merged into a single draw call
+  abcg::StaticBatch m_props;
 
   std::vector<Vertex> m_vertices;
   std::vector<GLuint> m_indices;
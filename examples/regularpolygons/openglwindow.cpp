@@ -9,13 +9,10 @@ void OpenGLWindow::initializeGL() {
     layout(location = 0) in vec2 inPosition;
     layout(location = 1) in vec4 inColor;
 
-    uniform vec2 translation;
-    uniform float scale;
     out vec4 fragColor;
 
     void main() { 
-      vec2 newPosition = inPosition * scale + translation;
-      gl_Position = vec4(newPosition, 0, 1); 
+      gl_Position = vec4(inPosition, 0, 1); 
       fragColor = inColor;
     }
   )gl"};
@@ -37,48 +34,32 @@ void OpenGLWindow::initializeGL() {
   // Start pseudo-random number generator
   m_randomEngine.seed(
       std::chrono::steady_clock::now().time_since_epoch().count());
+
+  // The polygons of each frame are accumulated and drawn together
+  m_batch.initializeGL(m_program);
 }
 
 void OpenGLWindow::paintGL() {
-  // Check whether to render the next polygon
+  // Check whether to render the next polygons
   if (m_elapsedTimer.elapsed() < m_delay / 1000.0) return;
   m_elapsedTimer.restart();
 
-  // Create a regular polygon with a number of sides in the range [3,20]
-  std::uniform_int_distribution<int> intDist(3, 20);
-  const auto sides{intDist(m_randomEngine)};
-  setupModel(sides);
-
   abcg::glViewport(0, 0, m_viewportWidth, m_viewportHeight);  // Set the viewport
 
-  abcg::glUseProgram(m_program);  // Start using the shader program
-
-  // Choose a random xy position from (-1,-1) to (1,1)
-  std::uniform_real_distribution<float> rd1(-1.0f, 1.0f);
-  const glm::vec2 translation{rd1(m_randomEngine), rd1(m_randomEngine)};
-  const GLint translationLocation{
-      abcg::glGetUniformLocation(m_program, "translation")};
-  abcg::glUniform2fv(translationLocation, 1, &translation.x);
-
-  // Choose a random scale factor (1% to 25%)
-  std::uniform_real_distribution<float> rd2(0.01f, 0.25f);
-  const auto scale{rd2(m_randomEngine)};
-  const GLint scaleLocation{abcg::glGetUniformLocation(m_program, "scale")};
-  abcg::glUniform1f(scaleLocation, scale);
+  m_batch.resetStats();
+  for ([[maybe_unused]] const auto i : iter::range(m_polygonsPerFrame)) {
+    addPolygon();
+  }
 
   //Render
-  abcg::glBindVertexArray(m_vao);  // Start using VAO
-  abcg::glDrawArrays(GL_TRIANGLE_FAN, 0, sides + 1);  // 
-
-  abcg::glBindVertexArray(0);  // End using VAO
-  abcg::glUseProgram(0);  // End using the shader program
+  m_batch.endFrame();
 }
 
 void OpenGLWindow::paintUI() {
   abcg::OpenGLWindow::paintUI();
 
   {
-    const auto widgetSize{ImVec2(200, 72)};
+    const auto widgetSize{ImVec2(220, 116)};
     ImGui::SetNextWindowPos(ImVec2(m_viewportWidth - widgetSize.x - 5
                                   ,m_viewportHeight - widgetSize.y - 5));
     ImGui::SetNextWindowSize(widgetSize); //definem a posição e tamanho da janela da ImGui que está prestes a ser criada
@@ -90,8 +71,14 @@ void OpenGLWindow::paintUI() {
     //Edit vertex colors
     ImGui::PushItemWidth(140);
     ImGui::SliderInt("Delay", &m_delay, 0, 200, "%d ms");
+    ImGui::SliderInt("Polygons", &m_polygonsPerFrame, 1, 100000, "%d",
+                     ImGuiSliderFlags_Logarithmic);
     ImGui::PopItemWidth();
 
+    const auto stats{m_batch.getStats()};
+    ImGui::Text("%zu vertices, %zu draw calls", stats.vertices,
+                stats.drawCalls);
+
     if(ImGui::Button("Clear Window", ImVec2(-1, 30))){
       abcg::glClear(GL_COLOR_BUFFER_BIT);
     }
@@ -107,84 +94,30 @@ void OpenGLWindow::resizeGL(int width, int height) {
 }
 
 void OpenGLWindow::terminateGL() {
-  // Release shader program, VBO and VAO
+  // Release shader program and batch
   abcg::glDeleteProgram(m_program);
-  abcg::glDeleteBuffers(1, &m_vboPositions);
-  abcg::glDeleteBuffers(1, &m_vboColors);
-  abcg::glDeleteVertexArrays(1, &m_vao);
+  m_batch.terminateGL();
 }
 
-void OpenGLWindow::setupModel(int sides) {
-  // Release previous resources, if any
-  abcg::glDeleteBuffers(1, &m_vboPositions);
-  abcg::glDeleteBuffers(1, &m_vboColors);
-  abcg::glDeleteVertexArrays(1, &m_vao);
+void OpenGLWindow::addPolygon() {
+  // Create a regular polygon with a number of sides in the range [3,20]
+  std::uniform_int_distribution<int> intDist(3, 20);
+  const auto sides{intDist(m_randomEngine)};
 
   // Select random colors for the radial gradient
   std::uniform_real_distribution<float> rd(0.0f, 1.0f);
-  const glm::vec3 color1{rd(m_randomEngine), rd(m_randomEngine),
-                         rd(m_randomEngine)};
-  const glm::vec3 color2{rd(m_randomEngine), rd(m_randomEngine),
-                         rd(m_randomEngine)};
-
-  // Minimum number of sides is 3
-  sides = std::max(3, sides);
-
-  std::vector<glm::vec2> positions(0);
-  std::vector<glm::vec3> colors(0);
-
-  // Polygon center
-  positions.emplace_back(0, 0);
-  colors.push_back(color1);
-
-  // Border vertices
-  const auto step{M_PI * 2 / sides};
-  for (const auto angle : iter::range(0.0, M_PI * 2, step)) {
-    positions.emplace_back(std::cos(angle), std::sin(angle));
-    colors.push_back(color2);
-  }
+  const glm::vec4 color1{rd(m_randomEngine), rd(m_randomEngine),
+                         rd(m_randomEngine), 1.0f};
+  const glm::vec4 color2{rd(m_randomEngine), rd(m_randomEngine),
+                         rd(m_randomEngine), 1.0f};
+
+  // Choose a random xy position from (-1,-1) to (1,1)
+  std::uniform_real_distribution<float> rd1(-1.0f, 1.0f);
+  const glm::vec2 translation{rd1(m_randomEngine), rd1(m_randomEngine)};
+
+  // Choose a random scale factor (1% to 25%)
+  std::uniform_real_distribution<float> rd2(0.01f, 0.25f);
+  const auto scale{rd2(m_randomEngine)};
 
-  // Duplicate second vertex
-  positions.push_back(positions.at(1));
-  colors.push_back(color2);
-
-  // Generate VBO of positions
-  abcg::glGenBuffers(1, &m_vboPositions);
-  abcg::glBindBuffer(GL_ARRAY_BUFFER, m_vboPositions);
-  abcg::glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec2),
-                     positions.data(), GL_STATIC_DRAW);
-  abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  // Generate VBO of colors
-  abcg::glGenBuffers(1, &m_vboColors);
-  abcg::glBindBuffer(GL_ARRAY_BUFFER, m_vboColors);
-  abcg::glBufferData(GL_ARRAY_BUFFER, colors.size() * sizeof(glm::vec3),
-                     colors.data(), GL_STATIC_DRAW);
-  abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  // Get location of attributes in the program
-  const auto positionAttribute{
-      abcg::glGetAttribLocation(m_program, "inPosition")};
-  const auto colorAttribute{abcg::glGetAttribLocation(m_program, "inColor")};
-
-  // Create VAO
-  abcg::glGenVertexArrays(1, &m_vao);
-
-  // Bind vertex attributes to current VAO
-  abcg::glBindVertexArray(m_vao);
-
-  abcg::glEnableVertexAttribArray(positionAttribute);
-  abcg::glBindBuffer(GL_ARRAY_BUFFER, m_vboPositions);
-  abcg::glVertexAttribPointer(positionAttribute, 2, GL_FLOAT, GL_FALSE, 0,
-                              nullptr);
-  abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  abcg::glEnableVertexAttribArray(colorAttribute);
-  abcg::glBindBuffer(GL_ARRAY_BUFFER, m_vboColors);
-  abcg::glVertexAttribPointer(colorAttribute, 3, GL_FLOAT, GL_FALSE, 0,
-                              nullptr);
-  abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  // End of binding to current VAO
-  abcg::glBindVertexArray(0);
+  m_batch.drawPolygon(translation, scale, sides, color1, color2);
 }
\ No newline at end of file
@@ -14,20 +14,21 @@ class OpenGLWindow : public abcg::OpenGLWindow {
   void terminateGL() override;
 
  private:
-  GLuint m_vao{};
-  GLuint m_vboPositions{};
-  GLuint m_vboColors{};
   GLuint m_program{};
 
+  // Accumulates the polygons of each frame
+  abcg::Batch2D m_batch;
+
   int m_viewportWidth{};
   int m_viewportHeight{};
 
   std::default_random_engine m_randomEngine;
 
   int m_delay{200};
+  int m_polygonsPerFrame{1};
   abcg::ElapsedTimer m_elapsedTimer;
 
-  void setupModel(int sides);
+  void addPolygon();
 };
 
 #endif
\ No newline at end of file
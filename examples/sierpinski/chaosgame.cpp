@@ -0,0 +1,147 @@
+#include "chaosgame.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+ChaosGame::ChaosGame() { m_workers.resize(m_threadPool.size()); }
+
+void ChaosGame::setMaps(const std::vector<AffineMap> &maps) {
+  m_maps = maps;
+  clear();
+}
+
+void ChaosGame::resize(int width, int height) {
+  m_width = std::max(width, 1);
+  m_height = std::max(height, 1);
+  const auto size{static_cast<std::size_t>(m_width) * m_height};
+  for (auto &worker : m_workers) worker.histogram.assign(size, 0);
+  m_density.assign(size, 0.0f);
+  clear();
+}
+
+void ChaosGame::clear() {
+  for (auto &worker : m_workers) {
+    std::fill(worker.histogram.begin(), worker.histogram.end(), 0);
+  }
+  std::fill(m_density.begin(), m_density.end(), 0.0f);
+  m_maxDensity = 0.0f;
+  m_totalPoints = 0;
+  resetOrbits();
+}
+
+void ChaosGame::iterate(std::size_t numPoints) {
+  if (m_maps.empty() || m_density.empty()) return;
+
+  // Split the points evenly among the workers and their lanes
+  const auto pointsPerStep{m_workers.size() * m_lanes};
+  const auto steps{(numPoints + pointsPerStep - 1) / pointsPerStep};
+
+  m_threadPool.run([this, steps](std::size_t workerIndex) {
+    iterateWorker(m_workers.at(workerIndex), steps, true);
+  });
+  m_threadPool.run([this](std::size_t workerIndex) { mergeRows(workerIndex); });
+
+  m_maxDensity = 0.0f;
+  for (const auto &worker : m_workers) {
+    m_maxDensity = std::max(m_maxDensity, worker.maxDensity);
+  }
+  m_totalPoints += steps * pointsPerStep;
+}
+
+void ChaosGame::resetOrbits() {
+  std::default_random_engine randomEngine{static_cast<std::uint32_t>(
+      std::chrono::steady_clock::now().time_since_epoch().count())};
+  // Xorshift states must not be zero
+  std::uniform_int_distribution<std::uint32_t> stateDistribution(1);
+  std::uniform_real_distribution<float> positionDistribution(-1.0f, 1.0f);
+
+  for (auto &worker : m_workers) {
+    for (std::size_t lane{}; lane < m_lanes; ++lane) {
+      worker.state.at(lane) = stateDistribution(randomEngine);
+      worker.x.at(lane) = positionDistribution(randomEngine);
+      worker.y.at(lane) = positionDistribution(randomEngine);
+    }
+    if (!m_maps.empty()) iterateWorker(worker, m_warmUpIterations, false);
+  }
+}
+
+void ChaosGame::iterateWorker(Worker &worker, std::size_t steps,
+                              bool accumulate) {
+  const auto numMaps{static_cast<std::uint64_t>(m_maps.size())};
+
+  // Maps from [-1, 1] to pixel coordinates
+  const auto scaleX{0.5f * static_cast<float>(m_width)};
+  const auto scaleY{0.5f * static_cast<float>(m_height)};
+  const auto width{static_cast<std::uint32_t>(m_width)};
+  const auto maxPixelX{static_cast<float>(m_width)};
+  const auto maxPixelY{static_cast<float>(m_height)};
+
+  auto &state{worker.state};
+  auto &x{worker.x};
+  auto &y{worker.y};
+  std::array<std::uint32_t, m_lanes> mapIndices{};
+  std::array<std::uint32_t, m_lanes> pixels{};
+
+  for (std::size_t step{}; step < steps; ++step) {
+    // Xorshift32 random number generator, one per lane. The map is chosen
+    // with a multiply-shift, which avoids the modulo.
+    for (std::size_t lane{}; lane < m_lanes; ++lane) {
+      auto s{state[lane]};
+      s ^= s << 13;
+      s ^= s >> 17;
+      s ^= s << 5;
+      state[lane] = s;
+      mapIndices[lane] = static_cast<std::uint32_t>((s * numMaps) >> 32);
+    }
+
+    for (std::size_t lane{}; lane < m_lanes; ++lane) {
+      const auto &map{m_maps[mapIndices[lane]]};
+      const auto newX{map.linear[0][0] * x[lane] + map.linear[1][0] * y[lane] +
+                      map.translation.x};
+      const auto newY{map.linear[0][1] * x[lane] + map.linear[1][1] * y[lane] +
+                      map.translation.y};
+      x[lane] = newX;
+      y[lane] = newY;
+    }
+
+    if (!accumulate) continue;
+
+    // Pixels outside the histogram are marked with an invalid index. The
+    // range is tested before converting to integers, as converting a
+    // negative or too large float is undefined.
+    for (std::size_t lane{}; lane < m_lanes; ++lane) {
+      const auto pixelX{(x[lane] + 1.0f) * scaleX};
+      const auto pixelY{(y[lane] + 1.0f) * scaleY};
+      const auto inside{pixelX >= 0.0f && pixelY >= 0.0f &&
+                        pixelX < maxPixelX && pixelY < maxPixelY};
+      pixels[lane] = inside ? static_cast<std::uint32_t>(pixelY) * width +
+                                  static_cast<std::uint32_t>(pixelX)
+                            : UINT32_MAX;
+    }
+
+    for (const auto pixel : pixels) {
+      if (pixel != UINT32_MAX) ++worker.histogram[pixel];
+    }
+  }
+}
+
+// Sums the histograms of every worker into the rows of the density map
+// assigned to the given worker
+void ChaosGame::mergeRows(std::size_t workerIndex) {
+  const auto numWorkers{m_workers.size()};
+  const auto rows{static_cast<std::size_t>(m_height)};
+  const auto width{static_cast<std::size_t>(m_width)};
+  const auto first{rows * workerIndex / numWorkers * width};
+  const auto last{rows * (workerIndex + 1) / numWorkers * width};
+
+  auto maxDensity{0.0f};
+  for (auto pixel{first}; pixel < last; ++pixel) {
+    std::uint32_t count{};
+    for (const auto &worker : m_workers) count += worker.histogram[pixel];
+    const auto density{static_cast<float>(count)};
+    m_density[pixel] = density;
+    maxDensity = std::max(maxDensity, density);
+  }
+  m_workers.at(workerIndex).maxDensity = maxDensity;
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+#ifndef CHAOSGAME_HPP_
+#define CHAOSGAME_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <glm/mat2x2.hpp>
+#include <glm/vec2.hpp>
+#include <vector>
+
+#include "abcg_threadpool.hpp"
+
+// Chaos game of an iterated function system (IFS), evaluated in parallel
+// and accumulated into a density histogram
+class ChaosGame {
+ public:
+  // p' = linear * p + translation
+  struct AffineMap {
+    glm::mat2 linear{1.0f};
+    glm::vec2 translation{};
+  };
+
+  ChaosGame();
+
+  void setMaps(const std::vector<AffineMap>& maps);
+  void resize(int width, int height);
+  void clear();
+  void iterate(std::size_t numPoints);
+
+  // Number of points in each pixel, bottom row first
+  [[nodiscard]] const std::vector<float>& getDensity() const {
+    return m_density;
+  }
+  [[nodiscard]] float getMaxDensity() const { return m_maxDensity; }
+  [[nodiscard]] std::uint64_t getTotalPoints() const { return m_totalPoints; }
+  [[nodiscard]] std::size_t getNumWorkers() const { return m_workers.size(); }
+  [[nodiscard]] int getWidth() const { return m_width; }
+  [[nodiscard]] int getHeight() const { return m_height; }
+
+ private:
+  // Independent orbits iterated together by each worker. The lanes are
+  // stored as separate arrays so that the random number generator and the
+  // affine maps compile to SIMD instructions.
+  static constexpr std::size_t m_lanes{16};
+  // Iterations discarded after a reset, until the orbits reach the attractor
+  static constexpr int m_warmUpIterations{32};
+
+  struct Worker {
+    std::array<std::uint32_t, m_lanes> state{};
+    std::array<float, m_lanes> x{};
+    std::array<float, m_lanes> y{};
+    std::vector<std::uint32_t> histogram;
+    float maxDensity{};
+  };
+
+  std::vector<Worker> m_workers;
+  std::vector<AffineMap> m_maps;
+
+  int m_width{};
+  int m_height{};
+  std::vector<float> m_density;
+  float m_maxDensity{};
+  std::uint64_t m_totalPoints{};
+
+  // One worker per thread of the pool
+  abcg::ThreadPool m_threadPool;
+
+  void resetOrbits();
+  void iterateWorker(Worker& worker, std::size_t steps, bool accumulate);
+  void mergeRows(std::size_t workerIndex);
+};
+
+#endif
\ No newline at end of file
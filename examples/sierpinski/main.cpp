@@ -10,8 +10,7 @@ int main(int argc, char **argv) {
 
     // Create OpenGL window
     auto window{std::make_unique<OpenGLWindow>()};
-    window->setOpenGLSettings(
-        {.samples = 2, .preserveWebGLDrawingBuffer = true});
+    window->setOpenGLSettings({.samples = 2});
     window->setWindowSettings({.width = 600,
                                .height = 600,
                                .showFullscreenButton = false,
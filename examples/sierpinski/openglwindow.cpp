@@ -3,22 +3,31 @@
 #include <fmt/core.h>
 #include <imgui.h>
 
-#include <chrono>
+#include <cmath>
 
 void OpenGLWindow::initializeGL() {
+  // Full-screen triangle generated from the vertex index
   const auto *vertexShader{R"gl(
     #version 410
-    layout(location = 0) in vec2 inPosition;
+    out vec2 fragTexCoord;
     void main() { 
-      gl_PointSize = 2.0;
-      gl_Position = vec4(inPosition, 0, 1); 
+      vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+      fragTexCoord = position;
+      gl_Position = vec4(position * 2.0 - 1.0, 0, 1); 
     }
   )gl"};
 
+  // Logarithmic tone mapping of the number of points in each pixel
   const auto *fragmentShader{R"gl(
     #version 410
+    uniform sampler2D densityTex;
+    uniform float logMaxDensity;
+    in vec2 fragTexCoord;
     out vec4 outColor;
-    void main() { outColor = vec4(1); }
+    void main() {
+      float density = texture(densityTex, fragTexCoord).r;
+      outColor = vec4(vec3(log(1.0 + density) / logMaxDensity), 1);
+    }
   )gl"};
 
   // Create shader program
@@ -28,55 +37,51 @@ void OpenGLWindow::initializeGL() {
   abcg::glClearColor(0, 0, 0, 1);
   abcg::glClear(GL_COLOR_BUFFER_BIT);
 
-  std::array<GLfloat, 2> sizes{};
-#if !defined(__EMSCRIPTEN__)
-  abcg::glEnable(GL_PROGRAM_POINT_SIZE);
-  abcg::glGetFloatv(GL_POINT_SIZE_RANGE, sizes.data());
-#else
-  abcg::glGetFloatv(GL_ALIASED_POINT_SIZE_RANGE, sizes.data());
-#endif
-  fmt::print("Point size: {:.2f} (min), {:.2f} (max)\n", sizes[0], sizes[1]);
-
-  // Start pseudo-random number generator
-  m_randomEngine.seed(
-      std::chrono::steady_clock::now().time_since_epoch().count());
-
-  // Randomly choose a pair of coordinates in the interval [-1; 1]
-  std::uniform_real_distribution<float> realDistribution(-1.0f, 1.0f);
-  m_P.x = realDistribution(m_randomEngine);
-  m_P.y = realDistribution(m_randomEngine);
+  // Each vertex of the triangle attracts the points halfway towards it
+  std::vector<ChaosGame::AffineMap> maps;
+  for (const auto &point : m_points) {
+    maps.push_back({.linear = glm::mat2{0.5f}, .translation = point * 0.5f});
+  }
+  m_chaosGame.setMaps(maps);
+  fmt::print("Chaos game workers: {}\n", m_chaosGame.getNumWorkers());
+
+  // Create the VAO and the density texture
+  setupModel();
 }
 
 void OpenGLWindow::paintGL() {
-  // Create OpenGL buffers for the single point at m_P
-  setupModel();
+  // Add a new batch of points to the histogram
+  abcg::ElapsedTimer timer;
+  m_chaosGame.iterate(static_cast<std::size_t>(m_pointsPerFrame));
+  m_pointsPerSecond = m_pointsPerFrame / std::max(timer.elapsed(), 1e-6);
+
+  // Upload the histogram
+  abcg::glBindTexture(GL_TEXTURE_2D, m_densityTexture);
+  abcg::glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_chaosGame.getWidth(),
+                        m_chaosGame.getHeight(), GL_RED, GL_FLOAT,
+                        m_chaosGame.getDensity().data());
 
   // Set the viewport
   abcg::glViewport(0, 0, m_viewportWidth, m_viewportHeight);
+  abcg::glClear(GL_COLOR_BUFFER_BIT);
 
   // Start using the shader program
   abcg::glUseProgram(m_program);
+  abcg::glUniform1i(abcg::glGetUniformLocation(m_program, "densityTex"), 0);
+  abcg::glUniform1f(abcg::glGetUniformLocation(m_program, "logMaxDensity"),
+                    std::log1p(std::max(m_chaosGame.getMaxDensity(), 1.0f)));
+  abcg::glActiveTexture(GL_TEXTURE0);
+
   // Start using VAO
   abcg::glBindVertexArray(m_vao);
 
-  // Draw a single point
-  abcg::glDrawArrays(GL_POINTS, 0, 1);
+  // Draw the histogram over the whole window
+  abcg::glDrawArrays(GL_TRIANGLES, 0, 3);
 
   // End using VAO
   abcg::glBindVertexArray(0);
   // End using the shader program
   abcg::glUseProgram(0);
-
-  // Randomly choose a triangle vertex index
-  std::uniform_int_distribution<int> intDistribution(0, m_points.size() - 1);
-  const int index{intDistribution(m_randomEngine)};
-
-  // The new position is the midpoint between the current position and the
-  // chosen vertex
-  m_P = (m_P + m_points.at(index)) / 2.0f;
-
-  // Print coordinates to the console
-  // fmt::print("({:+.2f}, {:+.2f})\n", m_P.x, m_P.y);
 }
 
 void OpenGLWindow::paintUI() {
@@ -86,8 +91,15 @@ void OpenGLWindow::paintUI() {
     ImGui::SetNextWindowPos(ImVec2(5, 81));
     ImGui::Begin(" ", nullptr, ImGuiWindowFlags_NoDecoration);
 
+    ImGui::PushItemWidth(150);
+    ImGui::SliderInt("Points per frame", &m_pointsPerFrame, 1000, 1 << 25,
+                     "%d", ImGuiSliderFlags_Logarithmic);
+    ImGui::PopItemWidth();
+    ImGui::Text("%.1f M points/s, %.0f M total", m_pointsPerSecond / 1e6,
+                static_cast<double>(m_chaosGame.getTotalPoints()) / 1e6);
+
     if (ImGui::Button("Clear window", ImVec2(150, 30))) {
-      abcg::glClear(GL_COLOR_BUFFER_BIT);
+      m_chaosGame.clear();
     }
 
     ImGui::End();
@@ -98,46 +110,31 @@ void OpenGLWindow::resizeGL(int width, int height) {
   m_viewportWidth = width;
   m_viewportHeight = height;
 
-  abcg::glClear(GL_COLOR_BUFFER_BIT);
+  // The histogram has the resolution of the window
+  m_chaosGame.resize(width, height);
+  abcg::glBindTexture(GL_TEXTURE_2D, m_densityTexture);
+  abcg::glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, m_chaosGame.getWidth(),
+                     m_chaosGame.getHeight(), 0, GL_RED, GL_FLOAT, nullptr);
 }
 
 void OpenGLWindow::terminateGL() {
-  // Release shader program, VBO and VAO
+  // Release shader program, texture and VAO
   abcg::glDeleteProgram(m_program);
-  abcg::glDeleteBuffers(1, &m_vboVertices);
+  abcg::glDeleteTextures(1, &m_densityTexture);
   abcg::glDeleteVertexArrays(1, &m_vao);
 }
 
 void OpenGLWindow::setupModel() {
-  // Release previous VBO and VAO
-  abcg::glDeleteBuffers(1, &m_vboVertices);
-  abcg::glDeleteVertexArrays(1, &m_vao);
-
-  // Generate a new VBO and get the associated ID
-  abcg::glGenBuffers(1, &m_vboVertices);
-  // Bind VBO in order to use it
-  abcg::glBindBuffer(GL_ARRAY_BUFFER, m_vboVertices);
-  // Upload data to VBO
-  abcg::glBufferData(GL_ARRAY_BUFFER, sizeof(m_P), &m_P, GL_STATIC_DRAW);
-  // Unbinding the VBO is allowed (data can be released now)
-  abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  // Get location of attributes in the program
-  const GLint positionAttribute{
-      abcg::glGetAttribLocation(m_program, "inPosition")};
-
-  // Create VAO
+  // The full-screen triangle has no vertex attributes, but a VAO must be
+  // bound to draw it
   abcg::glGenVertexArrays(1, &m_vao);
 
-  // Bind vertex attributes to current VAO
-  abcg::glBindVertexArray(m_vao);
-
-  abcg::glEnableVertexAttribArray(positionAttribute);
-  abcg::glBindBuffer(GL_ARRAY_BUFFER, m_vboVertices);
-  abcg::glVertexAttribPointer(positionAttribute, 2, GL_FLOAT, GL_FALSE, 0,
-                              nullptr);
-  abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  // End of binding to current VAO
-  abcg::glBindVertexArray(0);
+  // Float textures are not filterable in WebGL 2.0
+  abcg::glGenTextures(1, &m_densityTexture);
+  abcg::glBindTexture(GL_TEXTURE_2D, m_densityTexture);
+  abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  abcg::glBindTexture(GL_TEXTURE_2D, 0);
 }
\ No newline at end of file
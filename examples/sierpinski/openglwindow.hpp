@@ -3,9 +3,9 @@
 
 #include <array>
 #include <glm/vec2.hpp>
-#include <random>
 
 #include "abcg.hpp"
+#include "chaosgame.hpp"
 
 class OpenGLWindow : public abcg::OpenGLWindow {
  protected:
@@ -17,18 +17,20 @@ class OpenGLWindow : public abcg::OpenGLWindow {
 
  private:
   GLuint m_vao{};
-  GLuint m_vboVertices{};
   GLuint m_program{};
+  // Density histogram of the points, one texel per pixel
+  GLuint m_densityTexture{};
 
   int m_viewportWidth{};
   int m_viewportHeight{};
 
-  std::default_random_engine m_randomEngine;
-
   const std::array<glm::vec2, 3> m_points{glm::vec2( 0,  1), 
                                           glm::vec2(-1, -1),
                                           glm::vec2( 1, -1)};
-  glm::vec2 m_P{};
+
+  ChaosGame m_chaosGame;
+  int m_pointsPerFrame{1 << 22};
+  double m_pointsPerSecond{};
 
   void setupModel();
 };
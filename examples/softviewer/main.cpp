@@ -0,0 +1,257 @@
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <glm/gtc/matrix_inverse.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <string>
+
+#include "abcg.hpp"
+#include "model.hpp"
+
+// Model viewer drawn by abcg::SoftwareRasterizer, without OpenGL.
+//
+// Usage: softviewer [--size WxH] [--frames N] [--output file.bmp]
+//
+// With --frames or --output, N frames (1 by default) are rendered without
+// opening a window, the average frame time is printed, and the last frame is
+// saved to the output file. Otherwise, the model spins in a window whose
+// title shows the frame rate.
+
+namespace {
+struct Options {
+  int width{600};
+  int height{600};
+  // Number of frames to render without a window, or 0 to open a window
+  int frames{};
+  std::string output{"softviewer.bmp"};
+};
+
+// Camera and light, as in the FrameData block of viewer4
+struct FrameData {
+  glm::mat4 viewMatrix{1.0f};
+  glm::mat4 projMatrix{1.0f};
+  glm::vec4 lightDirWorldSpace{-1.0f, -1.0f, -1.0f, 0.0f};
+  glm::vec4 Ia{1.0f};
+  glm::vec4 Id{1.0f};
+  glm::vec4 Is{1.0f};
+};
+
+// Varyings written by the vertex shader: fragN, fragV and fragTexCoord
+constexpr std::size_t numVaryings{8};
+
+Options parseOptions(int argc, char **argv) {
+  Options options;
+  for (auto index{1}; index < argc; ++index) {
+    const std::string option{argv[index]};
+    if (index + 1 >= argc) {
+      throw abcg::Exception{abcg::Exception::Runtime(
+          fmt::format("Missing value for option {}", option))};
+    }
+    const std::string value{argv[++index]};
+
+    if (option == "--size") {
+      if (std::sscanf(value.c_str(), "%dx%d", &options.width,
+                      &options.height) != 2 ||
+          options.width <= 0 || options.height <= 0) {
+        throw abcg::Exception{abcg::Exception::Runtime(
+            fmt::format("Invalid size {} (expected WxH)", value))};
+      }
+    } else if (option == "--frames") {
+      const auto *end{value.data() + value.size()};
+      const auto [last, error]{
+          std::from_chars(value.data(), end, options.frames)};
+      if (error != std::errc{} || last != end || options.frames <= 0) {
+        throw abcg::Exception{abcg::Exception::Runtime(
+            fmt::format("Invalid number of frames {}", value))};
+      }
+    } else if (option == "--output") {
+      options.output = value;
+      options.frames = std::max(options.frames, 1);
+    } else {
+      throw abcg::Exception{
+          abcg::Exception::Runtime(fmt::format("Unknown option {}", option))};
+    }
+  }
+  return options;
+}
+
+// Blinn-Phong reflection model, as in texture.frag of viewer4
+glm::vec4 BlinnPhong(const Model &model, const FrameData &frameData,
+                     glm::vec3 N, glm::vec3 L, glm::vec3 V,
+                     glm::vec2 texCoord) {
+  N = glm::normalize(N);
+  L = glm::normalize(L);
+
+  // Compute lambertian term
+  const auto lambertian{std::max(glm::dot(N, L), 0.0f)};
+
+  // Compute specular term
+  auto specular{0.0f};
+  if (lambertian > 0.0f) {
+    V = glm::normalize(V);
+    const auto H{glm::normalize(L + V)};
+    const auto angle{std::max(glm::dot(H, N), 0.0f)};
+    specular = std::pow(angle, model.getShininess());
+  }
+
+  const auto map_Kd{abcg::sampleImage(model.getDiffuseTexture(), texCoord)};
+  const auto map_Ka{map_Kd};
+
+  const auto diffuseColor{map_Kd * model.getKd() * frameData.Id * lambertian};
+  const auto specularColor{model.getKs() * frameData.Is * specular};
+  const auto ambientColor{map_Ka * model.getKa() * frameData.Ia};
+
+  return ambientColor + diffuseColor + specularColor;
+}
+
+void render(abcg::SoftwareRasterizer &rasterizer, const Model &model,
+            float angle) {
+  const auto aspect{static_cast<float>(rasterizer.getWidth()) /
+                    static_cast<float>(rasterizer.getHeight())};
+  FrameData frameData;
+  frameData.viewMatrix =
+      glm::lookAt(glm::vec3(0.0f, 0.0f, 2.0f), glm::vec3(0.0f),
+                  glm::vec3(0.0f, 1.0f, 0.0f));
+  frameData.projMatrix =
+      glm::perspective(glm::radians(45.0f), aspect, 0.1f, 5.0f);
+
+  const auto modelMatrix{
+      glm::rotate(glm::mat4{1.0f}, angle, glm::vec3(0.0f, 1.0f, 0.0f))};
+  const auto modelViewMatrix{frameData.viewMatrix * modelMatrix};
+  const auto normalMatrix{glm::inverseTranspose(glm::mat3(modelViewMatrix))};
+  // Directional light, the same for every fragment
+  const glm::vec3 L{-(frameData.viewMatrix * frameData.lightDirWorldSpace)};
+
+  const auto &vertices{model.getVertices()};
+  const auto vertexShader{
+      [&](std::uint32_t index, abcg::SoftwareRasterizer::ShadedVertex &out) {
+        const auto &vertex{vertices[index]};
+        const glm::vec3 P{modelViewMatrix * glm::vec4(vertex.position, 1.0f)};
+        const auto N{normalMatrix * vertex.normal};
+
+        out.varyings = {N.x,  N.y,  N.z,
+                        -P.x, -P.y, -P.z,
+                        vertex.texCoord.x, vertex.texCoord.y};
+        out.position = frameData.projMatrix * glm::vec4(P, 1.0f);
+      }};
+
+  const auto fragmentShader{[&](const abcg::SoftwareRasterizer::Varyings &in,
+                                bool frontFacing) {
+    const glm::vec3 fragN{in[0], in[1], in[2]};
+    const glm::vec3 fragV{in[3], in[4], in[5]};
+    const glm::vec2 fragTexCoord{in[6], in[7]};
+    const auto color{
+        BlinnPhong(model, frameData, fragN, L, fragV, fragTexCoord)};
+
+    if (frontFacing) return color;
+    const auto i{(color.r + color.g + color.b) / 3.0f};
+    return glm::vec4(i, 0.0f, 0.0f, 1.0f);
+  }};
+
+  rasterizer.clear(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+  rasterizer.drawIndexed(vertices.size(), model.getIndices(), numVaryings,
+                         vertexShader, fragmentShader);
+}
+
+void renderToFile(abcg::SoftwareRasterizer &rasterizer, const Model &model,
+                  const Options &options) {
+  abcg::ElapsedTimer timer;
+  for (auto frame{0}; frame < options.frames; ++frame) {
+    render(rasterizer, model, static_cast<float>(frame) * 0.02f);
+  }
+  const auto elapsed{timer.elapsed()};
+
+  const auto stats{rasterizer.getStats()};
+  fmt::print("{}x{}, {} threads: {:.2f} ms per frame\n", options.width,
+             options.height, rasterizer.getNumWorkers(),
+             elapsed * 1000.0 / options.frames);
+  fmt::print("{} triangles, {} binned, {} fragments shaded\n",
+             stats.triangles, stats.trianglesBinned, stats.fragmentsShaded);
+
+  rasterizer.saveBMP(options.output);
+}
+
+void renderToWindow(abcg::SoftwareRasterizer &rasterizer, const Model &model,
+                    const Options &options) {
+  // No SDL_WINDOW_OPENGL: frames are copied to the window surface
+  auto *window{SDL_CreateWindow("Software Viewer", SDL_WINDOWPOS_CENTERED,
+                                SDL_WINDOWPOS_CENTERED, options.width,
+                                options.height, SDL_WINDOW_RESIZABLE)};
+  if (window == nullptr) {
+    throw abcg::Exception{abcg::Exception::SDL("SDL_CreateWindow failed")};
+  }
+
+  abcg::ElapsedTimer time;
+  abcg::ElapsedTimer titleTimer;
+  auto framesSinceTitle{0};
+  auto done{false};
+  while (!done) {
+    SDL_Event event;
+    while (SDL_PollEvent(&event) != 0) {
+      if (event.type == SDL_QUIT ||
+          (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_ESCAPE)) {
+        done = true;
+      }
+      if (event.type == SDL_WINDOWEVENT &&
+          event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+        rasterizer.resize(event.window.data1, event.window.data2);
+      }
+    }
+
+    render(rasterizer, model, static_cast<float>(time.elapsed()));
+    rasterizer.present(window);
+
+    ++framesSinceTitle;
+    if (titleTimer.elapsed() >= 1.0) {
+      const auto stats{rasterizer.getStats()};
+      const auto title{fmt::format(
+          "Software Viewer - {:.1f} fps, {} threads, {} triangles, "
+          "{} fragments",
+          framesSinceTitle / titleTimer.restart(),
+          rasterizer.getNumWorkers(), stats.triangles, stats.fragmentsShaded)};
+      SDL_SetWindowTitle(window, title.c_str());
+      framesSinceTitle = 0;
+    }
+  }
+
+  SDL_DestroyWindow(window);
+}
+}  // namespace
+
+int main(int argc, char **argv) {
+  try {
+    const auto options{parseOptions(argc, argv)};
+    const auto headless{options.frames > 0};
+
+    // The video subsystem is only needed for the window
+    if (SDL_Init(headless ? 0 : SDL_INIT_VIDEO) != 0) {
+      throw abcg::Exception{abcg::Exception::SDL("SDL_Init failed")};
+    }
+
+    std::string assetsPath{"assets/"};
+    if (auto *basePath{SDL_GetBasePath()}; basePath != nullptr) {
+      assetsPath = std::string{basePath} + "assets/";
+      SDL_free(basePath);
+    }
+
+    Model model;
+    model.loadObj(assetsPath + "roman_lamp.obj");
+
+    abcg::SoftwareRasterizer rasterizer;
+    rasterizer.resize(options.width, options.height);
+
+    if (headless) {
+      renderToFile(rasterizer, model, options);
+    } else {
+      renderToWindow(rasterizer, model, options);
+    }
+
+    SDL_Quit();
+  } catch (const abcg::Exception &exception) {
+    fmt::print(stderr, "{}\n", exception.what());
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,195 @@
+#include "model.hpp"
+
+#include <fmt/core.h>
+#include <tiny_obj_loader.h>
+
+#include <cppitertools/itertools.hpp>
+#include <filesystem>
+#include <glm/gtx/hash.hpp>
+#include <unordered_map>
+
+// Explicit specialization of std::hash for Vertex
+namespace std {
+template <>
+struct hash<Vertex> {
+  size_t operator()(Vertex const& vertex) const noexcept {
+    const std::size_t h1{std::hash<glm::vec3>()(vertex.position)};
+    const std::size_t h2{std::hash<glm::vec3>()(vertex.normal)};
+    const std::size_t h3{std::hash<glm::vec2>()(vertex.texCoord)};
+    return h1 ^ h2 ^ h3;
+  }
+};
+}  // namespace std
+
+void Model::computeNormals() {
+  // Clear previous vertex normals
+  for (auto& vertex : m_vertices) {
+    vertex.normal = glm::zero<glm::vec3>();
+  }
+
+  // Compute face normals
+  for (const auto offset : iter::range<int>(0, m_indices.size(), 3)) {
+    // Get face vertices
+    Vertex& a{m_vertices.at(m_indices.at(offset + 0))};
+    Vertex& b{m_vertices.at(m_indices.at(offset + 1))};
+    Vertex& c{m_vertices.at(m_indices.at(offset + 2))};
+
+    // Compute normal
+    const auto edge1{b.position - a.position};
+    const auto edge2{c.position - b.position};
+    const glm::vec3 normal{glm::cross(edge1, edge2)};
+
+    // Accumulate on vertices
+    a.normal += normal;
+    b.normal += normal;
+    c.normal += normal;
+  }
+
+  // Normalize
+  for (auto& vertex : m_vertices) {
+    vertex.normal = glm::normalize(vertex.normal);
+  }
+
+  m_hasNormals = true;
+}
+
+void Model::loadDiffuseTexture(std::string_view path) {
+  if (!std::filesystem::exists(path)) return;
+
+  m_diffuseTexture = abcg::loadImage(path);
+}
+
+void Model::loadObj(std::string_view path, bool standardize) {
+  const auto basePath{std::filesystem::path{path}.parent_path().string() + "/"};
+
+  tinyobj::ObjReaderConfig readerConfig;
+  readerConfig.mtl_search_path = basePath;  // Path to material files
+
+  tinyobj::ObjReader reader;
+
+  if (!reader.ParseFromFile(path.data(), readerConfig)) {
+    if (!reader.Error().empty()) {
+      throw abcg::Exception{abcg::Exception::Runtime(
+          fmt::format("Failed to load model {} ({})", path, reader.Error()))};
+    }
+    throw abcg::Exception{
+        abcg::Exception::Runtime(fmt::format("Failed to load model {}", path))};
+  }
+
+  if (!reader.Warning().empty()) {
+    fmt::print("Warning: {}\n", reader.Warning());
+  }
+
+  const auto& attrib{reader.GetAttrib()};
+  const auto& shapes{reader.GetShapes()};
+  const auto& materials{reader.GetMaterials()};
+
+  m_vertices.clear();
+  m_indices.clear();
+
+  m_diffuseTexture = {};
+  m_hasNormals = false;
+
+  // A key:value map with key=Vertex and value=index
+  std::unordered_map<Vertex, std::uint32_t> hash{};
+
+  // Loop over shapes
+  for (const auto& shape : shapes) {
+    // Loop over indices
+    for (const auto offset : iter::range(shape.mesh.indices.size())) {
+      // Access to vertex
+      const tinyobj::index_t index{shape.mesh.indices.at(offset)};
+
+      // Vertex position
+      const int startIndex{3 * index.vertex_index};
+      const float vx{attrib.vertices.at(startIndex + 0)};
+      const float vy{attrib.vertices.at(startIndex + 1)};
+      const float vz{attrib.vertices.at(startIndex + 2)};
+
+      // Vertex normal
+      float nx{};
+      float ny{};
+      float nz{};
+      if (index.normal_index >= 0) {
+        m_hasNormals = true;
+        const int normalStartIndex{3 * index.normal_index};
+        nx = attrib.normals.at(normalStartIndex + 0);
+        ny = attrib.normals.at(normalStartIndex + 1);
+        nz = attrib.normals.at(normalStartIndex + 2);
+      }
+
+      // Vertex texture coordinates
+      float tu{};
+      float tv{};
+      if (index.texcoord_index >= 0) {
+        const int texCoordsStartIndex{2 * index.texcoord_index};
+        tu = attrib.texcoords.at(texCoordsStartIndex + 0);
+        tv = attrib.texcoords.at(texCoordsStartIndex + 1);
+      }
+
+      Vertex vertex{};
+      vertex.position = {vx, vy, vz};
+      vertex.normal = {nx, ny, nz};
+      vertex.texCoord = {tu, tv};
+
+      // If hash doesn't contain this vertex
+      if (hash.count(vertex) == 0) {
+        // Add this index (size of m_vertices)
+        hash[vertex] = m_vertices.size();
+        // Add this vertex
+        m_vertices.push_back(vertex);
+      }
+
+      m_indices.push_back(hash[vertex]);
+    }
+  }
+
+  // Use properties of first material, if available
+  if (!materials.empty()) {
+    const auto& mat{materials.at(0)};  // First material
+    m_Ka = glm::vec4(mat.ambient[0], mat.ambient[1], mat.ambient[2], 1);
+    m_Kd = glm::vec4(mat.diffuse[0], mat.diffuse[1], mat.diffuse[2], 1);
+    m_Ks = glm::vec4(mat.specular[0], mat.specular[1], mat.specular[2], 1);
+    m_shininess = mat.shininess;
+
+    if (!mat.diffuse_texname.empty())
+      loadDiffuseTexture(basePath + mat.diffuse_texname);
+  } else {
+    // Default values
+    m_Ka = {0.1f, 0.1f, 0.1f, 1.0f};
+    m_Kd = {0.7f, 0.7f, 0.7f, 1.0f};
+    m_Ks = {1.0f, 1.0f, 1.0f, 1.0f};
+    m_shininess = 25.0f;
+  }
+
+  if (standardize) {
+    this->standardize();
+  }
+
+  if (!m_hasNormals) {
+    computeNormals();
+  }
+}
+
+void Model::standardize() {
+  // Center to origin and normalize largest bound to [-1, 1]
+
+  // Get bounds
+  glm::vec3 max(std::numeric_limits<float>::lowest());
+  glm::vec3 min(std::numeric_limits<float>::max());
+  for (const auto& vertex : m_vertices) {
+    max.x = std::max(max.x, vertex.position.x);
+    max.y = std::max(max.y, vertex.position.y);
+    max.z = std::max(max.z, vertex.position.z);
+    min.x = std::min(min.x, vertex.position.x);
+    min.y = std::min(min.y, vertex.position.y);
+    min.z = std::min(min.z, vertex.position.z);
+  }
+
+  // Center and scale
+  const auto center{(min + max) / 2.0f};
+  const auto scaling{2.0f / glm::length(max - min)};
+  for (auto& vertex : m_vertices) {
+    vertex.position = (vertex.position - center) * scaling;
+  }
+}
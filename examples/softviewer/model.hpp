@@ -0,0 +1,59 @@
+#ifndef MODEL_HPP_
+#define MODEL_HPP_
+
+#include <vector>
+
+#include "abcg.hpp"
+
+struct Vertex {
+  glm::vec3 position{};
+  glm::vec3 normal{};
+  glm::vec2 texCoord{};
+
+  bool operator==(const Vertex& other) const noexcept {
+    static const auto epsilon{std::numeric_limits<float>::epsilon()};
+    return glm::all(glm::epsilonEqual(position, other.position, epsilon)) &&
+           glm::all(glm::epsilonEqual(normal, other.normal, epsilon)) &&
+           glm::all(glm::epsilonEqual(texCoord, other.texCoord, epsilon));
+  }
+};
+
+// Model kept in main memory, to be drawn by abcg::SoftwareRasterizer
+class Model {
+ public:
+  void loadDiffuseTexture(std::string_view path);
+  void loadObj(std::string_view path, bool standardize = true);
+
+  [[nodiscard]] const std::vector<Vertex>& getVertices() const {
+    return m_vertices;
+  }
+  [[nodiscard]] const std::vector<std::uint32_t>& getIndices() const {
+    return m_indices;
+  }
+  [[nodiscard]] const abcg::Image& getDiffuseTexture() const {
+    return m_diffuseTexture;
+  }
+
+  [[nodiscard]] glm::vec4 getKa() const { return m_Ka; }
+  [[nodiscard]] glm::vec4 getKd() const { return m_Kd; }
+  [[nodiscard]] glm::vec4 getKs() const { return m_Ks; }
+  [[nodiscard]] float getShininess() const { return m_shininess; }
+
+ private:
+  glm::vec4 m_Ka;
+  glm::vec4 m_Kd;
+  glm::vec4 m_Ks;
+  float m_shininess;
+  // Empty if the model has no texture (sampled as white)
+  abcg::Image m_diffuseTexture;
+
+  std::vector<Vertex> m_vertices;
+  std::vector<std::uint32_t> m_indices;
+
+  bool m_hasNormals{false};
+
+  void computeNormals();
+  void standardize();
+};
+
+#endif
@@ -4,8 +4,11 @@ in vec3 fragN;
 in vec3 fragL;
 in vec3 fragV;
 
-// Light properties
-uniform vec4 Ia, Id, Is;
+#include "framedata.glsl"
+
+#ifdef CLUSTERED_LIGHTS
+#include "clusters.glsl"
+#endif
 
 // Material properties
 uniform vec4 Ka, Kd, Ks;
@@ -39,6 +42,13 @@ vec4 BlinnPhong(vec3 N, vec3 L, vec3 V) {
 void main() {
   vec4 color = BlinnPhong(fragN, fragL, fragV);
 
+#ifdef CLUSTERED_LIGHTS
+  // Point lights near the fragment
+  vec3 diffuse, specular;
+  accumulatePointLights(fragN, fragV, -fragV, shininess, diffuse, specular);
+  color.rgb += Kd.rgb * diffuse + Ks.rgb * specular;
+#endif
+
   if (gl_FrontFacing) {
     outColor = color;
   } else {
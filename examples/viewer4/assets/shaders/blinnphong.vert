@@ -3,17 +3,18 @@
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inNormal;
 
+#include "framedata.glsl"
+
 uniform mat4 modelMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 projMatrix;
 uniform mat3 normalMatrix;
 
-uniform vec4 lightDirWorldSpace;
-
 out vec3 fragV;
 out vec3 fragL;
 out vec3 fragN;
 
+// Same depth as in the depth pre-pass, for GL_EQUAL depth testing
+invariant gl_Position;
+
 void main() {
   vec3 P = (viewMatrix * modelMatrix * vec4(inPosition, 1.0)).xyz;
   vec3 N = normalMatrix * inNormal;
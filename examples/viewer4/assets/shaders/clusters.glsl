@@ -0,0 +1,94 @@
+// Point lights binned into clusters by abcg::LightClusters. Requires
+// framedata.glsl, included before this file
+
+// Position in view space and radius, then color, of each light
+uniform highp sampler2D lightTex;
+// Offset in the light list and number of lights of each cluster
+uniform highp usampler2D clusterTex;
+// Light list
+uniform highp usampler2D lightIndexTex;
+
+// Number of clusters along x, y and depth
+uniform ivec3 clusterGridSize;
+// Depth slice of a point is log(depth) * x + y
+uniform vec2 clusterDepthParams;
+
+struct PointLight {
+  vec3 position;
+  float radius;
+  vec3 color;
+};
+
+// Coordinates of an element of a texture filled row by row
+ivec2 getTexelCoord(int index, int width) {
+  return ivec2(index % width, index / width);
+}
+
+// Offset and count of the cluster that contains a point in view space
+uvec2 getCluster(vec3 P) {
+  vec4 clipPosition = projMatrix * vec4(P, 1.0);
+  vec2 uv = clipPosition.xy / clipPosition.w * 0.5 + 0.5;
+  float slice = log(max(-P.z, 1e-5)) * clusterDepthParams.x +
+                clusterDepthParams.y;
+
+  ivec3 cluster = ivec3(vec3(uv * vec2(clusterGridSize.xy), slice));
+  cluster = clamp(cluster, ivec3(0), clusterGridSize - 1);
+  int index = (cluster.z * clusterGridSize.y + cluster.y) * clusterGridSize.x +
+              cluster.x;
+  int width = textureSize(clusterTex, 0).x;
+  return texelFetch(clusterTex, getTexelCoord(index, width), 0).xy;
+}
+
+PointLight getPointLight(uint index) {
+  int width = textureSize(lightTex, 0).x;
+  vec4 data0 = texelFetch(lightTex, getTexelCoord(int(index) * 2, width), 0);
+  vec4 data1 =
+      texelFetch(lightTex, getTexelCoord(int(index) * 2 + 1, width), 0);
+  return PointLight(data0.xyz, data0.w, data1.rgb);
+}
+
+// Inverse square falloff, windowed to reach zero at the radius
+float getAttenuation(float lightDistance, float radius) {
+  float ratio = lightDistance / radius;
+  float ratio2 = ratio * ratio;
+  float window = clamp(1.0 - ratio2 * ratio2, 0.0, 1.0);
+  return window * window / (1.0 + lightDistance * lightDistance);
+}
+
+// Diffuse and specular light of the point lights of the cluster of P. N and
+// V need not be normalized. The specular term uses the Blinn half vector,
+// or the reflection vector if PHONG_SPECULAR is defined
+void accumulatePointLights(vec3 N, vec3 V, vec3 P, float shininess,
+                           out vec3 diffuse, out vec3 specular) {
+  diffuse = vec3(0.0);
+  specular = vec3(0.0);
+
+  N = normalize(N);
+  V = normalize(V);
+
+  uvec2 cluster = getCluster(P);
+  int width = textureSize(lightIndexTex, 0).x;
+  for (uint i = 0u; i < cluster.y; ++i) {
+    int entry = int(cluster.x + i);
+    uint index = texelFetch(lightIndexTex, getTexelCoord(entry, width), 0).r;
+    PointLight light = getPointLight(index);
+
+    vec3 L = light.position - P;
+    float lightDistance = length(L);
+    if (lightDistance >= light.radius) continue;
+    L /= lightDistance;
+
+    float lambertian = max(dot(N, L), 0.0);
+    if (lambertian <= 0.0) continue;
+
+    vec3 radiance = light.color * getAttenuation(lightDistance, light.radius);
+    diffuse += radiance * lambertian;
+
+#ifdef PHONG_SPECULAR
+    float angle = max(dot(reflect(-L, N), V), 0.0);
+#else
+    float angle = max(dot(normalize(L + V), N), 0.0);
+#endif
+    specular += radiance * pow(angle, shininess);
+  }
+}
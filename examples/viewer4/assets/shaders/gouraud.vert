@@ -3,15 +3,16 @@
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inNormal;
 
+#include "framedata.glsl"
+
+#ifdef CLUSTERED_LIGHTS
+#define PHONG_SPECULAR
+#include "clusters.glsl"
+#endif
+
 uniform mat4 modelMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 projMatrix;
 uniform mat3 normalMatrix;
 
-// Light properties
-uniform vec4 lightDirWorldSpace;
-uniform vec4 Ia, Id, Is;
-
 // Material properties
 uniform vec4 Ka, Kd, Ks;
 uniform float shininess;
@@ -42,6 +43,9 @@ vec4 Phong(vec3 N, vec3 L, vec3 V) {
   return ambientColor + diffuseColor + specularColor;
 }
 
+// Same depth as in the depth pre-pass, for GL_EQUAL depth testing
+invariant gl_Position;
+
 void main() {
   vec3 P = (viewMatrix * modelMatrix * vec4(inPosition, 1.0)).xyz;
   vec3 N = normalMatrix * inNormal;
@@ -50,5 +54,12 @@ void main() {
 
   fragColor = Phong(N, L, V);
 
+#ifdef CLUSTERED_LIGHTS
+  // Point lights near the vertex
+  vec3 diffuse, specular;
+  accumulatePointLights(N, V, P, shininess, diffuse, specular);
+  fragColor.rgb += Kd.rgb * diffuse + Ks.rgb * specular;
+#endif
+
   gl_Position = projMatrix * vec4(P, 1.0);
 }
@@ -0,0 +1,5 @@
+#version 410
+
+// Depth only. Color writes are disabled during the pre-pass
+
+void main() {}
@@ -0,0 +1,17 @@
+#version 410
+
+layout(location = 0) in vec3 inPosition;
+
+#include "framedata.glsl"
+
+uniform mat4 modelMatrix;
+
+// Depth must match the shading pass exactly for GL_EQUAL depth testing, so
+// the position is computed as in the lighting shaders
+invariant gl_Position;
+
+void main() {
+  vec3 P = (viewMatrix * modelMatrix * vec4(inPosition, 1.0)).xyz;
+
+  gl_Position = projMatrix * vec4(P, 1.0);
+}
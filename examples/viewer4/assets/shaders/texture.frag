@@ -7,8 +7,11 @@ in vec2 fragTexCoord;
 in vec3 fragPObj;
 in vec3 fragNObj;
 
-// Light properties
-uniform vec4 Ia, Id, Is;
+#include "framedata.glsl"
+
+#ifdef CLUSTERED_LIGHTS
+#include "clusters.glsl"
+#endif
 
 // Material properties
 uniform vec4 Ka, Kd, Ks;
@@ -17,9 +20,11 @@ uniform float shininess;
 // Diffuse texture sampler
 uniform sampler2D diffuseTex;
 
-// Mapping mode
+// Mapping mode, set when the program is created
 // 0: triplanar; 1: cylindrical; 2: spherical; 3: from mesh
-uniform int mappingMode;
+#ifndef MAPPING_MODE
+#define MAPPING_MODE 3
+#endif
 
 out vec4 outColor;
 
@@ -82,38 +87,52 @@ vec2 SphericalMapping(vec3 P) {
 void main() {
   vec4 color;
 
-  if (mappingMode == 0) {
-    // Triplanar mapping
-
-    // Sample with x planar mapping
-    vec2 texCoord1 = PlanarMappingX(fragPObj);
-    vec4 color1 = BlinnPhong(fragN, fragL, fragV, texCoord1);
-
-    // Sample with y planar mapping
-    vec2 texCoord2 = PlanarMappingY(fragPObj);
-    vec4 color2 = BlinnPhong(fragN, fragL, fragV, texCoord2);
-
-    // Sample with z planar mapping
-    vec2 texCoord3 = PlanarMappingZ(fragPObj);
-    vec4 color3 = BlinnPhong(fragN, fragL, fragV, texCoord3);
-
-    // Compute average based on normal
-    vec3 weight = abs(normalize(fragNObj));
-    color = color1 * weight.x + color2 * weight.y + color3 * weight.z;
-  } else {
-    vec2 texCoord;
-    if (mappingMode == 1) {
-      // Cylindrical mapping
-      texCoord = CylindricalMapping(fragPObj);
-    } else if (mappingMode == 2) {
-      // Spherical mapping
-      texCoord = SphericalMapping(fragPObj);
-    } else if (mappingMode == 3) {
-      // From mesh
-      texCoord = fragTexCoord;
-    }
-    color = BlinnPhong(fragN, fragL, fragV, texCoord);
-  }
+#if MAPPING_MODE == 0
+  // Triplanar mapping
+
+  // Sample with x planar mapping
+  vec2 texCoord1 = PlanarMappingX(fragPObj);
+  vec4 color1 = BlinnPhong(fragN, fragL, fragV, texCoord1);
+
+  // Sample with y planar mapping
+  vec2 texCoord2 = PlanarMappingY(fragPObj);
+  vec4 color2 = BlinnPhong(fragN, fragL, fragV, texCoord2);
+
+  // Sample with z planar mapping
+  vec2 texCoord3 = PlanarMappingZ(fragPObj);
+  vec4 color3 = BlinnPhong(fragN, fragL, fragV, texCoord3);
+
+  // Compute average based on normal
+  vec3 weight = abs(normalize(fragNObj));
+  color = color1 * weight.x + color2 * weight.y + color3 * weight.z;
+#ifdef CLUSTERED_LIGHTS
+  vec4 map_Kd = texture(diffuseTex, texCoord1) * weight.x +
+                texture(diffuseTex, texCoord2) * weight.y +
+                texture(diffuseTex, texCoord3) * weight.z;
+#endif
+#else
+#if MAPPING_MODE == 1
+  // Cylindrical mapping
+  vec2 texCoord = CylindricalMapping(fragPObj);
+#elif MAPPING_MODE == 2
+  // Spherical mapping
+  vec2 texCoord = SphericalMapping(fragPObj);
+#else
+  // From mesh
+  vec2 texCoord = fragTexCoord;
+#endif
+  color = BlinnPhong(fragN, fragL, fragV, texCoord);
+#ifdef CLUSTERED_LIGHTS
+  vec4 map_Kd = texture(diffuseTex, texCoord);
+#endif
+#endif
+
+#ifdef CLUSTERED_LIGHTS
+  // Point lights near the fragment
+  vec3 diffuse, specular;
+  accumulatePointLights(fragN, fragV, -fragV, shininess, diffuse, specular);
+  color.rgb += map_Kd.rgb * Kd.rgb * diffuse + Ks.rgb * specular;
+#endif
 
   if (gl_FrontFacing) {
     outColor = color;
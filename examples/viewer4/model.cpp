@@ -72,6 +72,34 @@ void Model::createBuffers() {
                      sizeof(m_indices[0]) * m_indices.size(), m_indices.data(),
                      GL_STATIC_DRAW);
   abcg::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+  // Position stream of the previous mesh, created again on demand
+  abcg::glDeleteBuffers(1, &m_positionVBO);
+  m_positionVBO = 0;
+}
+
+// Creates a VBO with only the positions of the vertices. A depth-only pass
+// fetches 12 bytes per vertex from it instead of the 32 bytes of Vertex
+void Model::createPositionStream() {
+  if (m_positionVBO != 0) return;
+
+  std::vector<glm::vec3> positions;
+  positions.reserve(m_vertices.size());
+  for (const auto& vertex : m_vertices) {
+    positions.push_back(vertex.position);
+  }
+
+  abcg::glGenBuffers(1, &m_positionVBO);
+  abcg::glBindBuffer(GL_ARRAY_BUFFER, m_positionVBO);
+  abcg::glBufferData(GL_ARRAY_BUFFER, sizeof(positions[0]) * positions.size(),
+                     positions.data(), GL_STATIC_DRAW);
+  abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+GLsizei Model::getNumIndices(int numTriangles) const {
+  const auto numIndices{(numTriangles < 0) ? m_indices.size()
+                                           : numTriangles * 3};
+  return static_cast<GLsizei>(numIndices);
 }
 
 void Model::loadDiffuseTexture(std::string_view path) {
@@ -210,16 +238,29 @@ void Model::render(int numTriangles) const {
   abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
   abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
-  const auto numIndices{(numTriangles < 0) ? m_indices.size()
-                                           : numTriangles * 3};
-
-  abcg::glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(numIndices),
+  abcg::glDrawElements(GL_TRIANGLES, getNumIndices(numTriangles),
                        GL_UNSIGNED_INT, nullptr);
 
   abcg::glBindVertexArray(0);
 }
 
+// Renders only the positions, with the VAO set up by setupDepthVAO()
+void Model::renderDepth(int numTriangles) const {
+  abcg::glBindVertexArray(m_depthVAO);
+  abcg::glDrawElements(GL_TRIANGLES, getNumIndices(numTriangles),
+                       GL_UNSIGNED_INT, nullptr);
+  abcg::glBindVertexArray(0);
+}
+
 void Model::setupVAO(GLuint program) {
+  // Programs that read only positions (e.g., the depth shader) use the
+  // position stream
+  if (abcg::glGetAttribLocation(program, "inNormal") < 0 &&
+      abcg::glGetAttribLocation(program, "inTexCoord") < 0) {
+    setupPositionVAO(m_VAO, program);
+    return;
+  }
+
   // Release previous VAO
   abcg::glDeleteVertexArrays(1, &m_VAO);
 
@@ -264,6 +305,39 @@ void Model::setupVAO(GLuint program) {
   abcg::glBindVertexArray(0);
 }
 
+// Sets up the VAO drawn by renderDepth()
+void Model::setupDepthVAO(GLuint program) {
+  setupPositionVAO(m_depthVAO, program);
+}
+
+// Sets up a VAO that reads only the positions, from the position stream
+void Model::setupPositionVAO(GLuint& vao, GLuint program) {
+  createPositionStream();
+
+  // Release previous VAO
+  abcg::glDeleteVertexArrays(1, &vao);
+
+  // Create VAO
+  abcg::glGenVertexArrays(1, &vao);
+  abcg::glBindVertexArray(vao);
+
+  // Bind EBO and position VBO
+  abcg::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+  abcg::glBindBuffer(GL_ARRAY_BUFFER, m_positionVBO);
+
+  const GLint positionAttribute{
+      abcg::glGetAttribLocation(program, "inPosition")};
+  if (positionAttribute >= 0) {
+    abcg::glEnableVertexAttribArray(positionAttribute);
+    abcg::glVertexAttribPointer(positionAttribute, 3, GL_FLOAT, GL_FALSE,
+                                sizeof(glm::vec3), nullptr);
+  }
+
+  // End of binding
+  abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
+  abcg::glBindVertexArray(0);
+}
+
 void Model::standardize() {
   // Center to origin and normalize largest bound to [-1, 1]
 
@@ -291,5 +365,7 @@ void Model::terminateGL() {
   abcg::glDeleteTextures(1, &m_diffuseTexture);
   abcg::glDeleteBuffers(1, &m_EBO);
   abcg::glDeleteBuffers(1, &m_VBO);
+  abcg::glDeleteBuffers(1, &m_positionVBO);
   abcg::glDeleteVertexArrays(1, &m_VAO);
+  abcg::glDeleteVertexArrays(1, &m_depthVAO);
 }
\ No newline at end of file
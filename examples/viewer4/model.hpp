@@ -23,7 +23,9 @@ class Model {
   void loadDiffuseTexture(std::string_view path);
   void loadObj(std::string_view path, bool standardize = true);
   void render(int numTriangles = -1) const;
+  void renderDepth(int numTriangles = -1) const;
   void setupVAO(GLuint program);
+  void setupDepthVAO(GLuint program);
   void terminateGL();
 
   [[nodiscard]] int getNumTriangles() const {
@@ -41,6 +43,10 @@ class Model {
   GLuint m_VAO{};
   GLuint m_VBO{};
   GLuint m_EBO{};
+  // Tightly packed copy of the positions, created for the programs that
+  // read only positions, and the VAO of the depth pre-pass
+  GLuint m_positionVBO{};
+  GLuint m_depthVAO{};
 
   glm::vec4 m_Ka;
   glm::vec4 m_Kd;
@@ -56,6 +62,9 @@ class Model {
 
   void computeNormals();
   void createBuffers();
+  void createPositionStream();
+  void setupPositionVAO(GLuint& vao, GLuint program);
+  [[nodiscard]] GLsizei getNumIndices(int numTriangles) const;
   void standardize();
 };
 
@@ -2,6 +2,7 @@
 
 #include <imgui.h>
 
+#include <cmath>
 #include <cppitertools/itertools.hpp>
 #include <glm/gtc/matrix_inverse.hpp>
 
@@ -41,28 +42,71 @@ void OpenGLWindow::initializeGL() {
   abcg::glClearColor(0, 0, 0, 1);
   abcg::glEnable(GL_DEPTH_TEST);
 
-  // Create programs
-  for (const auto& name : m_shaderNames) {
-    const auto path{getAssetsPath() + "shaders/" + name};
-    const auto program{createProgramFromFile(path + ".vert", path + ".frag")};
-    m_programs.push_back(program);
+  // Create programs. They are compiled in the background if the driver
+  // supports it, or on first use otherwise
+  m_mappingMode = 3;  // "From mesh" option
+  for (const auto index : iter::range(m_shaderNames.size())) {
+    const auto path{getAssetsPath() + "shaders/" + m_shaderNames.at(index)};
+    m_programs.emplace_back(
+        [this, path](const abcg::ShaderDefines& defines) {
+          return createProgramFromFileAsync(path + ".vert", path + ".frag",
+                                            defines);
+        });
+    getProgram(static_cast<int>(index));
   }
+  // The depth shader (the last one) is the simplest, so it is finished now
+  // to be shown while the selected program is not ready
+  m_fallbackProgram =
+      getProgram(static_cast<int>(m_shaderNames.size()) - 1).get();
+  const auto prePassPath{getAssetsPath() + "shaders/prepass"};
+  m_prePassProgram = createProgramFromFileAsync(prePassPath + ".vert",
+                                                prePassPath + ".frag");
+  m_frameData.initializeGL(0);
+  m_lightClusters.initializeGL();
 
   // Load default model
   loadModel(getAssetsPath() + "roman_lamp.obj");
-  m_mappingMode = 3;  // "From mesh" option
 
   // Initial trackball spin
   m_trackBallModel.setAxis(glm::normalize(glm::vec3(1, 1, 1)));
   m_trackBallModel.setVelocity(0.0001f);
 }
 
+// Returns the variant of a program for the current settings. The texture
+// shader is specialized for the selected mapping mode, and the lighting
+// shaders loop over the point lights if there are any
+abcg::AsyncProgram& OpenGLWindow::getProgram(int index) {
+  abcg::ShaderDefines defines;
+  if (std::string_view{m_shaderNames.at(index)} == "texture") {
+    defines.emplace_back("MAPPING_MODE", std::to_string(m_mappingMode));
+  }
+  if (index < 4 && m_numPointLights > 0) {
+    defines.emplace_back("CLUSTERED_LIGHTS", "1");
+  }
+  return m_programs.at(index).get(defines);
+}
+
+// Returns the variant of the selected program, looked up again only when
+// the selection, the mapping mode or the presence of point lights changed
+abcg::AsyncProgram& OpenGLWindow::getCurrentProgram() {
+  const ProgramSelection selection{.index = m_currentProgramIndex,
+                                   .mappingMode = m_mappingMode,
+                                   .clusteredLights = m_numPointLights > 0};
+  if (m_currentProgram == nullptr || selection != m_currentProgramSelection) {
+    m_currentProgram = &getProgram(m_currentProgramIndex);
+    m_currentProgramSelection = selection;
+  }
+  return *m_currentProgram;
+}
+
 void OpenGLWindow::loadModel(std::string_view path) {
   m_model.terminateGL();
 
   m_model.loadDiffuseTexture(getAssetsPath() + "maps/pattern.png");
   m_model.loadObj(path);
-  m_model.setupVAO(m_programs.at(m_currentProgramIndex));
+  // The VAO is set up by paintGL for the program in use
+  m_vaoProgram = 0;
+  m_prePassVAOProgram = 0;
   m_trianglesToDraw = m_model.getNumTriangles();
 
   // Use material properties from the loaded model
@@ -75,65 +119,105 @@ void OpenGLWindow::loadModel(std::string_view path) {
 void OpenGLWindow::paintGL() {
   update();
 
+  // Render targets cannot be empty (e.g., while the window is minimized)
+  if (m_viewportWidth <= 0 || m_viewportHeight <= 0) return;
+
+  // No pass reads the scene, so it is drawn straight to the default
+  // framebuffer. Passes that post-process it would have the scene pass
+  // create and write its color and depth textures instead.
+  m_frameGraph.addPass(
+      "Scene",
+      [](abcg::FrameGraph::Builder& builder) { builder.setSideEffects(); },
+      [this](const abcg::FrameGraph::Resources&) { renderScene(); });
+
+  m_frameGraph.execute();
+}
+
+void OpenGLWindow::renderScene() {
   abcg::glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-  abcg::glViewport(0, 0, m_viewportWidth, m_viewportHeight);
-
-  // Use currently selected program
-  const auto program{m_programs.at(m_currentProgramIndex)};
-  abcg::glUseProgram(program);
-
-  // Get location of uniform variables
-  const GLint viewMatrixLoc{abcg::glGetUniformLocation(program, "viewMatrix")};
-  const GLint projMatrixLoc{abcg::glGetUniformLocation(program, "projMatrix")};
-  const GLint modelMatrixLoc{
-      abcg::glGetUniformLocation(program, "modelMatrix")};
-  const GLint normalMatrixLoc{
-      abcg::glGetUniformLocation(program, "normalMatrix")};
-  const GLint lightDirLoc{
-      abcg::glGetUniformLocation(program, "lightDirWorldSpace")};
-  const GLint shininessLoc{abcg::glGetUniformLocation(program, "shininess")};
-  const GLint IaLoc{abcg::glGetUniformLocation(program, "Ia")};
-  const GLint IdLoc{abcg::glGetUniformLocation(program, "Id")};
-  const GLint IsLoc{abcg::glGetUniformLocation(program, "Is")};
-  const GLint KaLoc{abcg::glGetUniformLocation(program, "Ka")};
-  const GLint KdLoc{abcg::glGetUniformLocation(program, "Kd")};
-  const GLint KsLoc{abcg::glGetUniformLocation(program, "Ks")};
-  const GLint diffuseTexLoc{abcg::glGetUniformLocation(program, "diffuseTex")};
-  const GLint mappingModeLoc{
-      abcg::glGetUniformLocation(program, "mappingMode")};
-
-  // Set uniform variables used by every scene object
-  abcg::glUniformMatrix4fv(viewMatrixLoc, 1, GL_FALSE, &m_viewMatrix[0][0]);
-  abcg::glUniformMatrix4fv(projMatrixLoc, 1, GL_FALSE, &m_projMatrix[0][0]);
-  abcg::glUniform1i(diffuseTexLoc, 0);
-  abcg::glUniform1i(mappingModeLoc, m_mappingMode);
-
-  const auto lightDirRotated{m_trackBallLight.getRotation() * m_lightDir};
-  abcg::glUniform4fv(lightDirLoc, 1, &lightDirRotated.x);
-  abcg::glUniform4fv(IaLoc, 1, &m_Ia.x);
-  abcg::glUniform4fv(IdLoc, 1, &m_Id.x);
-  abcg::glUniform4fv(IsLoc, 1, &m_Is.x);
+
+  // Camera and light data, shared by every program through a uniform
+  // buffer bound to binding point 0
+  m_frameData.update({.viewMatrix = m_viewMatrix,
+                      .projMatrix = m_projMatrix,
+                      .lightDirWorldSpace =
+                          m_trackBallLight.getRotation() * m_lightDir,
+                      .Ia = m_Ia,
+                      .Id = m_Id,
+                      .Is = m_Is});
+
+  // Use currently selected program, if ready
+  auto& currentProgram{getCurrentProgram()};
+  auto program{currentProgram.isReady() ? currentProgram.get()
+                                        : m_fallbackProgram};
+
+  // Lay down the depth of the visible surfaces first, so that the lighting
+  // shaders run at most once per pixel
+  const auto prePass{m_depthPrePass && m_currentProgramIndex < 4 &&
+                     currentProgram.isReady() && m_prePassProgram.isReady()};
+  if (prePass) {
+    auto prePassProgram{m_prePassProgram.get()};
+    if (prePassProgram.getID() != m_prePassVAOProgram) {
+      abcg::bindUniformBlock(prePassProgram, "FrameData", 0);
+      m_model.setupDepthVAO(prePassProgram);
+      m_prePassVAOProgram = prePassProgram.getID();
+    }
+    prePassProgram.use();
+    prePassProgram.setUniform("modelMatrix", m_modelMatrix);
+
+    abcg::glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    m_model.renderDepth(m_trianglesToDraw);
+    abcg::glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+    // Shade only the fragments that are in the depth buffer
+    abcg::glDepthFunc(GL_EQUAL);
+    abcg::glDepthMask(GL_FALSE);
+  }
+
+  // Set up VAO if shader program has changed
+  if (program.getID() != m_vaoProgram) {
+    abcg::bindUniformBlock(program, "FrameData", 0);
+    m_model.setupVAO(program);
+    m_vaoProgram = program.getID();
+  }
+  program.use();
+
+  // Set uniform variables used by every scene object. Locations were
+  // queried when the program was created, and values that did not change
+  // since the last frame are not uploaded again
+  program.setUniform("diffuseTex", 0);
 
   // Set uniform variables of the current object
-  abcg::glUniformMatrix4fv(modelMatrixLoc, 1, GL_FALSE, &m_modelMatrix[0][0]);
+  program.setUniform("modelMatrix", m_modelMatrix);
 
   const auto modelViewMatrix{glm::mat3(m_viewMatrix * m_modelMatrix)};
-  glm::mat3 normalMatrix{glm::inverseTranspose(modelViewMatrix)};
-  abcg::glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, &normalMatrix[0][0]);
+  const glm::mat3 normalMatrix{glm::inverseTranspose(modelViewMatrix)};
+  program.setUniform("normalMatrix", normalMatrix);
 
-  abcg::glUniform1f(shininessLoc, m_shininess);
-  abcg::glUniform4fv(KaLoc, 1, &m_Ka.x);
-  abcg::glUniform4fv(KdLoc, 1, &m_Kd.x);
-  abcg::glUniform4fv(KsLoc, 1, &m_Ks.x);
+  program.setUniform("shininess", m_shininess);
+  program.setUniform("Ka", m_Ka);
+  program.setUniform("Kd", m_Kd);
+  program.setUniform("Ks", m_Ks);
+
+  // Point lights, on the texture units after the diffuse texture. Uniform
+  // variables not declared by the program are ignored
+  if (m_numPointLights > 0) m_lightClusters.bind(program, 1);
 
   m_model.render(m_trianglesToDraw);
 
+  if (prePass) {
+    abcg::glDepthFunc(GL_LESS);
+    abcg::glDepthMask(GL_TRUE);
+  }
+
   abcg::glUseProgram(0);
 }
 
 void OpenGLWindow::paintUI() {
   abcg::OpenGLWindow::paintUI();
 
+  m_frameGraph.paintUI();
+
   // File browser for models
   static ImGui::FileBrowser fileDialogModel;
   fileDialogModel.SetTitle("Load 3D Model");
@@ -155,7 +239,7 @@ void OpenGLWindow::paintUI() {
 
   // Create main window widget
   {
-    auto widgetSize{ImVec2(222, 190)};
+    auto widgetSize{ImVec2(222, 216)};
 
     if (!m_model.isUVMapped()) {
       // Add extra space for static text
@@ -198,6 +282,8 @@ void OpenGLWindow::paintUI() {
       abcg::glDisable(GL_CULL_FACE);
     }
 
+    ImGui::Checkbox("Depth pre-pass", &m_depthPrePass);
+
     // CW/CCW combo box
     {
       static std::size_t currentIndex{};
@@ -244,12 +330,12 @@ void OpenGLWindow::paintUI() {
       const auto aspect{static_cast<float>(m_viewportWidth) /
                         static_cast<float>(m_viewportHeight)};
       if (currentIndex == 0) {
-        m_projMatrix =
-            glm::perspective(glm::radians(45.0f), aspect, 0.1f, 5.0f);
+        m_projMatrix = glm::perspective(glm::radians(45.0f), aspect,
+                                        m_nearPlane, m_farPlane);
 
       } else {
-        m_projMatrix =
-            glm::ortho(-1.0f * aspect, 1.0f * aspect, -1.0f, 1.0f, 0.1f, 5.0f);
+        m_projMatrix = glm::ortho(-1.0f * aspect, 1.0f * aspect, -1.0f, 1.0f,
+                                  m_nearPlane, m_farPlane);
       }
     }
 
@@ -269,11 +355,8 @@ void OpenGLWindow::paintUI() {
       }
       ImGui::PopItemWidth();
 
-      // Set up VAO if shader program has changed
-      if (static_cast<int>(currentIndex) != m_currentProgramIndex) {
-        m_currentProgramIndex = currentIndex;
-        m_model.setupVAO(m_programs.at(m_currentProgramIndex));
-      }
+      // The VAO is set up again by paintGL once the program is ready
+      m_currentProgramIndex = static_cast<int>(currentIndex);
     }
 
     if (!m_model.isUVMapped()) {
@@ -306,7 +389,7 @@ void OpenGLWindow::paintUI() {
 
   // Create window for light sources
   if (m_currentProgramIndex < 4) {
-    const auto widgetSize{ImVec2(222, 244)};
+    const auto widgetSize{ImVec2(222, 270)};
     ImGui::SetNextWindowPos(ImVec2(m_viewportWidth - widgetSize.x - 5,
                                    m_viewportHeight - widgetSize.y - 5));
     ImGui::SetNextWindowSize(widgetSize);
@@ -321,6 +404,12 @@ void OpenGLWindow::paintUI() {
     ImGui::ColorEdit3("Is", &m_Is.x, ImGuiColorEditFlags_Float);
     ImGui::PopItemWidth();
 
+    // Slider to control the number of point lights
+    ImGui::PushItemWidth(widgetSize.x - 16);
+    ImGui::SliderInt("##lights", &m_numPointLights, 0, m_maxPointLights,
+                     "%d point lights");
+    ImGui::PopItemWidth();
+
     ImGui::Spacing();
 
     ImGui::Text("Material properties");
@@ -338,6 +427,8 @@ void OpenGLWindow::paintUI() {
     ImGui::PopItemWidth();
 
     ImGui::End();
+
+    if (m_numPointLights > 0) m_lightClusters.paintUI();
   }
 
   fileDialogModel.Display();
@@ -371,9 +462,14 @@ void OpenGLWindow::resizeGL(int width, int height) {
 
 void OpenGLWindow::terminateGL() {
   m_model.terminateGL();
-  for (const auto& program : m_programs) {
-    abcg::glDeleteProgram(program);
+  m_frameData.terminateGL();
+  m_lightClusters.terminateGL();
+  for (auto& program : m_programs) {
+    program.destroy();
   }
+  m_currentProgram = nullptr;
+  m_prePassProgram.destroy();
+  m_frameGraph.destroy();
 }
 
 void OpenGLWindow::update() {
@@ -382,4 +478,37 @@ void OpenGLWindow::update() {
   m_viewMatrix =
       glm::lookAt(glm::vec3(0.0f, 0.0f, 2.0f + m_zoom),
                   glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+  // Lights added with the slider get a random orbit and hue
+  std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+  while (m_orbitingLights.size() <
+         static_cast<std::size_t>(m_numPointLights)) {
+    const auto hue{distribution(m_randomEngine) * 6.0f};
+    const glm::vec3 color{
+        glm::clamp(glm::abs(hue - 3.0f) - 1.0f, 0.0f, 1.0f),
+        glm::clamp(2.0f - glm::abs(hue - 2.0f), 0.0f, 1.0f),
+        glm::clamp(2.0f - glm::abs(hue - 4.0f), 0.0f, 1.0f)};
+    m_orbitingLights.push_back(
+        {.distance = 0.3f + distribution(m_randomEngine) * 0.9f,
+         .height = distribution(m_randomEngine) * 1.6f - 0.8f,
+         .phase = glm::radians(distribution(m_randomEngine) * 360.0f),
+         .speed = distribution(m_randomEngine) * 2.0f - 1.0f,
+         .color = color});
+  }
+
+  const auto time{static_cast<float>(getElapsedTime())};
+  m_pointLights.clear();
+  for (const auto index : iter::range(m_numPointLights)) {
+    const auto& light{m_orbitingLights.at(index)};
+    const auto angle{light.phase + light.speed * time};
+    m_pointLights.push_back(
+        {.position = {light.distance * std::cos(angle), light.height,
+                      light.distance * std::sin(angle)},
+         .radius = 0.35f,
+         .color = light.color});
+  }
+  if (!m_pointLights.empty()) {
+    m_lightClusters.update(m_pointLights, m_viewMatrix, m_projMatrix,
+                           m_nearPlane, m_farPlane);
+  }
 }
\ No newline at end of file
@@ -1,10 +1,32 @@
 #ifndef OPENGLWINDOW_HPP_
 #define OPENGLWINDOW_HPP_
 
+#include <random>
+
 #include "abcg.hpp"
 #include "model.hpp"
 #include "trackball.hpp"
 
+// Layout of the FrameData uniform block (std140)
+struct FrameData {
+  glm::mat4 viewMatrix{1.0f};
+  glm::mat4 projMatrix{1.0f};
+  glm::vec4 lightDirWorldSpace{};
+  glm::vec4 Ia{};
+  glm::vec4 Id{};
+  glm::vec4 Is{};
+};
+
+// Point light circling the vertical axis
+struct OrbitingLight {
+  float distance{};
+  float height{};
+  float phase{};
+  // Radians per second
+  float speed{};
+  glm::vec3 color{};
+};
+
 class OpenGLWindow : public abcg::OpenGLWindow {
  protected:
   void handleEvent(SDL_Event& ev) override;
@@ -29,13 +51,36 @@ class OpenGLWindow : public abcg::OpenGLWindow {
   glm::mat4 m_viewMatrix{1.0f};
   glm::mat4 m_projMatrix{1.0f};
 
+  static constexpr float m_nearPlane{0.1f};
+  static constexpr float m_farPlane{5.0f};
+
   // Shaders
   std::vector<const char*> m_shaderNames{"texture", "blinnphong", "phong",
                                          "gouraud", "normal",     "depth"};
-  std::vector<GLuint> m_programs;
+  // Variants of each shader. The lighting shaders (the first four) have a
+  // variant with point lights, and the texture shader has one for each
+  // mapping mode
+  std::vector<abcg::ProgramVariants> m_programs;
   int m_currentProgramIndex{};
+  // Used while the selected program is compiled
+  abcg::Program m_fallbackProgram;
+  // Program for which the VAO of the model was set up
+  GLuint m_vaoProgram{};
 
-  // Mapping mode
+  // Depth pre-pass, drawing only the positions of the model before the
+  // lighting shaders shade the visible fragments with GL_EQUAL depth testing
+  bool m_depthPrePass{};
+  abcg::AsyncProgram m_prePassProgram;
+  GLuint m_prePassVAOProgram{};
+
+  // Camera and light data shared by every program
+  abcg::UniformBuffer<FrameData> m_frameData;
+
+  // Scene pass drawing to an offscreen target, and present pass copying it
+  // to the window
+  abcg::FrameGraph m_frameGraph;
+
+  // Mapping mode, set as the MAPPING_MODE macro of the texture shader
   // 0: triplanar; 1: cylindrical; 2: spherical; 3: from mesh
   int m_mappingMode{};
 
@@ -49,7 +94,30 @@ class OpenGLWindow : public abcg::OpenGLWindow {
   glm::vec4 m_Ks;
   float m_shininess{};
 
+  // Point lights, binned into clusters by the lighting shaders
+  static constexpr int m_maxPointLights{1024};
+  int m_numPointLights{};
+  std::vector<OrbitingLight> m_orbitingLights;
+  std::vector<abcg::PointLight> m_pointLights;
+  abcg::LightClusters m_lightClusters;
+  std::default_random_engine m_randomEngine;
+
+  // Settings the variant of the selected program depends on
+  struct ProgramSelection {
+    int index{-1};
+    int mappingMode{-1};
+    bool clusteredLights{};
+
+    bool operator==(const ProgramSelection&) const = default;
+  };
+  // Variant of the selected program, and the settings it was looked up for
+  abcg::AsyncProgram* m_currentProgram{};
+  ProgramSelection m_currentProgramSelection{};
+
+  abcg::AsyncProgram& getProgram(int index);
+  abcg::AsyncProgram& getCurrentProgram();
   void loadModel(std::string_view path);
+  void renderScene();
   void update();
 };
 